@@ -1,22 +1,95 @@
 
 #include "app_hal.h"
 #include "lvgl.h"
+#include "dlog.h"
+#include "trace.h"
+#include "fb_tiles.h"
+#include <esp_attr.h>
 
 
-/* include only one display settings */
-// #include "displays/lgfx_wt32sc01_plus.hpp"
-#include "displays/lgfx_elecrow_3_5.hpp"
+/* Board profile: panel, bus clock, draw buffer and touch settings together.
+ * Pick one with -D BOARD_<name> from its env in platformio.ini. */
+#if defined(BOARD_ELECROW_3_5)
+#include "displays/LGFX_ELECROW_3_5.hpp"
+#elif defined(BOARD_WT32SC01_PLUS)
+#include "displays/LGFX_WT32SC01_PLUS.hpp"
+#else
+#error "No board profile: add -D BOARD_ELECROW_3_5 or -D BOARD_WT32SC01_PLUS to the env"
+#endif
+
+/* Show the fill-rate benchmark screen at startup */
+#ifndef BOARD_BENCH
+#define BOARD_BENCH 0
+#endif
+#define BENCH_FILLS   20
+#define BENCH_FRAMES  20
+#define BENCH_HOLD_MS 5000
 
 
-static const uint32_t screenWidth = WIDTH;
-static const uint32_t screenHeight = HEIGHT;
+/* Panel rotation, LovyanGFX numbering (quarter turns, 0..3). The panel
+ * turns the picture itself through MADCTL, so LVGL renders straight at the
+ * rotated size and the flush path is unchanged. 1 runs the landscape
+ * instrument UI on the portrait panels. Touch follows the same rotation. */
+#ifndef BOARD_ROTATION
+#define BOARD_ROTATION 0
+#endif
+#if BOARD_ROTATION & 1
+#define BOARD_HOR_RES HEIGHT
+#define BOARD_VER_RES WIDTH
+#else
+#define BOARD_HOR_RES WIDTH
+#define BOARD_VER_RES HEIGHT
+#endif
+
+static const uint32_t screenWidth = BOARD_HOR_RES;
+static const uint32_t screenHeight = BOARD_VER_RES;
 
-const unsigned int lvBufferSize = screenWidth * 30;
-uint8_t lvBuffer[2][lvBufferSize];
+#if FB_L8
+/* L8: one byte per pixel, expanded to RGB565 a few rows at a time into
+ * two small bus buffers, so one is filled while the other is sent */
+#define L8_LINES 8
+const unsigned int lvBufferSize = screenWidth * BOARD_BUF_LINES;
+DMA_ATTR uint8_t lvBuffer[2][lvBufferSize];
+DMA_ATTR static uint16_t l8Line[2][BOARD_HOR_RES * L8_LINES];
+static uint16_t l8Lut[256];
+static uint32_t l8Next;
+#else
+/* RGB565: two bytes per pixel, in internal DMA-capable RAM */
+const unsigned int lvBufferSize = screenWidth * BOARD_BUF_LINES * 2;
+DMA_ATTR uint8_t lvBuffer[2][lvBufferSize];
+#endif
 
 static lv_display_t *lvDisplay;
 static lv_indev_t *lvInput;
 
+#if FB_TILES
+/* Only tiles that changed since the last frame go over the bus */
+#define TILES_LOG_FRAMES 256
+static uint32_t tileHash[FB_TILES_COUNT(BOARD_HOR_RES, BOARD_VER_RES)];
+static fb_tiles_t tiles;
+
+static void tiles_round_cb(lv_event_t *e)
+{
+  lv_area_t *area = (lv_area_t *)lv_event_get_param(e);
+  fb_rect_t rect = {area->x1, area->y1, area->x2, area->y2};
+
+  fb_tiles_round(&tiles, &rect);
+  lv_area_set(area, rect.x1, rect.y1, rect.x2, rect.y2);
+}
+
+static void tiles_frame_end(void)
+{
+  fb_tiles_frame_end(&tiles);
+  if (tiles.stats.frames % TILES_LOG_FRAMES == 0)
+  {
+    DLOG("flush: last frame %u of %u bytes sent, %u%% saved overall\n",
+         (unsigned)tiles.stats.frame_sent, (unsigned)tiles.stats.frame_bytes,
+         (unsigned)(tiles.stats.total_bytes
+                    ? 100 - tiles.stats.total_sent * 100 / tiles.stats.total_bytes : 0));
+  }
+}
+#endif
+
 #if LV_USE_LOG != 0
 static void lv_log_print_g_cb(lv_log_level_t level, const char *buf)
 {
@@ -25,25 +98,109 @@ static void lv_log_print_g_cb(lv_log_level_t level, const char *buf)
 }
 #endif
 
+#if FB_L8
+/* Expand one rectangle of the L8 area through the byte swapped table and
+ * send it. Rows are packed in the bus buffer, so narrow rectangles still
+ * go out in few transfers. pushImageDMA() waits for the previous transfer,
+ * which frees the buffer about to be refilled. */
+static void push_l8(const fb_rect_t *full, const fb_rect_t *rect, const uint8_t *data)
+{
+  int32_t stride = full->x2 - full->x1 + 1;
+  int32_t rw = rect->x2 - rect->x1 + 1;
+  int32_t lines = (BOARD_HOR_RES * L8_LINES) / rw;
+
+  for (int32_t y = rect->y1; y <= rect->y2; y += lines)
+  {
+    int32_t rh = (rect->y2 - y + 1 < lines) ? rect->y2 - y + 1 : lines;
+    uint16_t *buf = l8Line[l8Next];
+
+    l8Next ^= 1;
+    fb_l8_expand(buf, rw, data + fb_src_offset(full, rect, y), stride, rw, rh, l8Lut);
+    tft.pushImageDMA(rect->x1, y, rw, rh, buf);
+  }
+}
+#endif
+
 /* Display flushing */
 void my_disp_flush(lv_display_t *display, const lv_area_t *area, unsigned char *data)
 {
+  TRACE_SCOPE("my_disp_flush");
+
+#if FB_L8
+  fb_rect_t full = {area->x1, area->y1, area->x2, area->y2};
+
+  if (tft.getStartCount() == 0)
+  {
+    tft.endWrite();
+  }
+#if FB_TILES
+  fb_rect_t rect[FB_TILES_MAX_RECT];
+  uint32_t num = fb_tiles_diff(&tiles, &full, data, rect, FB_TILES_MAX_RECT);
 
+  for (uint32_t i = 0; i < num; i++)
+  {
+    push_l8(&full, &rect[i], data);
+  }
+
+  if (lv_display_flush_is_last(display))
+  {
+    tiles_frame_end();
+  }
+#else
+  push_l8(&full, &full, data);
+#endif
+#else
   uint32_t w = lv_area_get_width(area);
   uint32_t h = lv_area_get_height(area);
+
+#if FB_TILES
+  fb_rect_t full = {area->x1, area->y1, area->x2, area->y2};
+  fb_rect_t rect[FB_TILES_MAX_RECT];
+  uint32_t num = fb_tiles_diff(&tiles, &full, (const uint16_t *)data, rect, FB_TILES_MAX_RECT);
+#endif
+
   lv_draw_sw_rgb565_swap(data, w * h);
 
   if (tft.getStartCount() == 0)
   {
     tft.endWrite();
   }
+#if FB_TILES
+  for (uint32_t i = 0; i < num; i++)
+  {
+    const uint16_t *src = (const uint16_t *)data + fb_src_offset(&full, &rect[i], rect[i].y1);
+    int32_t rw = rect[i].x2 - rect[i].x1 + 1;
+    int32_t rh = rect[i].y2 - rect[i].y1 + 1;
+
+    if (rw == (int32_t)w)
+    {
+      tft.pushImageDMA(rect[i].x1, rect[i].y1, rw, rh, src);
+    }
+    else
+    {
+      /* Narrower than the buffer: rows are not contiguous */
+      for (int32_t row = 0; row < rh; row++)
+      {
+        tft.pushImageDMA(rect[i].x1, rect[i].y1 + row, rw, 1, src + row * w);
+      }
+    }
+  }
+
+  if (lv_display_flush_is_last(display))
+  {
+    tiles_frame_end();
+  }
+#else
   tft.pushImageDMA(area->x1, area->y1, area->x2 - area->x1 + 1, area->y2 - area->y1 + 1, (uint16_t *)data);
+#endif
+#endif /* FB_L8 */
   lv_display_flush_ready(display); /* tell lvgl that flushing is done */
 }
 
 /*Read the touchpad*/
 void my_touchpad_read(lv_indev_t *indev_driver, lv_indev_data_t *data)
 {
+  TRACE_SCOPE("my_touchpad_read");
   uint16_t touchX, touchY;
   bool touched = tft.getTouch(&touchX, &touchY);
   if (!touched)
@@ -65,6 +222,70 @@ static uint32_t my_tick(void)
   return millis();
 }
 
+#if BOARD_BENCH
+/* Achieved fill rate, raw through the bus and through LVGL's flush path,
+ * against the bus peak of BOARD_BUS_HZ * BOARD_BUS_BITS / 16 pixels/s. */
+static void board_bench(void)
+{
+  uint32_t pixels = screenWidth * screenHeight;
+  uint32_t peak_kpix = (uint32_t)((uint64_t)BOARD_BUS_HZ * BOARD_BUS_BITS / 16 / 1000);
+  uint32_t start;
+  uint32_t raw_us;
+  uint32_t lv_us;
+  uint32_t raw_kpix;
+  uint32_t lv_kpix;
+
+  tft.waitDMA();
+  start = micros();
+  for (int i = 0; i < BENCH_FILLS; i++)
+  {
+    tft.fillScreen((i & 1) ? TFT_BLACK : TFT_WHITE);
+  }
+  raw_us = micros() - start;
+#if FB_TILES
+  fb_tiles_reset(&tiles); /* The panel no longer shows LVGL's last frame */
+#endif
+
+  lv_obj_t *app_screen = lv_screen_active();
+  lv_obj_t *screen = lv_obj_create(NULL);
+  lv_obj_t *label = lv_label_create(screen);
+  lv_screen_load(screen);
+
+  start = micros();
+  for (int i = 0; i < BENCH_FRAMES; i++)
+  {
+    lv_obj_set_style_bg_color(screen, (i & 1) ? lv_color_black() : lv_color_white(), 0);
+    lv_obj_invalidate(screen);
+    lv_refr_now(lvDisplay);
+  }
+  tft.waitDMA();
+  lv_us = micros() - start;
+
+  raw_kpix = (uint32_t)((uint64_t)pixels * BENCH_FILLS * 1000 / raw_us);
+  lv_kpix = (uint32_t)((uint64_t)pixels * BENCH_FRAMES * 1000 / lv_us);
+
+  /* No float printing in lv_snprintf: values are in kpixel/s */
+  lv_obj_set_style_bg_color(screen, lv_color_white(), 0);
+  lv_obj_center(label);
+  lv_label_set_text_fmt(label,
+                        "%s\n"
+                        "bus %lu kHz x %d bit, peak %lu kpix/s\n"
+                        "raw fill %lu kpix/s (%lu%%)\n"
+                        "LVGL %lu kpix/s, %lu fps\n"
+                        "buffer %d lines",
+                        BOARD_NAME,
+                        (unsigned long)(BOARD_BUS_HZ / 1000), BOARD_BUS_BITS, (unsigned long)peak_kpix,
+                        (unsigned long)raw_kpix, (unsigned long)(raw_kpix * 100 / peak_kpix),
+                        (unsigned long)lv_kpix, (unsigned long)(lv_kpix / (pixels / 1000)),
+                        BOARD_BUF_LINES);
+  lv_refr_now(lvDisplay);
+  delay(BENCH_HOLD_MS);
+
+  lv_screen_load(app_screen);
+  lv_obj_delete(screen);
+}
+#endif
+
 void hal_setup(void)
 {
 
@@ -74,27 +295,60 @@ void hal_setup(void)
   tft.startWrite();
   tft.fillScreen(TFT_BLACK);
 
-  /* Set display rotation to landscape */
-  // tft.setRotation(1);
+  /* Rotate in the panel (MADCTL), before LVGL takes the size */
+  tft.setRotation(BOARD_ROTATION);
 
   /* Set the tick callback */
   lv_tick_set_cb(my_tick);
 
   /* Create LVGL display and set the flush function */
   lvDisplay = lv_display_create(screenWidth, screenHeight);
+#if FB_L8
+  static const uint32_t palette[] = FB_L8_PALETTE;
+  if (fb_l8_lut(l8Lut, palette, sizeof(palette) / sizeof(palette[0]), 1) != 0)
+  {
+    DLOG("flush: L8 palette has colors of equal luminance\n");
+  }
+  lv_display_set_color_format(lvDisplay, LV_COLOR_FORMAT_L8);
+#else
   lv_display_set_color_format(lvDisplay, LV_COLOR_FORMAT_RGB565);
+#endif
   lv_display_set_flush_cb(lvDisplay, my_disp_flush);
   lv_display_set_buffers(lvDisplay, lvBuffer[0], lvBuffer[1], lvBufferSize, LV_DISPLAY_RENDER_MODE_PARTIAL);
+#if FB_TILES
+  fb_tiles_init(&tiles, screenWidth, screenHeight, tileHash);
+  tiles.px_bytes = FB_L8 ? 1 : 2;
+  lv_display_add_event_cb(lvDisplay, tiles_round_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+#endif
 
   /* Set the touch input function */
   lvInput = lv_indev_create();
   lv_indev_set_type(lvInput, LV_INDEV_TYPE_POINTER);
   lv_indev_set_read_cb(lvInput, my_touchpad_read);
+  lv_timer_set_period(lv_indev_get_read_timer(lvInput), BOARD_TOUCH_READ_MS);
+
+#if BOARD_BENCH
+  board_bench();
+#endif
+}
+
+int hal_audio_start(uint32_t sample_rate, uint32_t frames, hal_audio_cb_t cb, void *user)
+{
+  /* No I2S codec wired on the supported boards yet */
+  LV_UNUSED(sample_rate);
+  LV_UNUSED(frames);
+  LV_UNUSED(cb);
+  LV_UNUSED(user);
+  return 0;
 }
 
 void hal_loop(void)
 {
   /* NO while loop in this function! (handled by framework) */
-  lv_timer_handler(); // Update the UI-
+  {
+    TRACE_SCOPE("lv_timer_handler");
+    lv_timer_handler(); // Update the UI-
+  }
+  dlog_flush();       // Deferred log output, in idle time
   delay(5);
 }
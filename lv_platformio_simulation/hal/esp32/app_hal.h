@@ -1,6 +1,8 @@
 #ifndef APP_HAL_H
 #define APP_HAL_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -19,6 +21,17 @@ void hal_setup(void);
  */
 void hal_loop(void);
 
+/**
+ * Audio render callback: fill `frames` interleaved stereo 16-bit samples.
+ */
+typedef void (*hal_audio_cb_t)(void *user, int16_t *out, uint32_t frames);
+
+/**
+ * Start the audio output, pulling blocks of `frames` from `cb`.
+ * Returns 0 when the board has no audio output.
+ */
+int hal_audio_start(uint32_t sample_rate, uint32_t frames, hal_audio_cb_t cb, void *user);
+
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -5,16 +5,34 @@
 
 
 /**
- * Recommended board settings for platformio.ini file
- * 
+ * Board profile, selected with -D BOARD_ELECROW_3_5 (env:esp32_elecrow_3_5)
+ *
  * board = esp32-s3-devkitc-1
  * board_build.partitions = max_app_8MB.csv
- * 
+ *
+ * ILI9488 on a 16-bit i80 bus: one pixel per write cycle, 40 MHz known
+ * good. To tune, override BOARD_BUS_HZ in the env, build with BOARD_BENCH=1
+ * and keep the highest rate that shows no corrupted fills.
  */
 
 #define WIDTH 320
 #define HEIGHT 480
 
+#define BOARD_NAME          "Elecrow 3.5\" ILI9488"
+#ifndef BOARD_BUS_HZ
+#define BOARD_BUS_HZ        40000000
+#endif
+#define BOARD_BUS_BITS      16
+#ifndef BOARD_BUF_LINES
+#define BOARD_BUF_LINES     40
+#endif
+#ifndef BOARD_TOUCH_I2C_HZ
+#define BOARD_TOUCH_I2C_HZ  400000
+#endif
+#ifndef BOARD_TOUCH_READ_MS
+#define BOARD_TOUCH_READ_MS 10
+#endif
+
 class LGFX : public lgfx::LGFX_Device
 {
 
@@ -33,7 +51,7 @@ public:
             auto cfg = _bus_instance.config();
 
             cfg.port = 0;
-            cfg.freq_write = 40000000;
+            cfg.freq_write = BOARD_BUS_HZ;
             cfg.pin_wr = 18;  // pin number connecting WR
             cfg.pin_rd = 48;  // pin number connecting RD
             cfg.pin_rs = 45;  // Pin number connecting RS(D/C)
@@ -111,7 +129,7 @@ public:
           cfg.i2c_addr = 0x38; // I2C device address number
           cfg.pin_sda = 38;     // pin number where SDA is connected
           cfg.pin_scl = 39;     // pin number to which SCL is connected
-          cfg.freq = 400000;   // set I2C clock
+          cfg.freq = BOARD_TOUCH_I2C_HZ; // set I2C clock
 
           _touch_instance.config(cfg);
           _panel_instance.setTouch(&_touch_instance); // Set the touchscreen to the panel.
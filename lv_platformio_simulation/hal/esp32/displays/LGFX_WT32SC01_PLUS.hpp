@@ -4,15 +4,28 @@
 
 
 /**
- * Recommended board settings for platformio.ini file
- * 
+ * Board profile, selected with -D BOARD_WT32SC01_PLUS (env:esp32_wt32sc01_plus)
+ *
  * board = esp32-s3-devkitm-1
- * 
+ *
+ * ST7796 on an 8-bit i80 bus: two write cycles per pixel. PanelLan sets
+ * up the bus and touch itself, so BOARD_BUS_HZ only documents its rate for
+ * the fill-rate benchmark.
  */
 
 #define WIDTH 320
 #define HEIGHT 480
 
+#define BOARD_NAME          "WT32-SC01 Plus ST7796"
+#define BOARD_BUS_HZ        40000000
+#define BOARD_BUS_BITS      8
+#ifndef BOARD_BUF_LINES
+#define BOARD_BUF_LINES     40
+#endif
+#ifndef BOARD_TOUCH_READ_MS
+#define BOARD_TOUCH_READ_MS 10
+#endif
+
 
 /* Set the board type. (Uses LovyanGFX internally to manage display drivers) */
 PanelLan tft(BOARD_SC01_PLUS);
@@ -4,6 +4,43 @@
 #include "drivers/sdl/lv_sdl_mouse.h"
 #include "drivers/sdl/lv_sdl_mousewheel.h"
 #include "drivers/sdl/lv_sdl_keyboard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "app_hal.h"
+#include "trace.h"
+#include "dlog.h"
+#include "resample.h"
+
+/* Virtual clock (HAL_SIM_CLOCK=1): every loop iteration advances LVGL ticks
+ * and the audio clock by HAL_SIM_STEP_MS, as fast as the host can go, so
+ * runs are deterministic and an hour of UI takes seconds. Audio is rendered
+ * by the loop instead of the sound card; the run stops after
+ * HAL_SIM_SECONDS (0 = never) and prints a checksum of the audio to compare
+ * commits. HAL_SIM_TAP_MS adds a scripted finger tapping the screen.
+ * With SDL_VIDEODRIVER=dummy no window is opened. */
+#ifndef HAL_SIM_CLOCK
+#define HAL_SIM_CLOCK 0
+#endif
+#ifndef HAL_SIM_STEP_MS
+#define HAL_SIM_STEP_MS 5
+#endif
+#ifndef HAL_SIM_SECONDS
+#define HAL_SIM_SECONDS 0
+#endif
+#ifndef HAL_SIM_TAP_MS
+#define HAL_SIM_TAP_MS 0
+#endif
+
+/* The engine renders at its own rate and the sound card runs at the rate it
+ * prefers (or HAL_AUDIO_RATE, 0 = the engine's); when they differ the
+ * resampler in lib/resample converts, at HAL_RESAMPLE_QUALITY. */
+#ifndef HAL_AUDIO_RATE
+#define HAL_AUDIO_RATE 0
+#endif
+#ifndef HAL_RESAMPLE_QUALITY
+#define HAL_RESAMPLE_QUALITY RESAMPLE_GOOD
+#endif
 
 
 
@@ -12,6 +49,22 @@ static lv_display_t *lvDisplay;
 static lv_indev_t *lvMouse;
 static lv_indev_t *lvMouseWheel;
 static lv_indev_t *lvKeyboard;
+static SDL_AudioDeviceID audioDevice;
+static hal_audio_cb_t audioCb;
+static void *audioUser;
+static resample_t audioResample;
+static int audioResampling;
+
+#if HAL_SIM_CLOCK
+/* Virtual clock: the loop owns time, audio is pulled instead of pushed */
+static uint32_t simRate;
+static uint32_t simBlock;
+static uint64_t simFrames;
+static uint32_t simHash = 2166136261u;
+static int16_t simBuf[2 * 1024];
+static uint32_t simNow;
+static uint32_t simSeed = 1;
+#endif
 
 
 #if LV_USE_LOG != 0
@@ -22,6 +75,40 @@ static void lv_log_print_g_cb(lv_log_level_t level, const char * buf)
 }
 #endif
 
+#if TRACE_ENABLE
+/* One slice per display refresh; the SDL flush happens inside it */
+static void refr_trace_cb(lv_event_t * e)
+{
+    if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+        TRACE_BEGIN("lv_refr");
+    } else {
+        TRACE_END("lv_refr");
+    }
+}
+#endif
+
+#if HAL_SIM_CLOCK && HAL_SIM_TAP_MS
+/* Scripted finger: a tap at a pseudo-random point every HAL_SIM_TAP_MS,
+ * held for half of it. Same seed, same taps, same run. */
+static void sim_touch_read(lv_indev_t * indev, lv_indev_data_t * data)
+{
+    static uint32_t tapIndex = UINT32_MAX;
+    static lv_point_t tapPoint;
+    LV_UNUSED(indev);
+
+    if (simNow / HAL_SIM_TAP_MS != tapIndex) {
+        tapIndex = simNow / HAL_SIM_TAP_MS;
+        simSeed = simSeed * 1664525u + 1013904223u;
+        tapPoint.x = (int32_t)((simSeed >> 8) % SDL_HOR_RES);
+        tapPoint.y = (int32_t)((simSeed >> 20) % SDL_VER_RES);
+    }
+
+    data->point = tapPoint;
+    data->state = (simNow % HAL_SIM_TAP_MS < HAL_SIM_TAP_MS / 2) ? LV_INDEV_STATE_PRESSED
+                                                                : LV_INDEV_STATE_RELEASED;
+}
+#endif
+
 
 void hal_setup(void)
 {
@@ -43,8 +130,140 @@ void hal_setup(void)
     lvMouse = lv_sdl_mouse_create();
     lvMouseWheel = lv_sdl_mousewheel_create();
     lvKeyboard = lv_sdl_keyboard_create();
+
+    #if TRACE_ENABLE
+    lv_display_add_event_cb(lvDisplay, refr_trace_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(lvDisplay, refr_trace_cb, LV_EVENT_REFR_READY, NULL);
+    #endif
+
+    #if HAL_SIM_CLOCK
+    /* LVGL must not read SDL_GetTicks behind our back */
+    lv_tick_set_cb(NULL);
+    #if HAL_SIM_TAP_MS
+    lv_indev_t *simTouch = lv_indev_create();
+    lv_indev_set_type(simTouch, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(simTouch, sim_touch_read);
+    #endif
+    #endif
 }
 
+static void sdl_audio_cb(void *userdata, Uint8 *stream, int len)
+{
+    LV_UNUSED(userdata);
+    TRACE_THREAD("audio");
+    if (audioResampling) {
+        resample_pull(&audioResample, audioCb, audioUser, (int16_t *)stream,
+                      (uint32_t)len / (2 * sizeof(int16_t)));
+    } else {
+        audioCb(audioUser, (int16_t *)stream, (uint32_t)len / (2 * sizeof(int16_t)));
+    }
+}
+
+int hal_audio_start(uint32_t sample_rate, uint32_t frames, hal_audio_cb_t cb, void *user)
+{
+    SDL_AudioSpec want;
+    SDL_AudioSpec have;
+
+    #if HAL_SIM_CLOCK
+    /* No device: hal_loop renders exactly the frames each step is worth */
+    audioCb = cb;
+    audioUser = user;
+    simRate = sample_rate;
+    simBlock = (frames > 0 && frames <= 1024) ? frames : 1024;
+    return 1;
+    #endif
+
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+        return 0;
+    }
+
+    /* Interleaved stereo S16, SDL converts the format if the device wants
+     * otherwise; the rate is left to the device and converted here */
+    SDL_zero(want);
+    want.freq = HAL_AUDIO_RATE ? HAL_AUDIO_RATE : sample_rate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples = frames;
+    want.callback = sdl_audio_cb;
+
+    audioCb = cb;
+    audioUser = user;
+    audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (audioDevice == 0) {
+        return 0;
+    }
+
+    if ((uint32_t)have.freq != sample_rate) {
+        if (!resample_init(&audioResample, sample_rate, (uint32_t)have.freq, HAL_RESAMPLE_QUALITY)) {
+            /* Too far apart for the resampler: let SDL convert */
+            SDL_CloseAudioDevice(audioDevice);
+            want.freq = sample_rate;
+            audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+            if (audioDevice == 0) {
+                return 0;
+            }
+        } else {
+            /* Deferred log from C: the arguments as raw 64-bit words */
+            double passHz = resample_pass_hz(&audioResample);
+            uint64_t arg[4] = {sample_rate, (uint64_t)(int64_t)have.freq,
+                               audioResample.taps, 0};
+
+            audioResampling = 1;
+            memcpy(&arg[3], &passHz, sizeof(passHz));
+            dlog_write("audio: engine %u Hz, device %d Hz, resampled (%u taps, %.0f Hz passband)\n",
+                       4, arg);
+        }
+    }
+
+    SDL_PauseAudioDevice(audioDevice, 0);
+    return 1;
+}
+
+#if HAL_SIM_CLOCK
+/* Render the audio of one step and fold it into the run's checksum */
+static void sim_audio_step(void)
+{
+    /* Frames due by the end of the step, from the absolute time: no drift */
+    uint64_t due = (uint64_t)simNow * simRate / 1000u;
+
+    while (audioCb != NULL && simFrames < due) {
+        uint32_t frames = (due - simFrames > simBlock) ? simBlock : (uint32_t)(due - simFrames);
+        const uint8_t *bytes = (const uint8_t *)simBuf;
+
+        audioCb(audioUser, simBuf, frames);
+        for (uint32_t idx = 0; idx < frames * 2 * sizeof(int16_t); ++idx) {
+            simHash = (simHash ^ bytes[idx]) * 16777619u;
+        }
+        simFrames += frames;
+    }
+}
+
+void hal_loop(void)
+{
+    const uint32_t endMs = HAL_SIM_SECONDS * 1000u;
+    Uint32 wallStart = SDL_GetTicks();
+
+    while (endMs == 0 || simNow < endMs) {
+        simNow += HAL_SIM_STEP_MS;
+        lv_tick_inc(HAL_SIM_STEP_MS);
+        sim_audio_step();
+        TRACE_BEGIN("lv_timer_handler");
+        lv_timer_handler();
+        TRACE_END("lv_timer_handler");
+    }
+
+    Uint32 wall = SDL_GetTicks() - wallStart;
+    printf("sim: %u s simulated in %u.%03u s wall (x%u), %llu audio frames, hash %08x\n",
+           (unsigned)(simNow / 1000u), (unsigned)(wall / 1000u), (unsigned)(wall % 1000u),
+           (unsigned)(simNow / (wall ? wall : 1)), (unsigned long long)simFrames,
+           (unsigned)simHash);
+
+    /* Let the log thread drain, then exit so the trace is saved */
+    SDL_Delay(100);
+    dlog_flush();
+    exit(0);
+}
+#else
 void hal_loop(void)
 {
     Uint32 lastTick = SDL_GetTicks();
@@ -53,6 +272,9 @@ void hal_loop(void)
         Uint32 current = SDL_GetTicks();
         lv_tick_inc(current - lastTick); // Update the tick timer. Tick is new for LVGL 9
         lastTick = current;
+        TRACE_BEGIN("lv_timer_handler");
         lv_timer_handler(); // Update the UI-
+        TRACE_END("lv_timer_handler");
     }
 }
+#endif
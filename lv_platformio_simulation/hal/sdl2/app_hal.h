@@ -1,6 +1,8 @@
 #ifndef DRIVER_H
 #define DRIVER_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -9,6 +11,9 @@ extern "C" {
 void hal_setup(void);
 void hal_loop(void);
 
+typedef void (*hal_audio_cb_t)(void *user, int16_t *out, uint32_t frames);
+int hal_audio_start(uint32_t sample_rate, uint32_t frames, hal_audio_cb_t cb, void *user);
+
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -1,13 +1,43 @@
 
 #include "stm32f4xx.h"
 #include "stm32f429i_discovery.h"
+#include "app_hal.h"
 #include "tft.h"
 #include "touchpad.h"
+#include "dlog.h"
+#include "trace.h"
+#include "perf.h"
+#include "budget.h"
 
 #ifdef USE_RTOS_SYSTICK
 #include <cmsis_os.h>
 #endif
 
+/* Audio and LVGL share the one core in hal_loop(): blocks are rendered on the
+ * sample clock at the top of the loop and while a refresh waits for its DMA,
+ * and LVGL runs only when the CPU budget (lib/budget) says it fits */
+#ifndef HAL_AUDIO_QUEUE
+#define HAL_AUDIO_QUEUE 2               /* Blocks buffered ahead of the codec */
+#endif
+#define HAL_AUDIO_MAX_FRAMES 256
+#define HAL_BUDGET_LOG_MS 5000
+
+static hal_audio_cb_t audioCb;
+static void *audioUser;
+static uint32_t audioRate;
+static uint32_t audioFrames;
+static uint32_t audioBlocks;            /* Rendered since hal_audio_start() */
+static uint64_t audioStartUs;
+static int16_t audioBuf[2 * HAL_AUDIO_MAX_FRAMES];
+
+static budget_t budget;
+static uint32_t uiStallUs;              /* Longest stretch of this pass without audio */
+static uint32_t uiMark;
+
+static uint64_t clockUs;                /* The cycle counter, extended to 64 bits */
+static uint32_t clockTicks;
+static uint32_t clockRem;
+
 
 /**
   * @brief  System Clock Configuration
@@ -85,6 +115,62 @@ static void SystemClock_Config(void)
 }
 
 
+/* Microseconds since boot; called at least every few ms, far below the
+ * 23 s the cycle counter takes to wrap */
+static uint64_t hal_now_us(void)
+{
+    uint32_t ticks = perf_ticks();
+
+    clockRem += ticks - clockTicks;
+    clockTicks = ticks;
+    clockUs += clockRem / PERF_TICKS_PER_US;
+    clockRem %= PERF_TICKS_PER_US;
+    return clockUs;
+}
+
+
+/* When block `block` is in on the sample clock; the codec plays it
+ * HAL_AUDIO_QUEUE blocks later */
+static uint64_t hal_block_us(uint32_t block)
+{
+    return audioStartUs + (uint64_t)block * audioFrames * 1000000u / audioRate;
+}
+
+
+/* Render every block that is in. The discovery board has no codec, so the
+ * samples go nowhere, but the engine's load on the core is the real one */
+static void hal_audio_service(void)
+{
+    if (audioCb == NULL) {
+        return;
+    }
+
+    while (hal_block_us(audioBlocks) <= hal_now_us()) {
+        uint32_t start = perf_ticks();
+
+        audioCb(audioUser, audioBuf, audioFrames);
+        budget_audio_done(&budget, perf_ticks_to_ns(perf_ticks() - start) / 1000u,
+                          hal_now_us() > hal_block_us(audioBlocks + HAL_AUDIO_QUEUE));
+        audioBlocks++;
+    }
+}
+
+
+/* Between the flushed chunks of a refresh: end the current stretch of UI
+ * work, let the audio catch up and start the next one */
+static void hal_flush_wait(void)
+{
+    uint32_t now = perf_ticks();
+    uint32_t us = perf_ticks_to_ns(now - uiMark) / 1000u;
+
+    if (us > uiStallUs) {
+        uiStallUs = us;
+    }
+    hal_audio_service();
+    uiMark = perf_ticks();
+}
+
+
 void hal_setup(void)
 {
     HAL_Init();
@@ -98,6 +184,9 @@ void hal_setup(void)
 
   	tft_init();
   	touchpad_init();
+
+  	perf_init();
+  	tft_set_wait_hook(hal_flush_wait);
 }
 
 
@@ -114,10 +203,107 @@ void SysTick_Handler(void)
 }
 
 
+int hal_audio_start(uint32_t sample_rate, uint32_t frames, hal_audio_cb_t cb, void *user)
+{
+    budget_cfg_t cfg;
+
+    if (cb == NULL || sample_rate == 0 || frames == 0) {
+        return 0;
+    }
+
+    /* The discovery board has no audio codec: the engine still runs in
+     * hal_loop(), so the UI is scheduled against its real load. That is
+     * rendering started as far as the caller is concerned. */
+    audioRate = sample_rate;
+    audioFrames = (frames > HAL_AUDIO_MAX_FRAMES) ? HAL_AUDIO_MAX_FRAMES : frames;
+    audioUser = user;
+    audioBlocks = 0;
+    audioStartUs = hal_now_us();
+    budget_cfg_default(&cfg, sample_rate, audioFrames);
+    budget_init(&budget, &cfg);
+    audioCb = cb;
+    return 1;
+}
+
+
+/* Stretch the display refresh with the audio load */
+static void hal_budget_period(void)
+{
+    static uint32_t period;
+    lv_display_t * disp = lv_display_get_default();
+
+    if (audioCb != NULL && disp != NULL && period != budget_refr_ms(&budget)) {
+        period = budget_refr_ms(&budget);
+        lv_timer_set_period(lv_display_get_refr_timer(disp), period);
+    }
+}
+
+
+/* Deferred frames and late blocks, every few seconds while audio runs */
+static void hal_budget_log(void)
+{
+    static uint32_t lastMs;
+    budget_stats_t stats;
+
+    if (audioCb == NULL || HAL_GetTick() - lastMs < HAL_BUDGET_LOG_MS) {
+        return;
+    }
+    lastMs = HAL_GetTick();
+    budget_get_stats(&budget, &stats);
+    {
+        const uint64_t arg[6] = {stats.load_pct, stats.ui_us, stats.level,
+                                 stats.deferred, stats.forced, stats.late};
+
+        dlog_write("budget: audio %u%%, ui %u us, level %u, %u deferred, %u forced, %u late\n",
+                   6, arg);
+    }
+}
+
+
+/* Ask the budget whether a pass fits before the next block is due */
+static int hal_ui_may_run(void)
+{
+    uint64_t now;
+    uint64_t due;
+
+    if (audioCb == NULL) {
+        return 1;
+    }
+    now = hal_now_us();
+    due = hal_block_us(audioBlocks + HAL_AUDIO_QUEUE);
+    return budget_ui_begin(&budget, (due > now) ? (uint32_t)(due - now) : 0);
+}
+
+
 void hal_loop(void)
 {
+    uint32_t uiDue = HAL_GetTick();
+
+    /* Touch is serviced every millisecond and audio whenever a block is in;
+     * LVGL runs when its next timer is due and the budget lets it */
     while(1) {
-        HAL_Delay(5);
-    		lv_task_handler();
+        HAL_Delay(1);
+        touchpad_service();
+        hal_audio_service();
+
+        if ((int32_t)(HAL_GetTick() - uiDue) >= 0) {
+            if (hal_ui_may_run()) {
+                uint32_t idle;
+
+                uiStallUs = 0;
+                uiMark = perf_ticks();
+                TRACE_BEGIN("lv_task_handler");
+                idle = lv_task_handler();
+                TRACE_END("lv_task_handler");
+                hal_flush_wait();
+                budget_ui_done(&budget, uiStallUs);
+
+                /* LV_NO_TIMER_READY when nothing is scheduled */
+                uiDue = HAL_GetTick() + ((idle > LV_DEF_REFR_PERIOD) ? LV_DEF_REFR_PERIOD : idle);
+            }
+            hal_budget_period();
+        }
+        hal_budget_log();
+        dlog_flush();
     }
 }
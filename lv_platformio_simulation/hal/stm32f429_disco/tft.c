@@ -10,6 +10,8 @@
 
 #include "tft.h"
 #include <lvgl.h>
+#include "fb_tiles.h"
+#include "trace.h"
 #include "stm32f4xx.h"
 #include "stm32f429i_discovery_lcd.h"
 #include "ili9341.h"
@@ -20,7 +22,16 @@
 
 #define SDRAM_BANK_ADDR ((uint32_t)0xD0000000)
 
+#if FB_L8
+/*LVGL draws one luminance byte per pixel, DMA2D expands it through its CLUT*/
+#define LV_BUFFER_SIZE  (TFT_HOR_RES * TFT_VER_RES / 8)
+#else
 #define LV_BUFFER_SIZE  (TFT_HOR_RES * TFT_VER_RES / 8 * (LV_COLOR_DEPTH / 8))
+#endif
+
+#if FB_L8 && TFT_ROTATION != 0
+#error "FB_L8 needs TFT_ROTATION 0: DMA2D expands the pixels but cannot rotate them"
+#endif
 
 #define DMA_STREAM DMA2_Stream0
 #define DMA_CHANNEL DMA_CHANNEL_0
@@ -36,6 +47,10 @@
  **********************/
 
 static void tft_flush(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map);
+static void tft_flush_wait(lv_display_t * disp);
+#if FB_TILES
+static void tiles_round_cb(lv_event_t * e);
+#endif
 
 /**********************
  *  STATIC VARIABLES
@@ -54,19 +69,40 @@ static uint16_t my_fb[TFT_HOR_RES * TFT_VER_RES];
 
 /*DMA to flush to frame buffer*/
 static void DMA_Config(void);
+static void DMA_StartRow(DMA_HandleTypeDef *han);
 static void DMA_TransferComplete(DMA_HandleTypeDef *han);
 static void DMA_TransferError(DMA_HandleTypeDef *han);
 
+#if FB_L8
+/*DMA2D to expand L8 to RGB565 into the frame buffer*/
+static void DMA2D_L8_Config(void);
+static void DMA2D_L8_StartRect(void);
+static void DMA2D_L8_TransferComplete(DMA2D_HandleTypeDef *han);
+
+static DMA2D_HandleTypeDef Dma2dL8Handle;
+static uint32_t l8_clut[256];
+#endif
+
 DMA_HandleTypeDef DmaHandle;
 static lv_display_t * lvDisplay;
 
 static uint8_t lvBuffer[LV_BUFFER_SIZE];
-static int32_t x1_flush;
-static int32_t y1_flush;
-static int32_t x2_flush;
-static int32_t y2_fill;
+static fb_rect_t area_flush;
+static fb_rect_t rect_flush[FB_TILES_MAX_RECT];
+static uint32_t rect_num;
+static uint32_t rect_act;
 static int32_t y_fill_act;
-static const uint8_t *buf_to_flush;
+static const uint16_t *buf_to_flush;
+
+/*Set while a DMA flush runs, cleared in its complete interrupt*/
+static volatile uint8_t flush_busy;
+static tft_wait_hook_t wait_hook;
+
+#if FB_TILES
+/*Only tiles that changed since the last frame are copied*/
+static uint32_t tile_hash[FB_TILES_COUNT(TFT_LV_HOR_RES, TFT_LV_VER_RES)];
+static fb_tiles_t tiles;
+#endif
 
 /**********************
  *      MACROS
@@ -89,14 +125,30 @@ void tft_init(void)
   lvDisplay = lv_display_create(TFT_HOR_RES, TFT_VER_RES);
   if (lvDisplay)
   {
+    /*LVGL swaps its resolution and turns touch points, the pixels are
+     *turned by tft_flush()*/
+    lv_display_set_rotation(lvDisplay, (lv_display_rotation_t)TFT_ROTATION);
+
     BSP_LCD_Init();
     BSP_LCD_LayerDefaultInit(0, (uint32_t)my_fb);
     HAL_LTDC_SetPixelFormat(&LtdcHandler, LTDC_PIXEL_FORMAT_RGB565, 0);
     DMA_Config();
 
+  #if FB_L8
+    DMA2D_L8_Config();
+    lv_display_set_color_format(lvDisplay, LV_COLOR_FORMAT_L8);
+  #else
     lv_display_set_color_format(lvDisplay, LV_COLOR_FORMAT_RGB565);
+  #endif
     lv_display_set_flush_cb(lvDisplay, tft_flush);
+    lv_display_set_flush_wait_cb(lvDisplay, tft_flush_wait);
     lv_display_set_buffers(lvDisplay, lvBuffer, NULL, LV_BUFFER_SIZE, LV_DISPLAY_RENDER_MODE_PARTIAL);
+
+  #if FB_TILES
+    fb_tiles_init(&tiles, TFT_LV_HOR_RES, TFT_LV_VER_RES, tile_hash);
+    tiles.px_bytes = FB_L8 ? 1 : 2;
+    lv_display_add_event_cb(lvDisplay, tiles_round_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+  #endif
     
   #if TFT_USE_GPU != 0
     DMA2D_Config();
@@ -133,36 +185,135 @@ static void lv_log_print_g_cb(lv_log_level_t level, const char * buf)
  */
 static void tft_flush(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map)
 {
-  /*Return if the area is out the screen*/
-  if (area->x2 < 0)
-    return;
-  if (area->y2 < 0)
-    return;
-  if (area->x1 > TFT_HOR_RES - 1)
+  fb_rect_t clip;
+
+  area_flush.x1 = area->x1;
+  area_flush.y1 = area->y1;
+  area_flush.x2 = area->x2;
+  area_flush.y2 = area->y2;
+
+  /*Return if the area is out the screen, else truncate it to the screen*/
+  if (!fb_clip(&area_flush, TFT_LV_HOR_RES, TFT_LV_VER_RES, &clip))
+  {
+    lv_display_flush_ready(disp);
     return;
-  if (area->y1 > TFT_VER_RES - 1)
+  }
+
+  buf_to_flush = (const uint16_t *)px_map;
+  rect_flush[0] = clip;
+  rect_num = 1;
+
+#if FB_TILES
+  if (memcmp(&clip, &area_flush, sizeof(clip)) == 0)
+  {
+    rect_num = fb_tiles_diff(&tiles, &area_flush, buf_to_flush, rect_flush, FB_TILES_MAX_RECT);
+  }
+
+  if (lv_display_flush_is_last(disp))
+  {
+    fb_tiles_frame_end(&tiles);
+  }
+
+  if (rect_num == 0)
+  {
+    lv_display_flush_ready(disp);
     return;
+  }
+#endif
+
+#if TFT_ROTATION != 0
+  /*The DMA copies rows only: rotate on the CPU, in the same single pass*/
+  TRACE_BEGIN("tft_rotate");
+  for (rect_act = 0; rect_act < rect_num; rect_act++)
+  {
+    const fb_rect_t * rect = &rect_flush[rect_act];
+    fb_rect_t panel;
+
+    fb_rotate_rect(rect, (fb_rotation_t)TFT_ROTATION, TFT_HOR_RES, TFT_VER_RES, &panel);
+    fb_rotate_copy((uint16_t *)&my_fb[fb_dst_offset(&panel, TFT_HOR_RES, panel.y1)], TFT_HOR_RES,
+                   &buf_to_flush[fb_src_offset(&area_flush, rect, rect->y1)],
+                   area_flush.x2 - area_flush.x1 + 1,
+                   rect->x2 - rect->x1 + 1, rect->y2 - rect->y1 + 1,
+                   (fb_rotation_t)TFT_ROTATION);
+  }
+  TRACE_END("tft_rotate");
+  lv_display_flush_ready(disp);
+  return;
+#endif
+
+  rect_act = 0;
+  y_fill_act = rect_flush[0].y1;
+
+#if FB_L8
+  /* Ends in the DMA2D complete interrupt, one transfer per rectangle */
+  TRACE_ASYNC_BEGIN("tft_flush");
+  flush_busy = 1;
+  DMA2D_L8_StartRect();
+  return;
+#endif
+
+  /* Ends in the DMA complete interrupt */
+  TRACE_ASYNC_BEGIN("tft_flush");
+  flush_busy = 1;
+  DMA_StartRow(&DmaHandle);
+}
+
+/**
+ * Set the function called while LVGL waits for a flush to end
+ * @param hook called repeatedly until the DMA is done, NULL for none
+ */
+void tft_set_wait_hook(tft_wait_hook_t hook)
+{
+  wait_hook = hook;
+}
+
+/**
+ * LVGL waits here before it draws the next chunk into the buffer: the only
+ * point inside a refresh where other work can run
+ * @param disp the display being flushed
+ */
+static void tft_flush_wait(lv_display_t * disp)
+{
+  LV_UNUSED(disp);
+
+  while (flush_busy)
+  {
+    if (wait_hook != NULL)
+    {
+      wait_hook();
+    }
+  }
+}
 
-  /*Truncate the area to the screen*/
-  int32_t act_x1 = area->x1 < 0 ? 0 : area->x1;
-  int32_t act_y1 = area->y1 < 0 ? 0 : area->y1;
-  int32_t act_x2 = area->x2 > TFT_HOR_RES - 1 ? TFT_HOR_RES - 1 : area->x2;
-  int32_t act_y2 = area->y2 > TFT_VER_RES - 1 ? TFT_VER_RES - 1 : area->y2;
+#if FB_TILES
+/**
+ * Grow invalidated areas to whole tiles, so they can be compared
+ * @param e LV_EVENT_INVALIDATE_AREA, the area is the parameter
+ */
+static void tiles_round_cb(lv_event_t * e)
+{
+  lv_area_t * area = (lv_area_t *)lv_event_get_param(e);
+  fb_rect_t rect = {area->x1, area->y1, area->x2, area->y2};
 
-  x1_flush = act_x1;
-  y1_flush = act_y1;
-  x2_flush = act_x2;
-  y2_fill = act_y2;
-  y_fill_act = act_y1;
-  buf_to_flush = px_map;
+  fb_tiles_round(&tiles, &rect);
+  lv_area_set(area, rect.x1, rect.y1, rect.x2, rect.y2);
+}
+#endif
+
+/**
+ * Copy row y_fill_act of the current rectangle to the frame buffer
+ */
+static void DMA_StartRow(DMA_HandleTypeDef *han)
+{
+  const fb_rect_t * rect = &rect_flush[rect_act];
 
   /*##-7- Start the DMA transfer using the interrupt mode #*/
   /* Configure the source, destination and buffer size DMA fields and Start DMA Stream transfer */
   /* Enable All the DMA interrupts */
-  HAL_StatusTypeDef err;
-  err = HAL_DMA_Start_IT(&DmaHandle, (uint32_t)buf_to_flush, (uint32_t)&my_fb[y_fill_act * TFT_HOR_RES + x1_flush],
-                         (x2_flush - x1_flush + 1));
-  if (err != HAL_OK)
+  if (HAL_DMA_Start_IT(han,
+                       (uint32_t)&buf_to_flush[fb_src_offset(&area_flush, rect, y_fill_act)],
+                       (uint32_t)&my_fb[fb_dst_offset(rect, TFT_HOR_RES, y_fill_act)],
+                       (rect->x2 - rect->x1 + 1)) != HAL_OK)
   {
     while (1)
       ; /*Halt on error*/
@@ -217,25 +368,123 @@ static void DMA_TransferComplete(DMA_HandleTypeDef *han)
 {
   y_fill_act++;
 
-  if (y_fill_act > y2_fill)
-  {
-    lv_disp_flush_ready(lvDisplay);
-  }
-  else
+  if (y_fill_act > rect_flush[rect_act].y2)
   {
-    buf_to_flush += x2_flush - x1_flush + 1;
-    /*##-7- Start the DMA transfer using the interrupt mode ####################*/
-    /* Configure the source, destination and buffer size DMA fields and Start DMA Stream transfer */
-    /* Enable All the DMA interrupts */
-    if (HAL_DMA_Start_IT(han, (uint32_t)buf_to_flush, (uint32_t)&my_fb[y_fill_act * TFT_HOR_RES + x1_flush],
-                         (x2_flush - x1_flush + 1)) != HAL_OK)
+    rect_act++;
+
+    if (rect_act == rect_num)
     {
-      while (1)
-        ; /*Halt on error*/
+      TRACE_ASYNC_END("tft_flush");
+      flush_busy = 0;
+      lv_disp_flush_ready(lvDisplay);
+      return;
     }
+
+    y_fill_act = rect_flush[rect_act].y1;
+  }
+
+  DMA_StartRow(han);
+}
+
+#if FB_L8
+/**
+ * Set up DMA2D for L8 to RGB565 pixel format conversion and load the CLUT
+ */
+static void DMA2D_L8_Config(void)
+{
+  uint16_t lut[256];
+  DMA2D_CLUTCfgTypeDef clut;
+
+  /*The same table as the CPU expansion, widened to ARGB8888 for the CLUT*/
+  static const uint32_t palette[] = FB_L8_PALETTE;
+  fb_l8_lut(lut, palette, sizeof(palette) / sizeof(palette[0]), 0);
+  for (int i = 0; i < 256; i++)
+  {
+    uint32_t r = (lut[i] >> 11) & 0x1F;
+    uint32_t g = (lut[i] >> 5) & 0x3F;
+    uint32_t b = lut[i] & 0x1F;
+
+    l8_clut[i] = 0xFF000000 | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+  }
+
+  __HAL_RCC_DMA2D_CLK_ENABLE();
+
+  Dma2dL8Handle.Instance = DMA2D;
+  Dma2dL8Handle.Init.Mode = DMA2D_M2M_PFC;
+  Dma2dL8Handle.Init.ColorMode = DMA2D_OUTPUT_RGB565;
+  Dma2dL8Handle.Init.OutputOffset = 0;
+  Dma2dL8Handle.XferCpltCallback = DMA2D_L8_TransferComplete;
+
+  Dma2dL8Handle.LayerCfg[1].InputColorMode = DMA2D_INPUT_L8;
+  Dma2dL8Handle.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+  Dma2dL8Handle.LayerCfg[1].InputAlpha = 0xFF;
+  Dma2dL8Handle.LayerCfg[1].InputOffset = 0;
+
+  if (HAL_DMA2D_Init(&Dma2dL8Handle) != HAL_OK || HAL_DMA2D_ConfigLayer(&Dma2dL8Handle, 1) != HAL_OK)
+  {
+    while (1)
+      ;
+  }
+
+  /*The CLUT stays loaded: every transfer only changes the offsets*/
+  clut.pCLUT = l8_clut;
+  clut.CLUTColorMode = DMA2D_CCM_ARGB8888;
+  clut.Size = 255;
+  HAL_DMA2D_CLUTLoad(&Dma2dL8Handle, clut, 1);
+  HAL_DMA2D_PollForTransfer(&Dma2dL8Handle, 10);
+
+  HAL_NVIC_SetPriority(DMA2D_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+}
+
+/**
+ * Expand the current rectangle into the frame buffer, in one 2D transfer
+ */
+static void DMA2D_L8_StartRect(void)
+{
+  const fb_rect_t * rect = &rect_flush[rect_act];
+  const uint8_t * src = (const uint8_t *)buf_to_flush;
+  uint32_t w = rect->x2 - rect->x1 + 1;
+
+  /*Line offsets: the rest of a source row, the rest of a frame buffer row*/
+  Dma2dL8Handle.Instance->FGOR = (area_flush.x2 - area_flush.x1 + 1) - w;
+  Dma2dL8Handle.Instance->OOR = TFT_HOR_RES - w;
+
+  if (HAL_DMA2D_Start_IT(&Dma2dL8Handle,
+                         (uint32_t)&src[fb_src_offset(&area_flush, rect, rect->y1)],
+                         (uint32_t)&my_fb[fb_dst_offset(rect, TFT_HOR_RES, rect->y1)],
+                         w, rect->y2 - rect->y1 + 1) != HAL_OK)
+  {
+    while (1)
+      ; /*Halt on error*/
   }
 }
 
+static void DMA2D_L8_TransferComplete(DMA2D_HandleTypeDef *han)
+{
+  LV_UNUSED(han);
+  rect_act++;
+
+  if (rect_act == rect_num)
+  {
+    TRACE_ASYNC_END("tft_flush");
+    flush_busy = 0;
+    lv_display_flush_ready(lvDisplay);
+    return;
+  }
+
+  DMA2D_L8_StartRect();
+}
+
+/**
+  * @brief  This function handles DMA2D interrupt request.
+  */
+void DMA2D_IRQHandler(void)
+{
+  HAL_DMA2D_IRQHandler(&Dma2dL8Handle);
+}
+#endif
+
 /**
   * @brief  DMA conversion error callback
   * @note   This function is executed when the transfer error interrupt
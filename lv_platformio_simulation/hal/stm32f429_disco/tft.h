@@ -18,17 +18,36 @@
 #define TFT_HOR_RES 240
 #define TFT_VER_RES 320
 
+/*Quarter turns clockwise of the LVGL display on the panel (0..3, see
+ *fb_rotation_t). 1 runs the landscape instrument UI on the portrait panel.
+ *The ILI9341 is scanned by the LTDC here, so neither MADCTL nor DMA2D can
+ *turn the picture: tft_flush() rotates while copying to the frame buffer.*/
+#ifndef TFT_ROTATION
+#define TFT_ROTATION 0
+#endif
+
+#if TFT_ROTATION & 1
+#define TFT_LV_HOR_RES TFT_VER_RES
+#define TFT_LV_VER_RES TFT_HOR_RES
+#else
+#define TFT_LV_HOR_RES TFT_HOR_RES
+#define TFT_LV_VER_RES TFT_VER_RES
+#endif
+
 #define TFT_EXT_FB		1		/*Frame buffer is located into an external SDRAM*/
 #define TFT_USE_GPU		0		/*Enable hardware accelerator*/
 
 /**********************
  *      TYPEDEFS
  **********************/
+typedef void (*tft_wait_hook_t)(void);
 
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
 void tft_init(void);
+/*Run `hook` while LVGL waits for a DMA flush, between the chunks of a refresh*/
+void tft_set_wait_hook(tft_wait_hook_t hook);
 
 /**********************
  *      MACROS
@@ -12,10 +12,15 @@
 #include "stm32f4xx.h"
 #include "stm32f429i_discovery.h"
 #include "stmpe811.h"
+#include "touch_filter.h"
+#include "trace.h"
 
 /*********************
  *      DEFINES
  *********************/
+#define TOUCHPAD_READ_PERIOD    5   /* ms, LVGL indev timer */
+#define TOUCHPAD_FIFO_MAX       128 /* STMPE811 FIFO depth */
+#define STMPE811_TSC_TOUCH_DET  0x80
 
 /**********************
  *      TYPEDEFS
@@ -25,11 +30,16 @@
  *  STATIC PROTOTYPES
  **********************/
 static void touchpad_read(lv_indev_t * drv, lv_indev_data_t *data);
-static bool touchpad_get_xy(int16_t *x, int16_t *y);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+static lv_indev_t * indev;
+static touch_filter_t filter;
+static volatile bool irq_pending;
+static bool pressed;
+static bool reported;
+static uint32_t last_tick;
 
 /**********************
  *      MACROS
@@ -44,97 +54,117 @@ static bool touchpad_get_xy(int16_t *x, int16_t *y);
  */
 void touchpad_init(void)
 {
+  touch_cfg_t cfg;
+
+  touch_cfg_default(&cfg, TFT_HOR_RES, TFT_VER_RES);
+  touch_filter_init(&filter, &cfg);
+
   stmpe811_Init(TS_I2C_ADDRESS);
   stmpe811_TS_Start(TS_I2C_ADDRESS);
 
-  lv_indev_t  * indev_drv = lv_indev_create();
-  lv_indev_set_read_cb(indev_drv, touchpad_read);
-  lv_indev_set_type(indev_drv, LV_INDEV_TYPE_POINTER);
-}
+  /* FIFO threshold interrupt on the INT pin (PA15, EXTI15_10) */
+  stmpe811_TS_EnableIT(TS_I2C_ADDRESS);
+  last_tick = HAL_GetTick();
 
-/**********************
- *   STATIC FUNCTIONS
- **********************/
+  indev = lv_indev_create();
+  lv_indev_set_read_cb(indev, touchpad_read);
+  lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
+  lv_timer_set_period(lv_indev_get_read_timer(indev), TOUCHPAD_READ_PERIOD);
+}
 
 /**
- * Read an input device
- * @param indev_id id of the input device to read
- * @param x put the x coordinate here
- * @param y put the y coordinate here
- * @return true: the device is pressed, false: released
+ * Replace the raw to screen mapping, e.g. with one from touch_calib_solve()
+ * @param calib affine calibration matrix
  */
-static void touchpad_read(lv_indev_t * dev, lv_indev_data_t *data)
+void touchpad_set_calib(const touch_calib_t * calib)
 {
-	static int16_t last_x = 0;
-	static int16_t last_y = 0;
-
-	bool detected;
-	int16_t x;
-	int16_t y;
-	detected = touchpad_get_xy(&x, &y);
-	if(detected) {
-		data->point.x = x;
-		data->point.y = y;
-		last_x = data->point.x;
-		last_y = data->point.y;
-
-		data->state = LV_INDEV_STATE_PR;
-	} else {
-		data->point.x = last_x;
-		data->point.y = last_y;
-		data->state = LV_INDEV_STATE_REL;
-	}
-}
+  touch_cfg_t cfg = filter.cfg;
 
+  cfg.calib = *calib;
+  touch_filter_init(&filter, &cfg);
+}
 
-static bool touchpad_get_xy(int16_t *x, int16_t *y)
+/**
+ * Drain the controller FIFO into the filter. Call every millisecond from the
+ * main loop: the I2C traffic stays out of interrupt context.
+ */
+void touchpad_service(void)
 {
-	static int32_t _x = 0, _y = 0;
-	int16_t xDiff, yDiff, xr, yr, x_raw, y_raw;;
-
-	bool detected;
-	detected = stmpe811_TS_DetectTouch(TS_I2C_ADDRESS);
-
-	if(!detected) return false;
-
-
-	stmpe811_TS_GetXY(TS_I2C_ADDRESS, &x_raw, &y_raw);
-
-	/* Y value first correction */
-	y_raw -= 360;
-
-	/* Y value second correction */
-	yr = y_raw / 11;
-
-	/* Return y_raw position value */
-	if(yr <= 0) yr = 0;
-	else if (yr > TFT_VER_RES) yr = TFT_VER_RES - 1;
-
-	y_raw = yr;
-
-	/* X value first correction */
-	if(x_raw <= 3000) x_raw = 3870 - x_raw;
-	else  x_raw = 3800 - x_raw;
+	uint8_t data[4];
+	uint32_t now = HAL_GetTick();
+	uint8_t num;
+
+	if(!irq_pending && !pressed) return;
+	irq_pending = false;
+	TRACE_BEGIN("touchpad_service");
+
+	num = IOE_Read(TS_I2C_ADDRESS, STMPE811_REG_FIFO_SIZE);
+	if(num > TOUCHPAD_FIFO_MAX) num = TOUCHPAD_FIFO_MAX;
+
+	if(num > 0) {
+		/* Samples are spread evenly over the time since the last drain */
+		float dt = (float)(now - last_tick) / 1000.0f / num;
+		if(dt < 0.0005f) dt = 0.0005f;
+
+		for(uint8_t i = 0; i < num; i++) {
+			uint16_t x_raw, y_raw;
+
+			IOE_ReadMultiple(TS_I2C_ADDRESS, STMPE811_REG_TSC_DATA_NON_INC, data, 4);
+			x_raw = ((uint16_t)data[0] << 4) | (data[1] >> 4);
+			y_raw = ((uint16_t)(data[1] & 0x0F) << 8) | data[2];
+			touch_filter_push(&filter, x_raw, y_raw, dt);
+		}
+		last_tick = now;
+	}
 
-	/* X value second correction */
-	xr = x_raw / 15;
+	pressed = (IOE_Read(TS_I2C_ADDRESS, STMPE811_REG_TSC_CTRL) & STMPE811_TSC_TOUCH_DET) != 0;
+	if(!pressed) {
+		touch_filter_reset(&filter);
+		last_tick = now;
+	}
 
-	/* Return X position value */
-	if(xr <= 0) xr = 0;
-	else if (xr > TFT_HOR_RES) xr = TFT_HOR_RES - 1;
+	stmpe811_TS_ClearIT(TS_I2C_ADDRESS);
 
-	x_raw = xr;
-	xDiff = x_raw > _x? (x_raw - _x): (_x - x_raw);
-	yDiff = y_raw > _y? (y_raw - _y): (_y - y_raw);
+	/* Deliver press and release edges now rather than at the next timer tick */
+	if((pressed && filter.b_started) != reported) {
+		lv_indev_read(indev);
+	}
+	TRACE_END("touchpad_service");
+}
 
-	if (xDiff + yDiff > 5) {
-		_x = x_raw;
-		_y = y_raw;
+/**
+ * STMPE811 INT line: only flag it, the FIFO is read by touchpad_service()
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	if(GPIO_Pin == STMPE811_INT_PIN) {
+		irq_pending = true;
 	}
+}
 
-	/* Update the X and Y position */
-	*x = _x;
-	*y = _y;
+void EXTI15_10_IRQHandler(void)
+{
+	HAL_GPIO_EXTI_IRQHandler(STMPE811_INT_PIN);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
 
-	return true;
+/**
+ * Read an input device
+ * @param dev the input device
+ * @param data put the filtered point and the pressed state here
+ */
+static void touchpad_read(lv_indev_t * dev, lv_indev_data_t *data)
+{
+	(void)dev;
+	TRACE_BEGIN("touchpad_read");
+
+	/* Before the first sample of a touch the point is still the last one */
+	data->point.x = filter.x;
+	data->point.y = filter.y;
+	reported = pressed && filter.b_started;
+	data->state = reported ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL;
+	TRACE_END("touchpad_read");
 }
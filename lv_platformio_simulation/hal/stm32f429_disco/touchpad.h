@@ -11,6 +11,7 @@
  *********************/
 #include <stdbool.h>
 #include <stdint.h>
+#include "touch_filter.h"
 
 /*********************
  *      DEFINES
@@ -24,6 +25,8 @@
  * GLOBAL PROTOTYPES
  **********************/
 void touchpad_init(void);
+void touchpad_set_calib(const touch_calib_t * calib);
+void touchpad_service(void);
 
 /**********************
  *      MACROS
@@ -0,0 +1,143 @@
+#include "budget.h"
+#include <string.h>
+
+#define BUDGET_REFR_MS      (33U)   /* LVGL's default refresh period */
+#define BUDGET_MAX_DEFER    (50U)   /* About 50 ms on a 1 ms loop */
+
+static uint32_t
+ewma (uint32_t avg, uint32_t value)
+{
+    return ((uint32_t) ((int32_t) avg
+                        + ((int32_t) value - (int32_t) avg)
+                          / (1 << BUDGET_DECAY_SHIFT)));
+}   /* ewma() */
+
+void
+budget_cfg_default (budget_cfg_t * p_cfg, uint32_t sample_rate,
+                    uint32_t block_frames)
+{
+    // Half the core to audio and the UI refreshes at half rate, three
+    // quarters and it drops to a quarter. The margin covers the loop's own
+    // delay (1 ms on the discovery board) being late by a tick.
+    //
+    p_cfg->block_us = (uint32_t) ((uint64_t) block_frames * 1000000U
+                                  / sample_rate);
+    p_cfg->margin_us = p_cfg->block_us / 4;
+    p_cfg->refr_ms[BUDGET_NORMAL] = BUDGET_REFR_MS;
+    p_cfg->refr_ms[BUDGET_REDUCED] = 2 * BUDGET_REFR_MS;
+    p_cfg->refr_ms[BUDGET_MINIMAL] = 4 * BUDGET_REFR_MS;
+    p_cfg->up_pct[0] = 50;
+    p_cfg->up_pct[1] = 75;
+    p_cfg->hyst_pct = 10;
+    p_cfg->max_defer = BUDGET_MAX_DEFER;
+}   /* budget_cfg_default() */
+
+void
+budget_init (budget_t * p_budget, const budget_cfg_t * p_cfg)
+{
+    memset(p_budget, 0, sizeof(*p_budget));
+    p_budget->cfg = *p_cfg;
+}   /* budget_init() */
+
+void
+budget_audio_done (budget_t * p_budget, uint32_t render_us, uint8_t b_late)
+{
+    budget_stats_t * p_stats = &p_budget->stats;
+    uint32_t load = 0;
+    uint8_t level = p_stats->level;
+
+    p_stats->audio_us = (0 == p_stats->audio_us)
+                        ? render_us : ewma(p_stats->audio_us, render_us);
+
+    if (render_us > p_stats->audio_peak_us)
+    {
+        p_stats->audio_peak_us = render_us;
+    }
+
+    if (b_late)
+    {
+        ++p_stats->late;
+    }
+
+    load = (0 == p_budget->cfg.block_us)
+           ? 100 : p_stats->audio_us * 100U / p_budget->cfg.block_us;
+    p_stats->load_pct = (uint8_t) ((load > 255) ? 255 : load);
+
+    // Up as soon as the load crosses a threshold, down only once it is
+    // clearly below, so a load sitting on one does not flip the period.
+    //
+    while ((level < BUDGET_MINIMAL) && (load >= p_budget->cfg.up_pct[level]))
+    {
+        ++level;
+    }
+
+    while ((level > BUDGET_NORMAL)
+           && (load + p_budget->cfg.hyst_pct
+               < p_budget->cfg.up_pct[level - 1]))
+    {
+        --level;
+    }
+
+    if (level != p_stats->level)
+    {
+        p_stats->level = level;
+        ++p_stats->level_changes;
+    }
+}   /* budget_audio_done() */
+
+uint8_t
+budget_ui_begin (budget_t * p_budget, uint32_t deadline_us)
+{
+    budget_stats_t * p_stats = &p_budget->stats;
+    uint32_t need = p_stats->ui_us + p_stats->audio_us
+                    + p_budget->cfg.margin_us;
+
+    if (need <= deadline_us)
+    {
+        p_budget->defer_run = 0;
+        ++p_stats->passes;
+
+        return (1);
+    }
+
+    // A UI that never fits is still a UI: let one through now and then,
+    // at the cost of a block that may be late.
+    //
+    if (p_budget->defer_run >= p_budget->cfg.max_defer)
+    {
+        p_budget->defer_run = 0;
+        ++p_stats->forced;
+        ++p_stats->passes;
+
+        return (1);
+    }
+
+    ++p_budget->defer_run;
+    ++p_stats->deferred;
+
+    return (0);
+}   /* budget_ui_begin() */
+
+void
+budget_ui_done (budget_t * p_budget, uint32_t stall_us)
+{
+    // A decaying peak: one long redraw is remembered for a while, since
+    // the next pass is likely to redraw the same thing.
+    //
+    budget_stats_t * p_stats = &p_budget->stats;
+
+    p_stats->ui_us = (stall_us >= p_stats->ui_us)
+                     ? stall_us : ewma(p_stats->ui_us, stall_us);
+}   /* budget_ui_done() */
+
+uint32_t
+budget_refr_ms (const budget_t * p_budget)
+{
+    return (p_budget->cfg.refr_ms[p_budget->stats.level]);
+}   /* budget_refr_ms() */
+
+void
+budget_get_stats (const budget_t * p_budget, budget_stats_t * p_stats)
+{
+    *p_stats = p_budget->stats;
+}   /* budget_get_stats() */
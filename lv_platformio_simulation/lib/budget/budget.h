@@ -0,0 +1,121 @@
+#ifndef BUDGET_H
+
+#   define BUDGET_H
+#   include <stdint.h>
+
+// CPU budget for single-core targets, where audio blocks and LVGL passes
+// take turns in one loop. The loop reports what each audio block took and
+// asks before every UI pass, giving the time left until the next block is
+// due at the codec. A pass that would not fit is deferred to a later
+// iteration, and as the audio load rises the display refresh period is
+// stretched, so the UI gives up frames before the audio gives up blocks.
+//
+// LVGL cannot be paused inside a refresh, but it waits for every flushed
+// chunk of a partial buffer; a HAL that renders due audio blocks in that
+// wait splits a pass into chunk-sized stretches. The budget only sees the
+// longest stretch, and decides whether a pass starts, not what it draws.
+//
+#   define BUDGET_DECAY_SHIFT   (3U)    /* Estimates move 1/8 per report */
+
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+
+typedef enum budget_level_t
+{
+    BUDGET_NORMAL = 0,
+    BUDGET_REDUCED,         /* Audio above up_pct[0]: refresh stretched */
+    BUDGET_MINIMAL,         /* Audio above up_pct[1]: UI barely alive */
+    BUDGET_NUM_LEVEL
+} budget_level_t;
+
+typedef struct budget_cfg_t
+{
+    uint32_t block_us;      /* Audio block period */
+    uint32_t margin_us;     /* Kept free ahead of every audio deadline */
+    uint32_t refr_ms[BUDGET_NUM_LEVEL];     /* Refresh period per level */
+    uint8_t up_pct[BUDGET_NUM_LEVEL - 1];   /* Audio load entering a level */
+    uint8_t hyst_pct;       /* Below up_pct by this much to leave it */
+    uint8_t max_defer;      /* Passes deferred in a row before one is forced */
+} budget_cfg_t;
+
+typedef struct budget_stats_t
+{
+    uint32_t passes;        /* UI passes run, forced ones included */
+    uint32_t deferred;      /* Passes held back for lack of headroom */
+    uint32_t forced;        /* Run after max_defer without headroom */
+    uint32_t late;          /* Audio blocks finished past their deadline */
+    uint32_t level_changes;
+    uint32_t audio_us;      /* Block render time, average */
+    uint32_t audio_peak_us;
+    uint32_t ui_us;         /* Longest stretch of a pass (decaying peak) */
+    uint8_t load_pct;       /* audio_us against the block period */
+    uint8_t level;          /* budget_level_t */
+} budget_stats_t;
+
+typedef struct budget_t
+{
+    budget_cfg_t cfg;
+    budget_stats_t stats;
+    uint8_t defer_run;      /* Passes deferred since the last one ran */
+} budget_t;
+
+// A simulated loop, see budget_sim().
+//
+typedef struct budget_sim_cfg_t
+{
+    uint32_t sample_rate;
+    uint32_t block_frames;
+    uint32_t queue;         /* Blocks buffered ahead of the codec */
+    uint32_t audio_us;      /* Cost of one block */
+    uint32_t ui_us;         /* Cost of a pass that redraws */
+    uint32_t ui_idle_us;    /* Cost of a pass with nothing to redraw */
+    uint32_t ui_chunks;     /* Flushes per redraw, audio runs between them */
+    uint32_t busy_ms;       /* The screen animates this long ... */
+    uint32_t idle_ms;       /* ... then is still this long, and so on */
+    uint32_t seconds;
+    uint8_t b_budget;       /* 0: every pass runs when due (the old loop) */
+} budget_sim_cfg_t;
+
+typedef struct budget_sim_t
+{
+    budget_stats_t stats;
+    uint32_t blocks;
+    uint32_t frames;        /* Passes that redrew the screen */
+    float fps;              /* Redraws per simulated second */
+} budget_sim_t;
+
+void budget_cfg_default(budget_cfg_t * p_cfg, uint32_t sample_rate,
+                        uint32_t block_frames);
+void budget_init(budget_t * p_budget, const budget_cfg_t * p_cfg);
+
+// After every audio block: its render time and whether it missed the
+// deadline (an underrun on the codec side).
+//
+void budget_audio_done(budget_t * p_budget, uint32_t render_us,
+                       uint8_t b_late);
+
+// Before a UI pass that is due: `deadline_us` is the time until the next
+// block not yet rendered is due at the codec. 1: run the pass now, then
+// call budget_ui_done() with the longest the pass kept the audio waiting;
+// 0: skip it this iteration.
+//
+uint8_t budget_ui_begin(budget_t * p_budget, uint32_t deadline_us);
+void budget_ui_done(budget_t * p_budget, uint32_t stall_us);
+
+// Display refresh period for the current load, for the refresh timer.
+//
+uint32_t budget_refr_ms(const budget_t * p_budget);
+void budget_get_stats(const budget_t * p_budget, budget_stats_t * p_stats);
+
+// One core in simulated time: audio blocks due on the sample clock and a UI
+// pass whenever the refresh timer expires, on the 1 ms loop of the
+// discovery board. Deterministic, for checking the policy on the host.
+//
+void budget_sim(const budget_sim_cfg_t * p_cfg, budget_sim_t * p_result);
+
+#   ifdef __cplusplus
+} /* extern "C" */
+#   endif
+
+#endif /* BUDGET_H */
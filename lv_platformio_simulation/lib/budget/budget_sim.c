@@ -0,0 +1,121 @@
+#include "budget.h"
+#include <string.h>
+
+#define SIM_TICK_US     (1000U)     /* HAL_Delay(1) in the board's loop */
+
+typedef struct sim_t
+{
+    const budget_sim_cfg_t * p_cfg;
+    budget_t budget;
+    uint64_t now;           /* Simulated microseconds */
+    uint32_t blocks;        /* Rendered so far */
+} sim_t;
+
+// When block `block` is in on the sample clock, from the frame count so
+// nothing drifts. The codec plays it `queue` blocks later.
+//
+static uint64_t
+block_time (const sim_t * p_sim, uint32_t block)
+{
+    return ((uint64_t) block * p_sim->p_cfg->block_frames * 1000000U
+            / p_sim->p_cfg->sample_rate);
+}   /* block_time() */
+
+// Render every block that is in, as the HAL does at the top of its loop
+// and between the flushed chunks of a pass.
+//
+static void
+sim_audio (sim_t * p_sim)
+{
+    const budget_sim_cfg_t * p_cfg = p_sim->p_cfg;
+
+    while (block_time(p_sim, p_sim->blocks) <= p_sim->now)
+    {
+        p_sim->now += p_cfg->audio_us;
+        budget_audio_done(&p_sim->budget, p_cfg->audio_us,
+                          p_sim->now > block_time(p_sim, p_sim->blocks
+                                                         + p_cfg->queue));
+        ++p_sim->blocks;
+    }
+}   /* sim_audio() */
+
+void
+budget_sim (const budget_sim_cfg_t * p_cfg, budget_sim_t * p_result)
+{
+    sim_t sim;
+    budget_cfg_t cfg;
+    const uint64_t end = (uint64_t) p_cfg->seconds * 1000000U;
+    const uint32_t period_ms = p_cfg->busy_ms + p_cfg->idle_ms;
+    uint64_t next_refr = 0;
+    uint32_t frames = 0;
+
+    memset(&sim, 0, sizeof(sim));
+    sim.p_cfg = p_cfg;
+    budget_cfg_default(&cfg, p_cfg->sample_rate, p_cfg->block_frames);
+    budget_init(&sim.budget, &cfg);
+
+    while (sim.now < end)
+    {
+        sim_audio(&sim);
+
+        if (sim.now >= next_refr)
+        {
+            uint64_t start = sim.now;
+            uint64_t due = block_time(&sim, sim.blocks + p_cfg->queue);
+            uint8_t b_busy = (0 == period_ms)
+                             || ((sim.now / 1000U) % period_ms
+                                 < p_cfg->busy_ms);
+            uint8_t b_run = 1;
+
+            if (p_cfg->b_budget)
+            {
+                b_run = budget_ui_begin(&sim.budget,
+                                        (due > sim.now)
+                                        ? (uint32_t) (due - sim.now) : 0);
+            }
+            else
+            {
+                ++sim.budget.stats.passes;
+            }
+
+            if (b_run)
+            {
+                uint32_t cost = b_busy ? p_cfg->ui_us : p_cfg->ui_idle_us;
+                uint32_t chunks = (b_busy && (p_cfg->ui_chunks > 1))
+                                  ? p_cfg->ui_chunks : 1;
+                uint32_t stall = 0;
+
+                // LVGL's refresh timer counts from the start of the pass:
+                // one longer than the period is due again right away.
+                //
+                for (uint32_t chunk = 0; chunk < chunks; ++chunk)
+                {
+                    uint32_t piece = cost / chunks
+                                     + ((0 == chunk) ? cost % chunks : 0);
+
+                    sim.now += piece;
+                    stall = (piece > stall) ? piece : stall;
+
+                    if (chunk + 1 < chunks)
+                    {
+                        sim_audio(&sim);
+                    }
+                }
+
+                budget_ui_done(&sim.budget, stall);
+                next_refr = start + 1000U * (p_cfg->b_budget
+                                             ? budget_refr_ms(&sim.budget)
+                                             : cfg.refr_ms[BUDGET_NORMAL]);
+                frames += b_busy;
+            }
+        }
+
+        sim.now = (sim.now / SIM_TICK_US + 1) * SIM_TICK_US;
+    }
+
+    budget_get_stats(&sim.budget, &p_result->stats);
+    p_result->blocks = sim.blocks;
+    p_result->frames = frames;
+    p_result->fps = (0 == p_cfg->seconds)
+                    ? 0.0f : (float) frames / (float) p_cfg->seconds;
+}   /* budget_sim() */
@@ -0,0 +1,290 @@
+#include "fb.h"
+#include <string.h>
+
+#define FB_ROT_BLOCK        (16)    /* 16 x 16 pixels: 32-byte rows */
+
+uint8_t
+fb_clip (const fb_rect_t * p_area, int32_t width, int32_t height,
+         fb_rect_t * p_clip)
+{
+    if ((p_area->x2 < 0) || (p_area->y2 < 0) || (p_area->x1 > width - 1)
+        || (p_area->y1 > height - 1) || (p_area->x2 < p_area->x1)
+        || (p_area->y2 < p_area->y1))
+    {
+        return (0);
+    }
+
+    p_clip->x1 = (p_area->x1 < 0) ? 0 : p_area->x1;
+    p_clip->y1 = (p_area->y1 < 0) ? 0 : p_area->y1;
+    p_clip->x2 = (p_area->x2 > width - 1) ? width - 1 : p_area->x2;
+    p_clip->y2 = (p_area->y2 > height - 1) ? height - 1 : p_area->y2;
+
+    return (1);
+}   /* fb_clip() */
+
+uint32_t
+fb_src_offset (const fb_rect_t * p_area, const fb_rect_t * p_clip, int32_t y)
+{
+    // Rows are as wide as the area, not as the clipped part of it.
+    //
+    return ((uint32_t) ((y - p_area->y1) * (p_area->x2 - p_area->x1 + 1)
+                        + (p_clip->x1 - p_area->x1)));
+}   /* fb_src_offset() */
+
+uint32_t
+fb_dst_offset (const fb_rect_t * p_clip, int32_t stride, int32_t y)
+{
+    return ((uint32_t) (y * stride + p_clip->x1));
+}   /* fb_dst_offset() */
+
+void
+fb_copy_rows (uint16_t * p_fb, int32_t stride, const fb_rect_t * p_area,
+              const fb_rect_t * p_clip, const uint16_t * p_src)
+{
+    size_t row_bytes = (size_t) (p_clip->x2 - p_clip->x1 + 1)
+                       * sizeof(uint16_t);
+
+    for (int32_t y = p_clip->y1; y <= p_clip->y2; ++y)
+    {
+        memcpy(&p_fb[fb_dst_offset(p_clip, stride, y)],
+               &p_src[fb_src_offset(p_area, p_clip, y)], row_bytes);
+    }
+}   /* fb_copy_rows() */
+
+// Quarter turn: source (x, y) goes to p_dst[x * row_step + y * col_step].
+// Square blocks keep the source rows they read and the destination rows
+// they write in the cache; inside a block 2 x 2 pixels move at a time, so
+// each source and destination row is touched two pixels at once.
+//
+static void
+rotate_quarter (uint16_t * p_dst, int32_t row_step, int32_t col_step,
+                const uint16_t * p_src, int32_t src_stride, int32_t width,
+                int32_t height)
+{
+    for (int32_t by = 0; by < height; by += FB_ROT_BLOCK)
+    {
+        int32_t ey = (by + FB_ROT_BLOCK < height) ? by + FB_ROT_BLOCK : height;
+
+        for (int32_t bx = 0; bx < width; bx += FB_ROT_BLOCK)
+        {
+            int32_t ex = (bx + FB_ROT_BLOCK < width) ? bx + FB_ROT_BLOCK
+                                                     : width;
+            int32_t x = bx;
+
+            for (; x + 1 < ex; x += 2)
+            {
+                uint16_t * p_row0 = &p_dst[x * row_step];
+                uint16_t * p_row1 = p_row0 + row_step;
+                const uint16_t * p_in = &p_src[by * src_stride + x];
+                int32_t y = by;
+
+                for (; y + 1 < ey; y += 2, p_in += 2 * src_stride)
+                {
+                    uint16_t a = p_in[0];
+                    uint16_t b = p_in[1];
+                    uint16_t c = p_in[src_stride];
+                    uint16_t d = p_in[src_stride + 1];
+
+                    p_row0[y * col_step] = a;
+                    p_row0[(y + 1) * col_step] = c;
+                    p_row1[y * col_step] = b;
+                    p_row1[(y + 1) * col_step] = d;
+                }
+
+                if (y < ey)
+                {
+                    p_row0[y * col_step] = p_in[0];
+                    p_row1[y * col_step] = p_in[1];
+                }
+            }
+
+            if (x < ex)
+            {
+                for (int32_t y = by; y < ey; ++y)
+                {
+                    p_dst[x * row_step + y * col_step] = p_src[y * src_stride
+                                                               + x];
+                }
+            }
+        }
+    }
+}   /* rotate_quarter() */
+
+void
+fb_rotate_rect (const fb_rect_t * p_rect, fb_rotation_t rotation,
+                int32_t width, int32_t height, fb_rect_t * p_out)
+{
+    fb_rect_t rect = *p_rect;
+
+    switch (rotation)
+    {
+        case FB_ROT_90:
+            p_out->x1 = rect.y1;
+            p_out->x2 = rect.y2;
+            p_out->y1 = height - 1 - rect.x2;
+            p_out->y2 = height - 1 - rect.x1;
+        break;
+
+        case FB_ROT_180:
+            p_out->x1 = width - 1 - rect.x2;
+            p_out->x2 = width - 1 - rect.x1;
+            p_out->y1 = height - 1 - rect.y2;
+            p_out->y2 = height - 1 - rect.y1;
+        break;
+
+        case FB_ROT_270:
+            p_out->x1 = width - 1 - rect.y2;
+            p_out->x2 = width - 1 - rect.y1;
+            p_out->y1 = rect.x1;
+            p_out->y2 = rect.x2;
+        break;
+
+        default:
+            *p_out = rect;
+        break;
+    }
+}   /* fb_rotate_rect() */
+
+void
+fb_rotate_copy (uint16_t * p_dst, int32_t dst_stride, const uint16_t * p_src,
+                int32_t src_stride, int32_t width, int32_t height,
+                fb_rotation_t rotation)
+{
+    switch (rotation)
+    {
+        case FB_ROT_90:
+            // Source column x is destination row (width - 1 - x), walked
+            // backwards: the same kernel with a negative stride.
+            //
+            rotate_quarter(&p_dst[(width - 1) * dst_stride], -dst_stride, 1,
+                           p_src, src_stride, width, height);
+        break;
+
+        case FB_ROT_270:
+            rotate_quarter(&p_dst[height - 1], dst_stride, -1,
+                           p_src, src_stride, width, height);
+        break;
+
+        case FB_ROT_180:
+            for (int32_t y = 0; y < height; ++y)
+            {
+                const uint16_t * p_in = &p_src[y * src_stride];
+                uint16_t * p_out = &p_dst[(height - 1 - y) * dst_stride
+                                          + width - 1];
+
+                for (int32_t x = 0; x < width; ++x)
+                {
+                    p_out[-x] = p_in[x];
+                }
+            }
+        break;
+
+        default:
+            for (int32_t y = 0; y < height; ++y)
+            {
+                memcpy(&p_dst[y * dst_stride], &p_src[y * src_stride],
+                       width * sizeof(uint16_t));
+            }
+        break;
+    }
+}   /* fb_rotate_copy() */
+
+uint8_t
+fb_l8_level (uint32_t rgb)
+{
+    uint32_t r = (rgb >> 16) & 0xFFU;
+    uint32_t g = (rgb >> 8) & 0xFFU;
+    uint32_t b = rgb & 0xFFU;
+
+    return ((uint8_t) ((77U * r + 151U * g + 28U * b) >> 8));
+}   /* fb_l8_level() */
+
+static uint16_t
+rgb565 (uint32_t rgb, uint8_t b_swap)
+{
+    uint16_t px = (uint16_t) (((rgb >> 8) & 0xF800U) | ((rgb >> 5) & 0x07E0U)
+                              | ((rgb >> 3) & 0x001FU));
+
+    return (b_swap ? (uint16_t) ((px << 8) | (px >> 8)) : px);
+}   /* rgb565() */
+
+uint32_t
+fb_l8_lut (uint16_t * p_lut, const uint32_t * p_rgb, uint32_t count,
+           uint8_t b_swap)
+{
+    uint8_t owner[256];
+    uint32_t lost = 0;
+
+    // Grey ramp first, then each color claims its level and the
+    // FB_L8_SNAP levels around it; 0xFF marks a level no color owns.
+    //
+    memset(owner, 0xFF, sizeof(owner));
+
+    for (uint32_t level = 0; level < 256; ++level)
+    {
+        p_lut[level] = rgb565(level * 0x010101U, b_swap);
+    }
+
+    for (uint32_t idx = 0; idx < count; ++idx)
+    {
+        int32_t level = fb_l8_level(p_rgb[idx]);
+
+        if ((0xFF != owner[level]) && (fb_l8_level(p_rgb[owner[level]])
+                                       == level))
+        {
+            ++lost;
+            continue;
+        }
+
+        for (int32_t near = level - FB_L8_SNAP; near <= level + FB_L8_SNAP;
+             ++near)
+        {
+            // Halfway between two close colors: the nearer one wins, the
+            // exact level always goes to its own color.
+            //
+            if ((near < 0) || (near > 255)
+                || ((0xFF != owner[near]) && (near != level)))
+            {
+                continue;
+            }
+
+            owner[near] = (uint8_t) idx;
+            p_lut[near] = rgb565(p_rgb[idx], b_swap);
+        }
+    }
+
+    return (lost);
+}   /* fb_l8_lut() */
+
+void
+fb_l8_expand (uint16_t * p_dst, int32_t dst_stride, const uint8_t * p_src,
+              int32_t src_stride, int32_t width, int32_t height,
+              const uint16_t * p_lut)
+{
+    for (int32_t y = 0; y < height; ++y)
+    {
+        const uint8_t * p_in = &p_src[y * src_stride];
+        uint16_t * p_out = &p_dst[y * dst_stride];
+        int32_t x = 0;
+
+        // Four lookups in flight: the table is 512 bytes and stays in L1.
+        //
+        for (; x + 4 <= width; x += 4)
+        {
+            uint16_t a = p_lut[p_in[x]];
+            uint16_t b = p_lut[p_in[x + 1]];
+            uint16_t c = p_lut[p_in[x + 2]];
+            uint16_t d = p_lut[p_in[x + 3]];
+
+            p_out[x] = a;
+            p_out[x + 1] = b;
+            p_out[x + 2] = c;
+            p_out[x + 3] = d;
+        }
+
+        for (; x < width; ++x)
+        {
+            p_out[x] = p_lut[p_in[x]];
+        }
+    }
+}   /* fb_l8_expand() */
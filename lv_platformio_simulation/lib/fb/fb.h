@@ -0,0 +1,109 @@
+#ifndef FB_H
+
+#   define FB_H
+#   include <stdint.h>
+
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+
+// Frame buffer maths shared by the display drivers, free of LVGL and of
+// any HAL so it builds and runs on the host.
+//
+// Rectangles are inclusive on both ends, like lv_area_t.
+//
+typedef struct fb_rect_t
+{
+    int32_t x1;
+    int32_t y1;
+    int32_t x2;
+    int32_t y2;
+} fb_rect_t;
+
+// Clip `p_area` to a `width` x `height` screen. Returns 0, and leaves
+// `p_clip` alone, when nothing of the area is on screen.
+//
+uint8_t fb_clip(const fb_rect_t * p_area, int32_t width, int32_t height,
+                fb_rect_t * p_clip);
+
+// Pixel offsets of row `y` of `p_clip`: in the source buffer, which is laid
+// out for the whole `p_area`, and in a frame buffer `stride` pixels wide.
+//
+uint32_t fb_src_offset(const fb_rect_t * p_area, const fb_rect_t * p_clip,
+                       int32_t y);
+uint32_t fb_dst_offset(const fb_rect_t * p_clip, int32_t stride, int32_t y);
+
+// Copy the clipped part of an RGB565 area into the frame buffer, row by
+// row: what the flush DMA does, done by the CPU.
+//
+void fb_copy_rows(uint16_t * p_fb, int32_t stride, const fb_rect_t * p_area,
+                  const fb_rect_t * p_clip, const uint16_t * p_src);
+
+// Quarter turns clockwise, numbered as LV_DISPLAY_ROTATION_*: the panel
+// stays in its native scan order and the flush turns LVGL's pixels.
+//
+typedef enum fb_rotation_t
+{
+    FB_ROT_0 = 0,
+    FB_ROT_90,
+    FB_ROT_180,
+    FB_ROT_270
+} fb_rotation_t;
+
+// Where the LVGL area `p_rect` lands on a panel of `width` x `height`
+// native pixels, with the same mapping LVGL uses for touch input.
+//
+void fb_rotate_rect(const fb_rect_t * p_rect, fb_rotation_t rotation,
+                    int32_t width, int32_t height, fb_rect_t * p_out);
+
+// Turn `width` x `height` RGB565 pixels (`src_stride` apart) into the
+// panel frame buffer: `p_dst` is the top left of the rotated rectangle.
+// Copies and rotates in one pass, in square blocks so both sides stay in
+// the cache.
+//
+void fb_rotate_copy(uint16_t * p_dst, int32_t dst_stride,
+                    const uint16_t * p_src, int32_t src_stride,
+                    int32_t width, int32_t height, fb_rotation_t rotation);
+
+// 8-bit render mode: LVGL draws L8 (one luminance byte per pixel), which
+// halves the draw buffers, and the flush expands each byte to RGB565
+// through a 256-entry table. Levels of the UI's own colors map back to
+// those exact colors; any other level (anti-aliasing, shadows, pressed
+// states) comes out as that shade of grey.
+//
+#   ifndef FB_L8
+#       define FB_L8                (0)     /* Enabled per board */
+#   endif
+#   define FB_L8_SNAP               (2)     /* Levels either side of a color */
+
+// The instrument screen and LVGL's default theme, as 0xRRGGBB: white
+// keys, black keys and text, light green, grey, blue and red.
+//
+#   ifndef FB_L8_PALETTE
+#       define FB_L8_PALETTE        {0xFFFFFFU, 0x000000U, 0x8BC34AU, \
+                                     0x9E9E9EU, 0x2196F3U, 0xF44336U}
+#   endif
+
+// Luminance of 0xRRGGBB as LVGL computes it when drawing in L8.
+//
+uint8_t fb_l8_level(uint32_t rgb);
+
+// Fill the 256-entry `p_lut` from `count` 0xRRGGBB colors. `b_swap`
+// stores the RGB565 values byte swapped, for panels fed big-endian.
+// Returns how many colors were lost to a neighbour with too close a level.
+//
+uint32_t fb_l8_lut(uint16_t * p_lut, const uint32_t * p_rgb, uint32_t count,
+                   uint8_t b_swap);
+
+// Expand `width` x `height` L8 pixels (`src_stride` apart) to RGB565 rows
+// `dst_stride` apart.
+//
+void fb_l8_expand(uint16_t * p_dst, int32_t dst_stride, const uint8_t * p_src,
+                  int32_t src_stride, int32_t width, int32_t height,
+                  const uint16_t * p_lut);
+
+#   ifdef __cplusplus
+} /* extern "C" */
+#   endif
+
+#endif /* FB_H */
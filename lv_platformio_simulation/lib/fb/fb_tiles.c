@@ -0,0 +1,255 @@
+#include "fb_tiles.h"
+#include <string.h>
+
+#define FB_HASH_MUL     (0x9E3779B1U)
+
+static inline uint32_t
+hash_mix (uint32_t hash, uint32_t word)
+{
+    hash ^= word;
+    hash *= FB_HASH_MUL;
+
+    return ((hash << 13) | (hash >> 19));
+}   /* hash_mix() */
+
+uint32_t
+fb_tiles_hash (const uint16_t * p_src, int32_t stride, int32_t width,
+               int32_t height)
+{
+    // Two pixels per word and two independent lanes, so consecutive
+    // multiplies do not wait on each other.
+    //
+    uint32_t lane[2] = {0x811C9DC5U, 0x01000193U};
+
+    for (int32_t y = 0; y < height; ++y)
+    {
+        const uint16_t * p_row = &p_src[y * stride];
+        int32_t x = 0;
+
+        for (; x + 4 <= width; x += 4)
+        {
+            uint32_t word[2];
+
+            memcpy(word, &p_row[x], sizeof(word));
+            lane[0] = hash_mix(lane[0], word[0]);
+            lane[1] = hash_mix(lane[1], word[1]);
+        }
+
+        for (; x < width; ++x)
+        {
+            lane[0] = hash_mix(lane[0], p_row[x]);
+        }
+    }
+
+    lane[0] = hash_mix(lane[0], lane[1]);
+
+    // 0 marks an unknown tile.
+    //
+    return ((0 == lane[0]) ? 1 : lane[0]);
+}   /* fb_tiles_hash() */
+
+void
+fb_tiles_init (fb_tiles_t * p_tiles, int32_t width, int32_t height,
+               uint32_t * p_hash)
+{
+    p_tiles->width = width;
+    p_tiles->height = height;
+    p_tiles->cols = (width + FB_TILE_W - 1) / FB_TILE_W;
+    p_tiles->p_hash = p_hash;
+    p_tiles->px_bytes = 2;
+    p_tiles->bytes = 0;
+    p_tiles->sent = 0;
+    memset(&p_tiles->stats, 0, sizeof(p_tiles->stats));
+    fb_tiles_reset(p_tiles);
+}   /* fb_tiles_init() */
+
+void
+fb_tiles_reset (fb_tiles_t * p_tiles)
+{
+    memset(p_tiles->p_hash, 0, FB_TILES_COUNT(p_tiles->width, p_tiles->height)
+                               * sizeof(uint32_t));
+}   /* fb_tiles_reset() */
+
+void
+fb_tiles_round (const fb_tiles_t * p_tiles, fb_rect_t * p_area)
+{
+    p_area->x1 -= p_area->x1 % FB_TILE_W;
+    p_area->y1 -= p_area->y1 % FB_TILE_H;
+    p_area->x2 += FB_TILE_W - 1 - p_area->x2 % FB_TILE_W;
+    p_area->y2 += FB_TILE_H - 1 - p_area->y2 % FB_TILE_H;
+    p_area->x2 = (p_area->x2 > p_tiles->width - 1) ? p_tiles->width - 1
+                                                   : p_area->x2;
+    p_area->y2 = (p_area->y2 > p_tiles->height - 1) ? p_tiles->height - 1
+                                                    : p_area->y2;
+}   /* fb_tiles_round() */
+
+// Hash of a whole tile of the area's pixels. L8 rows are hashed as pairs
+// of pixels, so they must start and end on even bytes; 0 when they do not
+// and the tile has to be sent.
+//
+static uint32_t
+tile_hash (const fb_tiles_t * p_tiles, const fb_rect_t * p_area,
+           const void * p_src, const fb_rect_t * p_tile)
+{
+    int32_t area_w = p_area->x2 - p_area->x1 + 1;
+    int32_t tile_w = p_tile->x2 - p_tile->x1 + 1;
+    uint32_t offset = fb_src_offset(p_area, p_tile, p_tile->y1);
+
+    if (1 == p_tiles->px_bytes)
+    {
+        if ((area_w | tile_w | (int32_t) offset) & 1)
+        {
+            return (0);
+        }
+
+        return (fb_tiles_hash((const uint16_t *) ((const uint8_t *) p_src
+                                                  + offset),
+                              area_w / 2, tile_w / 2,
+                              p_tile->y2 - p_tile->y1 + 1));
+    }
+
+    return (fb_tiles_hash((const uint16_t *) p_src + offset, area_w, tile_w,
+                          p_tile->y2 - p_tile->y1 + 1));
+}   /* tile_hash() */
+
+static uint32_t
+add_run (fb_rect_t * p_out, uint32_t num, uint32_t max_out,
+         const fb_rect_t * p_run)
+{
+    // A run right under one of the same columns extends it downwards.
+    //
+    for (uint32_t idx = 0; idx < num; ++idx)
+    {
+        if ((p_out[idx].x1 == p_run->x1) && (p_out[idx].x2 == p_run->x2)
+            && (p_out[idx].y2 + 1 == p_run->y1))
+        {
+            p_out[idx].y2 = p_run->y2;
+
+            return (num);
+        }
+    }
+
+    if (num < max_out)
+    {
+        p_out[num] = *p_run;
+    }
+
+    return (num + 1);
+}   /* add_run() */
+
+uint32_t
+fb_tiles_diff (fb_tiles_t * p_tiles, const fb_rect_t * p_area,
+               const void * p_src, fb_rect_t * p_out, uint32_t max_out)
+{
+    int32_t area_w = p_area->x2 - p_area->x1 + 1;
+    uint32_t num = 0;
+
+    p_tiles->bytes += (uint32_t) (area_w * (p_area->y2 - p_area->y1 + 1))
+                      * sizeof(uint16_t);
+
+    for (int32_t ty = p_area->y1 / FB_TILE_H; ty * FB_TILE_H <= p_area->y2;
+         ++ty)
+    {
+        fb_rect_t run = {0, 0, -1, 0};
+        int32_t y1 = ty * FB_TILE_H;
+        int32_t y2 = y1 + FB_TILE_H - 1;
+
+        y2 = (y2 > p_tiles->height - 1) ? p_tiles->height - 1 : y2;
+
+        for (int32_t tx = p_area->x1 / FB_TILE_W; tx * FB_TILE_W <= p_area->x2;
+             ++tx)
+        {
+            uint32_t * p_hash = &p_tiles->p_hash[ty * p_tiles->cols + tx];
+            fb_rect_t tile = {tx * FB_TILE_W, y1, tx * FB_TILE_W + FB_TILE_W - 1,
+                              y2};
+            uint32_t hash = 0;
+
+            tile.x2 = (tile.x2 > p_tiles->width - 1) ? p_tiles->width - 1
+                                                     : tile.x2;
+
+            if ((tile.x1 >= p_area->x1) && (tile.x2 <= p_area->x2)
+                && (tile.y1 >= p_area->y1) && (tile.y2 <= p_area->y2))
+            {
+                hash = tile_hash(p_tiles, p_area, p_src, &tile);
+
+                if ((0 != hash) && (hash == *p_hash))
+                {
+                    if (run.x2 >= run.x1)
+                    {
+                        num = add_run(p_out, num, max_out, &run);
+                        run.x2 = run.x1 - 1;
+                    }
+
+                    continue;
+                }
+            }
+            else
+            {
+                // Part of the tile is not in the buffer: send what is,
+                // and forget the tile.
+                //
+                tile.x1 = (tile.x1 < p_area->x1) ? p_area->x1 : tile.x1;
+                tile.x2 = (tile.x2 > p_area->x2) ? p_area->x2 : tile.x2;
+                tile.y1 = (tile.y1 < p_area->y1) ? p_area->y1 : tile.y1;
+                tile.y2 = (tile.y2 > p_area->y2) ? p_area->y2 : tile.y2;
+            }
+
+            *p_hash = hash;
+
+            if ((run.x2 >= run.x1) && (run.y1 == tile.y1)
+                && (run.y2 == tile.y2))
+            {
+                run.x2 = tile.x2;
+            }
+            else
+            {
+                if (run.x2 >= run.x1)
+                {
+                    num = add_run(p_out, num, max_out, &run);
+                }
+
+                run = tile;
+            }
+        }
+
+        if (run.x2 >= run.x1)
+        {
+            num = add_run(p_out, num, max_out, &run);
+        }
+    }
+
+    // Too fragmented to list: the whole area in one go.
+    //
+    if (num > max_out)
+    {
+        p_out[0] = *p_area;
+        num = 1;
+    }
+
+    for (uint32_t idx = 0; idx < num; ++idx)
+    {
+        p_tiles->sent += (uint32_t) ((p_out[idx].x2 - p_out[idx].x1 + 1)
+                                     * (p_out[idx].y2 - p_out[idx].y1 + 1))
+                         * sizeof(uint16_t);
+    }
+
+    return (num);
+}   /* fb_tiles_diff() */
+
+void
+fb_tiles_frame_end (fb_tiles_t * p_tiles)
+{
+    p_tiles->stats.frame_bytes = p_tiles->bytes;
+    p_tiles->stats.frame_sent = p_tiles->sent;
+    p_tiles->stats.total_bytes += p_tiles->bytes;
+    p_tiles->stats.total_sent += p_tiles->sent;
+    ++p_tiles->stats.frames;
+    p_tiles->bytes = 0;
+    p_tiles->sent = 0;
+}   /* fb_tiles_frame_end() */
+
+void
+fb_tiles_get_stats (const fb_tiles_t * p_tiles, fb_tiles_stats_t * p_stats)
+{
+    *p_stats = p_tiles->stats;
+}   /* fb_tiles_get_stats() */
@@ -0,0 +1,88 @@
+#ifndef FB_TILES_H
+
+#   define FB_TILES_H
+#   include <stdint.h>
+#   include "fb.h"
+
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+
+// Redundant flush elimination: the screen is cut into tiles, each
+// remembered by a 32-bit hash of what was last sent to the panel. A flush
+// hashes the tiles of the new area and returns only the rectangles whose
+// tiles changed, adjacent ones merged, so a key that toggles back to its
+// old look within a frame costs no bus time at all.
+//
+// Tiles are only compared when the area covers them whole: route
+// LV_EVENT_INVALIDATE_AREA to fb_tiles_round(), which also makes LVGL cut
+// its partial buffers on tile rows. A partly covered tile is always sent.
+//
+// A hash collision would leave a stale tile until it next changes; at 32
+// bits this is about one changed tile in four billion.
+//
+#   ifndef FB_TILES
+#       define FB_TILES             (0)     /* Enabled per board */
+#   endif
+#   define FB_TILE_W                (32)    /* 64-byte rows */
+#   define FB_TILE_H                (8)
+#   define FB_TILES_MAX_RECT        (32)    /* Per flush, else all of it */
+#   define FB_TILES_COUNT(w, h)     ((((w) + FB_TILE_W - 1) / FB_TILE_W) \
+                                     * (((h) + FB_TILE_H - 1) / FB_TILE_H))
+
+typedef struct fb_tiles_stats_t
+{
+    uint32_t frame_bytes;   /* Last frame: rendered by LVGL */
+    uint32_t frame_sent;    /* Last frame: actually pushed to the panel */
+    uint32_t frames;
+    uint64_t total_bytes;
+    uint64_t total_sent;
+} fb_tiles_stats_t;
+
+typedef struct fb_tiles_t
+{
+    int32_t width;
+    int32_t height;
+    int32_t cols;
+    uint32_t * p_hash;      /* FB_TILES_COUNT(width, height), 0 = unknown */
+    int32_t px_bytes;       /* Source pixels: 2 RGB565 (default), 1 L8 */
+    uint32_t bytes;         /* Frame in progress */
+    uint32_t sent;
+    fb_tiles_stats_t stats;
+} fb_tiles_t;
+
+void fb_tiles_init(fb_tiles_t * p_tiles, int32_t width, int32_t height,
+                   uint32_t * p_hash);
+
+// Forget every tile, e.g. after drawing to the panel behind LVGL's back.
+//
+void fb_tiles_reset(fb_tiles_t * p_tiles);
+
+// Grow `p_area` to whole tiles, clipped to the screen.
+//
+void fb_tiles_round(const fb_tiles_t * p_tiles, fb_rect_t * p_area);
+
+// `p_area` is on screen and `p_src` holds its pixels (RGB565, or L8 when
+// px_bytes is 1), rows as wide as the area. Fills `p_out` with the changed rectangles, in the area's
+// coordinates (see fb_src_offset()), and returns how many.
+//
+uint32_t fb_tiles_diff(fb_tiles_t * p_tiles, const fb_rect_t * p_area,
+                       const void * p_src, fb_rect_t * p_out,
+                       uint32_t max_out);
+
+// Last flush of an LVGL refresh: closes the frame's byte counts.
+//
+void fb_tiles_frame_end(fb_tiles_t * p_tiles);
+void fb_tiles_get_stats(const fb_tiles_t * p_tiles,
+                        fb_tiles_stats_t * p_stats);
+
+// The hashing kernel: `width` x `height` pixels, `stride` pixels apart.
+//
+uint32_t fb_tiles_hash(const uint16_t * p_src, int32_t stride, int32_t width,
+                       int32_t height);
+
+#   ifdef __cplusplus
+} /* extern "C" */
+#   endif
+
+#endif /* FB_TILES_H */
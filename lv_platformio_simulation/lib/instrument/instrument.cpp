@@ -1,4 +1,9 @@
 #include "instrument.h"
+#include "scope_view.h"
+#include "synth.h"
+#include "mem.h"
+#include "dlog.h"
+#include "trace.h"
 #include "lvgl.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,66 +13,96 @@
 static void on_button_cb(lv_event_t * p_event);
 static void on_knob_cb(lv_event_t * p_event);
 static void on_drop_cb(lv_event_t * p_event);
-
-static uint8_t * gp_volume = NULL;
-static uint8_t * gp_q_key_press = NULL;
-static const char g_waveform_names[] = "Sine\n" "Triangle\n" "Square";
+static void on_osc_mode_cb(lv_event_t * p_event);
+static void on_mode_cb(lv_event_t * p_event);
+static void on_loop_cb(lv_event_t * p_event);
+static void on_rec_cb(lv_event_t * p_event);
+static void on_preset_cb(lv_event_t * p_event);
+static void on_sampler_timer(lv_timer_t * p_timer);
+
+static const char g_waveform_names[] = "Sine\n" "Triangle\n" "Square\n"
+                                       "Saw\n" "E.Piano\n" "Bell\n" "Bass";
+static const char g_waveform_sampled_names[] = "Sine\n" "Triangle\n" "Square\n"
+                                               "Saw\n" "E.Piano\n" "Bell\n"
+                                               "Bass\n" "Piano";
+static sampler_set_t g_sample_set;
+static const char * const g_osc_mode_names[OSC_NUM_MODE] = {"Table",
+                                                            "BLEP"};
+static const char * const g_seq_mode_names[SEQ_NUM_MODE] = {"Play", "Arp",
+                                                            "Seq"};
+static const char * const g_looper_names[LOOPER_NUM_STATE] = {"Loop", "Rec",
+                                                              "Play", "Dub"};
+
+static_assert(FX_ARENA_SIZE(SYNTH_SAMPLE_RATE) + sizeof(synth_t)
+              + sizeof(scope_t) + sizeof(seq_t) <= MEM_AUDIO_SIZE,
+              "MEM_AUDIO_SIZE too small for the engine");
+
+// Grid descriptors and styles must outlive create_instrument(): they live
+// in the UI arena rather than in function statics.
+//
+typedef struct instrument_ui_t
+{
+    lv_coord_t col_dsc[INSTR_NUM_KEY + 1];
+    lv_coord_t row_dsc[5];
+    lv_style_t main_style;
+    lv_style_t upper_style;
+    lv_style_t white_key_style;
+    lv_style_t black_key_style;
+    lv_obj_t * p_wave_list;     /* Refreshed on a preset switch */
+    lv_obj_t * p_osc_mode_label;
+    lv_obj_t * p_knob;
+    lv_obj_t * p_knob_label;
+} instrument_ui_t;
 
 static void
 on_button_cb (lv_event_t * p_event)
 {
-    lv_obj_t * p_btn = lv_event_get_target_obj(p_event);
+    TRACE_SCOPE("on_button_cb");
     key_number_t * p_active_key =
                             (key_number_t *) lv_event_get_user_data(p_event);
-    char cmd_array[70] = {0};
-    double key_freq = pow(2.0, ((double) p_active_key->num - 9.0) / 12.0)
-                      * 440.0;   /* Align to middle C */
-    
+    uint8_t note = INSTR_BASE_NOTE + p_active_key->num;
+
     switch (p_event->code)
     {
         case LV_EVENT_PRESSED:
         {
-            lv_log("PRESSED %f\n", key_freq);
-            sprintf(cmd_array,
-                    "play -V1 -r 48000 -n synth sin %f trim 0 0.5 vol %f&",
-                    key_freq,
-                    (double) *gp_volume / 100.0 / (double) (*gp_q_key_press + 1));
-            lv_log("## cmd: %s", cmd_array);
-            system(cmd_array);
-            fflush(NULL);
-            ++(*gp_q_key_press);
+            DLOG("PRESSED note %u\n", note);
+            instrument_key(p_active_key->p_instr, p_active_key->num, 1);
         }
         break;
 
         case LV_EVENT_RELEASED:
         {
-            lv_log("RELEASED\n");
-            system("pkill play");
-            fflush(NULL);
-            --(*gp_q_key_press);
+            DLOG("RELEASED note %u\n", note);
+            instrument_key(p_active_key->p_instr, p_active_key->num, 0);
         }
         break;
 
         default:
         break;
     }
-    
 }   /* on_button_cb() */
 
 static void
 on_knob_cb (lv_event_t * p_event)
 {
+    TRACE_SCOPE("on_knob_cb");
+
     switch (p_event->code)
     {
         case LV_EVENT_VALUE_CHANGED:
         {
             lv_obj_t * p_knob = lv_event_get_target_obj(p_event);
-            lv_obj_t * p_knob_label =
-                                (lv_obj_t *) lv_event_get_user_data(p_event);
+            instrument_t * p_instr =
+                            (instrument_t *) lv_event_get_user_data(p_event);
 
-            *gp_volume = lv_arc_get_value(p_knob);
+            // The label is the first child of the knob's panel.
+            //
+            lv_obj_t * p_knob_label = lv_obj_get_child(lv_obj_get_parent(p_knob),
+                                                       0);
 
-            lv_label_set_text_fmt(p_knob_label, "%d%%", *gp_volume);
+            instrument_set_volume(p_instr, (uint8_t) lv_arc_get_value(p_knob));
+            lv_label_set_text_fmt(p_knob_label, "%d%%", p_instr->prop.volume);
         }
         break;
 
@@ -79,53 +114,616 @@ on_knob_cb (lv_event_t * p_event)
 static void
 on_drop_cb (lv_event_t * p_event)
 {
+    TRACE_SCOPE("on_drop_cb");
+
+    switch (p_event->code)
+    {
+        case LV_EVENT_VALUE_CHANGED:
+        {
+            lv_obj_t * p_drop = lv_event_get_target_obj(p_event);
+            instrument_t * p_instr =
+                            (instrument_t *) lv_event_get_user_data(p_event);
 
+            instrument_set_waveform(p_instr,
+                            (uint8_t) lv_dropdown_get_selected(p_drop));
+        }
+        break;
+
+        default:
+        break;
+    }
 }   /* on_drop_cb() */
 
+static void
+on_osc_mode_cb (lv_event_t * p_event)
+{
+    TRACE_SCOPE("on_osc_mode_cb");
+    instrument_t * p_instr = (instrument_t *) lv_event_get_user_data(p_event);
+
+    switch (p_event->code)
+    {
+        case LV_EVENT_CLICKED:
+        {
+            instrument_set_osc_mode(p_instr, (osc_mode_t)
+                                    ((p_instr->prop.osc_mode + 1)
+                                     % OSC_NUM_MODE));
+        }
+        break;
+
+        default:
+        break;
+    }
+}   /* on_osc_mode_cb() */
+
+synth_t *
+instrument_engine_create (void)
+{
+    synth_t * p_synth = (synth_t *) mem_alloc(MEM_AUDIO, sizeof(synth_t));
+
+    if ((NULL == p_synth)
+        || (0 == synth_init(p_synth, mem_get_arena(MEM_AUDIO),
+                            SYNTH_SAMPLE_RATE))
+        || (0 == synth_set_threads(p_synth, mem_get_arena(MEM_AUDIO),
+                                   INSTR_RENDER_THREADS)))
+    {
+        return (NULL);
+    }
+
+    // Sampled piano: attacks and stream rings in MEM_REC, ahead of the
+    // looper which takes whatever is left. Optional, the synth plays on
+    // without it.
+    //
+    if (sampler_set_map(&g_sample_set, SAMPLER_SET_PATH))
+    {
+        sampler_t * p_sampler = sampler_create(
+                        mem_alloc(MEM_REC, sizeof(sampler_t)),
+                        mem_get_arena(MEM_REC), &g_sample_set,
+                        SYNTH_SAMPLE_RATE);
+
+        if (NULL != p_sampler)
+        {
+#if !INSTR_SYNC_PREFETCH
+            sampler_start(p_sampler);
+#endif
+            synth_set_sampler(p_synth, p_sampler);
+        }
+        else
+        {
+            DLOG("sampler: no room in MEM_REC\n");
+        }
+    }
+
+    return (p_synth);
+}   /* instrument_engine_create() */
+
+// The sequencer plays the keyboard's layers and zones as they are when
+// the pattern is next committed.
+//
+static void
+seq_layers (instrument_t * p_instr)
+{
+    seq_pattern_t * p_pat = seq_edit(p_instr->p_seq);
+
+    p_pat->num_layer = 0;
+
+    for (instrument_t * p_part = p_instr;
+         (NULL != p_part) && (p_pat->num_layer < SEQ_MAX_LAYER);
+         p_part = p_part->p_layer)
+    {
+        seq_layer_t * p_layer = &p_pat->layer[p_pat->num_layer++];
+
+        p_layer->part = p_part->part;
+        p_layer->zone_lo = p_part->zone_lo;
+        p_layer->zone_hi = p_part->zone_hi;
+        p_layer->transpose = p_part->transpose;
+    }
+}   /* seq_layers() */
+
+static void
+on_mode_cb (lv_event_t * p_event)
+{
+    TRACE_SCOPE("on_mode_cb");
+    lv_obj_t * p_btn = lv_event_get_target_obj(p_event);
+    instrument_t * p_instr = (instrument_t *) lv_event_get_user_data(p_event);
+    seq_pattern_t * p_pat = seq_edit(p_instr->p_seq);
+
+    switch (p_event->code)
+    {
+        case LV_EVENT_CLICKED:
+        {
+            // Keys held for the arpeggiator are forgotten with it.
+            //
+            p_pat->mode = (uint8_t) ((p_pat->mode + 1) % SEQ_NUM_MODE);
+            memset(p_pat->held, 0, sizeof(p_pat->held));
+            seq_layers(p_instr);
+            seq_commit(p_instr->p_seq);
+
+            lv_label_set_text(lv_obj_get_child(p_btn, 0),
+                              g_seq_mode_names[p_pat->mode]);
+        }
+        break;
+
+        default:
+        break;
+    }
+}   /* on_mode_cb() */
+
+static void
+on_loop_cb (lv_event_t * p_event)
+{
+    TRACE_SCOPE("on_loop_cb");
+    lv_obj_t * p_btn = lv_event_get_target_obj(p_event);
+    instrument_t * p_instr = (instrument_t *) lv_event_get_user_data(p_event);
+    looper_state_t state = looper_get_state(p_instr->p_looper);
+
+    // The command lands on the next audio block: label the state it will
+    // lead to. A long press clears the loop.
+    //
+    switch (p_event->code)
+    {
+        case LV_EVENT_SHORT_CLICKED:
+        {
+            looper_command(p_instr->p_looper, LOOPER_CMD_NEXT);
+            state = (LOOPER_IDLE == state) ? LOOPER_RECORD
+                  : ((LOOPER_PLAY == state) ? LOOPER_OVERDUB : LOOPER_PLAY);
+        }
+        break;
+
+        case LV_EVENT_LONG_PRESSED:
+        {
+            looper_command(p_instr->p_looper, LOOPER_CMD_CLEAR);
+            state = LOOPER_IDLE;
+        }
+        break;
+
+        default:
+        return;
+    }
+
+    lv_label_set_text(lv_obj_get_child(p_btn, 0), g_looper_names[state]);
+}   /* on_loop_cb() */
+
+static void
+on_rec_cb (lv_event_t * p_event)
+{
+    TRACE_SCOPE("on_rec_cb");
+    lv_obj_t * p_btn = lv_event_get_target_obj(p_event);
+    instrument_t * p_instr = (instrument_t *) lv_event_get_user_data(p_event);
+
+    switch (p_event->code)
+    {
+        case LV_EVENT_CLICKED:
+        {
+            if (rec_is_armed(p_instr->p_rec))
+            {
+                rec_stop(p_instr->p_rec);
+            }
+            else
+            {
+                rec_start(p_instr->p_rec);
+            }
+
+            lv_label_set_text(lv_obj_get_child(p_btn, 0),
+                              rec_is_armed(p_instr->p_rec) ? "Stop" : "Rec");
+        }
+        break;
+
+        default:
+        break;
+    }
+}   /* on_rec_cb() */
+
+static void
+on_preset_cb (lv_event_t * p_event)
+{
+    TRACE_SCOPE("on_preset_cb");
+    lv_obj_t * p_btn = lv_event_get_target_obj(p_event);
+    instrument_t * p_instr = (instrument_t *) lv_event_get_user_data(p_event);
+    preset_bank_t * p_bank = p_instr->p_bank;
+
+    switch (p_event->code)
+    {
+        case LV_EVENT_SHORT_CLICKED:
+        {
+            p_instr->preset = preset_bank_next(p_bank, p_instr->preset);
+            instrument_set_preset(p_instr, &p_bank->p_preset[p_instr->preset]);
+        }
+        break;
+
+        case LV_EVENT_LONG_PRESSED:
+        {
+            // First free slot, so factory sounds are never overwritten.
+            //
+            preset_t preset;
+            uint32_t slot = 0;
+
+            while ((slot < p_bank->count)
+                   && ('\0' != p_bank->p_preset[slot].name[0]))
+            {
+                ++slot;
+            }
+
+            synth_get_preset(p_instr->p_synth, &preset);
+            snprintf(preset.name, sizeof(preset.name), "User %u",
+                     (unsigned) slot);
+
+            if ((slot >= p_bank->count)
+                || !preset_bank_store(p_bank, slot, &preset))
+            {
+                DLOG("preset: no slot to store into\n");
+                return;
+            }
+
+            p_instr->preset = slot;
+        }
+        break;
+
+        default:
+        return;
+    }
+
+    lv_label_set_text(lv_obj_get_child(p_btn, 0),
+                      p_bank->p_preset[p_instr->preset].name);
+}   /* on_preset_cb() */
+
+static void
+on_sampler_timer (lv_timer_t * p_timer)
+{
+    sampler_t * p_sampler = (sampler_t *) lv_timer_get_user_data(p_timer);
+    static uint32_t underruns = 0;
+    sampler_stats_t stats;
+
+    // Without a prefetch thread the UI loop feeds the streams.
+    //
+#if !SAMPLER_FILES
+    sampler_prefetch(p_sampler);
+#endif
+
+    sampler_get_stats(p_sampler, &stats);
+
+    if (stats.underruns != underruns)
+    {
+        underruns = stats.underruns;
+        DLOG("sampler: %u underruns, %u frames of silence\n",
+             (unsigned) stats.underruns, (unsigned) stats.underrun_frames);
+    }
+}   /* on_sampler_timer() */
+
+// Recorder ring, then a looper buffer as long as what is left of MEM_REC
+// allows, with a button for each in the volume panel.
+//
+static void
+create_tape (instrument_t * p_instr, lv_obj_t * p_panel)
+{
+    mem_arena_t * p_arena = mem_get_arena(MEM_REC);
+    uint32_t max_frames = 0;
+    int16_t * p_buf = NULL;
+    lv_obj_t * p_btn = NULL;
+
+#if REC_FILES
+    p_instr->p_rec = rec_create(mem_alloc(MEM_REC, sizeof(rec_t)),
+                                (int16_t *) mem_alloc(MEM_REC,
+                                                      REC_RING_FRAMES * 4U),
+                                SYNTH_SAMPLE_RATE);
+#endif
+
+    if (p_arena->size > p_arena->used + sizeof(looper_t) + 2 * MEM_ALIGN)
+    {
+        p_instr->p_looper = (looper_t *) mem_alloc(MEM_REC, sizeof(looper_t));
+        max_frames = (p_arena->size - p_arena->used - MEM_ALIGN) / 4U;
+        p_buf = (int16_t *) mem_alloc(MEM_REC, max_frames * 4U);
+    }
+
+    if ((NULL != p_instr->p_looper) && (NULL != p_buf))
+    {
+        looper_init(p_instr->p_looper, p_buf, max_frames);
+        synth_set_looper(p_instr->p_synth, p_instr->p_looper);
+        DLOG("looper: %u s\n", max_frames / SYNTH_SAMPLE_RATE);
+
+        p_btn = lv_button_create(p_panel);
+        lv_label_set_text(lv_label_create(p_btn), g_looper_names[LOOPER_IDLE]);
+        lv_obj_align(p_btn, LV_ALIGN_TOP_RIGHT, 0, 0);
+        lv_obj_add_event_cb(p_btn, on_loop_cb, LV_EVENT_SHORT_CLICKED, p_instr);
+        lv_obj_add_event_cb(p_btn, on_loop_cb, LV_EVENT_LONG_PRESSED, p_instr);
+    }
+    else
+    {
+        p_instr->p_looper = NULL;
+    }
+
+    if (NULL != p_instr->p_rec)
+    {
+        synth_set_rec(p_instr->p_synth, p_instr->p_rec);
+
+        p_btn = lv_button_create(p_panel);
+        lv_label_set_text(lv_label_create(p_btn), "Rec");
+        lv_obj_align(p_btn, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+        lv_obj_add_event_cb(p_btn, on_rec_cb, LV_EVENT_CLICKED, p_instr);
+    }
+}   /* create_tape() */
+
 uint8_t
-init_instrument (instrument_t * p_instr)
+init_instrument (instrument_t * p_instr, synth_t * p_synth)
 {
-    p_instr->prop.volume = 100;
+    int32_t part = synth_part_add(p_synth);
+
+    if (part < 0)
+    {
+        return (0);
+    }
+
+    p_instr->p_synth = p_synth;
+    p_instr->part = (uint8_t) part;
     p_instr->q_key_press = 0;
+    p_instr->zone_lo = 0;
+    p_instr->zone_hi = 127;
+    p_instr->transpose = 0;
+    p_instr->p_layer = NULL;
+    p_instr->p_seq = NULL;
+    p_instr->p_looper = NULL;
+    p_instr->p_rec = NULL;
+    p_instr->p_bank = NULL;
+    p_instr->preset = 0;
+    p_instr->p_ui = NULL;
+
+    for (uint32_t idx = 0; idx < INSTR_NUM_KEY; ++idx)
+    {
+        p_instr->key[idx].p_instr = p_instr;
+    }
+
+    p_instr->prop.osc_mode = OSC_DEFAULT_MODE;
+    instrument_set_volume(p_instr, 100);
+    instrument_set_waveform(p_instr, OSC_SINE);
 
     return (1);
 }   /* init_instrument() */
 
+int32_t
+instrument_part_note (const instrument_t * p_part, uint8_t note)
+{
+    int32_t part_note = (int32_t) note + p_part->transpose;
+
+    if ((note < p_part->zone_lo) || (note > p_part->zone_hi)
+        || (part_note < 0) || (part_note > 127))
+    {
+        return (-1);
+    }
+
+    return (part_note);
+}   /* instrument_part_note() */
+
+void
+instrument_key (instrument_t * p_instr, uint8_t key, uint8_t b_pressed)
+{
+    uint8_t note = INSTR_BASE_NOTE + key;
+
+    if (b_pressed)
+    {
+        ++p_instr->q_key_press;
+    }
+    else
+    {
+        --p_instr->q_key_press;
+    }
+
+    // The arpeggiator plays the held keys itself; the step sequencer
+    // records each key into the next step and lets it sound as well.
+    // Either plays through the same layers and zones as the keys.
+    //
+    if ((NULL != p_instr->p_seq)
+        && (SEQ_MODE_ARP == seq_edit(p_instr->p_seq)->mode))
+    {
+        seq_layers(p_instr);
+        seq_hold(p_instr->p_seq, note, b_pressed);
+        return;
+    }
+
+    if ((NULL != p_instr->p_seq)
+        && (SEQ_MODE_STEP == seq_edit(p_instr->p_seq)->mode) && b_pressed)
+    {
+        seq_layers(p_instr);
+        seq_record(p_instr->p_seq, note, 127);
+    }
+
+    // Every instrument layered on this keyboard whose zone holds the key.
+    //
+    for (instrument_t * p_part = p_instr; NULL != p_part;
+         p_part = p_part->p_layer)
+    {
+        int32_t part_note = instrument_part_note(p_part, note);
+
+        if (part_note < 0)
+        {
+            continue;
+        }
+
+        if (b_pressed)
+        {
+            synth_note_on(p_part->p_synth, p_part->part, (uint8_t) part_note,
+                          127);
+        }
+        else
+        {
+            synth_note_off(p_part->p_synth, p_part->part,
+                           (uint8_t) part_note);
+        }
+    }
+}   /* instrument_key() */
+
+void
+instrument_set_zone (instrument_t * p_instr, uint8_t zone_lo, uint8_t zone_hi,
+                     int8_t transpose)
+{
+    // Zones are read on every key, so change them between notes: a zone
+    // moved under a held key would route its release elsewhere.
+    //
+    p_instr->zone_lo = zone_lo;
+    p_instr->zone_hi = zone_hi;
+    p_instr->transpose = transpose;
+}   /* instrument_set_zone() */
+
+void
+instrument_set_waveform (instrument_t * p_instr, uint8_t wave)
+{
+    if (synth_set_waveform(p_instr->p_synth, p_instr->part, wave,
+                           (osc_mode_t) p_instr->prop.osc_mode))
+    {
+        p_instr->prop.waveform = wave;
+    }
+}   /* instrument_set_waveform() */
+
+void
+instrument_set_osc_mode (instrument_t * p_instr, osc_mode_t mode)
+{
+    if (mode >= OSC_NUM_MODE)
+    {
+        return;
+    }
+
+    p_instr->prop.osc_mode = (uint8_t) mode;
+    synth_set_waveform(p_instr->p_synth, p_instr->part,
+                       p_instr->prop.waveform, mode);
+
+    if (NULL != p_instr->p_ui)
+    {
+        lv_label_set_text(p_instr->p_ui->p_osc_mode_label,
+                          g_osc_mode_names[mode]);
+    }
+}   /* instrument_set_osc_mode() */
+
+void
+instrument_set_unison (instrument_t * p_instr, uint8_t count,
+                       float detune_cents, float spread)
+{
+    synth_set_unison(p_instr->p_synth, p_instr->part, count, detune_cents,
+                     spread);
+}   /* instrument_set_unison() */
+
+void
+instrument_set_volume (instrument_t * p_instr, uint8_t volume)
+{
+    p_instr->prop.volume = volume;
+    synth_set_volume(p_instr->p_synth, p_instr->part, volume);
+}   /* instrument_set_volume() */
+
+void
+instrument_layer (instrument_t * p_instr, instrument_t * p_layer)
+{
+    while (NULL != p_instr->p_layer)
+    {
+        p_instr = p_instr->p_layer;
+    }
+
+    p_instr->p_layer = p_layer;
+}   /* instrument_layer() */
+
+void
+instrument_set_bank (instrument_t * p_instr, preset_bank_t * p_bank)
+{
+    p_instr->p_bank = p_bank;
+    p_instr->preset = 0;
+
+    // The sound matches the slot the button shows from the start: slot 0,
+    // or the first one after it holding a preset.
+    //
+    if ((NULL == p_bank) || (0 == p_bank->count))
+    {
+        p_instr->p_bank = NULL;
+        return;
+    }
+
+    if ('\0' == p_bank->p_preset[0].name[0])
+    {
+        p_instr->preset = preset_bank_next(p_bank, 0);
+    }
+
+    instrument_set_preset(p_instr, &p_bank->p_preset[p_instr->preset]);
+}   /* instrument_set_bank() */
+
+void
+instrument_set_preset (instrument_t * p_instr, const preset_t * p_preset)
+{
+    synth_set_preset(p_instr->p_synth, p_preset);
+
+    for (instrument_t * p_part = p_instr; NULL != p_part;
+         p_part = p_part->p_layer)
+    {
+        if (p_part->part < PRESET_NUM_PART)
+        {
+            p_part->prop.volume = p_preset->part[p_part->part].volume;
+            p_part->prop.waveform = p_preset->part[p_part->part].wave;
+            p_part->prop.osc_mode = p_preset->part[p_part->part].mode
+                                    % OSC_NUM_MODE;
+        }
+    }
+
+    // Widgets set directly send no VALUE_CHANGED, so nothing is queued
+    // behind the switch.
+    //
+    if (NULL != p_instr->p_ui)
+    {
+        lv_dropdown_set_selected(p_instr->p_ui->p_wave_list,
+                                 p_instr->prop.waveform);
+        lv_label_set_text(p_instr->p_ui->p_osc_mode_label,
+                          g_osc_mode_names[p_instr->prop.osc_mode]);
+        lv_arc_set_value(p_instr->p_ui->p_knob, p_instr->prop.volume);
+        lv_label_set_text_fmt(p_instr->p_ui->p_knob_label, "%d%%",
+                              p_instr->prop.volume);
+    }
+}   /* instrument_set_preset() */
+
+void
+instrument_set_tempo (instrument_t * p_instr, uint16_t bpm, uint8_t swing_pct)
+{
+    seq_pattern_t * p_pat = NULL;
+
+    if (NULL == p_instr->p_seq)
+    {
+        return;
+    }
+
+    p_pat = seq_edit(p_instr->p_seq);
+    p_pat->bpm = bpm;
+    p_pat->swing_pct = swing_pct;
+    seq_commit(p_instr->p_seq);
+}   /* instrument_set_tempo() */
+
 void
 create_instrument (instrument_t * p_instr)
 {
     int32_t idx = 0;
-    static key_number_t * p_key_num = NULL;
-    static lv_coord_t col_dsc[INSTR_NUM_KEY] = {0};
-    static lv_style_t main_style{0};
-    static lv_style_t upper_style{0};
-    static lv_style_t white_key_style{0};
-    static lv_style_t black_key_style{0};
+    key_number_t * p_key_num = NULL;
+    instrument_ui_t * p_ui = NULL;
     const char key_name_list[INSTR_NUM_KEY][3] = {"C", "C#", "D", "D#", "E",
                                                   "F", "F#", "G", "G#", "A",
                                                   "A#", "B", "C"};
 
-    gp_volume = &p_instr->prop.volume;
-    gp_q_key_press = &p_instr->q_key_press;
+    p_ui = (instrument_ui_t *) mem_alloc(MEM_UI, sizeof(instrument_ui_t));
 
-    // Workaround to make the first played note emitting sound.
-    //
-    system("play");
+    if (NULL == p_ui)
+    {
+        DLOG("No memory for the instrument UI\n");
+        return;
+    }
 
     for (idx = 0; idx < INSTR_NUM_KEY; ++idx)
     {
-        col_dsc[idx] = LV_GRID_FR(1);
+        p_ui->col_dsc[idx] = LV_GRID_FR(1);
         p_key_num = &p_instr->key[idx];
         strncpy(p_key_num->key_name, key_name_list[idx], 3);
     }
 
-    col_dsc[INSTR_NUM_KEY] = LV_GRID_TEMPLATE_LAST;
+    p_ui->col_dsc[INSTR_NUM_KEY] = LV_GRID_TEMPLATE_LAST;
 
-    static lv_coord_t row_dsc[] = {LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1),
-                                   LV_GRID_FR(1), LV_GRID_TEMPLATE_LAST};
+    for (idx = 0; idx < 4; ++idx)
+    {
+        p_ui->row_dsc[idx] = LV_GRID_FR(1);
+    }
+
+    p_ui->row_dsc[4] = LV_GRID_TEMPLATE_LAST;
 
     lv_obj_t * p_screen(lv_screen_active());
-    lv_obj_set_grid_dsc_array(p_screen, col_dsc, row_dsc);
+    lv_obj_set_grid_dsc_array(p_screen, p_ui->col_dsc, p_ui->row_dsc);
     lv_obj_set_grid_align(p_screen, LV_GRID_ALIGN_CENTER, LV_GRID_ALIGN_CENTER);
 
     // ROW 0
@@ -142,44 +740,109 @@ create_instrument (instrument_t * p_instr)
 
     // Style for Row 0.
     //
-    lv_style_init(&main_style);
-    lv_style_set_bg_color(&main_style, lv_palette_main(LV_PALETTE_LIGHT_GREEN));
-    lv_obj_add_style(p_screen, &main_style, LV_PART_MAIN);
+    lv_style_init(&p_ui->main_style);
+    lv_style_set_bg_color(&p_ui->main_style,
+                          lv_palette_main(LV_PALETTE_LIGHT_GREEN));
+    lv_obj_add_style(p_screen, &p_ui->main_style, LV_PART_MAIN);
 
-    lv_style_init(&upper_style);
-    lv_style_set_bg_color(&upper_style, lv_palette_main(LV_PALETTE_GREY));
-    lv_obj_add_style(p_waveform_ctrl, &upper_style, LV_PART_MAIN);
-    lv_obj_add_style(p_volume_ctrl, &upper_style, LV_PART_MAIN);
+    lv_style_init(&p_ui->upper_style);
+    lv_style_set_bg_color(&p_ui->upper_style,
+                          lv_palette_main(LV_PALETTE_GREY));
+    lv_obj_add_style(p_waveform_ctrl, &p_ui->upper_style, LV_PART_MAIN);
+    lv_obj_add_style(p_volume_ctrl, &p_ui->upper_style, LV_PART_MAIN);
 
     // Waveform selector inside Row 0.
     //
     lv_obj_t * p_waveform_list = lv_dropdown_create(p_waveform_ctrl);
-    lv_dropdown_set_options(p_waveform_list, g_waveform_names);
+    lv_dropdown_set_options(p_waveform_list,
+                            (NULL != p_instr->p_synth->p_sampler)
+                            ? g_waveform_sampled_names : g_waveform_names);
+    lv_dropdown_set_selected(p_waveform_list, p_instr->prop.waveform);
+    lv_obj_align(p_waveform_list, LV_ALIGN_TOP_MID, 0, 0);
     lv_obj_add_event_cb(p_waveform_list, on_drop_cb, LV_EVENT_VALUE_CHANGED,
-                        &p_instr->prop.waveform);
+                        p_instr);
+    p_ui->p_wave_list = p_waveform_list;
+
+    // Wavetable / PolyBLEP switch beside it, for this instrument only.
+    //
+    lv_obj_t * p_osc_mode_btn = lv_button_create(p_waveform_ctrl);
+    p_ui->p_osc_mode_label = lv_label_create(p_osc_mode_btn);
+    lv_label_set_text(p_ui->p_osc_mode_label,
+                      g_osc_mode_names[p_instr->prop.osc_mode]);
+    lv_obj_align(p_osc_mode_btn, LV_ALIGN_TOP_RIGHT, 0, 0);
+    lv_obj_add_event_cb(p_osc_mode_btn, on_osc_mode_cb, LV_EVENT_CLICKED,
+                        p_instr);
+
+    // Scope below the selector, fed by the engine this keyboard plays.
+    //
+    scope_view_create(p_waveform_ctrl, p_instr->p_synth);
 
     // Knob inside Row 0.
     //
     lv_obj_t * p_knob_label = lv_label_create(p_volume_ctrl);
-    lv_label_set_text(p_knob_label, "100%");
+    lv_label_set_text_fmt(p_knob_label, "%d%%", p_instr->prop.volume);
     lv_obj_set_align(p_knob_label, LV_ALIGN_CENTER);
     
     lv_obj_t * p_knob = lv_arc_create(p_volume_ctrl);
     lv_obj_center(p_knob);
     lv_arc_set_range(p_knob, 0, 100);
-    lv_arc_set_value(p_knob, 100);
-    lv_obj_add_event_cb(p_knob, on_knob_cb, LV_EVENT_VALUE_CHANGED,
-                        p_knob_label);
+    lv_arc_set_value(p_knob, p_instr->prop.volume);
+    lv_obj_add_event_cb(p_knob, on_knob_cb, LV_EVENT_VALUE_CHANGED, p_instr);
+    p_ui->p_knob = p_knob;
+    p_ui->p_knob_label = p_knob_label;
+    p_instr->p_ui = p_ui;
+
+    // Preset switch in the last corner of the volume panel.
+    //
+    if (NULL != p_instr->p_bank)
+    {
+        lv_obj_t * p_preset_btn = lv_button_create(p_volume_ctrl);
+        lv_label_set_text(lv_label_create(p_preset_btn),
+                          p_instr->p_bank->p_preset[p_instr->preset].name);
+        lv_obj_align(p_preset_btn, LV_ALIGN_BOTTOM_RIGHT, 0, 0);
+        lv_obj_add_event_cb(p_preset_btn, on_preset_cb,
+                            LV_EVENT_SHORT_CLICKED, p_instr);
+        lv_obj_add_event_cb(p_preset_btn, on_preset_cb, LV_EVENT_LONG_PRESSED,
+                            p_instr);
+    }
+
+    // Play / Arp / Seq switch in the corner of the volume panel, for the
+    // sequencer clocked by the engine.
+    //
+    p_instr->p_seq = (seq_t *) mem_alloc(MEM_AUDIO, sizeof(seq_t));
+
+    if (NULL != p_instr->p_seq)
+    {
+        seq_init(p_instr->p_seq, SYNTH_SAMPLE_RATE, p_instr->part);
+        seq_layers(p_instr);
+        seq_commit(p_instr->p_seq);
+        synth_set_seq(p_instr->p_synth, p_instr->p_seq);
+
+        lv_obj_t * p_mode_btn = lv_button_create(p_volume_ctrl);
+        lv_obj_t * p_mode_label = lv_label_create(p_mode_btn);
+        lv_label_set_text(p_mode_label, g_seq_mode_names[SEQ_MODE_OFF]);
+        lv_obj_align(p_mode_btn, LV_ALIGN_TOP_LEFT, 0, 0);
+        lv_obj_add_event_cb(p_mode_btn, on_mode_cb, LV_EVENT_CLICKED, p_instr);
+    }
+
+    if (NULL != p_instr->p_synth->p_sampler)
+    {
+        lv_timer_create(on_sampler_timer, SAMPLER_POLL_MS,
+                        p_instr->p_synth->p_sampler);
+    }
+
+    create_tape(p_instr, p_volume_ctrl);
 
     // ROW 1
     //
     lv_obj_t * p_btn = NULL;
 
-    lv_style_init(&white_key_style);
-    lv_style_set_bg_color(&white_key_style, {0xFF, 0xFF, 0xFF});
+    lv_style_init(&p_ui->white_key_style);
+    lv_style_set_bg_color(&p_ui->white_key_style, {0xFF, 0xFF, 0xFF});
 
-    lv_style_init(&black_key_style);
-    lv_style_set_bg_color(&black_key_style, lv_palette_main(LV_PALETTE_NONE));
+    lv_style_init(&p_ui->black_key_style);
+    lv_style_set_bg_color(&p_ui->black_key_style,
+                          lv_palette_main(LV_PALETTE_NONE));
 
     for (idx = 0; idx < INSTR_NUM_KEY; ++idx)
     {
@@ -202,18 +865,47 @@ create_instrument (instrument_t * p_instr)
         //
         if ((1 == idx) || (3 == idx) || (6 == idx) || (8 == idx) || (10 == idx))
         {
-            lv_obj_add_style(p_btn, &black_key_style, LV_PART_MAIN);
+            lv_obj_add_style(p_btn, &p_ui->black_key_style, LV_PART_MAIN);
             lv_obj_set_style_text_color(p_key_label, {0xFF, 0xFF, 0xFF}, 0);
             lv_obj_set_grid_cell(p_btn, LV_GRID_ALIGN_STRETCH, idx, 1,
                                  LV_GRID_ALIGN_STRETCH, 2, 1);
         }
         else
         {
-            lv_obj_add_style(p_btn, &white_key_style, LV_PART_MAIN);
+            lv_obj_add_style(p_btn, &p_ui->white_key_style, LV_PART_MAIN);
             lv_obj_set_style_text_color(p_key_label, {0x0, 0x0, 0x0}, 0);
             lv_obj_set_grid_cell(p_btn, LV_GRID_ALIGN_STRETCH, idx, 1,
                                  LV_GRID_ALIGN_STRETCH, 2, 2);
         }
     }
 
-}   /* create_instrument() */
\ No newline at end of file
+}   /* create_instrument() */
+
+void
+instrument_render (void * p_user, int16_t * p_out, uint32_t frames)
+{
+    TRACE_SCOPE("synth_render");
+    synth_t * p_synth = (synth_t *) p_user;
+
+#if INSTR_SYNC_PREFETCH
+    if (NULL != p_synth->p_sampler)
+    {
+        sampler_prefetch(p_synth->p_sampler);
+    }
+#endif
+
+    synth_render(p_synth, p_out, frames);
+}   /* instrument_render() */
+
+uint8_t
+instrument_fx_enable (instrument_t * p_instr, fx_id_t fx_id, uint8_t enable)
+{
+    return (synth_fx_enable(p_instr->p_synth, fx_id, enable));
+}   /* instrument_fx_enable() */
+
+uint8_t
+instrument_fx_param (instrument_t * p_instr, fx_id_t fx_id, fx_param_t param,
+                     float value)
+{
+    return (synth_fx_param(p_instr->p_synth, fx_id, param, value));
+}   /* instrument_fx_param() */
\ No newline at end of file
@@ -2,31 +2,115 @@
 
 #   define INSTRUMENT_H
 #   include <stdint.h>
+#   include "fx.h"
+#   include "synth.h"
 
 #   define INSTR_NUM_KEY    (13)
 #   define SCREEN_WIDTH     (320)
 #   define SCREEN_HEIGHT    (240)
+#   define INSTR_BASE_NOTE  (60)    /* MIDI note of the first key, middle C */
+#   ifndef INSTR_RENDER_THREADS
+#       define INSTR_RENDER_THREADS (1) /* Voice render threads, native */
+#   endif
+
+// Under the virtual clock (HAL_SIM_CLOCK, hal/sdl2) the sample streams are
+// filled by the audio callback before each render, not by the prefetch
+// thread, so what a run plays depends on the clock alone.
+//
+#   if defined(HAL_SIM_CLOCK) && HAL_SIM_CLOCK
+#       define INSTR_SYNC_PREFETCH  (1)
+#   else
+#       define INSTR_SYNC_PREFETCH  (0)
+#   endif
+
+struct instrument_t;
+struct instrument_ui_t;
 
 typedef struct key_number_t
 {
     uint8_t num;
     char key_name[3];
+    struct instrument_t * p_instr;  /* Owner of the keyboard */
 } key_number_t;
 
 typedef struct properties_t
 {
     uint8_t volume;
     uint8_t waveform;
+    uint8_t osc_mode;       /* osc_mode_t, for the oscillator waveforms */
 } properties_t;
 
+// One timbre on a shared engine. Instruments chained with
+// instrument_layer() all follow the first one's keyboard, each playing
+// the notes inside its own zone: overlapping zones layer, disjoint zones
+// split the keyboard.
+//
 typedef struct instrument_t
 {
     key_number_t key[INSTR_NUM_KEY];
     properties_t prop;
     uint8_t q_key_press;
+    synth_t * p_synth;
+    uint8_t part;
+    uint8_t zone_lo;        /* MIDI notes, inclusive */
+    uint8_t zone_hi;
+    int8_t transpose;       /* Semitones added to the notes played */
+    struct instrument_t * p_layer;
+    seq_t * p_seq;          /* Arp / step sequencer of the keyboard */
+    looper_t * p_looper;    /* NULL without MEM_REC */
+    rec_t * p_rec;          /* NULL without MEM_REC */
+    preset_bank_t * p_bank; /* NULL: no preset button */
+    uint32_t preset;        /* Slot last switched to */
+    struct instrument_ui_t * p_ui;
 } instrument_t;
 
+// The engine every instrument plays on: voices, effects and render
+// threads, taken from the audio arena.
+//
+synth_t * instrument_engine_create(void);
+
 void create_instrument(instrument_t * p_instr);
-uint8_t init_instrument(instrument_t * p_instr);
+uint8_t init_instrument(instrument_t * p_instr, synth_t * p_synth);
+void instrument_set_zone(instrument_t * p_instr, uint8_t zone_lo,
+                         uint8_t zone_hi, int8_t transpose);
+void instrument_set_waveform(instrument_t * p_instr, uint8_t wave);
+void instrument_set_osc_mode(instrument_t * p_instr, osc_mode_t mode);
+void instrument_set_unison(instrument_t * p_instr, uint8_t count,
+                           float detune_cents, float spread);
+void instrument_set_volume(instrument_t * p_instr, uint8_t volume);
+void instrument_layer(instrument_t * p_instr, instrument_t * p_layer);
+
+// Keyboard key `key` (0 to INSTR_NUM_KEY - 1) pressed or released: feeds
+// the sequencer, or plays every layered instrument whose zone holds it.
+// instrument_part_note() is the note `p_part` plays for keyboard `note`,
+// -1 outside its zone or the MIDI range.
+//
+void instrument_key(instrument_t * p_instr, uint8_t key, uint8_t b_pressed);
+int32_t instrument_part_note(const instrument_t * p_part, uint8_t note);
+
+// Presets cover the whole engine: every part, so every layered
+// instrument, and the shared effects. instrument_set_bank() switches to
+// the bank's first preset; before create_instrument() it adds a preset
+// button: click for the next one, long press to store the current sound
+// into a free slot (native).
+//
+void instrument_set_bank(instrument_t * p_instr, preset_bank_t * p_bank);
+void instrument_set_preset(instrument_t * p_instr, const preset_t * p_preset);
+
+// Sequencer clock, once create_instrument() has made the sequencer.
+//
+void instrument_set_tempo(instrument_t * p_instr, uint16_t bpm,
+                          uint8_t swing_pct);
+
+// Audio callback, `p_user` is the engine.
+//
+void instrument_render(void * p_user, int16_t * p_out, uint32_t frames);
+
+// Effects sit on the engine output, so they are shared by all instruments.
+//
+uint8_t instrument_fx_enable(instrument_t * p_instr, fx_id_t fx_id,
+                             uint8_t enable);
+uint8_t instrument_fx_param(instrument_t * p_instr, fx_id_t fx_id,
+                            fx_param_t param, float value);
 
 #endif /* INSTRUMENT_H */
\ No newline at end of file
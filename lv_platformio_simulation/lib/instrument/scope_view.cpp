@@ -0,0 +1,178 @@
+#include "scope_view.h"
+#include "mem.h"
+#include "dlog.h"
+#include "trace.h"
+
+static void on_scope_timer(lv_timer_t * p_timer);
+static void on_chart_cb(lv_event_t * p_event);
+static void on_display_cb(lv_event_t * p_event);
+
+static void
+scope_view_report (scope_view_t * p_view)
+{
+    perf_counter_t * p_cost = &p_view->cost;
+
+    DLOG("scope %s: mean %u us, peak %u us, budget %u us, %u over\n",
+         p_view->b_spectrum ? "spectrum" : "waveform",
+         perf_ticks_to_ns((uint32_t) (p_cost->total / p_cost->count)) / 1000U,
+         perf_ticks_to_ns(p_cost->peak) / 1000U, SCOPE_VIEW_BUDGET_US,
+         p_view->num_over);
+
+    perf_counter_reset(p_cost);
+    p_view->num_over = 0;
+}   /* scope_view_report() */
+
+static void
+scope_view_frame_done (scope_view_t * p_view)
+{
+    perf_counter_add(&p_view->cost, p_view->frame_ticks);
+
+    if (perf_ticks_to_ns(p_view->frame_ticks) > SCOPE_VIEW_BUDGET_US * 1000U)
+    {
+        ++p_view->num_over;
+    }
+
+    p_view->frame_ticks = 0;
+
+    if (SCOPE_VIEW_REPORT == p_view->cost.count)
+    {
+        scope_view_report(p_view);
+    }
+}   /* scope_view_frame_done() */
+
+static void
+on_scope_timer (lv_timer_t * p_timer)
+{
+    TRACE_SCOPE("scope_frame");
+    scope_view_t * p_view = (scope_view_t *) lv_timer_get_user_data(p_timer);
+    uint32_t start = perf_ticks();
+    const int16_t * p_snap = scope_read(p_view->p_scope);
+
+    // Nothing new (audio stopped): leave the chart alone, no redraw.
+    //
+    if (NULL == p_snap)
+    {
+        return;
+    }
+
+    if (p_view->b_spectrum)
+    {
+        scope_spectrum(&p_view->fft, p_snap, p_view->point);
+    }
+    else
+    {
+        scope_waveform(p_snap, p_view->point);
+    }
+
+    // The series points at p_view->point: refresh only invalidates the
+    // chart, which is drawn (and timed) on the next refresh of the display.
+    //
+    lv_chart_refresh(p_view->p_chart);
+    p_view->frame_ticks += perf_ticks() - start;
+}   /* on_scope_timer() */
+
+static void
+on_chart_cb (lv_event_t * p_event)
+{
+    scope_view_t * p_view = (scope_view_t *) lv_event_get_user_data(p_event);
+
+    switch (p_event->code)
+    {
+        case LV_EVENT_DRAW_MAIN_BEGIN:
+            p_view->draw_start = perf_ticks();
+        break;
+
+        case LV_EVENT_DRAW_POST_END:
+            // With partial buffers the chart is drawn once per strip, each
+            // strip adds to the frame.
+            //
+            p_view->frame_ticks += perf_ticks() - p_view->draw_start;
+            p_view->b_drawn = 1;
+        break;
+
+        case LV_EVENT_CLICKED:
+            p_view->b_spectrum = !p_view->b_spectrum;
+            perf_counter_reset(&p_view->cost);
+            p_view->num_over = 0;
+        break;
+
+        default:
+        break;
+    }
+}   /* on_chart_cb() */
+
+static void
+on_display_cb (lv_event_t * p_event)
+{
+    // One frame of the view ends with the display refresh that drew it.
+    //
+    scope_view_t * p_view = (scope_view_t *) lv_event_get_user_data(p_event);
+
+    if (p_view->b_drawn)
+    {
+        p_view->b_drawn = 0;
+        scope_view_frame_done(p_view);
+    }
+}   /* on_display_cb() */
+
+scope_view_t *
+scope_view_create (lv_obj_t * p_parent, synth_t * p_synth)
+{
+    scope_view_t * p_view = (scope_view_t *) mem_alloc(MEM_UI,
+                                                       sizeof(scope_view_t));
+    scope_t * p_scope = (scope_t *) mem_alloc(MEM_AUDIO, sizeof(scope_t));
+
+    if ((NULL == p_view) || (NULL == p_scope)
+        || !scope_fft_init(&p_view->fft))
+    {
+        DLOG("No memory for the scope\n");
+        return (NULL);
+    }
+
+    scope_init(p_scope);
+    synth_set_scope(p_synth, p_scope);
+
+    p_view->p_scope = p_scope;
+    p_view->b_spectrum = 0;
+    p_view->draw_start = 0;
+    p_view->frame_ticks = 0;
+    p_view->b_drawn = 0;
+    p_view->num_over = 0;
+    perf_init();
+    perf_counter_reset(&p_view->cost);
+
+    for (uint32_t idx = 0; idx < SCOPE_POINTS; ++idx)
+    {
+        p_view->point[idx] = SCOPE_RANGE / 2;
+    }
+
+    p_view->p_chart = lv_chart_create(p_parent);
+    lv_obj_set_size(p_view->p_chart, lv_pct(100), lv_pct(55));
+    lv_obj_align(p_view->p_chart, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_chart_set_type(p_view->p_chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_point_count(p_view->p_chart, SCOPE_POINTS);
+    lv_chart_set_range(p_view->p_chart, LV_CHART_AXIS_PRIMARY_Y, 0,
+                       SCOPE_RANGE);
+    lv_chart_set_div_line_count(p_view->p_chart, 3, 0);
+    lv_obj_set_style_size(p_view->p_chart, 0, 0, LV_PART_INDICATOR);
+    lv_obj_set_style_pad_all(p_view->p_chart, 2, LV_PART_MAIN);
+    lv_obj_add_flag(p_view->p_chart, LV_OBJ_FLAG_CLICKABLE);
+
+    p_view->p_series = lv_chart_add_series(p_view->p_chart,
+                                lv_palette_main(LV_PALETTE_LIGHT_GREEN),
+                                LV_CHART_AXIS_PRIMARY_Y);
+    lv_chart_set_ext_y_array(p_view->p_chart, p_view->p_series,
+                             p_view->point);
+
+    lv_obj_add_event_cb(p_view->p_chart, on_chart_cb, LV_EVENT_DRAW_MAIN_BEGIN,
+                        p_view);
+    lv_obj_add_event_cb(p_view->p_chart, on_chart_cb, LV_EVENT_DRAW_POST_END,
+                        p_view);
+    lv_obj_add_event_cb(p_view->p_chart, on_chart_cb, LV_EVENT_CLICKED,
+                        p_view);
+    lv_display_add_event_cb(lv_display_get_default(), on_display_cb,
+                            LV_EVENT_REFR_READY, p_view);
+    lv_timer_create(on_scope_timer, SCOPE_VIEW_PERIOD_MS, p_view);
+
+    return (p_view);
+}   /* scope_view_create() */
@@ -0,0 +1,41 @@
+#ifndef SCOPE_VIEW_H
+
+#   define SCOPE_VIEW_H
+#   include <stdint.h>
+#   include "perf.h"
+#   include "synth.h"
+#   include "lvgl.h"
+
+#   ifndef SCOPE_VIEW_PERIOD_MS
+#       define SCOPE_VIEW_PERIOD_MS     (40)    /* 25 frames per second */
+#   endif
+#   ifndef SCOPE_VIEW_BUDGET_US
+#       define SCOPE_VIEW_BUDGET_US     (1000)  /* Analysis + chart redraw */
+#   endif
+#   define SCOPE_VIEW_REPORT            (250)   /* Frames between reports */
+
+// Oscilloscope / spectrum chart fed by the engine output; a tap on the
+// chart switches between the two. Analysis runs in the LVGL timer, at the
+// UI frame rate, and only the chart area is invalidated.
+//
+typedef struct scope_view_t
+{
+    scope_t * p_scope;
+    lv_obj_t * p_chart;
+    lv_chart_series_t * p_series;
+    uint8_t b_spectrum;
+    int32_t point[SCOPE_POINTS];
+    scope_fft_t fft;
+    uint32_t draw_start;
+    uint32_t frame_ticks;       /* Analysis plus draw of the current frame */
+    uint8_t b_drawn;
+    perf_counter_t cost;        /* Per frame */
+    uint32_t num_over;          /* Frames over SCOPE_VIEW_BUDGET_US */
+} scope_view_t;
+
+// The snapshot comes from the audio arena and the view from the UI arena.
+// Call before audio starts.
+//
+scope_view_t * scope_view_create(lv_obj_t * p_parent, synth_t * p_synth);
+
+#endif /* SCOPE_VIEW_H */
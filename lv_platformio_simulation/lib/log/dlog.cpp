@@ -0,0 +1,364 @@
+#include "dlog.h"
+#include <atomic>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#if !defined(STM32F429xx) && !defined(ESP_PLATFORM)
+#   define DLOG_THREAD      (1)
+#   include <thread>
+#   include <chrono>
+#   define DLOG_PERIOD_MS   (2)
+#endif
+
+static_assert(0 == (DLOG_SLOTS & (DLOG_SLOTS - 1)),
+              "DLOG_SLOTS must be a power of two");
+
+// Bounded multi-producer ring (Vyukov): a slot's sequence tells whether it
+// is free for the writer at `pos` (seq == pos) or holds a record for the
+// reader at `pos` (seq == pos + 1). Producers claim slots with one CAS.
+// Sequences are stored minus the slot index so the zeroed ring is ready
+// before any constructor runs.
+//
+typedef struct dlog_record_t
+{
+    std::atomic<uint32_t> seq;
+    uint32_t num_arg;
+    const char * p_fmt;
+    uint64_t arg[DLOG_MAX_ARGS];
+} dlog_record_t;
+
+static dlog_record_t g_record[DLOG_SLOTS];
+static std::atomic<uint32_t> g_head(0);
+static std::atomic<uint32_t> g_dropped(0);
+static std::atomic<uint8_t> gb_flushing(0);
+static uint32_t g_tail = 0;
+static uint32_t g_reported = 0;
+
+static void
+dlog_stdout (const char * p_text, uint32_t len)
+{
+    fwrite(p_text, 1, len, stdout);
+}   /* dlog_stdout() */
+
+static dlog_sink_t g_sink = dlog_stdout;
+
+void
+dlog_write (const char * p_fmt, uint32_t num_arg, const uint64_t * p_arg)
+{
+    dlog_record_t * p_record = NULL;
+    uint32_t pos = g_head.load(std::memory_order_relaxed);
+    uint32_t slot = 0;
+
+    for (;;)
+    {
+        slot = pos & (DLOG_SLOTS - 1);
+        p_record = &g_record[slot];
+
+        int32_t diff = (int32_t) (p_record->seq.load(std::memory_order_acquire)
+                                  + slot - pos);
+
+        if (0 == diff)
+        {
+            if (g_head.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+
+            return;
+        }
+        else
+        {
+            pos = g_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    p_record->p_fmt = p_fmt;
+    p_record->num_arg = num_arg;
+
+    for (uint32_t idx = 0; idx < num_arg; ++idx)
+    {
+        p_record->arg[idx] = p_arg[idx];
+    }
+
+    p_record->seq.store(pos + 1 - slot, std::memory_order_release);
+}   /* dlog_write() */
+
+static uint32_t
+format_arg (const char * p_spec, char conv, char len_mod, uint64_t word,
+            char * p_out, uint32_t size)
+{
+    int ret = 0;
+
+    switch (conv)
+    {
+        case 'd':
+        case 'i':
+        case 'c':
+        {
+            if ('l' == len_mod)
+            {
+                ret = snprintf(p_out, size, p_spec, (long) word);
+            }
+            else if (('L' == len_mod) || ('j' == len_mod))
+            {
+                ret = snprintf(p_out, size, p_spec, (long long) word);
+            }
+            else if (('z' == len_mod) || ('t' == len_mod))
+            {
+                ret = snprintf(p_out, size, p_spec, (ptrdiff_t) word);
+            }
+            else
+            {
+                ret = snprintf(p_out, size, p_spec, (int) word);
+            }
+        }
+        break;
+
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+        {
+            if ('l' == len_mod)
+            {
+                ret = snprintf(p_out, size, p_spec, (unsigned long) word);
+            }
+            else if (('L' == len_mod) || ('j' == len_mod))
+            {
+                ret = snprintf(p_out, size, p_spec, (unsigned long long) word);
+            }
+            else if (('z' == len_mod) || ('t' == len_mod))
+            {
+                ret = snprintf(p_out, size, p_spec, (size_t) word);
+            }
+            else
+            {
+                ret = snprintf(p_out, size, p_spec, (unsigned) word);
+            }
+        }
+        break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+        {
+            double value = 0.0;
+
+            memcpy(&value, &word, sizeof(value));
+            ret = snprintf(p_out, size, p_spec, value);
+        }
+        break;
+
+        case 's':
+        {
+            const char * p_str = (const char *) (uintptr_t) word;
+
+            ret = snprintf(p_out, size, p_spec, p_str ? p_str : "(null)");
+        }
+        break;
+
+        case 'p':
+        {
+            ret = snprintf(p_out, size, p_spec, (void *) (uintptr_t) word);
+        }
+        break;
+
+        default:
+        break;
+    }
+
+    if (ret < 0)
+    {
+        return (0);
+    }
+
+    return (((uint32_t) ret < size) ? (uint32_t) ret : size - 1);
+}   /* format_arg() */
+
+uint32_t
+dlog_format (const char * p_fmt, uint32_t num_arg, const uint64_t * p_arg,
+             char * p_out, uint32_t size)
+{
+    // Walk the format once, handing each conversion to snprintf() with its
+    // argument cast back to the type the length modifier asks for.
+    //
+    uint32_t len = 0;
+    uint32_t arg = 0;
+    const char * p_pos = p_fmt;
+
+    if (0 == size)
+    {
+        return (0);
+    }
+
+    while (('\0' != *p_pos) && (len + 1 < size))
+    {
+        char spec[24];
+        uint32_t spec_len = 1;
+        char len_mod = '\0';
+
+        if (('%' != *p_pos) || ('%' == p_pos[1]))
+        {
+            p_out[len++] = *p_pos;
+            p_pos += ('%' == *p_pos) ? 2 : 1;
+            continue;
+        }
+
+        spec[0] = '%';
+        ++p_pos;
+
+        while (('\0' != *p_pos) && (NULL != strchr("-+ #0123456789.", *p_pos))
+               && (spec_len < sizeof(spec) - 4))
+        {
+            spec[spec_len++] = *p_pos++;
+        }
+
+        while (('\0' != *p_pos) && (NULL != strchr("hljztL", *p_pos)))
+        {
+            // "ll" folds into 'L'; 'h' and "hh" print like int.
+            //
+            len_mod = (('l' == len_mod) && ('l' == *p_pos)) ? 'L' : *p_pos;
+            len_mod = ('h' == len_mod) ? '\0' : len_mod;
+            ++p_pos;
+        }
+
+        if ('\0' == *p_pos)
+        {
+            break;
+        }
+
+        if ('l' == len_mod)
+        {
+            spec[spec_len++] = 'l';
+        }
+        else if (('L' == len_mod) || ('j' == len_mod))
+        {
+            spec[spec_len++] = 'l';
+            spec[spec_len++] = 'l';
+        }
+        else if (('z' == len_mod) || ('t' == len_mod))
+        {
+            spec[spec_len++] = ('z' == len_mod) ? 'z' : 't';
+        }
+
+        spec[spec_len++] = *p_pos;
+        spec[spec_len] = '\0';
+
+        if (arg < num_arg)
+        {
+            len += format_arg(spec, *p_pos, len_mod, p_arg[arg++],
+                              &p_out[len], size - len);
+        }
+        else
+        {
+            p_out[len++] = '?';
+        }
+
+        ++p_pos;
+    }
+
+    p_out[len] = '\0';
+
+    return (len);
+}   /* dlog_format() */
+
+uint32_t
+dlog_flush (void)
+{
+    char line[DLOG_LINE_MAX];
+    uint32_t num = 0;
+    uint32_t dropped = 0;
+
+    // Single consumer: a flush racing another one just returns.
+    //
+    if (0 != gb_flushing.exchange(1, std::memory_order_acquire))
+    {
+        return (0);
+    }
+
+    for (;;)
+    {
+        uint32_t slot = g_tail & (DLOG_SLOTS - 1);
+        dlog_record_t * p_record = &g_record[slot];
+
+        if (p_record->seq.load(std::memory_order_acquire) + slot != g_tail + 1)
+        {
+            break;
+        }
+
+        uint32_t len = dlog_format(p_record->p_fmt, p_record->num_arg,
+                                   p_record->arg, line, sizeof(line));
+
+        p_record->seq.store(g_tail + DLOG_SLOTS - slot,
+                            std::memory_order_release);
+        ++g_tail;
+        ++num;
+        g_sink(line, len);
+    }
+
+    dropped = g_dropped.load(std::memory_order_relaxed);
+
+    if (dropped != g_reported)
+    {
+        uint32_t len = (uint32_t) snprintf(line, sizeof(line),
+                                           "dlog: %u records dropped\n",
+                                           (unsigned) (dropped - g_reported));
+
+        g_reported = dropped;
+        g_sink(line, len);
+    }
+
+    if ((0 != num) && (dlog_stdout == g_sink))
+    {
+        fflush(stdout);
+    }
+
+    gb_flushing.store(0, std::memory_order_release);
+
+    return (num);
+}   /* dlog_flush() */
+
+uint8_t
+dlog_start (void)
+{
+#if DLOG_THREAD
+    std::thread([]()
+    {
+        for (;;)
+        {
+            dlog_flush();
+            std::this_thread::sleep_for(
+                                std::chrono::milliseconds(DLOG_PERIOD_MS));
+        }
+    }).detach();
+
+    return (1);
+#else
+    // Firmware: the main loop calls dlog_flush() when idle.
+    //
+    return (0);
+#endif
+}   /* dlog_start() */
+
+void
+dlog_set_sink (dlog_sink_t sink)
+{
+    g_sink = sink ? sink : dlog_stdout;
+}   /* dlog_set_sink() */
+
+uint32_t
+dlog_get_dropped (void)
+{
+    return (g_dropped.load(std::memory_order_relaxed));
+}   /* dlog_get_dropped() */
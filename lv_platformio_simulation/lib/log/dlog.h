@@ -0,0 +1,75 @@
+#ifndef DLOG_H
+
+#   define DLOG_H
+#   include <stdint.h>
+
+// Deferred binary log. A call stores the format string's address and its
+// raw arguments in a lock-free ring; formatting and output happen later in
+// dlog_flush(), from a background thread on native (dlog_start()) or from
+// the firmware main loop when idle. Safe from the audio thread: no locks,
+// no allocation, and a full ring drops the record instead of waiting.
+//
+// The format must be a string literal and %s arguments must point to
+// storage that outlives the flush. '*' width/precision is not supported.
+//
+#   ifndef DLOG_SLOTS
+#       define DLOG_SLOTS           (128U)  /* Power of two */
+#   endif
+#   define DLOG_MAX_ARGS            (6U)
+#   define DLOG_LINE_MAX            (192U)
+
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+
+typedef void (*dlog_sink_t)(const char * p_text, uint32_t len);
+
+void dlog_write(const char * p_fmt, uint32_t num_arg, const uint64_t * p_arg);
+uint32_t dlog_flush(void);
+uint8_t dlog_start(void);
+void dlog_set_sink(dlog_sink_t sink);
+uint32_t dlog_get_dropped(void);
+uint32_t dlog_format(const char * p_fmt, uint32_t num_arg,
+                     const uint64_t * p_arg, char * p_out, uint32_t size);
+
+#   ifdef __cplusplus
+} /* extern "C" */
+
+#       include <string.h>
+
+// Every argument is widened to one 64-bit word; dlog_format() reads it back
+// according to its conversion in the format string.
+//
+static inline uint64_t dlog_word (int value) { return ((uint64_t) (int64_t) value); }
+static inline uint64_t dlog_word (unsigned value) { return (value); }
+static inline uint64_t dlog_word (long value) { return ((uint64_t) (int64_t) value); }
+static inline uint64_t dlog_word (unsigned long value) { return (value); }
+static inline uint64_t dlog_word (long long value) { return ((uint64_t) value); }
+static inline uint64_t dlog_word (unsigned long long value) { return (value); }
+static inline uint64_t dlog_word (const char * p_value) { return ((uintptr_t) p_value); }
+static inline uint64_t dlog_word (const void * p_value) { return ((uintptr_t) p_value); }
+
+static inline uint64_t
+dlog_word (double value)
+{
+    uint64_t word = 0;
+
+    memcpy(&word, &value, sizeof(word));
+
+    return (word);
+}   /* dlog_word() */
+
+template <typename... T>
+static inline void
+dlog_args (const char * p_fmt, T... args)
+{
+    static_assert(sizeof...(T) <= DLOG_MAX_ARGS, "Too many DLOG arguments");
+    const uint64_t word[sizeof...(T) + 1] = {dlog_word(args)..., 0};
+
+    dlog_write(p_fmt, sizeof...(T), word);
+}   /* dlog_args() */
+
+#       define DLOG(...)    dlog_args(__VA_ARGS__)
+#   endif
+
+#endif /* DLOG_H */
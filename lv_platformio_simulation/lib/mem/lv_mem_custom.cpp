@@ -0,0 +1,84 @@
+#include "lvgl.h"
+#include "mem.h"
+
+// LVGL hooks for LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM: route the whole
+// LVGL heap through the size-class pools and heap of mem.h.
+//
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM
+
+void
+lv_mem_init (void)
+{
+    mem_init();
+}   /* lv_mem_init() */
+
+void
+lv_mem_deinit (void)
+{
+}   /* lv_mem_deinit() */
+
+lv_mem_pool_t
+lv_mem_add_pool (void * p_mem, size_t bytes)
+{
+    // All of LVGL's memory is the static LV_MEM_SIZE region.
+    //
+    LV_UNUSED(p_mem);
+    LV_UNUSED(bytes);
+
+    return (NULL);
+}   /* lv_mem_add_pool() */
+
+void
+lv_mem_remove_pool (lv_mem_pool_t pool)
+{
+    LV_UNUSED(pool);
+}   /* lv_mem_remove_pool() */
+
+void *
+lv_malloc_core (size_t size)
+{
+    return (mem_lvgl_alloc(size));
+}   /* lv_malloc_core() */
+
+void *
+lv_realloc_core (void * p_mem, size_t new_size)
+{
+    return (mem_lvgl_realloc(p_mem, new_size));
+}   /* lv_realloc_core() */
+
+void
+lv_free_core (void * p_mem)
+{
+    mem_lvgl_free(p_mem);
+}   /* lv_free_core() */
+
+void
+lv_mem_monitor_core (lv_mem_monitor_t * p_mon)
+{
+    mem_stats_t stats;
+    uint32_t id = 0;
+
+    lv_memzero(p_mon, sizeof(*p_mon));
+
+    for (id = MEM_LVGL_16; id <= MEM_LVGL_HEAP; ++id)
+    {
+        mem_get_stats((mem_id_t) id, &stats);
+        p_mon->total_size += stats.size;
+        p_mon->used_cnt += stats.count;
+        p_mon->max_used += stats.peak;
+        p_mon->free_size += stats.size - stats.live;
+    }
+
+    mem_get_stats(MEM_LVGL_HEAP, &stats);
+    p_mon->frag_pct = (uint8_t) stats.frag_pct;
+    p_mon->used_pct = (uint8_t) (100 - 100 * p_mon->free_size
+                                       / p_mon->total_size);
+}   /* lv_mem_monitor_core() */
+
+lv_result_t
+lv_mem_test_core (void)
+{
+    return (LV_RESULT_OK);
+}   /* lv_mem_test_core() */
+
+#endif /* LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM */
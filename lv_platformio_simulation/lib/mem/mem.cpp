@@ -0,0 +1,511 @@
+#include "mem.h"
+#include <string.h>
+
+#define MEM_ROUND(x)        (((x) + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1))
+#define MEM_NUM_CLASS       (4)
+#define MEM_CLASS_BYTES     (MEM_LVGL_16_COUNT * 16 + MEM_LVGL_32_COUNT * 32 \
+                             + MEM_LVGL_64_COUNT * 64                        \
+                             + MEM_LVGL_128_COUNT * 128)
+
+// Heap boundary tag, in front of every heap block. The low bit of size
+// flags the block as used.
+//
+#define HEAP_TAG_SIZE       (8U)
+#define HEAP_USED           (1U)
+#define HEAP_MIN_BLOCK      (2 * HEAP_TAG_SIZE)
+
+// Every LVGL allocation carries its requested size and region, so free and
+// realloc need nothing from the caller and stats count real bytes.
+//
+#define LVGL_HDR_SIZE       (8U)
+
+typedef struct heap_tag_t
+{
+    uint32_t size;
+    uint32_t prev_size;
+} heap_tag_t;
+
+typedef struct lvgl_hdr_t
+{
+    uint32_t size;
+    uint32_t id;
+} lvgl_hdr_t;
+
+typedef struct mem_usage_t
+{
+    uint32_t live;
+    uint32_t peak;
+    uint32_t count;
+} mem_usage_t;
+
+static const char * const g_mem_names[MEM_NUM] =
+{
+    "lvgl_16", "lvgl_32", "lvgl_64", "lvgl_128", "lvgl_heap", "ui", "audio",
+    "rec"
+};
+
+static const uint32_t g_class_size[MEM_NUM_CLASS] = {16, 32, 64, 128};
+static const uint32_t g_class_count[MEM_NUM_CLASS] =
+{
+    MEM_LVGL_16_COUNT, MEM_LVGL_32_COUNT, MEM_LVGL_64_COUNT,
+    MEM_LVGL_128_COUNT
+};
+
+alignas(MEM_ALIGN) static uint8_t g_lvgl_mem[LV_MEM_SIZE];
+alignas(MEM_ALIGN) static uint8_t g_ui_mem[MEM_UI_SIZE];
+#ifndef MEM_AUDIO_ADDR
+alignas(MEM_ALIGN) static uint8_t g_audio_mem[MEM_AUDIO_SIZE];
+#endif
+#if !defined(MEM_REC_ADDR) && (MEM_REC_SIZE > 0)
+alignas(MEM_ALIGN) static uint8_t g_rec_mem[MEM_REC_SIZE];
+#endif
+
+static mem_pool_t g_class_pool[MEM_NUM_CLASS];
+static mem_heap_t g_lvgl_heap;
+static mem_arena_t g_ui_arena;
+static mem_arena_t g_audio_arena;
+static mem_arena_t g_rec_arena;
+static mem_usage_t g_usage[MEM_NUM];
+static uint8_t gb_init = 0;
+
+static_assert(MEM_CLASS_BYTES < LV_MEM_SIZE,
+              "LVGL size-class pools do not fit in LV_MEM_SIZE");
+
+void
+mem_arena_init (mem_arena_t * p_arena, void * p_mem, uint32_t size)
+{
+    p_arena->p_base = (uint8_t *) p_mem;
+    p_arena->size = size;
+    p_arena->used = 0;
+    p_arena->count = 0;
+}   /* mem_arena_init() */
+
+void *
+mem_arena_alloc (mem_arena_t * p_arena, uint32_t size)
+{
+    uint32_t start = MEM_ROUND(p_arena->used);
+    void * p_mem = NULL;
+
+    if (start + size <= p_arena->size)
+    {
+        p_mem = p_arena->p_base + start;
+        p_arena->used = start + size;
+        ++p_arena->count;
+        memset(p_mem, 0, size);
+    }
+
+    return (p_mem);
+}   /* mem_arena_alloc() */
+
+void
+mem_pool_init (mem_pool_t * p_pool, void * p_mem, uint32_t size,
+               uint32_t block_size)
+{
+    p_pool->p_base = (uint8_t *) p_mem;
+    p_pool->block_size = block_size;
+    p_pool->num_block = size / block_size;
+    p_pool->p_free = NULL;
+    p_pool->used_block = 0;
+
+    // Thread the free list backwards so the first allocation returns the
+    // lowest address.
+    //
+    for (uint32_t idx = p_pool->num_block; idx > 0; --idx)
+    {
+        void ** p_block = (void **) (p_pool->p_base + (idx - 1) * block_size);
+
+        *p_block = p_pool->p_free;
+        p_pool->p_free = p_block;
+    }
+}   /* mem_pool_init() */
+
+void *
+mem_pool_alloc (mem_pool_t * p_pool)
+{
+    void ** p_block = (void **) p_pool->p_free;
+
+    if (NULL != p_block)
+    {
+        p_pool->p_free = *p_block;
+        ++p_pool->used_block;
+    }
+
+    return (p_block);
+}   /* mem_pool_alloc() */
+
+void
+mem_pool_free (mem_pool_t * p_pool, void * p_mem)
+{
+    *(void **) p_mem = p_pool->p_free;
+    p_pool->p_free = p_mem;
+    --p_pool->used_block;
+}   /* mem_pool_free() */
+
+uint8_t
+mem_pool_owns (const mem_pool_t * p_pool, const void * p_mem)
+{
+    const uint8_t * p_byte = (const uint8_t *) p_mem;
+
+    return ((p_byte >= p_pool->p_base)
+            && (p_byte < p_pool->p_base
+                         + p_pool->num_block * p_pool->block_size));
+}   /* mem_pool_owns() */
+
+static inline heap_tag_t *
+heap_next (const mem_heap_t * p_heap, heap_tag_t * p_tag)
+{
+    uint8_t * p_next = (uint8_t *) p_tag + (p_tag->size & ~HEAP_USED);
+
+    return ((p_next < p_heap->p_base + p_heap->size) ? (heap_tag_t *) p_next
+                                                     : NULL);
+}   /* heap_next() */
+
+void
+mem_heap_init (mem_heap_t * p_heap, void * p_mem, uint32_t size)
+{
+    heap_tag_t * p_tag = (heap_tag_t *) p_mem;
+
+    p_heap->p_base = (uint8_t *) p_mem;
+    p_heap->size = size & ~(MEM_ALIGN - 1);
+    p_tag->size = p_heap->size;
+    p_tag->prev_size = 0;
+}   /* mem_heap_init() */
+
+void *
+mem_heap_alloc (mem_heap_t * p_heap, uint32_t size)
+{
+    uint32_t need = MEM_ROUND(size) + HEAP_TAG_SIZE;
+    heap_tag_t * p_tag = (heap_tag_t *) p_heap->p_base;
+
+    if (need < HEAP_MIN_BLOCK)
+    {
+        need = HEAP_MIN_BLOCK;
+    }
+
+    for (; NULL != p_tag; p_tag = heap_next(p_heap, p_tag))
+    {
+        if ((p_tag->size & HEAP_USED) || (p_tag->size < need))
+        {
+            continue;
+        }
+
+        if (p_tag->size - need >= HEAP_MIN_BLOCK)
+        {
+            heap_tag_t * p_rest = (heap_tag_t *) ((uint8_t *) p_tag + need);
+            heap_tag_t * p_after = NULL;
+
+            p_rest->size = p_tag->size - need;
+            p_rest->prev_size = need;
+            p_tag->size = need;
+            p_after = heap_next(p_heap, p_rest);
+
+            if (NULL != p_after)
+            {
+                p_after->prev_size = p_rest->size;
+            }
+        }
+
+        p_tag->size |= HEAP_USED;
+
+        return ((uint8_t *) p_tag + HEAP_TAG_SIZE);
+    }
+
+    return (NULL);
+}   /* mem_heap_alloc() */
+
+void
+mem_heap_free (mem_heap_t * p_heap, void * p_mem)
+{
+    heap_tag_t * p_tag = (heap_tag_t *) ((uint8_t *) p_mem - HEAP_TAG_SIZE);
+    heap_tag_t * p_next = NULL;
+
+    p_tag->size &= ~HEAP_USED;
+    p_next = heap_next(p_heap, p_tag);
+
+    if ((NULL != p_next) && !(p_next->size & HEAP_USED))
+    {
+        p_tag->size += p_next->size;
+    }
+
+    if (0 != p_tag->prev_size)
+    {
+        heap_tag_t * p_prev = (heap_tag_t *) ((uint8_t *) p_tag
+                                              - p_tag->prev_size);
+
+        if (!(p_prev->size & HEAP_USED))
+        {
+            p_prev->size += p_tag->size;
+            p_tag = p_prev;
+        }
+    }
+
+    p_next = heap_next(p_heap, p_tag);
+
+    if (NULL != p_next)
+    {
+        p_next->prev_size = p_tag->size;
+    }
+}   /* mem_heap_free() */
+
+uint32_t
+mem_heap_largest_free (const mem_heap_t * p_heap)
+{
+    heap_tag_t * p_tag = (heap_tag_t *) p_heap->p_base;
+    uint32_t largest = 0;
+
+    for (; NULL != p_tag; p_tag = heap_next(p_heap, p_tag))
+    {
+        if (!(p_tag->size & HEAP_USED) && (p_tag->size > largest))
+        {
+            largest = p_tag->size;
+        }
+    }
+
+    return ((largest > HEAP_TAG_SIZE) ? largest - HEAP_TAG_SIZE : 0);
+}   /* mem_heap_largest_free() */
+
+uint32_t
+mem_heap_total_free (const mem_heap_t * p_heap)
+{
+    heap_tag_t * p_tag = (heap_tag_t *) p_heap->p_base;
+    uint32_t total = 0;
+
+    for (; NULL != p_tag; p_tag = heap_next(p_heap, p_tag))
+    {
+        if (!(p_tag->size & HEAP_USED))
+        {
+            total += p_tag->size - HEAP_TAG_SIZE;
+        }
+    }
+
+    return (total);
+}   /* mem_heap_total_free() */
+
+static void
+usage_add (mem_id_t id, int32_t bytes, int32_t count)
+{
+    mem_usage_t * p_usage = &g_usage[id];
+
+    p_usage->live += bytes;
+    p_usage->count += count;
+
+    if (p_usage->live > p_usage->peak)
+    {
+        p_usage->peak = p_usage->live;
+    }
+}   /* usage_add() */
+
+void
+mem_init (void)
+{
+    uint8_t * p_mem = g_lvgl_mem;
+
+    if (gb_init)
+    {
+        return;
+    }
+
+    for (uint32_t idx = 0; idx < MEM_NUM_CLASS; ++idx)
+    {
+        uint32_t bytes = g_class_size[idx] * g_class_count[idx];
+
+        mem_pool_init(&g_class_pool[idx], p_mem, bytes, g_class_size[idx]);
+        p_mem += bytes;
+    }
+
+    mem_heap_init(&g_lvgl_heap, p_mem, LV_MEM_SIZE - MEM_CLASS_BYTES);
+    mem_arena_init(&g_ui_arena, g_ui_mem, MEM_UI_SIZE);
+#ifdef MEM_AUDIO_ADDR
+    mem_arena_init(&g_audio_arena, (void *) MEM_AUDIO_ADDR, MEM_AUDIO_SIZE);
+#else
+    mem_arena_init(&g_audio_arena, g_audio_mem, MEM_AUDIO_SIZE);
+#endif
+#if defined(MEM_REC_ADDR)
+    mem_arena_init(&g_rec_arena, (void *) MEM_REC_ADDR, MEM_REC_SIZE);
+#elif MEM_REC_SIZE > 0
+    mem_arena_init(&g_rec_arena, g_rec_mem, MEM_REC_SIZE);
+#else
+    mem_arena_init(&g_rec_arena, NULL, 0);
+#endif
+    memset(g_usage, 0, sizeof(g_usage));
+    gb_init = 1;
+}   /* mem_init() */
+
+mem_arena_t *
+mem_get_arena (mem_id_t id)
+{
+    mem_init();
+
+    switch (id)
+    {
+        case MEM_UI:
+            return (&g_ui_arena);
+
+        case MEM_AUDIO:
+            return (&g_audio_arena);
+
+        case MEM_REC:
+            return (&g_rec_arena);
+
+        default:
+            return (NULL);
+    }
+}   /* mem_get_arena() */
+
+void *
+mem_alloc (mem_id_t id, uint32_t size)
+{
+    mem_arena_t * p_arena = mem_get_arena(id);
+    void * p_mem = NULL;
+
+    if (NULL != p_arena)
+    {
+        p_mem = mem_arena_alloc(p_arena, size);
+    }
+
+    return (p_mem);
+}   /* mem_alloc() */
+
+void *
+mem_lvgl_alloc (size_t size)
+{
+    uint32_t total = (uint32_t) size + LVGL_HDR_SIZE;
+    lvgl_hdr_t * p_hdr = NULL;
+    uint32_t id = MEM_LVGL_HEAP;
+
+    mem_init();
+
+    // Smallest size class that fits, falling back to the heap when it is
+    // exhausted.
+    //
+    for (uint32_t idx = 0; idx < MEM_NUM_CLASS; ++idx)
+    {
+        if (total <= g_class_size[idx])
+        {
+            p_hdr = (lvgl_hdr_t *) mem_pool_alloc(&g_class_pool[idx]);
+
+            if (NULL != p_hdr)
+            {
+                id = idx;
+            }
+
+            break;
+        }
+    }
+
+    if (NULL == p_hdr)
+    {
+        p_hdr = (lvgl_hdr_t *) mem_heap_alloc(&g_lvgl_heap, total);
+    }
+
+    if (NULL == p_hdr)
+    {
+        return (NULL);
+    }
+
+    p_hdr->size = (uint32_t) size;
+    p_hdr->id = id;
+    usage_add((mem_id_t) id, (int32_t) size, 1);
+
+    return ((uint8_t *) p_hdr + LVGL_HDR_SIZE);
+}   /* mem_lvgl_alloc() */
+
+void
+mem_lvgl_free (void * p_mem)
+{
+    lvgl_hdr_t * p_hdr = NULL;
+
+    if (NULL == p_mem)
+    {
+        return;
+    }
+
+    p_hdr = (lvgl_hdr_t *) ((uint8_t *) p_mem - LVGL_HDR_SIZE);
+    usage_add((mem_id_t) p_hdr->id, -(int32_t) p_hdr->size, -1);
+
+    if (MEM_LVGL_HEAP == p_hdr->id)
+    {
+        mem_heap_free(&g_lvgl_heap, p_hdr);
+    }
+    else
+    {
+        mem_pool_free(&g_class_pool[p_hdr->id], p_hdr);
+    }
+}   /* mem_lvgl_free() */
+
+void *
+mem_lvgl_realloc (void * p_mem, size_t size)
+{
+    lvgl_hdr_t * p_hdr = NULL;
+    void * p_new = NULL;
+
+    if (NULL == p_mem)
+    {
+        return (mem_lvgl_alloc(size));
+    }
+
+    p_hdr = (lvgl_hdr_t *) ((uint8_t *) p_mem - LVGL_HDR_SIZE);
+
+    // Shrinking inside a size-class block is free.
+    //
+    if ((MEM_LVGL_HEAP != p_hdr->id) && (size <= p_hdr->size))
+    {
+        usage_add((mem_id_t) p_hdr->id,
+                  (int32_t) size - (int32_t) p_hdr->size, 0);
+        p_hdr->size = (uint32_t) size;
+
+        return (p_mem);
+    }
+
+    p_new = mem_lvgl_alloc(size);
+
+    if (NULL != p_new)
+    {
+        memcpy(p_new, p_mem, (size < p_hdr->size) ? size : p_hdr->size);
+        mem_lvgl_free(p_mem);
+    }
+
+    return (p_new);
+}   /* mem_lvgl_realloc() */
+
+void
+mem_get_stats (mem_id_t id, mem_stats_t * p_stats)
+{
+    mem_init();
+    memset(p_stats, 0, sizeof(*p_stats));
+    p_stats->p_name = g_mem_names[id];
+
+    if (id < MEM_NUM_CLASS)
+    {
+        const mem_pool_t * p_pool = &g_class_pool[id];
+        uint32_t held = p_pool->used_block * p_pool->block_size;
+
+        p_stats->size = p_pool->num_block * p_pool->block_size;
+        p_stats->live = g_usage[id].live;
+        p_stats->peak = g_usage[id].peak;
+        p_stats->count = g_usage[id].count;
+        p_stats->frag_pct = (0 == held) ? 0 : 100 - 100 * g_usage[id].live
+                                                    / held;
+    }
+    else if (MEM_LVGL_HEAP == id)
+    {
+        uint32_t total_free = mem_heap_total_free(&g_lvgl_heap);
+
+        p_stats->size = g_lvgl_heap.size;
+        p_stats->live = g_usage[id].live;
+        p_stats->peak = g_usage[id].peak;
+        p_stats->count = g_usage[id].count;
+        p_stats->frag_pct = (0 == total_free)
+            ? 0 : 100 - 100 * mem_heap_largest_free(&g_lvgl_heap)
+                        / total_free;
+    }
+    else
+    {
+        mem_arena_t * p_arena = mem_get_arena(id);
+
+        p_stats->size = p_arena->size;
+        p_stats->live = p_arena->used;
+        p_stats->peak = p_arena->used;
+        p_stats->count = p_arena->count;
+    }
+}   /* mem_get_stats() */
@@ -0,0 +1,129 @@
+#ifndef MEM_H
+
+#   define MEM_H
+#   include <stdint.h>
+#   include <stddef.h>
+
+// Every byte of dynamic memory in the firmware comes from one of these
+// regions, so their peaks can be read back to size each board.
+//
+// - LVGL allocations up to 128 bytes go to fixed-size pools (one per size
+//   class), bigger ones to a first-fit heap; all of it inside LV_MEM_SIZE.
+// - Instrument UI state, audio and recording buffers are bump arenas:
+//   allocated once at init, never freed.
+//
+#   ifndef LV_MEM_SIZE
+#       define LV_MEM_SIZE          (64U * 1024U)
+#   endif
+#   ifndef MEM_LVGL_16_COUNT
+#       define MEM_LVGL_16_COUNT    (256)
+#   endif
+#   ifndef MEM_LVGL_32_COUNT
+#       define MEM_LVGL_32_COUNT    (256)
+#   endif
+#   ifndef MEM_LVGL_64_COUNT
+#       define MEM_LVGL_64_COUNT    (128)
+#   endif
+#   ifndef MEM_LVGL_128_COUNT
+#       define MEM_LVGL_128_COUNT   (64)
+#   endif
+#   ifndef MEM_UI_SIZE
+#       define MEM_UI_SIZE          (8U * 1024U)    /* Grid, styles, scope */
+#   endif
+#   ifndef MEM_AUDIO_SIZE
+#       define MEM_AUDIO_SIZE       (384U * 1024U)
+#   endif
+
+// A board may place the audio arena at a fixed address (external SDRAM)
+// instead of internal RAM; it must be usable before init_instrument().
+//
+// #   define MEM_AUDIO_ADDR       (0xD0100000U)
+
+// Recorder ring and looper buffer: large, so 0 leaves them out on boards
+// without external RAM. MEM_REC_ADDR works as MEM_AUDIO_ADDR.
+//
+#   ifndef MEM_REC_SIZE
+#       define MEM_REC_SIZE         (8U * 1024U * 1024U)
+#   endif
+
+#   define MEM_ALIGN                (8U)
+
+typedef enum mem_id_t
+{
+    MEM_LVGL_16 = 0,
+    MEM_LVGL_32,
+    MEM_LVGL_64,
+    MEM_LVGL_128,
+    MEM_LVGL_HEAP,
+    MEM_UI,
+    MEM_AUDIO,
+    MEM_REC,
+    MEM_NUM
+} mem_id_t;
+
+typedef struct mem_stats_t
+{
+    const char * p_name;
+    uint32_t size;
+    uint32_t live;      /* Bytes handed out and not yet freed */
+    uint32_t peak;      /* High-water mark of live */
+    uint32_t count;     /* Live allocations */
+    uint32_t frag_pct;  /* Pools: slack inside blocks, heap: free space
+                           not in the largest free block */
+} mem_stats_t;
+
+// Bump allocator: carved once, never freed.
+//
+typedef struct mem_arena_t
+{
+    uint8_t * p_base;
+    uint32_t size;
+    uint32_t used;
+    uint32_t count;
+} mem_arena_t;
+
+// Fixed-size blocks threaded on a free list.
+//
+typedef struct mem_pool_t
+{
+    uint8_t * p_base;
+    uint32_t block_size;
+    uint32_t num_block;
+    void * p_free;
+    uint32_t used_block;
+} mem_pool_t;
+
+// Address-ordered first-fit heap with boundary tags.
+//
+typedef struct mem_heap_t
+{
+    uint8_t * p_base;
+    uint32_t size;
+} mem_heap_t;
+
+void mem_arena_init(mem_arena_t * p_arena, void * p_mem, uint32_t size);
+void * mem_arena_alloc(mem_arena_t * p_arena, uint32_t size);
+
+void mem_pool_init(mem_pool_t * p_pool, void * p_mem, uint32_t size,
+                   uint32_t block_size);
+void * mem_pool_alloc(mem_pool_t * p_pool);
+void mem_pool_free(mem_pool_t * p_pool, void * p_mem);
+uint8_t mem_pool_owns(const mem_pool_t * p_pool, const void * p_mem);
+
+void mem_heap_init(mem_heap_t * p_heap, void * p_mem, uint32_t size);
+void * mem_heap_alloc(mem_heap_t * p_heap, uint32_t size);
+void mem_heap_free(mem_heap_t * p_heap, void * p_mem);
+uint32_t mem_heap_largest_free(const mem_heap_t * p_heap);
+uint32_t mem_heap_total_free(const mem_heap_t * p_heap);
+
+// System regions.
+//
+void mem_init(void);
+void * mem_alloc(mem_id_t id, uint32_t size);
+mem_arena_t * mem_get_arena(mem_id_t id);
+void * mem_lvgl_alloc(size_t size);
+void * mem_lvgl_realloc(void * p_mem, size_t size);
+void mem_lvgl_free(void * p_mem);
+void mem_get_stats(mem_id_t id, mem_stats_t * p_stats);
+
+#endif /* MEM_H */
@@ -0,0 +1,84 @@
+#ifndef PERF_H
+
+#   define PERF_H
+#   include <stdint.h>
+
+// Cheapest free-running counter on each target: the DWT cycle counter on
+// Cortex-M, CCOUNT on the Xtensa ESP32 cores and the monotonic clock in
+// nanoseconds on the native build. Only differences are meaningful.
+//
+#   if defined(STM32F429xx)
+#       include "stm32f4xx.h"
+#       define PERF_TICKS_PER_US   (SystemCoreClock / 1000000U)
+#   elif defined(ESP_PLATFORM)
+#       include <xtensa/hal.h>
+#       define PERF_TICKS_PER_US   (F_CPU / 1000000U)
+#   else
+#       include <time.h>
+#       define PERF_TICKS_PER_US   (1000U)
+#   endif
+
+typedef struct perf_counter_t
+{
+    uint32_t last;
+    uint32_t peak;
+    uint64_t total;
+    uint32_t count;
+} perf_counter_t;
+
+static inline void
+perf_init (void)
+{
+#   if defined(STM32F429xx)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#   endif
+}   /* perf_init() */
+
+static inline uint32_t
+perf_ticks (void)
+{
+#   if defined(STM32F429xx)
+    return (DWT->CYCCNT);
+#   elif defined(ESP_PLATFORM)
+    return (xthal_get_ccount());
+#   else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint32_t) ((uint64_t) now.tv_sec * 1000000000ULL
+                        + (uint64_t) now.tv_nsec));
+#   endif
+}   /* perf_ticks() */
+
+static inline void
+perf_counter_add (perf_counter_t * p_counter, uint32_t ticks)
+{
+    p_counter->last = ticks;
+    p_counter->total += ticks;
+    ++p_counter->count;
+
+    if (ticks > p_counter->peak)
+    {
+        p_counter->peak = ticks;
+    }
+}   /* perf_counter_add() */
+
+static inline void
+perf_counter_reset (perf_counter_t * p_counter)
+{
+    p_counter->last = 0;
+    p_counter->peak = 0;
+    p_counter->total = 0;
+    p_counter->count = 0;
+}   /* perf_counter_reset() */
+
+static inline uint32_t
+perf_ticks_to_ns (uint32_t ticks)
+{
+    return ((uint32_t) ((uint64_t) ticks * 1000U / PERF_TICKS_PER_US));
+}   /* perf_ticks_to_ns() */
+
+#endif /* PERF_H */
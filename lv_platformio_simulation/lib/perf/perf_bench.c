@@ -0,0 +1,79 @@
+#include "perf_bench.h"
+#include "perf.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PERF_BENCH_WARMUP   (3U)    /* Timed repetitions thrown away */
+
+static int
+cmp_float (const void * p_a, const void * p_b)
+{
+    float a = *(const float *) p_a;
+    float b = *(const float *) p_b;
+
+    return ((a > b) - (a < b));
+}   /* cmp_float() */
+
+static uint32_t
+bench_rep (perf_bench_fn_t p_fn, void * p_ctx, uint32_t iters)
+{
+    uint32_t start = perf_ticks();
+
+    p_fn(p_ctx, iters);
+
+    return (perf_ticks_to_ns(perf_ticks() - start));
+}   /* bench_rep() */
+
+void
+perf_bench_run (const char * p_name, perf_bench_fn_t p_fn, void * p_ctx,
+                uint32_t reps, perf_bench_t * p_result)
+{
+    float sample[PERF_BENCH_MAX_REPS];
+    uint32_t iters = 1;
+    double sum = 0.0;
+    double sq = 0.0;
+
+    perf_init();
+    reps = (reps < 1) ? 1 : ((reps > PERF_BENCH_MAX_REPS)
+                             ? PERF_BENCH_MAX_REPS : reps);
+
+    // Double until one repetition is long enough for the clock, capped so
+    // a very slow operation still ends.
+    //
+    while ((bench_rep(p_fn, p_ctx, iters) < PERF_BENCH_REP_US * 1000U)
+           && (iters < (1U << 24)))
+    {
+        iters *= 2;
+    }
+
+    for (uint32_t idx = 0; idx < PERF_BENCH_WARMUP; ++idx)
+    {
+        (void) bench_rep(p_fn, p_ctx, iters);
+    }
+
+    for (uint32_t idx = 0; idx < reps; ++idx)
+    {
+        sample[idx] = (float) bench_rep(p_fn, p_ctx, iters) / iters;
+        sum += sample[idx];
+        sq += (double) sample[idx] * sample[idx];
+    }
+
+    qsort(sample, reps, sizeof(sample[0]), cmp_float);
+
+    p_result->iters = iters;
+    p_result->reps = reps;
+    p_result->min_ns = sample[0];
+    p_result->median_ns = (reps & 1U) ? sample[reps / 2]
+                          : 0.5f * (sample[reps / 2 - 1] + sample[reps / 2]);
+    p_result->mean_ns = (float) (sum / reps);
+    p_result->stddev_ns = (float) sqrt(fmax(0.0, sq / reps
+                                                 - (sum / reps) * (sum / reps)));
+
+    if (NULL != p_name)
+    {
+        printf("bench %-24s %10.1f ns/op (min %.1f, sd %.1f, %u x %u)\n",
+               p_name, p_result->median_ns, p_result->min_ns,
+               p_result->stddev_ns, (unsigned) reps, (unsigned) iters);
+    }
+}   /* perf_bench_run() */
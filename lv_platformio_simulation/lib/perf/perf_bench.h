@@ -0,0 +1,40 @@
+#ifndef PERF_BENCH_H
+
+#   define PERF_BENCH_H
+#   include <stdint.h>
+
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+
+// Microbenchmark runner: `p_fn` runs the operation `iters` times. The
+// warm-up finds an iteration count that makes one repetition last about
+// PERF_BENCH_REP_US (caches, branch predictors and the clock all settle
+// meanwhile), then every repetition is timed on its own. The median is the
+// figure to compare; min and spread tell how noisy the host was.
+//
+#   ifndef PERF_BENCH_REP_US
+#       define PERF_BENCH_REP_US    (2000U)
+#   endif
+#   define PERF_BENCH_MAX_REPS      (64U)
+
+typedef void (*perf_bench_fn_t)(void * p_ctx, uint32_t iters);
+
+typedef struct perf_bench_t
+{
+    uint32_t iters;         /* Per repetition */
+    uint32_t reps;
+    float min_ns;           /* Per operation */
+    float median_ns;
+    float mean_ns;
+    float stddev_ns;
+} perf_bench_t;
+
+void perf_bench_run(const char * p_name, perf_bench_fn_t p_fn, void * p_ctx,
+                    uint32_t reps, perf_bench_t * p_result);
+
+#   ifdef __cplusplus
+} /* extern "C" */
+#   endif
+
+#endif /* PERF_BENCH_H */
@@ -0,0 +1,290 @@
+#include "resample.h"
+#include <math.h>
+#include <string.h>
+
+#define RESAMPLE_PI         (3.14159265358979)
+
+// Four floats. Coefficients are aligned; the history window starts at any
+// frame, so its loads take the unaligned type.
+//
+typedef float v4f_t __attribute__((vector_size(4 * sizeof(float))));
+typedef float v4f_u_t __attribute__((vector_size(4 * sizeof(float)),
+                                     aligned(sizeof(float))));
+
+// Kaiser beta sets the stopband depth: about 60, 80 and 100 dB.
+//
+typedef struct tier_t
+{
+    uint16_t taps;          /* Multiple of 4 */
+    uint16_t phases;
+    float beta;
+} tier_t;
+
+static const tier_t g_tier[RESAMPLE_NUM_QUALITY] =
+{
+    {16, 32, 5.65f},        /* RESAMPLE_FAST */
+    {32, 64, 7.86f},        /* RESAMPLE_GOOD */
+    {64, 128, 10.06f},      /* RESAMPLE_BEST */
+};
+
+static double
+bessel_i0 (double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (uint32_t k = 1; k < 64; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+
+        if (term < sum * 1e-12)
+        {
+            break;
+        }
+    }
+
+    return (sum);
+}   /* bessel_i0() */
+
+// One phase: the filter for an output `frac` of an input frame past tap
+// taps / 2 - 1, normalised to unity gain at DC.
+//
+static void
+build_phase (const tier_t * p_tier, double fc, double frac, double * p_row)
+{
+    const double half = p_tier->taps / 2;
+    const double i0_beta = bessel_i0(p_tier->beta);
+    double sum = 0.0;
+
+    for (uint32_t k = 0; k < p_tier->taps; ++k)
+    {
+        double d = (double) k - (half - 1.0) - frac;
+        double x = d / half;
+        double sinc = (fabs(d) < 1e-9)
+                      ? 1.0 : sin(RESAMPLE_PI * fc * d) / (RESAMPLE_PI * fc * d);
+        double w = (fabs(x) <= 1.0)
+                   ? bessel_i0(p_tier->beta * sqrt(1.0 - x * x)) / i0_beta
+                   : 0.0;
+
+        p_row[k] = fc * sinc * w;
+        sum += p_row[k];
+    }
+
+    for (uint32_t k = 0; k < p_tier->taps; ++k)
+    {
+        p_row[k] /= sum;
+    }
+}   /* build_phase() */
+
+uint8_t
+resample_init (resample_t * p_rs, uint32_t in_rate, uint32_t out_rate,
+               resample_quality_t quality)
+{
+    double row[2][RESAMPLE_MAX_TAPS];
+    const tier_t * p_tier = NULL;
+    double down = 1.0;
+    double atten = 0.0;
+    double width = 0.0;
+
+    if ((0 == in_rate) || (0 == out_rate)
+        || (in_rate > RESAMPLE_MAX_RATIO * out_rate)
+        || (out_rate > RESAMPLE_MAX_RATIO * in_rate)
+        || (quality >= RESAMPLE_NUM_QUALITY))
+    {
+        return (0);
+    }
+
+    while ((quality > RESAMPLE_FAST)
+           && ((g_tier[quality].taps > RESAMPLE_MAX_TAPS)
+               || (g_tier[quality].phases > RESAMPLE_MAX_PHASES)))
+    {
+        quality = (resample_quality_t) (quality - 1);
+    }
+
+    p_tier = &g_tier[quality];
+    p_rs->in_rate = in_rate;
+    p_rs->out_rate = out_rate;
+    p_rs->taps = p_tier->taps;
+    p_rs->phases = p_tier->phases;
+    p_rs->quality = (uint8_t) quality;
+    p_rs->phase_scale = (float) p_tier->phases / (float) out_rate;
+
+    // The transition band from Kaiser's estimate, as a fraction of the
+    // lower rate: going down, the taps span fewer output samples and it
+    // widens. It is centred half its width below the lower Nyquist, so
+    // the stopband starts there and nothing that would fold back gets
+    // through; the passband ends a whole width below it.
+    //
+    down = (out_rate < in_rate) ? (double) out_rate / in_rate : 1.0;
+    atten = p_tier->beta / 0.1102 + 8.7;
+    width = (atten - 7.95) / (14.36 * p_tier->taps * down);
+    p_rs->pass_hz = (float) ((0.5 - width) * (in_rate * down));
+
+    // Each phase holds its taps, then the step to the next phase, so the
+    // interpolation is one multiply-add per tap. Phase `phases` is only
+    // there to end the last step.
+    //
+    build_phase(p_tier, (1.0 - width) * down, 0.0, row[0]);
+
+    for (uint32_t phase = 0; phase < p_tier->phases; ++phase)
+    {
+        float * p_coef = &p_rs->table[phase * 2 * p_tier->taps];
+        double * p_this = row[phase & 1U];
+        double * p_next = row[(phase + 1) & 1U];
+
+        build_phase(p_tier, (1.0 - width) * down,
+                    (double) (phase + 1) / p_tier->phases, p_next);
+
+        for (uint32_t k = 0; k < p_tier->taps; ++k)
+        {
+            p_coef[k] = (float) p_this[k];
+            p_coef[p_tier->taps + k] = (float) (p_next[k] - p_this[k]);
+        }
+    }
+
+    resample_reset(p_rs);
+
+    return (1);
+}   /* resample_init() */
+
+void
+resample_reset (resample_t * p_rs)
+{
+    // Silence in every tap but the last: the first input frame makes the
+    // first output.
+    //
+    memset(p_rs->hist, 0, sizeof(p_rs->hist));
+    p_rs->frac = 0;
+    p_rs->start = 0;
+    p_rs->fill = p_rs->taps - 1;
+}   /* resample_reset() */
+
+float
+resample_pass_hz (const resample_t * p_rs)
+{
+    return (p_rs->pass_hz);
+}   /* resample_pass_hz() */
+
+uint32_t
+resample_write (resample_t * p_rs, const float * p_in, uint32_t frames)
+{
+    uint32_t room = RESAMPLE_HIST - p_rs->fill;
+    uint32_t pos = p_rs->start + p_rs->fill;
+
+    frames = (frames > room) ? room : frames;
+
+    // Every frame twice, a history apart, so any window of taps is
+    // contiguous.
+    //
+    for (uint32_t idx = 0; idx < frames; ++idx, ++pos)
+    {
+        pos = (pos >= RESAMPLE_HIST) ? pos - RESAMPLE_HIST : pos;
+        p_rs->hist[0][pos] = p_in[2 * idx];
+        p_rs->hist[0][pos + RESAMPLE_HIST] = p_in[2 * idx];
+        p_rs->hist[1][pos] = p_in[2 * idx + 1];
+        p_rs->hist[1][pos + RESAMPLE_HIST] = p_in[2 * idx + 1];
+    }
+
+    p_rs->fill += frames;
+
+    return (frames);
+}   /* resample_write() */
+
+uint32_t
+resample_read (resample_t * p_rs, float * p_out, uint32_t frames)
+{
+    const uint32_t taps = p_rs->taps;
+    uint32_t made = 0;
+
+    while ((made < frames) && (p_rs->fill >= taps))
+    {
+        const float * p_left = &p_rs->hist[0][p_rs->start];
+        const float * p_right = &p_rs->hist[1][p_rs->start];
+        float pos = (float) p_rs->frac * p_rs->phase_scale;
+        uint32_t phase = (uint32_t) pos;
+        v4f_t sub;
+        v4f_t left = {0.0f, 0.0f, 0.0f, 0.0f};
+        v4f_t right = left;
+        const float * p_coef = NULL;
+
+        // The float product can round up to the last phase.
+        //
+        phase = (phase >= p_rs->phases) ? p_rs->phases - 1 : phase;
+        pos -= (float) phase;
+        sub = (v4f_t) {pos, pos, pos, pos};
+        p_coef = &p_rs->table[phase * 2 * taps];
+
+        for (uint32_t k = 0; k < taps; k += 4)
+        {
+            v4f_t coef = *(const v4f_t *) &p_coef[k]
+                         + sub * *(const v4f_t *) &p_coef[taps + k];
+
+            left += coef * *(const v4f_u_t *) &p_left[k];
+            right += coef * *(const v4f_u_t *) &p_right[k];
+        }
+
+        p_out[2 * made] = (left[0] + left[1]) + (left[2] + left[3]);
+        p_out[2 * made + 1] = (right[0] + right[1]) + (right[2] + right[3]);
+        ++made;
+
+        // Exact: a whole input frame every out_rate steps of in_rate.
+        //
+        p_rs->frac += p_rs->in_rate;
+
+        while (p_rs->frac >= p_rs->out_rate)
+        {
+            p_rs->frac -= p_rs->out_rate;
+            --p_rs->fill;
+
+            if (++p_rs->start == RESAMPLE_HIST)
+            {
+                p_rs->start = 0;
+            }
+        }
+    }
+
+    return (made);
+}   /* resample_read() */
+
+void
+resample_pull (resample_t * p_rs, resample_src_t src, void * p_user,
+               int16_t * p_out, uint32_t frames)
+{
+    float buf[2 * RESAMPLE_CHUNK];
+    int16_t pcm[2 * RESAMPLE_CHUNK];
+
+    while (frames > 0)
+    {
+        uint32_t want = (frames > RESAMPLE_CHUNK) ? RESAMPLE_CHUNK : frames;
+        uint32_t made = resample_read(p_rs, buf, want);
+
+        for (uint32_t idx = 0; idx < 2 * made; ++idx)
+        {
+            float value = buf[idx] * 32768.0f;
+
+            value = (value > 32767.0f) ? 32767.0f
+                                       : ((value < -32768.0f) ? -32768.0f
+                                                              : value);
+            p_out[idx] = (int16_t) lrintf(value);
+        }
+
+        p_out += 2 * made;
+        frames -= made;
+
+        // Short of input: fewer than taps frames are left, so a chunk
+        // always fits.
+        //
+        if (made < want)
+        {
+            src(p_user, pcm, RESAMPLE_CHUNK);
+
+            for (uint32_t idx = 0; idx < 2 * RESAMPLE_CHUNK; ++idx)
+            {
+                buf[idx] = pcm[idx] * (1.0f / 32768.0f);
+            }
+
+            resample_write(p_rs, buf, RESAMPLE_CHUNK);
+        }
+    }
+}   /* resample_pull() */
@@ -0,0 +1,110 @@
+#ifndef RESAMPLE_H
+
+#   define RESAMPLE_H
+#   include <stdint.h>
+
+// Sample rate conversion between the engine and the audio device: the
+// engine renders at its one fixed rate and the device takes whatever rate
+// it runs at. Polyphase windowed sinc (Kaiser), the filter for each output
+// sample interpolated between the two nearest of `phases` precomputed
+// ones, so any pair of rates works and the position never drifts (it is
+// kept as an exact fraction of the two rates).
+//
+// Both channels share the coefficients. They are read four at a time with
+// GCC vector types, which become SSE on x86 and NEON on ARM hosts, and
+// scalar code on cores without SIMD.
+//
+// The tier trades CPU for the width of the passband and the depth of the
+// stopband; resample_bench() measures all three. A tier above what
+// RESAMPLE_MAX_TAPS / RESAMPLE_MAX_PHASES hold falls back to the best
+// that fits (the table lives in resample_t).
+//
+#   ifndef RESAMPLE_MAX_TAPS
+#       define RESAMPLE_MAX_TAPS    (64)
+#   endif
+#   ifndef RESAMPLE_MAX_PHASES
+#       define RESAMPLE_MAX_PHASES  (128)
+#   endif
+#   define RESAMPLE_MAX_RATIO       (8U)    /* Either way round */
+#   define RESAMPLE_HIST            (256)   /* Input frames buffered */
+#   define RESAMPLE_CHUNK           (64)    /* Frames per pull from the source */
+#   define RESAMPLE_TABLE_SIZE      ((RESAMPLE_MAX_PHASES + 1) * 2 \
+                                     * RESAMPLE_MAX_TAPS)
+
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+
+typedef enum resample_quality_t
+{
+    RESAMPLE_FAST = 0,
+    RESAMPLE_GOOD,
+    RESAMPLE_BEST,
+    RESAMPLE_NUM_QUALITY
+} resample_quality_t;
+
+// Same as hal_audio_cb_t: interleaved stereo S16.
+//
+typedef void (*resample_src_t)(void * p_user, int16_t * p_out,
+                               uint32_t frames);
+
+typedef struct resample_t
+{
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint32_t taps;
+    uint32_t phases;
+    uint8_t quality;        /* resample_quality_t actually used */
+    uint32_t frac;          /* Position past `start`, in 1 / out_rate */
+    float phase_scale;      /* frac to table phase */
+    float pass_hz;
+    uint32_t start;         /* First tap in `hist` */
+    uint32_t fill;          /* Frames in `hist` from `start` on */
+    float hist[2][2 * RESAMPLE_HIST] __attribute__((aligned(16)));
+    float table[RESAMPLE_TABLE_SIZE] __attribute__((aligned(16)));
+} resample_t;
+
+typedef struct resample_bench_t
+{
+    uint32_t taps;
+    uint32_t phases;
+    float pass_hz;          /* Passband edge */
+    float ripple_db;        /* Gain, highest minus lowest, over the passband */
+    float alias_db;         /* Worst unwanted output against the tone */
+    float ns_per_frame;     /* One stereo output frame */
+    float realtime;         /* Times real time at out_rate, one core */
+} resample_bench_t;
+
+// Init time: builds the table for this pair of rates. The converter
+// delays the signal by taps / 2 input frames.
+//
+uint8_t resample_init(resample_t * p_rs, uint32_t in_rate, uint32_t out_rate,
+                      resample_quality_t quality);
+void resample_reset(resample_t * p_rs);
+float resample_pass_hz(const resample_t * p_rs);
+
+// Interleaved stereo float. resample_write() takes up to `frames` input
+// frames (as many as there is room for) and returns how many it took;
+// resample_read() makes up to `frames` output frames from what has been
+// written and returns how many it made.
+//
+uint32_t resample_write(resample_t * p_rs, const float * p_in,
+                        uint32_t frames);
+uint32_t resample_read(resample_t * p_rs, float * p_out, uint32_t frames);
+
+// Audio callback side: `frames` output frames, rendering the input from
+// `src` in RESAMPLE_CHUNK frame pieces as they are needed.
+//
+void resample_pull(resample_t * p_rs, resample_src_t src, void * p_user,
+                   int16_t * p_out, uint32_t frames);
+
+// Passband ripple and aliasing from test tones, then throughput.
+//
+void resample_bench(uint32_t in_rate, uint32_t out_rate,
+                    resample_quality_t quality, resample_bench_t * p_result);
+
+#   ifdef __cplusplus
+} /* extern "C" */
+#   endif
+
+#endif /* RESAMPLE_H */
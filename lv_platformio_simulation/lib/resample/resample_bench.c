@@ -0,0 +1,187 @@
+#include "resample.h"
+#include "perf_bench.h"
+#include <math.h>
+
+#define BENCH_TONES         (24)
+#define BENCH_FRAMES        (4096)  /* Output frames fitted per tone */
+#define BENCH_AMP           (0.5)
+#define BENCH_PI            (3.14159265358979)
+
+static resample_t g_rs;
+
+typedef struct tone_t
+{
+    double gain;            /* The tone itself, output over input amplitude */
+    double rest;            /* Everything else, RMS over the tone's RMS */
+    double total;           /* All of the output, the same way */
+} tone_t;
+
+// A tone at `freq` through the converter. A sinusoid at `freq` is fitted
+// to the output (least squares, so a window holding a fraction of a cycle
+// is fine) once the filter has settled; the rest is what it leaves.
+//
+static void
+tone_response (resample_t * p_rs, double freq, tone_t * p_tone)
+{
+    static float y[BENCH_FRAMES];
+    float in[2 * RESAMPLE_CHUNK];
+    float out[2 * RESAMPLE_CHUNK];
+    const uint32_t skip = 2 * p_rs->taps * RESAMPLE_MAX_RATIO;
+    const double w_in = 2.0 * BENCH_PI * freq / p_rs->in_rate;
+    const double w_out = 2.0 * BENCH_PI * freq / p_rs->out_rate;
+    uint32_t n_in = 0;
+    uint32_t n_out = 0;
+    double ss = 0.0;
+    double sc = 0.0;
+    double cc = 0.0;
+    double ys = 0.0;
+    double yc = 0.0;
+    double yy = 0.0;
+    double det = 0.0;
+    double a = 0.0;
+    double b = 0.0;
+    double rest = 0.0;
+
+    resample_reset(p_rs);
+
+    while (n_out < skip + BENCH_FRAMES)
+    {
+        uint32_t made = 0;
+
+        for (uint32_t idx = 0; idx < RESAMPLE_CHUNK; ++idx, ++n_in)
+        {
+            in[2 * idx] = (float) (BENCH_AMP * sin(w_in * n_in));
+            in[2 * idx + 1] = in[2 * idx];
+        }
+
+        resample_write(p_rs, in, RESAMPLE_CHUNK);
+
+        while ((made = resample_read(p_rs, out, RESAMPLE_CHUNK)) > 0)
+        {
+            for (uint32_t idx = 0; idx < made; ++idx, ++n_out)
+            {
+                if ((n_out >= skip) && (n_out < skip + BENCH_FRAMES))
+                {
+                    y[n_out - skip] = out[2 * idx];
+                }
+            }
+        }
+    }
+
+    for (uint32_t idx = 0; idx < BENCH_FRAMES; ++idx)
+    {
+        double s = sin(w_out * idx);
+        double c = cos(w_out * idx);
+
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        ys += y[idx] * s;
+        yc += y[idx] * c;
+        yy += (double) y[idx] * y[idx];
+    }
+
+    det = ss * cc - sc * sc;
+    a = (ys * cc - yc * sc) / det;
+    b = (yc * ss - ys * sc) / det;
+
+    for (uint32_t idx = 0; idx < BENCH_FRAMES; ++idx)
+    {
+        double e = y[idx] - a * sin(w_out * idx) - b * cos(w_out * idx);
+
+        rest += e * e;
+    }
+
+    p_tone->gain = sqrt(a * a + b * b) / BENCH_AMP;
+    p_tone->rest = sqrt(rest / BENCH_FRAMES) / (BENCH_AMP / sqrt(2.0));
+    p_tone->total = sqrt(yy / BENCH_FRAMES) / (BENCH_AMP / sqrt(2.0));
+}   /* tone_response() */
+
+static void
+bench_read (void * p_ctx, uint32_t iters)
+{
+    static float in[2 * RESAMPLE_CHUNK];
+    static float out[2 * RESAMPLE_CHUNK];
+    resample_t * p_rs = (resample_t *) p_ctx;
+
+    while (iters > 0)
+    {
+        uint32_t made = resample_read(p_rs, out,
+                                      (iters > RESAMPLE_CHUNK)
+                                      ? RESAMPLE_CHUNK : iters);
+
+        if (0 == made)
+        {
+            for (uint32_t idx = 0; idx < 2 * RESAMPLE_CHUNK; ++idx)
+            {
+                in[idx] = (float) ((idx * 37U) % 64U) * (1.0f / 64.0f)
+                          - 0.5f;
+            }
+
+            resample_write(p_rs, in, RESAMPLE_CHUNK);
+        }
+
+        iters -= made;
+    }
+}   /* bench_read() */
+
+void
+resample_bench (uint32_t in_rate, uint32_t out_rate,
+                resample_quality_t quality, resample_bench_t * p_result)
+{
+    const uint32_t low_rate = (in_rate < out_rate) ? in_rate : out_rate;
+    double lo_db = 1e9;
+    double hi_db = -1e9;
+    double worst = 0.0;
+    perf_bench_t perf;
+    tone_t tone;
+
+    if (0 == resample_init(&g_rs, in_rate, out_rate, quality))
+    {
+        return;
+    }
+
+    p_result->taps = g_rs.taps;
+    p_result->phases = g_rs.phases;
+    p_result->pass_hz = resample_pass_hz(&g_rs);
+
+    // Passband: the tone's gain is the ripple; whatever comes out besides
+    // it (images, aliases of it) counts against the aliasing figure.
+    //
+    for (uint32_t idx = 0; idx < BENCH_TONES; ++idx)
+    {
+        double freq = 50.0 + (p_result->pass_hz - 50.0) * idx
+                             / (BENCH_TONES - 1);
+        double db = 0.0;
+
+        tone_response(&g_rs, freq, &tone);
+        db = 20.0 * log10(tone.gain);
+        lo_db = (db < lo_db) ? db : lo_db;
+        hi_db = (db > hi_db) ? db : hi_db;
+        worst = (tone.rest > worst) ? tone.rest : worst;
+    }
+
+    // Going down, the input's band above the output's Nyquist must not
+    // come out at all: anything that does is folded back.
+    //
+    if (in_rate > out_rate)
+    {
+        for (uint32_t idx = 0; idx < BENCH_TONES; ++idx)
+        {
+            double freq = 0.5 * low_rate + (0.5 * in_rate - 0.5 * low_rate)
+                                           * (idx + 0.5) / BENCH_TONES;
+
+            tone_response(&g_rs, freq, &tone);
+            worst = (tone.total > worst) ? tone.total : worst;
+        }
+    }
+
+    p_result->ripple_db = (float) (hi_db - lo_db);
+    p_result->alias_db = (float) (20.0 * log10(worst + 1e-12));
+
+    resample_reset(&g_rs);
+    perf_bench_run("resample_read", bench_read, &g_rs, 21, &perf);
+    p_result->ns_per_frame = perf.median_ns;
+    p_result->realtime = (0.0f == perf.median_ns)
+                         ? 0.0f : 1e9f / (perf.median_ns * out_rate);
+}   /* resample_bench() */
@@ -0,0 +1,116 @@
+#include "fft.h"
+#include <math.h>
+
+#define FFT_PI  (3.14159265358979)
+
+uint8_t
+fft_init (fft_t * p_fft, float * p_twiddle, uint32_t size)
+{
+    uint32_t half = size / 2;
+
+    if ((size < 2) || (0 != (size & (size - 1))))
+    {
+        return (0);
+    }
+
+    p_fft->size = size;
+    p_fft->bits = 0;
+
+    while ((1U << p_fft->bits) < size)
+    {
+        ++p_fft->bits;
+    }
+
+    for (uint32_t idx = 0; idx < half; ++idx)
+    {
+        p_twiddle[idx] = (float) cos(2.0 * FFT_PI * idx / size);
+        p_twiddle[half + idx] = (float) -sin(2.0 * FFT_PI * idx / size);
+    }
+
+    p_fft->p_cos = p_twiddle;
+    p_fft->p_sin = p_twiddle + half;
+
+    return (1);
+}   /* fft_init() */
+
+void
+fft_forward (const fft_t * p_fft, float * p_re, float * p_im)
+{
+    const uint32_t size = p_fft->size;
+
+    // Bit-reversal permutation.
+    //
+    for (uint32_t idx = 0, rev = 0; idx < size; ++idx)
+    {
+        if (idx < rev)
+        {
+            float tmp = p_re[idx];
+
+            p_re[idx] = p_re[rev];
+            p_re[rev] = tmp;
+            tmp = p_im[idx];
+            p_im[idx] = p_im[rev];
+            p_im[rev] = tmp;
+        }
+
+        uint32_t bit = size >> 1;
+
+        while (rev & bit)
+        {
+            rev ^= bit;
+            bit >>= 1;
+        }
+
+        rev |= bit;
+    }
+
+    for (uint32_t len = 2; len <= size; len <<= 1)
+    {
+        uint32_t half = len >> 1;
+        uint32_t step = size / len;
+
+        for (uint32_t start = 0; start < size; start += len)
+        {
+            for (uint32_t idx = 0; idx < half; ++idx)
+            {
+                float wr = p_fft->p_cos[idx * step];
+                float wi = p_fft->p_sin[idx * step];
+                uint32_t a = start + idx;
+                uint32_t b = a + half;
+                float tr = p_re[b] * wr - p_im[b] * wi;
+                float ti = p_re[b] * wi + p_im[b] * wr;
+
+                p_re[b] = p_re[a] - tr;
+                p_im[b] = p_im[a] - ti;
+                p_re[a] += tr;
+                p_im[a] += ti;
+            }
+        }
+    }
+}   /* fft_forward() */
+
+void
+fft_power (const fft_t * p_fft, const float * p_re, const float * p_im,
+           float * p_power)
+{
+    for (uint32_t idx = 0; idx <= p_fft->size / 2; ++idx)
+    {
+        p_power[idx] = p_re[idx] * p_re[idx] + p_im[idx] * p_im[idx];
+    }
+}   /* fft_power() */
+
+void
+fft_window (float * p_buf, uint32_t size)
+{
+    // 4-term Blackman-Harris: side lobes below -92 dB, so leakage does not
+    // mask what we measure.
+    //
+    for (uint32_t idx = 0; idx < size; ++idx)
+    {
+        double x = 2.0 * FFT_PI * idx / size;
+
+        p_buf[idx] *= (float) (0.35875 - 0.48829 * cos(x)
+                               + 0.14128 * cos(2.0 * x)
+                               - 0.01168 * cos(3.0 * x));
+    }
+}   /* fft_window() */
@@ -0,0 +1,24 @@
+#ifndef FFT_H
+
+#   define FFT_H
+#   include <stdint.h>
+
+// In-place radix-2 complex FFT of a fixed power-of-two size. The caller
+// owns the twiddle table (size / 2 cosines followed by size / 2 sines), so
+// the transform itself never allocates.
+//
+typedef struct fft_t
+{
+    uint32_t size;
+    uint32_t bits;
+    const float * p_cos;
+    const float * p_sin;
+} fft_t;
+
+uint8_t fft_init(fft_t * p_fft, float * p_twiddle, uint32_t size);
+void fft_forward(const fft_t * p_fft, float * p_re, float * p_im);
+void fft_power(const fft_t * p_fft, const float * p_re, const float * p_im,
+               float * p_power);
+void fft_window(float * p_buf, uint32_t size);
+
+#endif /* FFT_H */
@@ -0,0 +1,327 @@
+#include "fm.h"
+#include "osc.h"
+#include <math.h>
+
+#define FM_PI               (3.14159265358979f)
+#define FM_TABLE_SCALE      ((float) OSC_TABLE_SIZE / (2.0f * FM_PI))
+#define FM_PHASE_SCALE      ((float) OSC_TABLE_SIZE / 16777216.0f)
+#define FM_INDEX_BIAS       ((float) OSC_TABLE_SIZE * 16.0f)
+#define FM_SILENT           (1e-4f)     /* -80 dB */
+#define FM_FLOOR            (1e-6f)     /* Snapped to its target below */
+#define FM_LN_1000          (6.9078f)   /* Decays are given to -60 dB */
+
+typedef enum fm_stage_t
+{
+    FM_STAGE_ATTACK = 0,
+    FM_STAGE_DECAY,         /* Then holds at sustain */
+    FM_STAGE_RELEASE
+} fm_stage_t;
+
+// Bit s of mod[op]: operator s modulates op. out: operators heard.
+//
+typedef struct fm_algo_t
+{
+    uint8_t mod[FM_NUM_OP];
+    uint8_t out;
+} fm_algo_t;
+
+static const fm_algo_t g_algo[FM_NUM_ALGO] =
+{
+    {{0x2, 0x4, 0x8, 0x0}, 0x1},    /* 3 > 2 > 1 > 0 */
+    {{0x2, 0xC, 0x0, 0x0}, 0x1},    /* (3 + 2) > 1 > 0 */
+    {{0x6, 0x0, 0x8, 0x0}, 0x1},    /* (3 > 2) + 1 > 0 */
+    {{0x2, 0x0, 0x8, 0x0}, 0x5},    /* 3 > 2, 1 > 0 */
+    {{0x8, 0x8, 0x8, 0x0}, 0x7},    /* 3 > 2, 1, 0 */
+    {{0x0, 0x0, 0x8, 0x0}, 0x7},    /* 3 > 2, 1, 0 */
+    {{0x0, 0x0, 0x0, 0x0}, 0xF},    /* 3, 2, 1, 0 */
+    {{0xE, 0x0, 0x0, 0x0}, 0x1}     /* (3 + 2 + 1) > 0 */
+};
+
+// Ratio, level, attack, decay, sustain, release.
+//
+static fm_patch_t g_patch[FM_NUM_PATCH] =
+{
+    {3, 0.0f, {{1.0f, 1.0f, 2.0f, 2500.0f, 0.0f, 400.0f},
+               {1.0f, 1.3f, 2.0f, 1200.0f, 0.1f, 400.0f},
+               {1.0f, 0.5f, 2.0f, 900.0f, 0.0f, 300.0f},
+               {14.0f, 1.4f, 1.0f, 150.0f, 0.0f, 100.0f}}},
+    {3, 0.0f, {{1.0f, 1.0f, 1.0f, 5000.0f, 0.0f, 2500.0f},
+               {3.5f, 2.5f, 1.0f, 3500.0f, 0.0f, 2000.0f},
+               {2.0f, 0.6f, 1.0f, 3000.0f, 0.0f, 2000.0f},
+               {7.07f, 2.0f, 1.0f, 1800.0f, 0.0f, 1500.0f}}},
+    {0, 0.9f, {{1.0f, 1.0f, 2.0f, 900.0f, 0.6f, 80.0f},
+               {1.0f, 1.6f, 1.0f, 400.0f, 0.3f, 80.0f},
+               {2.0f, 1.0f, 1.0f, 250.0f, 0.2f, 80.0f},
+               {1.0f, 0.8f, 1.0f, 200.0f, 0.2f, 80.0f}}}
+};
+
+static inline const fm_algo_t *
+patch_algo (const fm_patch_t * p_patch)
+{
+    return (&g_algo[p_patch->algorithm % FM_NUM_ALGO]);
+}   /* patch_algo() */
+
+// Sine at `phase` moved on by `m` table steps, interpolated. The bias
+// keeps a negative index positive before it is wrapped.
+//
+static inline float
+table_read (const float * p_sine, uint32_t phase, float m)
+{
+    float x = (float) (int32_t) (phase >> 8) * FM_PHASE_SCALE + m
+              + FM_INDEX_BIAS;
+    int32_t pos = (int32_t) x;
+    float frac = x - (float) pos;
+    float a = 0.0f;
+
+    pos &= OSC_TABLE_SIZE - 1;
+    a = p_sine[pos];
+
+    return (a + (p_sine[pos + 1] - a) * frac);
+}   /* table_read() */
+
+// Envelope `op` of `p_voice` moved on by `frames`; returns the new level.
+// Decays stop short of denormals, which would stall the render loop long
+// after the operator has gone quiet.
+//
+static float
+env_advance (fm_voice_t * p_voice, const fm_op_t * p_op, uint32_t op,
+             uint32_t frames)
+{
+    const float ms = (float) frames * 1000.0f / (float) p_voice->sample_rate;
+    float env = p_voice->env[op];
+
+    switch (p_voice->stage[op])
+    {
+        case FM_STAGE_ATTACK:
+        {
+            env += (p_op->attack_ms > 0.0f) ? ms / p_op->attack_ms : 1.0f;
+
+            if (env >= 1.0f)
+            {
+                env = 1.0f;
+                p_voice->stage[op] = FM_STAGE_DECAY;
+            }
+        }
+        break;
+
+        case FM_STAGE_DECAY:
+        {
+            env = p_op->sustain + (env - p_op->sustain)
+                                  * expf(-FM_LN_1000 * ms / p_op->decay_ms);
+            env = (env - p_op->sustain < FM_FLOOR) ? p_op->sustain : env;
+        }
+        break;
+
+        default:
+        {
+            env *= expf(-FM_LN_1000 * ms / p_op->release_ms);
+            env = (env < FM_FLOOR) ? 0.0f : env;
+        }
+        break;
+    }
+
+    p_voice->env[op] = env;
+
+    return (env);
+}   /* env_advance() */
+
+const fm_patch_t *
+fm_get_patch (fm_patch_id_t id)
+{
+    return (&g_patch[id % FM_NUM_PATCH]);
+}   /* fm_get_patch() */
+
+void
+fm_set_patch (fm_patch_id_t id, const fm_patch_t * p_patch)
+{
+    g_patch[id % FM_NUM_PATCH] = *p_patch;
+}   /* fm_set_patch() */
+
+void
+fm_voice_start (fm_voice_t * p_voice, fm_patch_id_t id, uint32_t inc,
+                uint32_t sample_rate)
+{
+    const fm_patch_t * p_patch = fm_get_patch(id);
+
+    p_voice->patch = (uint8_t) (1 + id % FM_NUM_PATCH);
+    p_voice->sample_rate = sample_rate;
+    p_voice->fb[0] = 0.0f;
+    p_voice->fb[1] = 0.0f;
+
+    for (uint32_t op = 0; op < FM_NUM_OP; ++op)
+    {
+        p_voice->stage[op] = FM_STAGE_ATTACK;
+        p_voice->phase[op] = 0;
+        p_voice->inc[op] = (uint32_t) ((float) inc * p_patch->op[op].ratio);
+        p_voice->env[op] = 0.0f;
+    }
+}   /* fm_voice_start() */
+
+void
+fm_voice_release (fm_voice_t * p_voice)
+{
+    for (uint32_t op = 0; op < FM_NUM_OP; ++op)
+    {
+        p_voice->stage[op] = FM_STAGE_RELEASE;
+    }
+}   /* fm_voice_release() */
+
+void
+fm_voice_set_inc (fm_voice_t * p_voice, uint32_t inc)
+{
+    const fm_patch_t * p_patch = fm_get_patch((fm_patch_id_t)
+                                              (p_voice->patch - 1));
+
+    for (uint32_t op = 0; op < FM_NUM_OP; ++op)
+    {
+        p_voice->inc[op] = (uint32_t) ((float) inc * p_patch->op[op].ratio);
+    }
+}   /* fm_voice_set_inc() */
+
+uint32_t
+fm_render (fm_voice_t * const * pp_voice, uint32_t count,
+           float * const * pp_out, uint32_t frames)
+{
+    const float * p_sine = osc_sine_table();
+    uint32_t phase[FM_NUM_OP][FM_LANES];
+    uint32_t inc[FM_NUM_OP][FM_LANES];
+    float env[FM_NUM_OP][FM_LANES];
+    float step[FM_NUM_OP][FM_LANES];
+    float level[FM_NUM_OP][FM_LANES];
+    float heard[FM_NUM_OP][FM_LANES];
+    float mod[FM_NUM_OP][FM_NUM_OP][FM_LANES];
+    float y[FM_NUM_OP][FM_LANES];
+    float feedback[FM_LANES];
+    float fb0[FM_LANES];
+    float fb1[FM_LANES];
+    uint32_t alive = 0;
+
+    // Per-voice setup at block rate. Spare lanes run silent so every loop
+    // below has the same fixed trip count.
+    //
+    for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+    {
+        fm_voice_t * p_voice = (lane < count) ? pp_voice[lane] : NULL;
+        const fm_patch_t * p_patch = (NULL != p_voice)
+                                     ? fm_get_patch((fm_patch_id_t)
+                                                    (p_voice->patch - 1))
+                                     : NULL;
+        const fm_algo_t * p_algo = (NULL != p_patch) ? patch_algo(p_patch)
+                                                     : NULL;
+        float num_out = (NULL != p_algo)
+                        ? (float) __builtin_popcount(p_algo->out) : 1.0f;
+        uint8_t b_sounding = 0;
+
+        for (uint32_t op = 0; op < FM_NUM_OP; ++op)
+        {
+            uint8_t b_out = (NULL != p_algo) && ((p_algo->out >> op) & 1U);
+
+            y[op][lane] = 0.0f;
+
+            for (uint32_t src = 0; src < FM_NUM_OP; ++src)
+            {
+                mod[op][src][lane] = ((NULL != p_algo)
+                                      && ((p_algo->mod[op] >> src) & 1U))
+                                     ? 1.0f : 0.0f;
+            }
+
+            if (NULL == p_voice)
+            {
+                phase[op][lane] = 0;
+                inc[op][lane] = 0;
+                env[op][lane] = 0.0f;
+                step[op][lane] = 0.0f;
+                level[op][lane] = 0.0f;
+                heard[op][lane] = 0.0f;
+                continue;
+            }
+
+            // Heard operators are scaled to share the output, modulators
+            // to table steps so their output adds straight to the index.
+            //
+            float start = p_voice->env[op];
+            float end = env_advance(p_voice, &p_patch->op[op], op, frames);
+
+            phase[op][lane] = p_voice->phase[op];
+            inc[op][lane] = p_voice->inc[op];
+            env[op][lane] = start;
+            step[op][lane] = (end - start) / (float) frames;
+            level[op][lane] = b_out ? p_patch->op[op].level / num_out
+                                    : p_patch->op[op].level * FM_TABLE_SCALE;
+            heard[op][lane] = b_out ? 1.0f : 0.0f;
+
+            if (b_out && ((end > FM_SILENT)
+                          || (FM_STAGE_ATTACK == p_voice->stage[op])))
+            {
+                b_sounding = 1;
+            }
+        }
+
+        feedback[lane] = (NULL != p_patch)
+                         ? p_patch->feedback * FM_TABLE_SCALE * 0.5f : 0.0f;
+        fb0[lane] = (NULL != p_voice) ? p_voice->fb[0] : 0.0f;
+        fb1[lane] = (NULL != p_voice) ? p_voice->fb[1] : 0.0f;
+        alive |= (uint32_t) b_sounding << lane;
+    }
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        float acc[FM_LANES];
+
+        // Operator 3 hears only itself; the rest take every operator's
+        // last output through their mod gains (zero where not connected),
+        // so the lane loops have no branches.
+        //
+        for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+        {
+            float s = table_read(p_sine, phase[3][lane],
+                                 feedback[lane] * (fb0[lane] + fb1[lane]));
+
+            fb1[lane] = fb0[lane];
+            fb0[lane] = s * env[3][lane];
+            y[3][lane] = fb0[lane] * level[3][lane];
+            acc[lane] = y[3][lane] * heard[3][lane];
+        }
+
+        for (int32_t op = FM_NUM_OP - 2; op >= 0; --op)
+        {
+            for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+            {
+                float m = mod[op][1][lane] * y[1][lane]
+                          + mod[op][2][lane] * y[2][lane]
+                          + mod[op][3][lane] * y[3][lane];
+                float s = table_read(p_sine, phase[op][lane], m);
+
+                y[op][lane] = s * env[op][lane] * level[op][lane];
+                acc[lane] += y[op][lane] * heard[op][lane];
+            }
+        }
+
+        for (uint32_t op = 0; op < FM_NUM_OP; ++op)
+        {
+            for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+            {
+                env[op][lane] += step[op][lane];
+                phase[op][lane] += inc[op][lane];
+            }
+        }
+
+        for (uint32_t lane = 0; lane < count; ++lane)
+        {
+            pp_out[lane][idx] = acc[lane];
+        }
+    }
+
+    for (uint32_t lane = 0; lane < count; ++lane)
+    {
+        for (uint32_t op = 0; op < FM_NUM_OP; ++op)
+        {
+            pp_voice[lane]->phase[op] = phase[op][lane];
+        }
+
+        pp_voice[lane]->fb[0] = fb0[lane];
+        pp_voice[lane]->fb[1] = fb1[lane];
+    }
+
+    return (alive);
+}   /* fm_render() */
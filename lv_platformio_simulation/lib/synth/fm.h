@@ -0,0 +1,98 @@
+#ifndef FM_H
+
+#   define FM_H
+#   include <stdint.h>
+
+// Four-operator FM. Operators are numbered 0..3 and only modulate lower
+// numbers, so evaluating 3 down to 0 sees every modulator first; operator
+// 3 may also modulate itself (feedback). An algorithm is which operator
+// feeds which, and which ones are heard.
+//
+// Voices are rendered FM_LANES at a time, their state laid out lane by
+// lane so the inner loops run across voices; envelopes move at block
+// rate and are interpolated per sample. Phases index the oscillator's
+// sine table.
+//
+#   define FM_NUM_OP        (4)
+#   define FM_LANES         (4)
+#   define FM_NUM_ALGO      (8)
+
+typedef enum fm_patch_id_t
+{
+    FM_EPIANO = 0,          /* Same order as the waveform dropdown */
+    FM_BELL,
+    FM_BASS,
+    FM_NUM_PATCH
+} fm_patch_id_t;
+
+typedef struct fm_op_t
+{
+    float ratio;            /* Of the note frequency */
+    float level;            /* Heard: gain. Modulating: index, radians */
+    float attack_ms;
+    float decay_ms;         /* To -60 dB of the way down to sustain */
+    float sustain;          /* 0.0 .. 1.0 */
+    float release_ms;       /* To -60 dB */
+} fm_op_t;
+
+typedef struct fm_patch_t
+{
+    uint8_t algorithm;      /* 0 .. FM_NUM_ALGO - 1, see fm.cpp */
+    float feedback;         /* Operator 3 on itself, radians */
+    fm_op_t op[FM_NUM_OP];
+} fm_patch_t;
+
+// Inside the synth voice.
+//
+typedef struct fm_voice_t
+{
+    uint8_t patch;          /* 1 + fm_patch_id_t, 0: not an FM voice */
+    uint8_t stage[FM_NUM_OP];
+    uint32_t phase[FM_NUM_OP];
+    uint32_t inc[FM_NUM_OP];
+    float env[FM_NUM_OP];
+    float fb[2];            /* Operator 3, last two outputs */
+    uint32_t sample_rate;
+} fm_voice_t;
+
+typedef struct fm_bench_t
+{
+    uint32_t osc_ns;        /* One oscillator voice, one block */
+    uint32_t fm_ns;         /* One FM voice, one block, FM_LANES at a time */
+    float osc_voices;       /* Voices one core renders in real time */
+    float fm_voices;
+    uint32_t checksum;      /* First blocks of every lane, as 16-bit PCM */
+    float peak;             /* Largest sample of those blocks */
+} fm_bench_t;
+
+// Patches live in RAM, so a board may replace one (init time only, before
+// audio starts).
+//
+const fm_patch_t * fm_get_patch(fm_patch_id_t id);
+void fm_set_patch(fm_patch_id_t id, const fm_patch_t * p_patch);
+
+// Audio side. `inc` is the note's phase step; the voice restarts from
+// zero phase and silent envelopes.
+//
+void fm_voice_start(fm_voice_t * p_voice, fm_patch_id_t id, uint32_t inc,
+                    uint32_t sample_rate);
+void fm_voice_release(fm_voice_t * p_voice);
+
+// Retune a sounding voice to `inc` (pitch modulation), keeping its phases
+// and envelopes.
+//
+void fm_voice_set_inc(fm_voice_t * p_voice, uint32_t inc);
+
+// Render `count` (up to FM_LANES) voices, one output buffer each. Returns
+// a bit per lane still sounding.
+//
+uint32_t fm_render(fm_voice_t * const * pp_voice, uint32_t count,
+                   float * const * pp_out, uint32_t frames);
+
+// Block cost of an FM voice next to an oscillator voice at `note`. The
+// checksum and peak come from freshly struck voices, so they are the same
+// on every run of a build; the times are the host's.
+//
+void fm_bench(uint8_t note, uint32_t sample_rate, fm_bench_t * p_result);
+
+#endif /* FM_H */
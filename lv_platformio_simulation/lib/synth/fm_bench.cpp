@@ -0,0 +1,130 @@
+#include "fm.h"
+#include "osc.h"
+#include "perf.h"
+#include "synth.h"
+#include <math.h>
+
+#define BENCH_WARMUP        (64)
+#define BENCH_BLOCKS        (4096)
+#define BENCH_CHECK_BLOCKS  (16)
+
+static uint32_t
+note_phase_inc (uint8_t note, uint32_t sample_rate)
+{
+    double freq = pow(2.0, ((double) note - 69.0) / 12.0) * 440.0;
+
+    return ((uint32_t) (freq / sample_rate * 4294967296.0));
+}   /* note_phase_inc() */
+
+static uint32_t
+pcm_hash (uint32_t hash, const float * p_buf, uint32_t frames)
+{
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        float value = p_buf[idx] * 32767.0f;
+        int16_t pcm = (int16_t) ((value > 32767.0f) ? 32767.0f
+                                 : ((value < -32768.0f) ? -32768.0f : value));
+
+        hash = (hash ^ (uint16_t) pcm) * 16777619U;
+    }
+
+    return (hash);
+}   /* pcm_hash() */
+
+// Keep every lane busy: a voice that has died away is struck again.
+//
+static void
+fm_block (fm_voice_t * p_voice, float * const * pp_out, uint32_t inc,
+          uint32_t sample_rate)
+{
+    fm_voice_t * pp_voice[FM_LANES];
+    uint32_t alive = 0;
+
+    for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+    {
+        pp_voice[lane] = &p_voice[lane];
+    }
+
+    alive = fm_render(pp_voice, FM_LANES, pp_out, SYNTH_BLOCK_SIZE);
+
+    for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+    {
+        if (0 == ((alive >> lane) & 1U))
+        {
+            fm_voice_start(&p_voice[lane],
+                           (fm_patch_id_t) (lane % FM_NUM_PATCH),
+                           inc, sample_rate);
+        }
+    }
+}   /* fm_block() */
+
+void
+fm_bench (uint8_t note, uint32_t sample_rate, fm_bench_t * p_result)
+{
+    static float block[FM_LANES][SYNTH_BLOCK_SIZE];
+    static fm_voice_t voice[FM_LANES];
+    float * pp_out[FM_LANES];
+    uint32_t inc = note_phase_inc(note, sample_rate);
+    osc_t osc = {0, inc, (uint8_t) OSC_SQUARE, (uint8_t) OSC_DEFAULT_MODE};
+    uint64_t deadline_ns = (uint64_t) SYNTH_BLOCK_SIZE * 1000000000ULL
+                           / sample_rate;
+    uint32_t start = 0;
+    uint64_t osc_ticks = 0;
+    uint64_t fm_ticks = 0;
+    uint32_t hash = 2166136261U;
+    float peak = 0.0f;
+
+    osc_init();
+
+    for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+    {
+        pp_out[lane] = block[lane];
+        fm_voice_start(&voice[lane], (fm_patch_id_t) (lane % FM_NUM_PATCH),
+                       inc, sample_rate);
+    }
+
+    for (uint32_t idx = 0; idx < BENCH_CHECK_BLOCKS; ++idx)
+    {
+        fm_block(voice, pp_out, inc, sample_rate);
+
+        for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+        {
+            hash = pcm_hash(hash, block[lane], SYNTH_BLOCK_SIZE);
+
+            for (uint32_t frame = 0; frame < SYNTH_BLOCK_SIZE; ++frame)
+            {
+                peak = (fabsf(block[lane][frame]) > peak)
+                       ? fabsf(block[lane][frame]) : peak;
+            }
+        }
+    }
+
+    p_result->checksum = hash;
+    p_result->peak = peak;
+
+    for (uint32_t idx = 0; idx < BENCH_WARMUP; ++idx)
+    {
+        osc_render(&osc, block[0], SYNTH_BLOCK_SIZE);
+        fm_block(voice, pp_out, inc, sample_rate);
+    }
+
+    for (uint32_t idx = 0; idx < BENCH_BLOCKS; ++idx)
+    {
+        start = perf_ticks();
+        osc_render(&osc, block[0], SYNTH_BLOCK_SIZE);
+        osc_ticks += perf_ticks() - start;
+
+        start = perf_ticks();
+        fm_block(voice, pp_out, inc, sample_rate);
+        fm_ticks += perf_ticks() - start;
+    }
+
+    p_result->osc_ns = perf_ticks_to_ns((uint32_t) (osc_ticks / BENCH_BLOCKS));
+    p_result->fm_ns = perf_ticks_to_ns((uint32_t) (fm_ticks
+                                                   / (BENCH_BLOCKS
+                                                      * FM_LANES)));
+    p_result->osc_voices = (0 == p_result->osc_ns)
+                           ? 0.0f : (float) deadline_ns / p_result->osc_ns;
+    p_result->fm_voices = (0 == p_result->fm_ns)
+                          ? 0.0f : (float) deadline_ns / p_result->fm_ns;
+}   /* fm_bench() */
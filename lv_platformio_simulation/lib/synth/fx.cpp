@@ -0,0 +1,483 @@
+#include "fx.h"
+#include <string.h>
+#include <math.h>
+
+#define FX_PI               (3.14159265358979f)
+
+// Freeverb tunings, in frames at 44.1 kHz.
+//
+#define FX_REVERB_RATE      (44100)
+#define FX_REVERB_SPREAD    (23)
+#define FX_REVERB_GAIN      (0.015f)
+#define FX_REVERB_ROOM_SCALE    (0.28f)
+#define FX_REVERB_ROOM_OFFSET   (0.7f)
+#define FX_REVERB_DAMP_SCALE    (0.4f)
+#define FX_ALLPASS_FEEDBACK (0.5f)
+
+#define FX_UNDENORMAL(x)    (((x) < 1e-15f) && ((x) > -1e-15f) ? 0.0f : (x))
+
+static void filter_process(void * p_state, float * p_left, float * p_right,
+                           uint32_t frames);
+static void chorus_process(void * p_state, float * p_left, float * p_right,
+                           uint32_t frames);
+static void delay_process(void * p_state, float * p_left, float * p_right,
+                          uint32_t frames);
+static void reverb_process(void * p_state, float * p_left, float * p_right,
+                           uint32_t frames);
+
+static const uint16_t g_comb_tuning[FX_REVERB_NUM_COMB] =
+{
+    1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617
+};
+
+static const uint16_t g_allpass_tuning[FX_REVERB_NUM_ALLPASS] =
+{
+    556, 441, 341, 225
+};
+
+static float
+clampf (float value, float min, float max)
+{
+    return ((value < min) ? min : ((value > max) ? max : value));
+}   /* clampf() */
+
+static void
+filter_update (fx_filter_t * p_filter, uint32_t sample_rate)
+{
+    // Trapezoidal SVF: stable at any cutoff, resonance maps to 1/Q.
+    //
+    float cutoff = clampf(p_filter->cutoff * exp2f(p_filter->cutoff_mod),
+                          20.0f, (float) sample_rate * 0.45f);
+    float g = tanf(FX_PI * cutoff / (float) sample_rate);
+
+    p_filter->k = 2.0f - 1.98f * p_filter->resonance;
+    p_filter->a1 = 1.0f / (1.0f + g * (g + p_filter->k));
+    p_filter->a2 = g * p_filter->a1;
+    p_filter->a3 = g * p_filter->a2;
+}   /* filter_update() */
+
+static void
+filter_process (void * p_state, float * p_left, float * p_right,
+                uint32_t frames)
+{
+    fx_filter_t * p_filter = (fx_filter_t *) p_state;
+    float * p_chan[2] = {p_left, p_right};
+    const float a1 = p_filter->a1;
+    const float a2 = p_filter->a2;
+    const float a3 = p_filter->a3;
+
+    for (uint32_t ch = 0; ch < 2; ++ch)
+    {
+        float * p_buf = p_chan[ch];
+        float ic1eq = p_filter->ic1eq[ch];
+        float ic2eq = p_filter->ic2eq[ch];
+
+        for (uint32_t idx = 0; idx < frames; ++idx)
+        {
+            float v3 = p_buf[idx] - ic2eq;
+            float v1 = a1 * ic1eq + a2 * v3;
+            float v2 = ic2eq + a2 * ic1eq + a3 * v3;
+
+            ic1eq = 2.0f * v1 - ic1eq;
+            ic2eq = 2.0f * v2 - ic2eq;
+            p_buf[idx] = v2;
+        }
+
+        p_filter->ic1eq[ch] = FX_UNDENORMAL(ic1eq);
+        p_filter->ic2eq[ch] = FX_UNDENORMAL(ic2eq);
+    }
+}   /* filter_process() */
+
+static float
+line_read (const float * p_line, uint32_t len, uint32_t pos, float delay)
+{
+    float read = (float) pos - delay;
+    int32_t idx = 0;
+    float frac = 0.0f;
+
+    if (read < 0.0f)
+    {
+        read += (float) len;
+    }
+
+    idx = (int32_t) read;
+    frac = read - (float) idx;
+
+    float a = p_line[idx];
+    float b = p_line[((uint32_t) idx + 1 < len) ? idx + 1 : 0];
+
+    return (a + (b - a) * frac);
+}   /* line_read() */
+
+static void
+chorus_process (void * p_state, float * p_left, float * p_right,
+                uint32_t frames)
+{
+    fx_chorus_t * p_chorus = (fx_chorus_t *) p_state;
+    float * p_line_l = p_chorus->p_line[0];
+    float * p_line_r = p_chorus->p_line[1];
+    uint32_t pos = p_chorus->pos;
+    float lfo = p_chorus->lfo;
+    float lfo_inc = p_chorus->lfo_inc;
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        // Triangle LFO, the right channel runs in anti-phase.
+        //
+        float tri = (lfo < 0.5f) ? (2.0f * lfo) : (2.0f - 2.0f * lfo);
+        float dl = p_chorus->base + p_chorus->depth * tri;
+        float dr = p_chorus->base + p_chorus->depth * (1.0f - tri);
+        float in_l = p_left[idx];
+        float in_r = p_right[idx];
+
+        p_line_l[pos] = in_l;
+        p_line_r[pos] = in_r;
+
+        float wet_l = line_read(p_line_l, p_chorus->len, pos, dl);
+        float wet_r = line_read(p_line_r, p_chorus->len, pos, dr);
+
+        p_left[idx] = in_l + (wet_l - in_l) * p_chorus->mix;
+        p_right[idx] = in_r + (wet_r - in_r) * p_chorus->mix;
+
+        if (++pos >= p_chorus->len)
+        {
+            pos = 0;
+        }
+
+        lfo += lfo_inc;
+
+        if (lfo >= 1.0f)
+        {
+            lfo -= 1.0f;
+        }
+    }
+
+    p_chorus->pos = pos;
+    p_chorus->lfo = lfo;
+}   /* chorus_process() */
+
+static void
+delay_process (void * p_state, float * p_left, float * p_right,
+               uint32_t frames)
+{
+    fx_delay_t * p_delay = (fx_delay_t *) p_state;
+    float * p_line_l = p_delay->p_line[0];
+    float * p_line_r = p_delay->p_line[1];
+    uint32_t pos = p_delay->pos;
+    uint32_t read = (pos + p_delay->len - p_delay->time) % p_delay->len;
+    const float feedback = p_delay->feedback;
+    const float mix = p_delay->mix;
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        float in_l = p_left[idx];
+        float in_r = p_right[idx];
+        float wet_l = p_line_l[read];
+        float wet_r = p_line_r[read];
+
+        p_line_l[pos] = in_l + FX_UNDENORMAL(wet_l * feedback);
+        p_line_r[pos] = in_r + FX_UNDENORMAL(wet_r * feedback);
+        p_left[idx] = in_l + (wet_l - in_l) * mix;
+        p_right[idx] = in_r + (wet_r - in_r) * mix;
+
+        if (++pos >= p_delay->len)
+        {
+            pos = 0;
+        }
+
+        if (++read >= p_delay->len)
+        {
+            read = 0;
+        }
+    }
+
+    p_delay->pos = pos;
+}   /* delay_process() */
+
+static float
+comb_process (fx_comb_t * p_comb, float input, float feedback, float damp)
+{
+    float output = p_comb->p_buf[p_comb->pos];
+
+    p_comb->store = FX_UNDENORMAL(output + (p_comb->store - output) * damp);
+    p_comb->p_buf[p_comb->pos] = input + p_comb->store * feedback;
+
+    if (++p_comb->pos >= p_comb->len)
+    {
+        p_comb->pos = 0;
+    }
+
+    return (output);
+}   /* comb_process() */
+
+static float
+allpass_process (fx_allpass_t * p_allpass, float input)
+{
+    float buf_out = FX_UNDENORMAL(p_allpass->p_buf[p_allpass->pos]);
+
+    p_allpass->p_buf[p_allpass->pos] = input + buf_out * FX_ALLPASS_FEEDBACK;
+
+    if (++p_allpass->pos >= p_allpass->len)
+    {
+        p_allpass->pos = 0;
+    }
+
+    return (buf_out - input);
+}   /* allpass_process() */
+
+static void
+reverb_process (void * p_state, float * p_left, float * p_right,
+                uint32_t frames)
+{
+    fx_reverb_t * p_reverb = (fx_reverb_t *) p_state;
+    const float feedback = p_reverb->room * FX_REVERB_ROOM_SCALE
+                           + FX_REVERB_ROOM_OFFSET;
+    const float damp = p_reverb->damp * FX_REVERB_DAMP_SCALE;
+    const float wet = p_reverb->mix * 3.0f;
+    const float dry = 1.0f - p_reverb->mix;
+    float * p_chan[2] = {p_left, p_right};
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        float input = (p_left[idx] + p_right[idx]) * FX_REVERB_GAIN;
+
+        for (uint32_t ch = 0; ch < 2; ++ch)
+        {
+            float out = 0.0f;
+
+            for (uint32_t num = 0; num < FX_REVERB_NUM_COMB; ++num)
+            {
+                out += comb_process(&p_reverb->comb[ch][num], input, feedback,
+                                    damp);
+            }
+
+            for (uint32_t num = 0; num < FX_REVERB_NUM_ALLPASS; ++num)
+            {
+                out = allpass_process(&p_reverb->allpass[ch][num], out);
+            }
+
+            p_chan[ch][idx] = p_chan[ch][idx] * dry + out * wet;
+        }
+    }
+}   /* reverb_process() */
+
+static float *
+line_alloc (mem_arena_t * p_arena, uint32_t frames)
+{
+    return ((float *) mem_arena_alloc(p_arena, frames * sizeof(float)));
+}   /* line_alloc() */
+
+uint8_t
+fx_init (fx_rack_t * p_rack, mem_arena_t * p_arena, uint32_t sample_rate)
+{
+    uint32_t ch = 0;
+    uint32_t num = 0;
+
+    memset(p_rack, 0, sizeof(*p_rack));
+    p_rack->sample_rate = sample_rate;
+
+    p_rack->delay.len = FX_LINE_FRAMES(FX_DELAY_MAX_MS, sample_rate);
+    p_rack->chorus.len = FX_LINE_FRAMES(FX_CHORUS_MAX_MS, sample_rate);
+
+    for (ch = 0; ch < 2; ++ch)
+    {
+        p_rack->delay.p_line[ch] = line_alloc(p_arena, p_rack->delay.len);
+        p_rack->chorus.p_line[ch] = line_alloc(p_arena, p_rack->chorus.len);
+
+        if ((NULL == p_rack->delay.p_line[ch])
+            || (NULL == p_rack->chorus.p_line[ch]))
+        {
+            return (0);
+        }
+
+        for (num = 0; num < FX_REVERB_NUM_COMB; ++num)
+        {
+            fx_comb_t * p_comb = &p_rack->reverb.comb[ch][num];
+
+            p_comb->len = (g_comb_tuning[num] + ch * FX_REVERB_SPREAD)
+                          * sample_rate / FX_REVERB_RATE;
+            p_comb->p_buf = line_alloc(p_arena, p_comb->len);
+
+            if (NULL == p_comb->p_buf)
+            {
+                return (0);
+            }
+        }
+
+        for (num = 0; num < FX_REVERB_NUM_ALLPASS; ++num)
+        {
+            fx_allpass_t * p_allpass = &p_rack->reverb.allpass[ch][num];
+
+            p_allpass->len = (g_allpass_tuning[num] + ch * FX_REVERB_SPREAD)
+                             * sample_rate / FX_REVERB_RATE;
+            p_allpass->p_buf = line_alloc(p_arena, p_allpass->len);
+
+            if (NULL == p_allpass->p_buf)
+            {
+                return (0);
+            }
+        }
+    }
+
+    p_rack->stage[FX_FILTER].process = filter_process;
+    p_rack->stage[FX_FILTER].p_state = &p_rack->filter;
+    p_rack->stage[FX_CHORUS].process = chorus_process;
+    p_rack->stage[FX_CHORUS].p_state = &p_rack->chorus;
+    p_rack->stage[FX_DELAY].process = delay_process;
+    p_rack->stage[FX_DELAY].p_state = &p_rack->delay;
+    p_rack->stage[FX_REVERB].process = reverb_process;
+    p_rack->stage[FX_REVERB].p_state = &p_rack->reverb;
+
+    // Defaults: open filter, subtle chorus, short slap delay, medium room.
+    //
+    fx_set_param(p_rack, FX_FILTER, FX_PARAM_CUTOFF, 8000.0f);
+    fx_set_param(p_rack, FX_FILTER, FX_PARAM_RESONANCE, 0.2f);
+    fx_set_param(p_rack, FX_CHORUS, FX_PARAM_RATE, 0.8f);
+    fx_set_param(p_rack, FX_CHORUS, FX_PARAM_DEPTH, 3.0f);
+    fx_set_param(p_rack, FX_CHORUS, FX_PARAM_MIX, 0.5f);
+    fx_set_param(p_rack, FX_DELAY, FX_PARAM_TIME, 250.0f);
+    fx_set_param(p_rack, FX_DELAY, FX_PARAM_FEEDBACK, 0.35f);
+    fx_set_param(p_rack, FX_DELAY, FX_PARAM_MIX, 0.3f);
+    fx_set_param(p_rack, FX_REVERB, FX_PARAM_ROOM, 0.5f);
+    fx_set_param(p_rack, FX_REVERB, FX_PARAM_DAMP, 0.5f);
+    fx_set_param(p_rack, FX_REVERB, FX_PARAM_MIX, 0.25f);
+
+    return (1);
+}   /* fx_init() */
+
+void
+fx_enable (fx_rack_t * p_rack, fx_id_t id, uint8_t enable)
+{
+    uint8_t num = 0;
+
+    p_rack->stage[id].enabled = enable;
+
+    // Rebuild the list of active stages, keeping the rack order.
+    //
+    for (uint8_t idx = 0; idx < FX_NUM; ++idx)
+    {
+        if (p_rack->stage[idx].enabled)
+        {
+            p_rack->active[num++] = idx;
+        }
+    }
+
+    p_rack->num_active = num;
+}   /* fx_enable() */
+
+void
+fx_set_param (fx_rack_t * p_rack, fx_id_t id, fx_param_t param, float value)
+{
+    const float rate = (float) p_rack->sample_rate;
+
+    switch (id)
+    {
+        case FX_FILTER:
+        {
+            if (FX_PARAM_CUTOFF == param)
+            {
+                p_rack->filter.cutoff = clampf(value, 20.0f, rate * 0.45f);
+            }
+            else if (FX_PARAM_RESONANCE == param)
+            {
+                p_rack->filter.resonance = clampf(value, 0.0f, 1.0f);
+            }
+
+            filter_update(&p_rack->filter, p_rack->sample_rate);
+        }
+        break;
+
+        case FX_CHORUS:
+        {
+            fx_chorus_t * p_chorus = &p_rack->chorus;
+
+            if (FX_PARAM_RATE == param)
+            {
+                p_chorus->lfo_inc = clampf(value, 0.01f, 10.0f) / rate;
+            }
+            else if (FX_PARAM_DEPTH == param)
+            {
+                // Keep base + depth inside the line.
+                //
+                value = clampf(value, 0.0f, FX_CHORUS_MAX_MS / 2.0f);
+                p_chorus->depth = value * rate / 1000.0f;
+                p_chorus->base = FX_CHORUS_MAX_MS / 2.0f * rate / 1000.0f;
+            }
+            else if (FX_PARAM_MIX == param)
+            {
+                p_chorus->mix = clampf(value, 0.0f, 1.0f);
+            }
+        }
+        break;
+
+        case FX_DELAY:
+        {
+            fx_delay_t * p_delay = &p_rack->delay;
+
+            if (FX_PARAM_TIME == param)
+            {
+                value = clampf(value, 1.0f, (float) FX_DELAY_MAX_MS);
+                p_delay->time = (uint32_t) (value * rate / 1000.0f);
+            }
+            else if (FX_PARAM_FEEDBACK == param)
+            {
+                p_delay->feedback = clampf(value, 0.0f, 0.95f);
+            }
+            else if (FX_PARAM_MIX == param)
+            {
+                p_delay->mix = clampf(value, 0.0f, 1.0f);
+            }
+        }
+        break;
+
+        case FX_REVERB:
+        {
+            if (FX_PARAM_ROOM == param)
+            {
+                p_rack->reverb.room = clampf(value, 0.0f, 1.0f);
+            }
+            else if (FX_PARAM_DAMP == param)
+            {
+                p_rack->reverb.damp = clampf(value, 0.0f, 1.0f);
+            }
+            else if (FX_PARAM_MIX == param)
+            {
+                p_rack->reverb.mix = clampf(value, 0.0f, 1.0f);
+            }
+        }
+        break;
+
+        default:
+        break;
+    }
+}   /* fx_set_param() */
+
+void
+fx_set_cutoff_mod (fx_rack_t * p_rack, float octaves)
+{
+    if (octaves != p_rack->filter.cutoff_mod)
+    {
+        p_rack->filter.cutoff_mod = octaves;
+        filter_update(&p_rack->filter, p_rack->sample_rate);
+    }
+}   /* fx_set_cutoff_mod() */
+
+void
+fx_process (fx_rack_t * p_rack, float * p_left, float * p_right,
+            uint32_t frames)
+{
+    for (uint8_t idx = 0; idx < p_rack->num_active; ++idx)
+    {
+        fx_stage_t * p_stage = &p_rack->stage[p_rack->active[idx]];
+        uint32_t start = perf_ticks();
+
+        p_stage->process(p_stage->p_state, p_left, p_right, frames);
+        perf_counter_add(&p_stage->cost, perf_ticks() - start);
+    }
+}   /* fx_process() */
+
+const perf_counter_t *
+fx_get_cost (const fx_rack_t * p_rack, fx_id_t id)
+{
+    return (&p_rack->stage[id].cost);
+}   /* fx_get_cost() */
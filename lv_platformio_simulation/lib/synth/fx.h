@@ -0,0 +1,150 @@
+#ifndef FX_H
+
+#   define FX_H
+#   include <stdint.h>
+#   include "perf.h"
+#   include "mem.h"
+
+#   ifndef FX_DELAY_MAX_MS
+#       define FX_DELAY_MAX_MS     (500)
+#   endif
+#   ifndef FX_CHORUS_MAX_MS
+#       define FX_CHORUS_MAX_MS    (30)
+#   endif
+#   define FX_REVERB_NUM_COMB      (8)
+#   define FX_REVERB_NUM_ALLPASS   (4)
+
+// Worst-case arena footprint of one rack: both delay lines, both chorus
+// lines and the Freeverb tunings (given at 44.1 kHz, plus the right channel
+// stereo spread), with room for the 8-byte alignment of every allocation.
+//
+#   define FX_LINE_FRAMES(ms, rate)  ((ms) * (rate) / 1000 + 2)
+#   define FX_REVERB_FRAMES(rate)    ((((11024 + 1563) * 2) + (23 * 12))   \
+                                      * (rate) / 44100 + 1)
+#   define FX_ARENA_SIZE(rate)                                           \
+        (sizeof(float) * (2 * FX_LINE_FRAMES(FX_DELAY_MAX_MS, rate)       \
+                          + 2 * FX_LINE_FRAMES(FX_CHORUS_MAX_MS, rate)    \
+                          + FX_REVERB_FRAMES(rate))                       \
+         + 8 * 32)
+
+typedef enum fx_id_t
+{
+    FX_FILTER = 0,
+    FX_CHORUS,
+    FX_DELAY,
+    FX_REVERB,
+    FX_NUM
+} fx_id_t;
+
+typedef enum fx_param_t
+{
+    FX_PARAM_CUTOFF = 0,    /* Hz */
+    FX_PARAM_RESONANCE,     /* 0.0 .. 1.0 */
+    FX_PARAM_TIME,          /* ms */
+    FX_PARAM_FEEDBACK,      /* 0.0 .. 1.0 */
+    FX_PARAM_RATE,          /* Hz */
+    FX_PARAM_DEPTH,         /* ms */
+    FX_PARAM_ROOM,          /* 0.0 .. 1.0 */
+    FX_PARAM_DAMP,          /* 0.0 .. 1.0 */
+    FX_PARAM_MIX            /* 0.0 .. 1.0 */
+} fx_param_t;
+
+typedef struct fx_filter_t
+{
+    float cutoff;
+    float cutoff_mod;       /* Octaves on top, from the mod matrix */
+    float resonance;
+    float a1;
+    float a2;
+    float a3;
+    float k;
+    float ic1eq[2];
+    float ic2eq[2];
+} fx_filter_t;
+
+typedef struct fx_delay_t
+{
+    float * p_line[2];
+    uint32_t len;
+    uint32_t pos;
+    uint32_t time;
+    float feedback;
+    float mix;
+} fx_delay_t;
+
+typedef struct fx_chorus_t
+{
+    float * p_line[2];
+    uint32_t len;
+    uint32_t pos;
+    float lfo;
+    float lfo_inc;
+    float base;
+    float depth;
+    float mix;
+} fx_chorus_t;
+
+typedef struct fx_comb_t
+{
+    float * p_buf;
+    uint32_t len;
+    uint32_t pos;
+    float store;
+} fx_comb_t;
+
+typedef struct fx_allpass_t
+{
+    float * p_buf;
+    uint32_t len;
+    uint32_t pos;
+} fx_allpass_t;
+
+typedef struct fx_reverb_t
+{
+    fx_comb_t comb[2][FX_REVERB_NUM_COMB];
+    fx_allpass_t allpass[2][FX_REVERB_NUM_ALLPASS];
+    float room;
+    float damp;
+    float mix;
+} fx_reverb_t;
+
+typedef void (* fx_process_t)(void * p_state, float * p_left, float * p_right,
+                              uint32_t frames);
+
+typedef struct fx_stage_t
+{
+    fx_process_t process;
+    void * p_state;
+    perf_counter_t cost;
+    uint8_t enabled;
+} fx_stage_t;
+
+// Only the enabled stages are listed in active[], so a bypassed effect is
+// never visited by fx_process().
+//
+typedef struct fx_rack_t
+{
+    uint32_t sample_rate;
+    fx_filter_t filter;
+    fx_chorus_t chorus;
+    fx_delay_t delay;
+    fx_reverb_t reverb;
+    fx_stage_t stage[FX_NUM];
+    uint8_t active[FX_NUM];
+    uint8_t num_active;
+} fx_rack_t;
+
+uint8_t fx_init(fx_rack_t * p_rack, mem_arena_t * p_arena,
+                uint32_t sample_rate);
+void fx_enable(fx_rack_t * p_rack, fx_id_t id, uint8_t enable);
+void fx_set_param(fx_rack_t * p_rack, fx_id_t id, fx_param_t param,
+                  float value);
+// Audio side, per block: move the filter `octaves` away from the cutoff
+// set, without changing it. Nothing to do when it has not moved.
+//
+void fx_set_cutoff_mod(fx_rack_t * p_rack, float octaves);
+void fx_process(fx_rack_t * p_rack, float * p_left, float * p_right,
+                uint32_t frames);
+const perf_counter_t * fx_get_cost(const fx_rack_t * p_rack, fx_id_t id);
+
+#endif /* FX_H */
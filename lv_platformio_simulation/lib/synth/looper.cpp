@@ -0,0 +1,137 @@
+#include "looper.h"
+#include <stddef.h>
+
+static inline int16_t
+sat_add (int16_t a, int16_t b)
+{
+    int32_t sum = (int32_t) a + b;
+
+    return ((int16_t) ((sum > 32767) ? 32767
+                                     : ((sum < -32768) ? -32768 : sum)));
+}   /* sat_add() */
+
+static void
+looper_apply (looper_t * p_looper, uint8_t cmd)
+{
+    uint8_t state = p_looper->state.load(std::memory_order_relaxed);
+
+    if (LOOPER_CMD_CLEAR == cmd)
+    {
+        state = LOOPER_IDLE;
+        p_looper->length = 0;
+    }
+    else if (LOOPER_CMD_NEXT == cmd)
+    {
+        switch (state)
+        {
+            case LOOPER_IDLE:
+                state = LOOPER_RECORD;
+                p_looper->length = 0;
+            break;
+
+            case LOOPER_RECORD:
+                state = (0 == p_looper->pos) ? LOOPER_IDLE : LOOPER_PLAY;
+                p_looper->length = p_looper->pos;
+            break;
+
+            case LOOPER_PLAY:
+                state = LOOPER_OVERDUB;
+            break;
+
+            default:
+                state = LOOPER_PLAY;
+            break;
+        }
+    }
+
+    // A new take and the playback of a finished one both start at the
+    // top of the loop; overdub keeps its place.
+    //
+    if ((LOOPER_RECORD == state)
+        || (LOOPER_RECORD == p_looper->state.load(std::memory_order_relaxed))
+        || (LOOPER_IDLE == state))
+    {
+        p_looper->pos = 0;
+    }
+
+    p_looper->state.store(state, std::memory_order_release);
+}   /* looper_apply() */
+
+void
+looper_init (looper_t * p_looper, int16_t * p_buf, uint32_t max_frames)
+{
+    p_looper->p_buf = p_buf;
+    p_looper->max_frames = (NULL == p_buf) ? 0 : max_frames;
+    p_looper->length = 0;
+    p_looper->pos = 0;
+    p_looper->cmd.store(LOOPER_CMD_NONE);
+    p_looper->state.store(LOOPER_IDLE);
+}   /* looper_init() */
+
+void
+looper_command (looper_t * p_looper, looper_cmd_t cmd)
+{
+    // One pending command: a second press before the next block replaces
+    // the first, as the audio side would only see the latest anyway.
+    //
+    p_looper->cmd.store((uint8_t) cmd, std::memory_order_release);
+}   /* looper_command() */
+
+looper_state_t
+looper_get_state (const looper_t * p_looper)
+{
+    return ((looper_state_t) p_looper->state.load(std::memory_order_acquire));
+}   /* looper_get_state() */
+
+void
+looper_process (looper_t * p_looper, int16_t * p_io, uint32_t frames)
+{
+    uint8_t cmd = p_looper->cmd.exchange(LOOPER_CMD_NONE,
+                                         std::memory_order_acq_rel);
+    uint8_t state = 0;
+
+    if ((LOOPER_CMD_NONE != cmd) && (0 != p_looper->max_frames))
+    {
+        looper_apply(p_looper, cmd);
+    }
+
+    state = p_looper->state.load(std::memory_order_relaxed);
+
+    for (uint32_t idx = 0; (idx < frames) && (LOOPER_IDLE != state); ++idx)
+    {
+        int16_t * p_loop = &p_looper->p_buf[2 * p_looper->pos];
+        int16_t left = p_io[2 * idx];
+        int16_t right = p_io[2 * idx + 1];
+
+        switch (state)
+        {
+            case LOOPER_RECORD:
+                p_loop[0] = left;
+                p_loop[1] = right;
+
+                // A full buffer closes the take by itself.
+                //
+                if (++p_looper->pos == p_looper->max_frames)
+                {
+                    looper_apply(p_looper, LOOPER_CMD_NEXT);
+                    state = LOOPER_PLAY;
+                }
+            continue;
+
+            case LOOPER_OVERDUB:
+                p_io[2 * idx] = sat_add(left, p_loop[0]);
+                p_io[2 * idx + 1] = sat_add(right, p_loop[1]);
+                p_loop[0] = p_io[2 * idx];
+                p_loop[1] = p_io[2 * idx + 1];
+            break;
+
+            default:
+                p_io[2 * idx] = sat_add(left, p_loop[0]);
+                p_io[2 * idx + 1] = sat_add(right, p_loop[1]);
+            break;
+        }
+
+        p_looper->pos = (p_looper->pos + 1 == p_looper->length)
+                        ? 0 : p_looper->pos + 1;
+    }
+}   /* looper_process() */
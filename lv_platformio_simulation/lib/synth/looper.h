@@ -0,0 +1,50 @@
+#ifndef LOOPER_H
+
+#   define LOOPER_H
+#   include <stdint.h>
+#   include <atomic>
+
+// Loop recorder on a preallocated buffer, run on the audio thread after
+// the engine output. The first take sets the loop length; later passes
+// play it back under the live output, or overdub the live output onto it.
+//
+// The UI only posts commands, applied at the start of the next block.
+//
+typedef enum looper_state_t
+{
+    LOOPER_IDLE = 0,
+    LOOPER_RECORD,          /* First take, sets the length */
+    LOOPER_PLAY,
+    LOOPER_OVERDUB,
+    LOOPER_NUM_STATE
+} looper_state_t;
+
+typedef enum looper_cmd_t
+{
+    LOOPER_CMD_NONE = 0,
+    LOOPER_CMD_NEXT,        /* Idle > record > play <> overdub */
+    LOOPER_CMD_CLEAR
+} looper_cmd_t;
+
+typedef struct looper_t
+{
+    int16_t * p_buf;        /* Interleaved stereo */
+    uint32_t max_frames;
+    uint32_t length;
+    uint32_t pos;
+    std::atomic<uint8_t> cmd;       /* UI to audio */
+    std::atomic<uint8_t> state;     /* Audio to UI */
+} looper_t;
+
+void looper_init(looper_t * p_looper, int16_t * p_buf, uint32_t max_frames);
+
+// UI side.
+//
+void looper_command(looper_t * p_looper, looper_cmd_t cmd);
+looper_state_t looper_get_state(const looper_t * p_looper);
+
+// Audio side: mixes the loop into `p_io` (interleaved stereo) in place.
+//
+void looper_process(looper_t * p_looper, int16_t * p_io, uint32_t frames);
+
+#endif /* LOOPER_H */
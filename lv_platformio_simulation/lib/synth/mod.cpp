@@ -0,0 +1,512 @@
+#include "mod.h"
+#include "osc.h"
+#include <string.h>
+#include <math.h>
+
+#define MOD_FRESH           (0x80U)
+#define MOD_INDEX_MASK      (0x03U)
+#define MOD_ACC_CUTOFF      (MOD_NUM_PART * MOD_NUM_VOICE_DST)
+#define MOD_PHASE_SCALE     (1.0f / 4294967296.0f)
+
+// Block values: the LFOs, then the controllers the program reads. Voice
+// values: the envelope, then the velocity.
+//
+#define MOD_VAL_CC          (MOD_NUM_LFO)
+#define MOD_NUM_VAL         (MOD_NUM_LFO + MOD_NUM_ROUTE)
+
+typedef enum mod_stage_t
+{
+    MOD_STAGE_ATTACK = 0,
+    MOD_STAGE_DECAY,
+    MOD_STAGE_SUSTAIN,
+    MOD_STAGE_RELEASE,
+    MOD_STAGE_IDLE
+} mod_stage_t;
+
+static_assert(MOD_NUM_ROUTE * MOD_NUM_PART <= 255, "op index is a byte");
+static_assert(MOD_NUM_ROUTE == 16, "MOD_PATCH_DEFAULT lists 16 routes");
+
+static float
+clampf (float value, float min, float max)
+{
+    return ((value < min) ? min : ((value > max) ? max : value));
+}   /* clampf() */
+
+static uint8_t
+is_voice_src (uint8_t src)
+{
+    return ((MOD_SRC_ENV == src) || (MOD_SRC_VELOCITY == src));
+}   /* is_voice_src() */
+
+// Largest power of two, up to `max_step`, giving MOD_STEPS_PER_CYCLE
+// updates over `frames`.
+//
+static uint32_t
+step_over (float frames, uint32_t max_step)
+{
+    uint32_t step = 1;
+
+    while (((float) (2 * step * MOD_STEPS_PER_CYCLE) <= frames)
+           && (2 * step <= max_step))
+    {
+        step *= 2;
+    }
+
+    return (step);
+}   /* step_over() */
+
+// Per frame rise or fall of `span` over `ms`; all at once for 0 ms.
+//
+static float
+env_rate (float span, float ms, uint32_t sample_rate)
+{
+    float frames = ms * (float) sample_rate / 1000.0f;
+
+    return ((frames < 1.0f) ? 1.0f : span / frames);
+}   /* env_rate() */
+
+static void
+add_op (mod_prog_t * p_prog, uint32_t * p_num, uint8_t src, uint32_t dst,
+        float depth)
+{
+    mod_op_t * p_op = &p_prog->op[(*p_num)++];
+
+    p_op->src = src;
+    p_op->dst = (uint8_t) dst;
+    p_op->depth = depth;
+}   /* add_op() */
+
+static uint8_t
+cc_slot (mod_prog_t * p_prog, uint8_t cc)
+{
+    uint8_t slot = 0;
+
+    while ((slot < p_prog->num_cc) && (p_prog->cc[slot] != cc))
+    {
+        ++slot;
+    }
+
+    if (slot == p_prog->num_cc)
+    {
+        p_prog->cc[p_prog->num_cc++] = cc;
+    }
+
+    return ((uint8_t) (MOD_VAL_CC + slot));
+}   /* cc_slot() */
+
+// The patch (already checked) as a program: block ops first, then each
+// part's voice ops, so the audio side walks two plain ranges.
+//
+static void
+compile (const mod_t * p_mod, mod_prog_t * p_prog)
+{
+    const mod_patch_t * p_patch = &p_mod->edit;
+    const mod_env_t * p_env = &p_patch->env;
+    const float rate = (float) p_mod->sample_rate;
+    uint32_t num = 0;
+
+    memset(p_prog, 0, sizeof(*p_prog));
+    p_prog->step = p_mod->block_size;
+
+    for (uint32_t lfo = 0; lfo < MOD_NUM_LFO; ++lfo)
+    {
+        p_prog->lfo_inc[lfo] = (uint32_t) ((double) p_patch->lfo[lfo].hz
+                                           / rate * 4294967296.0);
+        p_prog->lfo_wave[lfo] = p_patch->lfo[lfo].wave;
+    }
+
+    p_prog->env_up = env_rate(1.0f, p_env->attack_ms, p_mod->sample_rate);
+    p_prog->env_down = env_rate(1.0f - p_env->sustain, p_env->decay_ms,
+                                p_mod->sample_rate);
+    p_prog->env_sustain = p_env->sustain;
+    p_prog->env_release = env_rate(1.0f, p_env->release_ms,
+                                   p_mod->sample_rate);
+
+    for (uint32_t idx = 0; idx < MOD_NUM_ROUTE; ++idx)
+    {
+        const mod_route_t * p_route = &p_patch->route[idx];
+        uint32_t first = (MOD_ALL_PARTS == p_route->part) ? 0 : p_route->part;
+        uint32_t last = (MOD_ALL_PARTS == p_route->part) ? p_mod->num_part
+                                                         : first + 1;
+        uint8_t val = 0;
+
+        if ((MOD_SRC_OFF == p_route->src) || is_voice_src(p_route->src))
+        {
+            continue;
+        }
+
+        if (MOD_SRC_CC == p_route->src)
+        {
+            val = cc_slot(p_prog, p_route->cc);
+        }
+        else
+        {
+            val = (uint8_t) (p_route->src - MOD_SRC_LFO1);
+            p_prog->step = step_over(rate / p_patch->lfo[val].hz,
+                                     p_prog->step);
+        }
+
+        if (MOD_DST_CUTOFF == p_route->dst)
+        {
+            add_op(p_prog, &num, val, MOD_ACC_CUTOFF, p_route->depth);
+            continue;
+        }
+
+        for (uint32_t part = first; part < last; ++part)
+        {
+            add_op(p_prog, &num, val, part * MOD_NUM_VOICE_DST + p_route->dst,
+                   p_route->depth);
+            p_prog->part_mask |= (uint8_t) (1U << part);
+        }
+    }
+
+    p_prog->num_block = (uint8_t) num;
+
+    for (uint32_t part = 0; part < MOD_NUM_PART; ++part)
+    {
+        p_prog->part_op[part] = (uint8_t) num;
+
+        for (uint32_t idx = 0; idx < MOD_NUM_ROUTE; ++idx)
+        {
+            const mod_route_t * p_route = &p_patch->route[idx];
+
+            if (!is_voice_src(p_route->src) || (part >= p_mod->num_part)
+                || ((MOD_ALL_PARTS != p_route->part)
+                    && (part != p_route->part)))
+            {
+                continue;
+            }
+
+            add_op(p_prog, &num, (uint8_t) (p_route->src - MOD_SRC_ENV),
+                   p_route->dst, p_route->depth);
+            p_prog->part_mask |= (uint8_t) (1U << part);
+
+            // Volume follows a linear envelope exactly at any step; pitch
+            // holds each step, so a fast segment needs short ones.
+            //
+            if ((MOD_SRC_ENV == p_route->src)
+                && (MOD_DST_PITCH == p_route->dst))
+            {
+                const float seg_ms[3] = {p_env->attack_ms,
+                                         (p_env->sustain < 1.0f)
+                                         ? p_env->decay_ms : 0.0f,
+                                         p_env->release_ms};
+
+                for (uint32_t seg = 0; seg < 3; ++seg)
+                {
+                    if (seg_ms[seg] > 0.0f)
+                    {
+                        p_prog->step = step_over(seg_ms[seg] * rate / 1000.0f,
+                                                 p_prog->step);
+                    }
+                }
+            }
+        }
+    }
+
+    p_prog->part_op[MOD_NUM_PART] = (uint8_t) num;
+}   /* compile() */
+
+static float
+lfo_value (uint8_t wave, uint32_t phase)
+{
+    // All of them start at zero rising (square: at the top), as the sine.
+    //
+    float t = (float) phase * MOD_PHASE_SCALE;
+
+    switch (wave)
+    {
+        case MOD_LFO_TRIANGLE:
+            t = (float) (phase + 0x40000000U) * MOD_PHASE_SCALE;
+            return (1.0f - 4.0f * fabsf(t - 0.5f));
+
+        case MOD_LFO_SAW:
+            t = (float) (phase + 0x80000000U) * MOD_PHASE_SCALE;
+            return (2.0f * t - 1.0f);
+
+        case MOD_LFO_SQUARE:
+            return ((t < 0.5f) ? 1.0f : -1.0f);
+
+        default:
+            return (osc_sine(phase));
+    }
+}   /* lfo_value() */
+
+static void
+env_run (const mod_prog_t * p_prog, mod_voice_t * p_voice, uint32_t frames)
+{
+    float env = p_voice->env;
+
+    switch (p_voice->stage)
+    {
+        case MOD_STAGE_ATTACK:
+            env += p_prog->env_up * (float) frames;
+
+            if (env >= 1.0f)
+            {
+                env = 1.0f;
+                p_voice->stage = MOD_STAGE_DECAY;
+            }
+        break;
+
+        case MOD_STAGE_DECAY:
+            env -= p_prog->env_down * (float) frames;
+
+            if (env <= p_prog->env_sustain)
+            {
+                env = p_prog->env_sustain;
+                p_voice->stage = MOD_STAGE_SUSTAIN;
+            }
+        break;
+
+        case MOD_STAGE_SUSTAIN:
+            env = p_prog->env_sustain;
+        break;
+
+        case MOD_STAGE_RELEASE:
+            env -= p_prog->env_release * (float) frames;
+
+            if (env <= 0.0f)
+            {
+                env = 0.0f;
+                p_voice->stage = MOD_STAGE_IDLE;
+            }
+        break;
+
+        default:
+        break;
+    }
+
+    p_voice->env = env;
+}   /* env_run() */
+
+void
+mod_init (mod_t * p_mod, uint32_t sample_rate, uint32_t block_size,
+          uint8_t num_part)
+{
+    static const mod_patch_t patch = MOD_PATCH_DEFAULT;
+
+    p_mod->edit = patch;
+    p_mod->num_part = (num_part > MOD_NUM_PART) ? MOD_NUM_PART : num_part;
+    p_mod->sample_rate = sample_rate;
+    p_mod->block_size = block_size;
+
+    for (uint32_t idx = 0; idx < 3; ++idx)
+    {
+        compile(p_mod, &p_mod->prog[idx]);
+    }
+
+    p_mod->back = 0;
+    p_mod->middle.store(1);
+    p_mod->front = 2;
+    p_mod->b_fresh = 0;
+    memset(p_mod->lfo_phase, 0, sizeof(p_mod->lfo_phase));
+    memset(p_mod->cc, 0, sizeof(p_mod->cc));
+    memset(p_mod->acc, 0, sizeof(p_mod->acc));
+}   /* mod_init() */
+
+mod_patch_t *
+mod_edit (mod_t * p_mod)
+{
+    return (&p_mod->edit);
+}   /* mod_edit() */
+
+uint8_t
+mod_commit (mod_t * p_mod)
+{
+    mod_patch_t * p_patch = &p_mod->edit;
+
+    for (uint32_t idx = 0; idx < MOD_NUM_ROUTE; ++idx)
+    {
+        const mod_route_t * p_route = &p_patch->route[idx];
+
+        if (MOD_SRC_OFF == p_route->src)
+        {
+            continue;
+        }
+
+        if ((p_route->src >= MOD_NUM_SRC) || (p_route->dst >= MOD_NUM_DST)
+            || (p_route->cc >= MOD_NUM_CC)
+            || ((MOD_ALL_PARTS != p_route->part)
+                && (p_route->part >= p_mod->num_part))
+            || ((MOD_DST_CUTOFF == p_route->dst)
+                && is_voice_src(p_route->src)))
+        {
+            return (0);
+        }
+    }
+
+    // Clamp here, so the audio side can trust every field.
+    //
+    for (uint32_t lfo = 0; lfo < MOD_NUM_LFO; ++lfo)
+    {
+        p_patch->lfo[lfo].wave = (p_patch->lfo[lfo].wave < MOD_NUM_LFO_WAVE)
+                                 ? p_patch->lfo[lfo].wave
+                                 : (uint8_t) MOD_LFO_SINE;
+        p_patch->lfo[lfo].hz = clampf(p_patch->lfo[lfo].hz, MOD_LFO_MIN_HZ,
+                                      MOD_LFO_MAX_HZ);
+    }
+
+    p_patch->env.attack_ms = clampf(p_patch->env.attack_ms, 0.0f, 10000.0f);
+    p_patch->env.decay_ms = clampf(p_patch->env.decay_ms, 0.0f, 10000.0f);
+    p_patch->env.sustain = clampf(p_patch->env.sustain, 0.0f, 1.0f);
+    p_patch->env.release_ms = clampf(p_patch->env.release_ms, 0.0f, 10000.0f);
+
+    compile(p_mod, &p_mod->prog[p_mod->back]);
+    p_mod->back = p_mod->middle.exchange(p_mod->back | MOD_FRESH,
+                                         std::memory_order_acq_rel)
+                  & MOD_INDEX_MASK;
+
+    return (1);
+}   /* mod_commit() */
+
+uint32_t
+mod_begin (mod_t * p_mod, uint32_t max_frames)
+{
+    if (p_mod->middle.load(std::memory_order_relaxed) & MOD_FRESH)
+    {
+        p_mod->front = p_mod->middle.exchange(p_mod->front,
+                                              std::memory_order_acq_rel)
+                       & MOD_INDEX_MASK;
+        p_mod->b_fresh = 1;
+    }
+
+    return ((max_frames > p_mod->prog[p_mod->front].step)
+            ? p_mod->prog[p_mod->front].step : max_frames);
+}   /* mod_begin() */
+
+void
+mod_set_cc (mod_t * p_mod, uint8_t cc, uint8_t value)
+{
+    p_mod->cc[cc % MOD_NUM_CC] = (uint8_t) (value & 0x7FU);
+}   /* mod_set_cc() */
+
+uint32_t
+mod_run (mod_t * p_mod, uint32_t frames, float * p_cutoff)
+{
+    const mod_prog_t * p_prog = &p_mod->prog[p_mod->front];
+    float val[MOD_NUM_VAL];
+
+    // A new program visits every voice once, so the ones it no longer
+    // routes go back to where they were.
+    //
+    uint32_t mask = p_mod->b_fresh ? (1U << p_mod->num_part) - 1U
+                                   : p_prog->part_mask;
+
+    p_mod->b_fresh = 0;
+    *p_cutoff = 0.0f;
+
+    if ((0 == p_prog->num_block) && (0 == mask))
+    {
+        return (0);
+    }
+
+    // Sources at the end of the block: a ramp ends on them.
+    //
+    for (uint32_t lfo = 0; lfo < MOD_NUM_LFO; ++lfo)
+    {
+        p_mod->lfo_phase[lfo] += p_prog->lfo_inc[lfo] * frames;
+        val[lfo] = lfo_value(p_prog->lfo_wave[lfo], p_mod->lfo_phase[lfo]);
+    }
+
+    for (uint32_t slot = 0; slot < p_prog->num_cc; ++slot)
+    {
+        val[MOD_VAL_CC + slot] = (float) p_mod->cc[p_prog->cc[slot]]
+                                 / 127.0f;
+    }
+
+    memset(p_mod->acc, 0, sizeof(p_mod->acc));
+
+    for (uint32_t idx = 0; idx < p_prog->num_block; ++idx)
+    {
+        const mod_op_t * p_op = &p_prog->op[idx];
+
+        p_mod->acc[p_op->dst] += val[p_op->src] * p_op->depth;
+    }
+
+    *p_cutoff = p_mod->acc[MOD_ACC_CUTOFF];
+
+    return (mask);
+}   /* mod_run() */
+
+void
+mod_voice_start (mod_voice_t * p_voice, uint8_t b_restart)
+{
+    // The synth has just tuned the voice to its note.
+    //
+    p_voice->stage = MOD_STAGE_ATTACK;
+    p_voice->pitch = 0.0f;
+    p_voice->gain_step = 0.0f;
+    p_voice->pan_step = 0.0f;
+
+    if (b_restart)
+    {
+        p_voice->env = 0.0f;
+        p_voice->gain = 1.0f;
+        p_voice->pan = 0.0f;
+        p_voice->b_new = 1;
+    }
+}   /* mod_voice_start() */
+
+void
+mod_voice_release (mod_voice_t * p_voice)
+{
+    p_voice->stage = MOD_STAGE_RELEASE;
+}   /* mod_voice_release() */
+
+uint8_t
+mod_voice_run (const mod_t * p_mod, mod_voice_t * p_voice, uint8_t part,
+               float velocity, uint32_t frames)
+{
+    const mod_prog_t * p_prog = &p_mod->prog[p_mod->front];
+    const float * p_block = &p_mod->acc[part * MOD_NUM_VOICE_DST];
+    const uint32_t last = p_prog->part_op[part + 1];
+    float acc[MOD_NUM_VOICE_DST];
+    float val[2];
+    float gain = 0.0f;
+    float pan = 0.0f;
+    float pitch = 0.0f;
+
+    env_run(p_prog, p_voice, frames);
+    val[0] = p_voice->env;
+    val[1] = velocity;
+
+    for (uint32_t dst = 0; dst < MOD_NUM_VOICE_DST; ++dst)
+    {
+        acc[dst] = p_block[dst];
+    }
+
+    for (uint32_t idx = p_prog->part_op[part]; idx < last; ++idx)
+    {
+        const mod_op_t * p_op = &p_prog->op[idx];
+
+        acc[p_op->dst] += val[p_op->src] * p_op->depth;
+    }
+
+    gain = 1.0f + acc[MOD_DST_VOLUME];
+    gain = (gain < 0.0f) ? 0.0f : gain;
+    pan = clampf(acc[MOD_DST_PAN], -1.0f, 1.0f);
+    pitch = clampf(acc[MOD_DST_PITCH], -MOD_MAX_SEMITONES, MOD_MAX_SEMITONES);
+
+    // A new note starts where its routings put it rather than sliding
+    // there from the neutral values.
+    //
+    if (p_voice->b_new)
+    {
+        p_voice->gain = gain;
+        p_voice->pan = pan;
+        p_voice->b_new = 0;
+    }
+
+    p_voice->gain_step = (gain - p_voice->gain) / (float) frames;
+    p_voice->pan_step = (pan - p_voice->pan) / (float) frames;
+
+    if (pitch == p_voice->pitch)
+    {
+        return (0);
+    }
+
+    p_voice->pitch = pitch;
+
+    return (1);
+}   /* mod_voice_run() */
@@ -0,0 +1,220 @@
+#ifndef MOD_H
+
+#   define MOD_H
+#   include <stdint.h>
+#   include <atomic>
+
+// Modulation matrix: LFOs, a per-voice envelope, velocity and MIDI CCs
+// routed to pitch, volume, pan (per voice) and the filter cutoff (the
+// engine's, so only LFOs and CCs reach it).
+//
+// The UI edits the routings in a mod_patch_t and mod_commit() compiles
+// them into a flat list of (source, destination, depth) multiply-adds,
+// published to the audio side through the same triple buffer as the
+// sequencer. The audio side runs the list without a branch per routing:
+// an empty matrix costs a load and a compare per block, a full one the
+// same work every block.
+//
+// Sources move at block rate. Volume and pan slide to their new value
+// across the block; pitch and cutoff take it for the whole block. The
+// block is shortened to the step the fastest routing needs (an LFO gets
+// MOD_STEPS_PER_CYCLE updates per cycle, an envelope into pitch as many
+// per segment), down to one sample.
+//
+#   define MOD_NUM_ROUTE        (16)
+#   define MOD_NUM_LFO          (2)
+#   define MOD_NUM_PART         (4)     /* SYNTH_NUM_PART: the op list and
+                                           accumulators scale with it */
+#   define MOD_ALL_PARTS        (0xFF)
+#   define MOD_NUM_CC           (128)
+#   define MOD_STEPS_PER_CYCLE  (16)
+#   define MOD_LFO_MIN_HZ       (0.01f)
+#   define MOD_LFO_MAX_HZ       (1000.0f)
+#   define MOD_MAX_SEMITONES    (48.0f) /* Pitch, either way */
+
+typedef enum mod_src_t
+{
+    MOD_SRC_OFF = 0,        /* Slot unused */
+    MOD_SRC_LFO1,           /* -1 .. 1 */
+    MOD_SRC_LFO2,
+    MOD_SRC_ENV,            /* 0 .. 1, per voice */
+    MOD_SRC_VELOCITY,       /* 0 .. 1, per voice */
+    MOD_SRC_CC,             /* 0 .. 1, controller `cc` of the routing */
+    MOD_NUM_SRC
+} mod_src_t;
+
+typedef enum mod_dst_t
+{
+    MOD_DST_PITCH = 0,      /* Semitones */
+    MOD_DST_VOLUME,         /* Added to a gain of 1, floored at 0 */
+    MOD_DST_PAN,            /* -1 left .. 1 right */
+    MOD_DST_CUTOFF,         /* Octaves, engine filter */
+    MOD_NUM_DST
+} mod_dst_t;
+
+#   define MOD_NUM_VOICE_DST    (MOD_DST_CUTOFF)    /* Pitch, volume, pan */
+
+typedef enum mod_lfo_wave_t
+{
+    MOD_LFO_SINE = 0,
+    MOD_LFO_TRIANGLE,
+    MOD_LFO_SAW,            /* Rising */
+    MOD_LFO_SQUARE,
+    MOD_NUM_LFO_WAVE
+} mod_lfo_wave_t;
+
+typedef struct mod_route_t
+{
+    uint8_t src;            /* mod_src_t */
+    uint8_t dst;            /* mod_dst_t */
+    uint8_t part;           /* MOD_ALL_PARTS, ignored for the cutoff */
+    uint8_t cc;             /* MOD_SRC_CC only */
+    float depth;            /* Destination units at a source of 1 */
+} mod_route_t;
+
+typedef struct mod_lfo_t
+{
+    uint8_t wave;           /* mod_lfo_wave_t */
+    float hz;
+} mod_lfo_t;
+
+// Linear attack, decay to sustain, and release, gated by the note.
+//
+typedef struct mod_env_t
+{
+    float attack_ms;
+    float decay_ms;
+    float sustain;          /* 0.0 .. 1.0 */
+    float release_ms;
+} mod_env_t;
+
+typedef struct mod_patch_t
+{
+    mod_route_t route[MOD_NUM_ROUTE];
+    mod_lfo_t lfo[MOD_NUM_LFO];
+    mod_env_t env;
+} mod_patch_t;
+
+// The patch mod_init() starts from, as an initializer for constant tables
+// (presets in flash): every slot off, a vibrato-rate LFO, a slow sweep and
+// a plucked envelope.
+//
+#   define MOD_ROUTE_OFF        {MOD_SRC_OFF, MOD_DST_PITCH, MOD_ALL_PARTS, \
+                                 0, 0.0f}
+#   define MOD_ROUTE_OFF_4      MOD_ROUTE_OFF, MOD_ROUTE_OFF, MOD_ROUTE_OFF, \
+                                MOD_ROUTE_OFF
+#   define MOD_PATCH_DEFAULT    {{MOD_ROUTE_OFF_4, MOD_ROUTE_OFF_4,          \
+                                  MOD_ROUTE_OFF_4, MOD_ROUTE_OFF_4},         \
+                                 {{MOD_LFO_SINE, 5.0f},                      \
+                                  {MOD_LFO_TRIANGLE, 0.2f}},                 \
+                                 {5.0f, 300.0f, 0.5f, 300.0f}}
+
+// One multiply-add: acc[dst] += val[src] * depth.
+//
+typedef struct mod_op_t
+{
+    uint8_t src;
+    uint8_t dst;
+    float depth;
+} mod_op_t;
+
+// What mod_commit() hands to the audio side. op[0, num_block) reads the
+// block sources into the part and engine accumulators; the voice ops of
+// part p are op[part_op[p], part_op[p + 1]).
+//
+typedef struct mod_prog_t
+{
+    mod_op_t op[MOD_NUM_ROUTE * MOD_NUM_PART];
+    uint8_t num_block;
+    uint8_t part_op[MOD_NUM_PART + 1];
+    uint8_t part_mask;      /* Parts with a voice destination */
+    uint8_t num_cc;
+    uint8_t cc[MOD_NUM_ROUTE];  /* Controllers read, in value order */
+    uint32_t step;          /* Longest block, frames */
+    uint32_t lfo_inc[MOD_NUM_LFO];
+    uint8_t lfo_wave[MOD_NUM_LFO];
+    float env_up;           /* Per frame */
+    float env_down;
+    float env_sustain;
+    float env_release;
+} mod_prog_t;
+
+// Inside the synth voice. gain and pan are where the voice mix starts
+// this block, each moving by its step per frame.
+//
+typedef struct mod_voice_t
+{
+    uint8_t stage;
+    uint8_t b_new;          /* Ramps start at their first values */
+    float env;
+    float pitch;            /* Semitones the voice is tuned to */
+    float gain;
+    float gain_step;
+    float pan;
+    float pan_step;
+} mod_voice_t;
+
+typedef struct mod_t
+{
+    mod_prog_t prog[3];
+    std::atomic<uint8_t> middle;
+    uint8_t back;           /* UI side */
+    mod_patch_t edit;       /* UI side, published by mod_commit() */
+    uint8_t front;          /* Audio side from here on */
+    uint8_t b_fresh;        /* Program changed: visit every voice once */
+    uint8_t num_part;
+    uint32_t sample_rate;
+    uint32_t block_size;
+    uint32_t lfo_phase[MOD_NUM_LFO];
+    uint8_t cc[MOD_NUM_CC]; /* Last 7-bit values */
+    float acc[MOD_NUM_PART * MOD_NUM_VOICE_DST + 1];    /* Cutoff last */
+} mod_t;
+
+typedef struct mod_bench_t
+{
+    float idle_ns;          /* Empty matrix, one block */
+    float full_ns;          /* Every slot routed, one block */
+    float spread_pct;       /* Its standard deviation over the median */
+    uint32_t step;          /* Frames per update of the full matrix */
+} mod_bench_t;
+
+// `num_part` (up to MOD_NUM_PART) is how many parts MOD_ALL_PARTS
+// expands to; `block_size` is the longest block the engine renders.
+//
+void mod_init(mod_t * p_mod, uint32_t sample_rate, uint32_t block_size,
+              uint8_t num_part);
+
+// UI side. mod_edit() returns the working copy; nothing reaches audio
+// until mod_commit(), which returns 0 (and publishes nothing) when a
+// routing names an unknown source, destination or part, or sends a
+// per-voice source to the cutoff.
+//
+mod_patch_t * mod_edit(mod_t * p_mod);
+uint8_t mod_commit(mod_t * p_mod);
+
+// Audio side. mod_begin() takes the newest program and returns how many
+// frames, up to `max_frames`, to render before the next update.
+// mod_run() moves the block sources on by `frames` and returns a bit per
+// part whose voices need mod_voice_run(); `p_cutoff` gets the octaves for
+// the engine filter.
+//
+uint32_t mod_begin(mod_t * p_mod, uint32_t max_frames);
+void mod_set_cc(mod_t * p_mod, uint8_t cc, uint8_t value);
+uint32_t mod_run(mod_t * p_mod, uint32_t frames, float * p_cutoff);
+
+// Voice side, inside the synth. mod_voice_run() sets the gain and pan
+// ramps for the next `frames` and returns 1 when the voice has to be
+// retuned to `pitch`.
+//
+void mod_voice_start(mod_voice_t * p_voice, uint8_t b_restart);
+void mod_voice_release(mod_voice_t * p_voice);
+uint8_t mod_voice_run(const mod_t * p_mod, mod_voice_t * p_voice,
+                      uint8_t part, float velocity, uint32_t frames);
+
+// Matrix cost per block over `num_voice` voices of one part: empty, then
+// every slot routed.
+//
+void mod_bench(uint32_t num_voice, uint32_t sample_rate, uint32_t block_size,
+               mod_bench_t * p_result);
+
+#endif /* MOD_H */
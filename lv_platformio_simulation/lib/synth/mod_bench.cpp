@@ -0,0 +1,97 @@
+#include "mod.h"
+#include "osc.h"
+#include "perf_bench.h"
+#include <stddef.h>
+
+#define BENCH_MAX_VOICE     (128)
+
+typedef struct bench_ctx_t
+{
+    mod_t * p_mod;
+    mod_voice_t * p_voice;
+    uint32_t num_voice;
+    uint32_t block_size;
+} bench_ctx_t;
+
+// One engine block of matrix work per iteration: the block sources, then
+// every voice, as many times as the program's step asks for.
+//
+static void
+bench_blocks (void * p_arg, uint32_t iters)
+{
+    bench_ctx_t * p_ctx = (bench_ctx_t *) p_arg;
+    volatile uint32_t retune = 0;
+    float cutoff = 0.0f;
+
+    for (uint32_t iter = 0; iter < iters; ++iter)
+    {
+        uint32_t frames = p_ctx->block_size;
+
+        while (frames > 0)
+        {
+            uint32_t step = mod_begin(p_ctx->p_mod, frames);
+
+            if (0 != mod_run(p_ctx->p_mod, step, &cutoff))
+            {
+                for (uint32_t idx = 0; idx < p_ctx->num_voice; ++idx)
+                {
+                    retune = retune + mod_voice_run(p_ctx->p_mod,
+                                                    &p_ctx->p_voice[idx], 0,
+                                                    0.75f, step);
+                }
+            }
+
+            frames -= step;
+        }
+    }
+}   /* bench_blocks() */
+
+void
+mod_bench (uint32_t num_voice, uint32_t sample_rate, uint32_t block_size,
+           mod_bench_t * p_result)
+{
+    static mod_t mod;
+    static mod_voice_t voice[BENCH_MAX_VOICE];
+    bench_ctx_t ctx = {&mod, voice, num_voice, block_size};
+    mod_patch_t * p_patch = NULL;
+    perf_bench_t perf;
+
+    osc_init();
+    ctx.num_voice = (num_voice > BENCH_MAX_VOICE) ? BENCH_MAX_VOICE
+                                                  : num_voice;
+    mod_init(&mod, sample_rate, block_size, 1);
+
+    for (uint32_t idx = 0; idx < ctx.num_voice; ++idx)
+    {
+        mod_voice_start(&voice[idx], 1);
+    }
+
+    perf_bench_run("mod matrix, empty", bench_blocks, &ctx, 21, &perf);
+    p_result->idle_ns = perf.median_ns;
+
+    // Every slot taken, every source and destination used: LFOs and CCs
+    // on all four, the envelope and velocity on the voice ones.
+    //
+    p_patch = mod_edit(&mod);
+
+    for (uint32_t idx = 0; idx < MOD_NUM_ROUTE; ++idx)
+    {
+        mod_route_t * p_route = &p_patch->route[idx];
+
+        p_route->src = (uint8_t) (MOD_SRC_LFO1 + idx % (MOD_NUM_SRC - 1));
+        p_route->dst = (uint8_t) (idx % ((MOD_SRC_ENV == p_route->src)
+                                         || (MOD_SRC_VELOCITY == p_route->src)
+                                         ? MOD_NUM_VOICE_DST : MOD_NUM_DST));
+        p_route->part = 0;
+        p_route->cc = (uint8_t) (idx + 1);
+        p_route->depth = 0.1f;
+    }
+
+    mod_commit(&mod);
+    mod_begin(&mod, block_size);
+    p_result->step = mod.prog[mod.front].step;
+    perf_bench_run("mod matrix, full", bench_blocks, &ctx, 21, &perf);
+    p_result->full_ns = perf.median_ns;
+    p_result->spread_pct = (0.0f == perf.median_ns)
+                           ? 0.0f : 100.0f * perf.stddev_ns / perf.median_ns;
+}   /* mod_bench() */
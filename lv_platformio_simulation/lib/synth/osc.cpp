@@ -0,0 +1,281 @@
+#include "osc.h"
+#include <string.h>
+#include <math.h>
+
+#define OSC_PI          (3.14159265358979)
+#define OSC_PHASE_SCALE (1.0f / 4294967296.0f)
+#define OSC_FRAC_SCALE  (1.0f / (float) (1U << OSC_FRAC_BITS))
+#define OSC_FRAC_MASK   ((1U << OSC_FRAC_BITS) - 1)
+
+static float g_sine_table[OSC_TABLE_SIZE + 1] = {0};
+
+// [0] triangle, [1] square, [2] saw.
+//
+static float g_mip_table[OSC_NUM_WAVE - 1][OSC_TABLE_LEVELS]
+                        [OSC_TABLE_SIZE + 1] = {{{0}}};
+static uint8_t gb_init = 0;
+
+static inline float
+table_read (const float * p_table, uint32_t phase)
+{
+    uint32_t pos = phase >> OSC_FRAC_BITS;
+    float frac = (float) (phase & OSC_FRAC_MASK) * OSC_FRAC_SCALE;
+    float a = p_table[pos];
+
+    return (a + (p_table[pos + 1] - a) * frac);
+}   /* table_read() */
+
+static inline uint32_t
+table_level (uint32_t phase_inc)
+{
+    // Highest level whose top harmonic stays below Nyquist: level k is
+    // safe while phase_inc < 2^(32 - OSC_TABLE_BITS + k).
+    //
+    int32_t level = 0;
+
+    if (0 != phase_inc)
+    {
+        level = OSC_TABLE_BITS - __builtin_clz(phase_inc);
+    }
+
+    if (level < 0)
+    {
+        level = 0;
+    }
+    else if (level >= OSC_TABLE_LEVELS)
+    {
+        level = OSC_TABLE_LEVELS - 1;
+    }
+
+    return ((uint32_t) level);
+}   /* table_level() */
+
+static inline float
+poly_blep (float t, float dt)
+{
+    if (t < dt)
+    {
+        t = t / dt - 1.0f;
+
+        return (-t * t);
+    }
+    else if (t > 1.0f - dt)
+    {
+        t = (t - 1.0f) / dt + 1.0f;
+
+        return (t * t);
+    }
+
+    return (0.0f);
+}   /* poly_blep() */
+
+static inline float
+poly_blamp (float t, float dt)
+{
+    if (t < dt)
+    {
+        t = t / dt - 1.0f;
+
+        return (-1.0f / 3.0f * t * t * t);
+    }
+    else if (t > 1.0f - dt)
+    {
+        t = (t - 1.0f) / dt + 1.0f;
+
+        return (1.0f / 3.0f * t * t * t);
+    }
+
+    return (0.0f);
+}   /* poly_blamp() */
+
+static void
+render_table (osc_t * p_osc, const float * p_table, float * p_out,
+              uint32_t frames)
+{
+    uint32_t phase = p_osc->phase;
+    const uint32_t inc = p_osc->phase_inc;
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        p_out[idx] = table_read(p_table, phase);
+        phase += inc;
+    }
+
+    p_osc->phase = phase;
+}   /* render_table() */
+
+static void
+render_blep_square (osc_t * p_osc, float * p_out, uint32_t frames)
+{
+    uint32_t phase = p_osc->phase;
+    const uint32_t inc = p_osc->phase_inc;
+    const float dt = (float) inc * OSC_PHASE_SCALE;
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        float t = (float) phase * OSC_PHASE_SCALE;
+        float t2 = (float) (phase + 0x80000000U) * OSC_PHASE_SCALE;
+        float y = (phase < 0x80000000U) ? 1.0f : -1.0f;
+
+        p_out[idx] = y + poly_blep(t, dt) - poly_blep(t2, dt);
+        phase += inc;
+    }
+
+    p_osc->phase = phase;
+}   /* render_blep_square() */
+
+static void
+render_blep_saw (osc_t * p_osc, float * p_out, uint32_t frames)
+{
+    uint32_t phase = p_osc->phase;
+    const uint32_t inc = p_osc->phase_inc;
+    const float dt = (float) inc * OSC_PHASE_SCALE;
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        // Reset at half the period, in phase with the table.
+        //
+        float t = (float) (phase + 0x80000000U) * OSC_PHASE_SCALE;
+
+        p_out[idx] = 2.0f * t - 1.0f - poly_blep(t, dt);
+        phase += inc;
+    }
+
+    p_osc->phase = phase;
+}   /* render_blep_saw() */
+
+static void
+render_blep_triangle (osc_t * p_osc, float * p_out, uint32_t frames)
+{
+    uint32_t phase = p_osc->phase;
+    const uint32_t inc = p_osc->phase_inc;
+    const float dt = (float) inc * OSC_PHASE_SCALE;
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        // Corners at 1/4 (peak) and 3/4 (trough) of the period.
+        //
+        float t1 = (float) (phase + 0x40000000U) * OSC_PHASE_SCALE;
+        float t2 = (float) (phase + 0xC0000000U) * OSC_PHASE_SCALE;
+        float y = (float) phase * OSC_PHASE_SCALE * 4.0f;
+
+        if (y >= 3.0f)
+        {
+            y -= 4.0f;
+        }
+        else if (y > 1.0f)
+        {
+            y = 2.0f - y;
+        }
+
+        p_out[idx] = y + 4.0f * dt * (poly_blamp(t1, dt) - poly_blamp(t2, dt));
+        phase += inc;
+    }
+
+    p_osc->phase = phase;
+}   /* render_blep_triangle() */
+
+void
+osc_init (void)
+{
+    uint32_t idx = 0;
+
+    if (gb_init)
+    {
+        return;
+    }
+
+    for (idx = 0; idx <= OSC_TABLE_SIZE; ++idx)
+    {
+        g_sine_table[idx] = (float) sin(2.0 * OSC_PI * idx / OSC_TABLE_SIZE);
+    }
+
+    // Build from the top level (fundamental only) down, each level adding
+    // the harmonics that fit below its limit (odd ones only but for the
+    // saw). Partials are summed from the sine table, so this costs no trig
+    // calls.
+    //
+    for (uint32_t wave = 0; wave < OSC_NUM_WAVE - 1; ++wave)
+    {
+        const uint32_t step = (OSC_SAW - 1 == wave) ? 1 : 2;
+        uint32_t harm = 1;
+
+        for (int32_t level = OSC_TABLE_LEVELS - 1; level >= 0; --level)
+        {
+            float * p_table = g_mip_table[wave][level];
+            uint32_t top = (OSC_TABLE_SIZE / 2) >> level;
+
+            if (level < OSC_TABLE_LEVELS - 1)
+            {
+                memcpy(p_table, g_mip_table[wave][level + 1],
+                       sizeof(g_mip_table[wave][level]));
+            }
+
+            for (; harm <= top; harm += step)
+            {
+                float gain = (OSC_TRIANGLE - 1 == wave)
+                    ? (float) (8.0 / (OSC_PI * OSC_PI * harm * harm))
+                      * ((harm & 2) ? -1.0f : 1.0f)
+                    : (OSC_SQUARE - 1 == wave)
+                    ? (float) (4.0 / (OSC_PI * harm))
+                    : (float) (2.0 / (OSC_PI * harm))
+                      * ((harm & 1) ? 1.0f : -1.0f);
+
+                for (idx = 0; idx < OSC_TABLE_SIZE; ++idx)
+                {
+                    p_table[idx] += gain * g_sine_table[(harm * idx)
+                                                        & (OSC_TABLE_SIZE - 1)];
+                }
+            }
+
+            p_table[OSC_TABLE_SIZE] = p_table[0];
+        }
+    }
+
+    gb_init = 1;
+}   /* osc_init() */
+
+float
+osc_sine (uint32_t phase)
+{
+    return (table_read(g_sine_table, phase));
+}   /* osc_sine() */
+
+const float *
+osc_sine_table (void)
+{
+    return (g_sine_table);
+}   /* osc_sine_table() */
+
+const float *
+osc_table (osc_wave_t wave, uint32_t phase_inc)
+{
+    if ((OSC_SINE == wave) || (wave >= OSC_NUM_WAVE))
+    {
+        return (g_sine_table);
+    }
+
+    return (g_mip_table[wave - 1][table_level(phase_inc)]);
+}   /* osc_table() */
+
+void
+osc_render (osc_t * p_osc, float * p_out, uint32_t frames)
+{
+    if ((OSC_SINE == p_osc->wave) || (OSC_MODE_TABLE == p_osc->mode))
+    {
+        render_table(p_osc, osc_table((osc_wave_t) p_osc->wave,
+                                      p_osc->phase_inc), p_out, frames);
+    }
+    else if (OSC_TRIANGLE == p_osc->wave)
+    {
+        render_blep_triangle(p_osc, p_out, frames);
+    }
+    else if (OSC_SAW == p_osc->wave)
+    {
+        render_blep_saw(p_osc, p_out, frames);
+    }
+    else
+    {
+        render_blep_square(p_osc, p_out, frames);
+    }
+}   /* osc_render() */
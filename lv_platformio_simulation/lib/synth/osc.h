@@ -0,0 +1,62 @@
+#ifndef OSC_H
+
+#   define OSC_H
+#   include <stdint.h>
+
+// Band-limited wavetables hold one mip level per octave; level k keeps the
+// harmonics below OSC_TABLE_SIZE / 2 >> k.
+//
+#   ifndef OSC_TABLE_BITS
+#       define OSC_TABLE_BITS   (10)
+#   endif
+#   define OSC_TABLE_SIZE       (1 << OSC_TABLE_BITS)
+#   define OSC_TABLE_LEVELS     (OSC_TABLE_BITS)
+#   define OSC_FRAC_BITS        (32 - OSC_TABLE_BITS)
+
+#   ifndef OSC_DEFAULT_MODE
+#       define OSC_DEFAULT_MODE (OSC_MODE_TABLE)
+#   endif
+
+typedef enum osc_wave_t
+{
+    OSC_SINE = 0,       /* Same order as the waveform dropdown */
+    OSC_TRIANGLE,
+    OSC_SQUARE,
+    OSC_SAW,
+    OSC_NUM_WAVE
+} osc_wave_t;
+
+typedef enum osc_mode_t
+{
+    OSC_MODE_TABLE = 0, /* Mip-mapped band-limited wavetable */
+    OSC_MODE_BLEP,      /* Naive shape corrected with PolyBLEP/PolyBLAMP */
+    OSC_NUM_MODE
+} osc_mode_t;
+
+typedef struct osc_t
+{
+    uint32_t phase;
+    uint32_t phase_inc;
+    uint8_t wave;
+    uint8_t mode;
+} osc_t;
+
+typedef struct osc_bench_t
+{
+    uint32_t ns_per_block;  /* One voice, one SYNTH_BLOCK_SIZE block */
+    float alias_db;         /* Non-harmonic energy relative to the total */
+} osc_bench_t;
+
+void osc_init(void);
+float osc_sine(uint32_t phase);
+const float * osc_sine_table(void);     /* OSC_TABLE_SIZE + 1 entries */
+
+// The band-limited table to play `wave` at `phase_inc` or below from, for
+// callers running their own phase (OSC_TABLE_SIZE + 1 entries).
+//
+const float * osc_table(osc_wave_t wave, uint32_t phase_inc);
+void osc_render(osc_t * p_osc, float * p_out, uint32_t frames);
+void osc_bench(osc_wave_t wave, osc_mode_t mode, uint8_t note,
+               uint32_t sample_rate, osc_bench_t * p_result);
+
+#endif /* OSC_H */
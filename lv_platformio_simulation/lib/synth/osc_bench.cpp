@@ -0,0 +1,97 @@
+#include "osc.h"
+#include "fft.h"
+#include "perf.h"
+#include "synth.h"
+#include <math.h>
+
+#define BENCH_WARMUP        (64)
+#define BENCH_BLOCKS        (4096)
+#define BENCH_FFT_SIZE      (4096)
+#define BENCH_LOBE_BINS     (4)     /* Blackman-Harris main lobe half-width */
+
+static float g_fft_re[BENCH_FFT_SIZE];
+static float g_fft_im[BENCH_FFT_SIZE];
+static float g_fft_twiddle[BENCH_FFT_SIZE];
+static float g_power[BENCH_FFT_SIZE / 2 + 1];
+
+static uint32_t
+note_phase_inc (uint8_t note, uint32_t sample_rate)
+{
+    double freq = pow(2.0, ((double) note - 69.0) / 12.0) * 440.0;
+
+    return ((uint32_t) (freq / sample_rate * 4294967296.0));
+}   /* note_phase_inc() */
+
+static float
+alias_energy_db (osc_t * p_osc, uint32_t sample_rate)
+{
+    fft_t fft;
+    double freq = (double) p_osc->phase_inc / 4294967296.0 * sample_rate;
+    double bin_hz = (double) sample_rate / BENCH_FFT_SIZE;
+    double total = 0.0;
+    double alias = 0.0;
+
+    fft_init(&fft, g_fft_twiddle, BENCH_FFT_SIZE);
+    osc_render(p_osc, g_fft_re, BENCH_FFT_SIZE);
+
+    for (uint32_t idx = 0; idx < BENCH_FFT_SIZE; ++idx)
+    {
+        g_fft_im[idx] = 0.0f;
+    }
+
+    fft_window(g_fft_re, BENCH_FFT_SIZE);
+    fft_forward(&fft, g_fft_re, g_fft_im);
+    fft_power(&fft, g_fft_re, g_fft_im, g_power);
+
+    // Whatever is not under a harmonic's main lobe has been folded back
+    // from above Nyquist.
+    //
+    for (uint32_t bin = BENCH_LOBE_BINS + 1; bin <= BENCH_FFT_SIZE / 2; ++bin)
+    {
+        double pos = bin * bin_hz / freq;
+        double dist = fabs(pos - floor(pos + 0.5)) * freq / bin_hz;
+
+        total += g_power[bin];
+
+        if (dist > BENCH_LOBE_BINS)
+        {
+            alias += g_power[bin];
+        }
+    }
+
+    if ((alias <= 0.0) || (total <= 0.0))
+    {
+        return (-200.0f);
+    }
+
+    return ((float) (10.0 * log10(alias / total)));
+}   /* alias_energy_db() */
+
+void
+osc_bench (osc_wave_t wave, osc_mode_t mode, uint8_t note,
+           uint32_t sample_rate, osc_bench_t * p_result)
+{
+    static float block[SYNTH_BLOCK_SIZE];
+    osc_t osc = {0, note_phase_inc(note, sample_rate), (uint8_t) wave,
+                 (uint8_t) mode};
+    uint32_t start = 0;
+    uint64_t ticks = 0;
+
+    osc_init();
+
+    for (uint32_t idx = 0; idx < BENCH_WARMUP; ++idx)
+    {
+        osc_render(&osc, block, SYNTH_BLOCK_SIZE);
+    }
+
+    for (uint32_t idx = 0; idx < BENCH_BLOCKS; ++idx)
+    {
+        start = perf_ticks();
+        osc_render(&osc, block, SYNTH_BLOCK_SIZE);
+        ticks += perf_ticks() - start;
+    }
+
+    p_result->ns_per_block = perf_ticks_to_ns((uint32_t) (ticks
+                                                          / BENCH_BLOCKS));
+    p_result->alias_db = alias_energy_db(&osc, sample_rate);
+}   /* osc_bench() */
@@ -0,0 +1,415 @@
+#include "preset.h"
+#include "osc.h"
+#include "unison.h"
+#include <string.h>
+#if PRESET_FILES
+#   include <stdio.h>
+#   include <stdlib.h>
+#   if !defined(_WIN32)
+#       include <fcntl.h>
+#       include <sys/mman.h>
+#       include <sys/stat.h>
+#       include <unistd.h>
+#   endif
+#endif
+
+static_assert(sizeof(preset_part_t) == 4, "preset_part_t layout");
+static_assert(offsetof(preset_t, part) == 16, "preset_t layout");
+static_assert(offsetof(preset_t, fx) == 32, "preset_t layout");
+static_assert(offsetof(preset_t, detune) == 76, "preset_t layout");
+static_assert(offsetof(preset_t, mod) == 108, "preset_t layout");
+static_assert(sizeof(mod_patch_t) == 160, "mod_patch_t layout");
+static_assert(sizeof(preset_t) == 268, "preset_t layout");
+static_assert(sizeof(preset_bank_header_t) == 16, "bank header layout");
+static_assert(PRESET_NUM_PART >= 2, "the factory bank sets two parts");
+
+#define PRESET_HASH_MUL     (0x01000193U)
+
+// Effect parameters in preset_t::fx order. Appending here needs a new
+// PRESET_VERSION: the record grows.
+//
+static const uint8_t g_fx_param[PRESET_NUM_FX_PARAM][2] =
+{
+    {FX_FILTER, FX_PARAM_CUTOFF},
+    {FX_FILTER, FX_PARAM_RESONANCE},
+    {FX_CHORUS, FX_PARAM_RATE},
+    {FX_CHORUS, FX_PARAM_DEPTH},
+    {FX_CHORUS, FX_PARAM_MIX},
+    {FX_DELAY, FX_PARAM_TIME},
+    {FX_DELAY, FX_PARAM_FEEDBACK},
+    {FX_DELAY, FX_PARAM_MIX},
+    {FX_REVERB, FX_PARAM_ROOM},
+    {FX_REVERB, FX_PARAM_DAMP},
+    {FX_REVERB, FX_PARAM_MIX}
+};
+
+// fx_init() defaults, same order.
+//
+#define PRESET_FX_DEFAULT   {8000.0f, 0.2f, 0.8f, 3.0f, 0.5f, 250.0f, 0.35f, \
+                             0.3f, 0.5f, 0.5f, 0.25f}
+
+// Unison detune, then spread, for every part.
+//
+#define PRESET_UNISON_DEFAULT   {UNISON_DETUNE, UNISON_DETUNE, UNISON_DETUNE, \
+                                 UNISON_DETUNE},                              \
+                                {UNISON_SPREAD, UNISON_SPREAD, UNISON_SPREAD, \
+                                 UNISON_SPREAD}
+
+#define FX_BIT(id)          ((uint8_t) (1U << (id)))
+
+// The factory bank, in flash on firmware. The first entry is the sound
+// main() sets up: sine piano over a quieter triangle pad.
+//
+static const preset_t g_factory[] =
+{
+    {"Piano+Pad", 0, {0},
+     {{100, OSC_SINE, OSC_DEFAULT_MODE, 0}, {40, OSC_TRIANGLE, OSC_DEFAULT_MODE, 0},
+      {100, OSC_SINE, OSC_DEFAULT_MODE, 0}, {100, OSC_SINE, OSC_DEFAULT_MODE, 0}},
+     PRESET_FX_DEFAULT, PRESET_UNISON_DEFAULT, MOD_PATCH_DEFAULT},
+    {"Organ", FX_BIT(FX_CHORUS), {0},
+     {{80, OSC_SQUARE, OSC_DEFAULT_MODE, 0}, {50, OSC_SINE, OSC_DEFAULT_MODE, 0},
+      {100, OSC_SINE, OSC_DEFAULT_MODE, 0}, {100, OSC_SINE, OSC_DEFAULT_MODE, 0}},
+     {8000.0f, 0.2f, 5.5f, 2.0f, 0.5f, 250.0f, 0.35f, 0.3f, 0.5f, 0.5f,
+      0.25f}, PRESET_UNISON_DEFAULT, MOD_PATCH_DEFAULT},
+    {"Echo Bell", FX_BIT(FX_DELAY) | FX_BIT(FX_REVERB), {0},
+     {{90, OSC_TRIANGLE, OSC_DEFAULT_MODE, 0}, {0, OSC_SINE, OSC_DEFAULT_MODE, 0},
+      {100, OSC_SINE, OSC_DEFAULT_MODE, 0}, {100, OSC_SINE, OSC_DEFAULT_MODE, 0}},
+     {8000.0f, 0.2f, 0.8f, 3.0f, 0.5f, 375.0f, 0.5f, 0.35f, 0.6f, 0.4f,
+      0.2f}, PRESET_UNISON_DEFAULT, MOD_PATCH_DEFAULT},
+    {"Hall Pad", FX_BIT(FX_CHORUS) | FX_BIT(FX_REVERB), {0},
+     {{60, OSC_SINE, OSC_DEFAULT_MODE, 0}, {60, OSC_TRIANGLE, OSC_DEFAULT_MODE, 0},
+      {100, OSC_SINE, OSC_DEFAULT_MODE, 0}, {100, OSC_SINE, OSC_DEFAULT_MODE, 0}},
+     {8000.0f, 0.2f, 0.4f, 6.0f, 0.4f, 250.0f, 0.35f, 0.3f, 0.85f, 0.3f,
+      0.45f}, PRESET_UNISON_DEFAULT, MOD_PATCH_DEFAULT},
+    {"Dark Square", FX_BIT(FX_FILTER), {0},
+     {{100, OSC_SQUARE, OSC_DEFAULT_MODE, 0}, {30, OSC_SQUARE, OSC_DEFAULT_MODE, 0},
+      {100, OSC_SINE, OSC_DEFAULT_MODE, 0}, {100, OSC_SINE, OSC_DEFAULT_MODE, 0}},
+     {900.0f, 0.6f, 0.8f, 3.0f, 0.5f, 250.0f, 0.35f, 0.3f, 0.5f, 0.5f,
+      0.25f}, PRESET_UNISON_DEFAULT, MOD_PATCH_DEFAULT},
+    {"Supersaw", FX_BIT(FX_FILTER) | FX_BIT(FX_REVERB), {0},
+     {{70, OSC_SAW, OSC_DEFAULT_MODE, 8}, {40, OSC_SAW, OSC_DEFAULT_MODE, 4},
+      {100, OSC_SINE, OSC_DEFAULT_MODE, 0}, {100, OSC_SINE, OSC_DEFAULT_MODE, 0}},
+     {5000.0f, 0.3f, 0.8f, 3.0f, 0.5f, 250.0f, 0.35f, 0.3f, 0.7f, 0.3f,
+      0.3f},
+     {30.0f, 12.0f, UNISON_DETUNE, UNISON_DETUNE},
+     {0.9f, 0.4f, UNISON_SPREAD, UNISON_SPREAD}, MOD_PATCH_DEFAULT}
+};
+
+#define PRESET_NUM_FACTORY  (sizeof(g_factory) / sizeof(g_factory[0]))
+
+void
+preset_fx_param (uint32_t idx, fx_id_t * p_id, fx_param_t * p_param)
+{
+    *p_id = (fx_id_t) g_fx_param[idx][0];
+    *p_param = (fx_param_t) g_fx_param[idx][1];
+}   /* preset_fx_param() */
+
+int32_t
+preset_fx_index (fx_id_t id, fx_param_t param)
+{
+    for (uint32_t idx = 0; idx < PRESET_NUM_FX_PARAM; ++idx)
+    {
+        if ((id == g_fx_param[idx][0]) && (param == g_fx_param[idx][1]))
+        {
+            return ((int32_t) idx);
+        }
+    }
+
+    return (-1);
+}   /* preset_fx_index() */
+
+void
+preset_init (preset_t * p_preset, const char * p_name)
+{
+    static const float fx[PRESET_NUM_FX_PARAM] = PRESET_FX_DEFAULT;
+    static const mod_patch_t mod = MOD_PATCH_DEFAULT;
+
+    memset(p_preset, 0, sizeof(*p_preset));
+    strncpy(p_preset->name, p_name, PRESET_NAME_LEN - 1);
+
+    for (uint32_t part = 0; part < PRESET_NUM_PART; ++part)
+    {
+        p_preset->part[part].volume = 100;
+        p_preset->part[part].wave = OSC_SINE;
+        p_preset->part[part].mode = OSC_DEFAULT_MODE;
+        p_preset->detune[part] = UNISON_DETUNE;
+        p_preset->spread[part] = UNISON_SPREAD;
+    }
+
+    memcpy(p_preset->fx, fx, sizeof(fx));
+    p_preset->mod = mod;
+}   /* preset_init() */
+
+uint32_t
+preset_checksum (const preset_t * p_preset, uint32_t count)
+{
+    // Word at a time: a bank of hundreds of records is a few thousand
+    // multiplies, well under the startup budget even on the MCUs. Record
+    // by record, so no byte count is formed that could wrap.
+    //
+    uint32_t hash = 0x811C9DC5U;
+
+    for (uint32_t rec = 0; rec < count; ++rec)
+    {
+        const uint8_t * p_byte = (const uint8_t *) &p_preset[rec];
+
+        for (uint32_t idx = 0; idx < sizeof(preset_t) / 4U; ++idx)
+        {
+            uint32_t word = 0;
+
+            memcpy(&word, &p_byte[4U * idx], sizeof(word));
+            hash = (hash ^ word) * PRESET_HASH_MUL;
+        }
+    }
+
+    return (hash);
+}   /* preset_checksum() */
+
+uint8_t
+preset_bank_open (preset_bank_t * p_bank, const void * p_data, size_t size)
+{
+    const preset_bank_header_t * p_hdr = (const preset_bank_header_t *) p_data;
+    const preset_t * p_preset = (const preset_t *) (p_hdr + 1);
+
+    if ((NULL == p_data) || (size < sizeof(*p_hdr))
+        || (PRESET_MAGIC != p_hdr->magic)
+        || (PRESET_VERSION != p_hdr->version)
+        || (sizeof(preset_t) != p_hdr->record_size)
+        || (p_hdr->count > (size - sizeof(*p_hdr)) / sizeof(preset_t))
+        || (p_hdr->checksum != preset_checksum(p_preset, p_hdr->count)))
+    {
+        return (0);
+    }
+
+    p_bank->p_preset = p_preset;
+    p_bank->count = p_hdr->count;
+    p_bank->p_map = NULL;
+    p_bank->map_size = 0;
+    p_bank->p_file = NULL;
+
+    return (1);
+}   /* preset_bank_open() */
+
+void
+preset_bank_factory (preset_bank_t * p_bank)
+{
+    p_bank->p_preset = g_factory;
+    p_bank->count = PRESET_NUM_FACTORY;
+    p_bank->p_map = NULL;
+    p_bank->map_size = 0;
+    p_bank->p_file = NULL;
+}   /* preset_bank_factory() */
+
+#if PRESET_FILES
+// A new bank file: the factory presets, then free slots.
+//
+static uint8_t
+bank_create (const char * p_path)
+{
+    preset_bank_header_t hdr = {PRESET_MAGIC, PRESET_VERSION,
+                                (uint16_t) sizeof(preset_t),
+                                PRESET_BANK_SLOTS, 0};
+    preset_t * p_slot = (preset_t *) calloc(PRESET_BANK_SLOTS,
+                                            sizeof(preset_t));
+    FILE * p_file = NULL;
+    uint8_t b_ok = 0;
+
+    if (NULL == p_slot)
+    {
+        return (0);
+    }
+
+    for (uint32_t idx = 0; idx < PRESET_BANK_SLOTS; ++idx)
+    {
+        preset_init(&p_slot[idx], "");
+    }
+
+    memcpy(p_slot, g_factory, sizeof(g_factory));
+    hdr.checksum = preset_checksum(p_slot, PRESET_BANK_SLOTS);
+    p_file = fopen(p_path, "wb");
+
+    if (NULL != p_file)
+    {
+        b_ok = (1 == fwrite(&hdr, sizeof(hdr), 1, p_file))
+               && (PRESET_BANK_SLOTS == fwrite(p_slot, sizeof(preset_t),
+                                               PRESET_BANK_SLOTS, p_file));
+        b_ok = (0 == fclose(p_file)) && b_ok;
+    }
+
+    free(p_slot);
+
+    return (b_ok);
+}   /* bank_create() */
+#endif
+
+uint8_t
+preset_bank_map (preset_bank_t * p_bank, const char * p_path)
+{
+#if PRESET_FILES
+    void * p_map = NULL;
+    void * p_open = NULL;
+    size_t size = 0;
+
+#   if !defined(_WIN32)
+    struct stat st;
+    int fd = open(p_path, O_RDWR);
+
+    if ((fd < 0) && bank_create(p_path))
+    {
+        fd = open(p_path, O_RDWR);
+    }
+
+    if ((fd < 0) || (0 != fstat(fd, &st)))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        preset_bank_factory(p_bank);
+        return (0);
+    }
+
+    // Shared and writable: preset_bank_store() edits the file in place.
+    // The mapping outlives the descriptor.
+    //
+    size = (size_t) st.st_size;
+    p_map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (MAP_FAILED == p_map)
+    {
+        p_map = NULL;
+    }
+#   else
+    // No mmap on MinGW: one read into memory, written back on store into
+    // the file kept open here, not whatever PRESET_BANK_PATH names.
+    //
+    FILE * p_file = fopen(p_path, "r+b");
+
+    if ((NULL == p_file) && bank_create(p_path))
+    {
+        p_file = fopen(p_path, "r+b");
+    }
+
+    if (NULL != p_file)
+    {
+        fseek(p_file, 0, SEEK_END);
+        size = (size_t) ftell(p_file);
+        fseek(p_file, 0, SEEK_SET);
+        p_map = malloc(size);
+
+        if ((NULL != p_map) && (1 != fread(p_map, size, 1, p_file)))
+        {
+            free(p_map);
+            p_map = NULL;
+        }
+
+        p_open = p_file;
+    }
+#   endif
+
+    if ((NULL == p_map) || !preset_bank_open(p_bank, p_map, size))
+    {
+        p_bank->p_map = p_map;
+        p_bank->map_size = size;
+        p_bank->p_file = p_open;
+        preset_bank_unmap(p_bank);
+        preset_bank_factory(p_bank);
+        return (0);
+    }
+
+    p_bank->p_map = p_map;
+    p_bank->map_size = size;
+    p_bank->p_file = p_open;
+
+    return (1);
+#else
+    (void) p_path;
+    preset_bank_factory(p_bank);
+
+    return (0);
+#endif
+}   /* preset_bank_map() */
+
+void
+preset_bank_unmap (preset_bank_t * p_bank)
+{
+#if PRESET_FILES
+    if (NULL != p_bank->p_map)
+    {
+#   if !defined(_WIN32)
+        munmap(p_bank->p_map, p_bank->map_size);
+#   else
+        free(p_bank->p_map);
+#   endif
+    }
+
+    if (NULL != p_bank->p_file)
+    {
+        fclose((FILE *) p_bank->p_file);
+    }
+#endif
+
+    p_bank->p_preset = NULL;
+    p_bank->count = 0;
+    p_bank->p_map = NULL;
+    p_bank->map_size = 0;
+    p_bank->p_file = NULL;
+}   /* preset_bank_unmap() */
+
+uint8_t
+preset_bank_store (preset_bank_t * p_bank, uint32_t idx,
+                   const preset_t * p_preset)
+{
+#if PRESET_FILES
+    preset_bank_header_t * p_hdr = (preset_bank_header_t *) p_bank->p_map;
+    preset_t * p_slot = NULL;
+
+    if ((NULL == p_hdr) || (idx >= p_bank->count))
+    {
+        return (0);
+    }
+
+    // The engine reads a record only while applying it, right after the
+    // switch: storing over the live slot is safe once that has happened.
+    //
+    p_slot = (preset_t *) (p_hdr + 1);
+    p_slot[idx] = *p_preset;
+    p_hdr->checksum = preset_checksum(p_slot, p_bank->count);
+
+#   if !defined(_WIN32)
+    return (0 == msync(p_hdr, p_bank->map_size, MS_ASYNC));
+#   else
+    {
+        FILE * p_file = (FILE *) p_bank->p_file;
+
+        return ((NULL != p_file) && (0 == fseek(p_file, 0, SEEK_SET))
+                && (1 == fwrite(p_hdr, p_bank->map_size, 1, p_file))
+                && (0 == fflush(p_file)));
+    }
+#   endif
+#else
+    (void) p_bank;
+    (void) idx;
+    (void) p_preset;
+
+    return (0);
+#endif
+}   /* preset_bank_store() */
+
+uint32_t
+preset_bank_next (const preset_bank_t * p_bank, uint32_t idx)
+{
+    for (uint32_t step = 1; step <= p_bank->count; ++step)
+    {
+        uint32_t next = (idx + step) % p_bank->count;
+
+        if ('\0' != p_bank->p_preset[next].name[0])
+        {
+            return (next);
+        }
+    }
+
+    return (idx);
+}   /* preset_bank_next() */
@@ -0,0 +1,109 @@
+#ifndef PRESET_H
+
+#   define PRESET_H
+#   include <stdint.h>
+#   include <stddef.h>
+#   include "fx.h"
+#   include "mod.h"
+
+// Presets: every engine parameter in one fixed-layout record, so a bank is
+// a header followed by an array that is used where it lies: mapped from a
+// file on native, linked into flash on firmware. Nothing is parsed or
+// copied at load time beyond checking the header.
+//
+// Layout rules, kept by the static_asserts in preset.cpp: little-endian,
+// IEEE floats, natural alignment, no pointers and no build-dependent
+// sizes. Fields are only ever appended; a bank whose version or record
+// size does not match is refused rather than guessed at.
+//
+#   if !defined(STM32F429xx) && !defined(ESP_PLATFORM)
+#       define PRESET_FILES         (1)
+#   else
+#       define PRESET_FILES         (0)
+#   endif
+
+#   define PRESET_MAGIC         (0x4B4E4250U)   /* "PBNK" */
+#   define PRESET_VERSION       (3)
+#   define PRESET_NAME_LEN      (12)
+#   define PRESET_NUM_PART      (4)     /* Stored, whatever SYNTH_NUM_PART */
+#   define PRESET_NUM_FX_PARAM  (11)
+#   define PRESET_BANK_SLOTS    (128)   /* Of a bank file made on native */
+#   ifndef PRESET_BANK_PATH
+#       define PRESET_BANK_PATH     "presets.bin"
+#   endif
+
+typedef struct preset_part_t
+{
+    uint8_t volume;         /* 0 .. 100 */
+    uint8_t wave;           /* osc_wave_t */
+    uint8_t mode;           /* osc_mode_t */
+    uint8_t unison;         /* Copies per voice, 0 or 1: off */
+} preset_part_t;
+
+typedef struct preset_t
+{
+    char name[PRESET_NAME_LEN];     /* NUL padded, empty for a free slot */
+    uint8_t fx_mask;                /* Bit per fx_id_t: enabled */
+    uint8_t reserved[3];
+    preset_part_t part[PRESET_NUM_PART];
+    float fx[PRESET_NUM_FX_PARAM];  /* In preset_fx_param() order */
+    float detune[PRESET_NUM_PART];  /* Unison cents, either side */
+    float spread[PRESET_NUM_PART];  /* Unison stereo width, 0 .. 1 */
+    mod_patch_t mod;                /* Modulation matrix, as edited */
+} preset_t;
+
+typedef struct preset_bank_header_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;   /* sizeof(preset_t) */
+    uint32_t count;
+    uint32_t checksum;      /* preset_checksum() of the records */
+} preset_bank_header_t;
+
+typedef struct preset_bank_t
+{
+    const preset_t * p_preset;
+    uint32_t count;
+    void * p_map;           /* Native: the mapped or read file, else NULL */
+    size_t map_size;
+    void * p_file;          /* Native without mmap: the FILE stored into */
+} preset_bank_t;
+
+// Which effect parameter slot `idx` of preset_t::fx holds, and the
+// reverse (-1 for a parameter presets do not store).
+//
+void preset_fx_param(uint32_t idx, fx_id_t * p_id, fx_param_t * p_param);
+int32_t preset_fx_index(fx_id_t id, fx_param_t param);
+
+// The engine's power-on sound: the defaults of synth_init(), fx_init() and
+// mod_init().
+//
+void preset_init(preset_t * p_preset, const char * p_name);
+
+uint32_t preset_checksum(const preset_t * p_preset, uint32_t count);
+
+// Use the bank image at `p_data` in place (flash, or any memory that
+// outlives the bank). Fails on a bad header, size or checksum.
+//
+uint8_t preset_bank_open(preset_bank_t * p_bank, const void * p_data,
+                         size_t size);
+
+// The bank built into the firmware, in flash.
+//
+void preset_bank_factory(preset_bank_t * p_bank);
+
+// Native: map the bank file, made from the factory bank when missing, and
+// write one record back into it. Firmware: preset_bank_map() falls back
+// to the factory bank and preset_bank_store() fails.
+//
+uint8_t preset_bank_map(preset_bank_t * p_bank, const char * p_path);
+void preset_bank_unmap(preset_bank_t * p_bank);
+uint8_t preset_bank_store(preset_bank_t * p_bank, uint32_t idx,
+                          const preset_t * p_preset);
+
+// Slot after `idx` holding a preset, wrapping; `idx` itself if none.
+//
+uint32_t preset_bank_next(const preset_bank_t * p_bank, uint32_t idx);
+
+#endif /* PRESET_H */
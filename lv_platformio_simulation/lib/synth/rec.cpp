@@ -0,0 +1,231 @@
+#include "rec.h"
+#include "dlog.h"
+#include <new>
+#include <string.h>
+#if REC_FILES
+#   include <chrono>
+#endif
+
+#define REC_WAV_HEADER      (44U)
+
+#if REC_FILES
+static void
+put_le (uint8_t * p_dst, uint32_t value, uint32_t bytes)
+{
+    for (uint32_t idx = 0; idx < bytes; ++idx)
+    {
+        p_dst[idx] = (uint8_t) (value >> (8 * idx));
+    }
+}   /* put_le() */
+
+static void
+wav_header (uint8_t * p_hdr, uint32_t sample_rate, uint64_t frames)
+{
+    uint32_t data = (uint32_t) ((frames * 4U > 0xFFFFFFFFULL - 36U)
+                                ? 0xFFFFFFFFULL - 36U : frames * 4U);
+
+    memcpy(p_hdr, "RIFF", 4);
+    put_le(p_hdr + 4, data + 36U, 4);
+    memcpy(p_hdr + 8, "WAVEfmt ", 8);
+    put_le(p_hdr + 16, 16, 4);              /* fmt chunk size */
+    put_le(p_hdr + 20, 1, 2);               /* PCM */
+    put_le(p_hdr + 22, 2, 2);               /* Channels */
+    put_le(p_hdr + 24, sample_rate, 4);
+    put_le(p_hdr + 28, sample_rate * 4U, 4);
+    put_le(p_hdr + 32, 4, 2);               /* Block align */
+    put_le(p_hdr + 34, 16, 2);              /* Bits per sample */
+    memcpy(p_hdr + 36, "data", 4);
+    put_le(p_hdr + 40, data, 4);
+}   /* wav_header() */
+
+static void
+rec_writer (rec_t * p_rec)
+{
+    uint32_t reported = 0;
+
+    for (;;)
+    {
+        uint32_t tail = p_rec->tail.load(std::memory_order_relaxed);
+        uint32_t head = p_rec->head.load(std::memory_order_acquire);
+        uint32_t avail = head - tail;
+        uint32_t dropped = p_rec->dropped.load(std::memory_order_relaxed);
+        uint8_t b_stop = p_rec->b_stop.load(std::memory_order_acquire);
+
+        p_rec->peak = (avail > p_rec->peak) ? avail : p_rec->peak;
+
+        if (dropped != reported)
+        {
+            DLOG("rec: writer behind, %u frames dropped\n", dropped);
+            reported = dropped;
+        }
+
+        // Whole chunks only, unless draining: the disk sees few, large,
+        // sequential writes.
+        //
+        if ((avail >= REC_CHUNK_FRAMES) || (b_stop && (avail > 0)))
+        {
+            uint32_t pos = tail & (REC_RING_FRAMES - 1);
+            uint32_t count = (avail > REC_CHUNK_FRAMES) ? REC_CHUNK_FRAMES
+                                                        : avail;
+
+            count = (count > REC_RING_FRAMES - pos) ? REC_RING_FRAMES - pos
+                                                     : count;
+            fwrite(&p_rec->p_ring[2 * pos], 4, count, p_rec->p_file);
+            p_rec->written += count;
+            p_rec->tail.store(tail + count, std::memory_order_release);
+        }
+        else if (b_stop)
+        {
+            break;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(REC_POLL_MS));
+        }
+    }
+
+    uint8_t hdr[REC_WAV_HEADER];
+
+    wav_header(hdr, p_rec->sample_rate, p_rec->written);
+    fseek(p_rec->p_file, 0, SEEK_SET);
+    fwrite(hdr, 1, sizeof(hdr), p_rec->p_file);
+    fclose(p_rec->p_file);
+    p_rec->p_file = NULL;
+
+    DLOG("rec: take %u closed, %u frames, %u dropped, ring peak %u%%\n",
+         p_rec->take - 1, (uint32_t) p_rec->written,
+         p_rec->dropped.load(std::memory_order_relaxed),
+         p_rec->peak * 100U / REC_RING_FRAMES);
+}   /* rec_writer() */
+#endif
+
+rec_t *
+rec_create (void * p_mem, int16_t * p_ring, uint32_t sample_rate)
+{
+    rec_t * p_rec = NULL;
+
+    if ((NULL == p_mem) || (NULL == p_ring))
+    {
+        return (NULL);
+    }
+
+    p_rec = new (p_mem) rec_t();
+    p_rec->p_ring = p_ring;
+    p_rec->sample_rate = sample_rate;
+    p_rec->head.store(0);
+    p_rec->tail.store(0);
+    p_rec->b_armed.store(0);
+    p_rec->b_stop.store(0);
+    p_rec->dropped.store(0);
+    p_rec->peak = 0;
+    p_rec->written = 0;
+    p_rec->take = 0;
+#if REC_FILES
+    p_rec->p_file = NULL;
+#endif
+
+    return (p_rec);
+}   /* rec_create() */
+
+uint8_t
+rec_start (rec_t * p_rec)
+{
+#if REC_FILES
+    char path[32];
+    uint8_t hdr[REC_WAV_HEADER];
+
+    // The previous take may still be draining: wait for its writer.
+    //
+    rec_stop(p_rec);
+
+    if (p_rec->writer.joinable())
+    {
+        p_rec->writer.join();
+    }
+
+    snprintf(path, sizeof(path), "rec_%03u.wav", (unsigned) p_rec->take);
+    p_rec->p_file = fopen(path, "wb");
+
+    if (NULL == p_rec->p_file)
+    {
+        DLOG("rec: cannot open take %u\n", p_rec->take);
+        return (0);
+    }
+
+    // Chunks are already large: no stdio buffer copy in between.
+    //
+    setvbuf(p_rec->p_file, NULL, _IONBF, 0);
+    wav_header(hdr, p_rec->sample_rate, 0);
+    fwrite(hdr, 1, sizeof(hdr), p_rec->p_file);
+
+    ++p_rec->take;
+    p_rec->written = 0;
+    p_rec->peak = 0;
+    p_rec->dropped.store(0, std::memory_order_relaxed);
+    p_rec->tail.store(p_rec->head.load(std::memory_order_acquire),
+                      std::memory_order_relaxed);
+    p_rec->b_stop.store(0, std::memory_order_relaxed);
+    p_rec->writer = std::thread(rec_writer, p_rec);
+    p_rec->b_armed.store(1, std::memory_order_release);
+    DLOG("rec: recording take %u\n", p_rec->take - 1);
+
+    return (1);
+#else
+    (void) p_rec;
+
+    return (0);
+#endif
+}   /* rec_start() */
+
+void
+rec_stop (rec_t * p_rec)
+{
+    p_rec->b_armed.store(0, std::memory_order_release);
+    p_rec->b_stop.store(1, std::memory_order_release);
+}   /* rec_stop() */
+
+uint8_t
+rec_is_armed (const rec_t * p_rec)
+{
+    return (p_rec->b_armed.load(std::memory_order_relaxed));
+}   /* rec_is_armed() */
+
+void
+rec_get_stats (const rec_t * p_rec, rec_stats_t * p_stats)
+{
+    p_stats->written = p_rec->written;
+    p_stats->dropped = p_rec->dropped.load(std::memory_order_relaxed);
+    p_stats->peak_pct = p_rec->peak * 100U / REC_RING_FRAMES;
+}   /* rec_get_stats() */
+
+void
+rec_write (rec_t * p_rec, const int16_t * p_in, uint32_t frames)
+{
+    uint32_t head = 0;
+    uint32_t room = 0;
+
+    if (!p_rec->b_armed.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    head = p_rec->head.load(std::memory_order_relaxed);
+    room = REC_RING_FRAMES - (head - p_rec->tail.load(
+                                            std::memory_order_acquire));
+
+    if (frames > room)
+    {
+        p_rec->dropped.fetch_add(frames - room, std::memory_order_relaxed);
+        frames = room;
+    }
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        uint32_t pos = (head + idx) & (REC_RING_FRAMES - 1);
+
+        p_rec->p_ring[2 * pos] = p_in[2 * idx];
+        p_rec->p_ring[2 * pos + 1] = p_in[2 * idx + 1];
+    }
+
+    p_rec->head.store(head + frames, std::memory_order_release);
+}   /* rec_write() */
@@ -0,0 +1,69 @@
+#ifndef REC_H
+
+#   define REC_H
+#   include <stdint.h>
+#   include <atomic>
+
+// Recorder: the audio thread copies the master output into a lock-free
+// ring, a writer thread empties it to a 16-bit stereo WAV file in large
+// sequential writes. A full ring drops frames (and counts them) rather
+// than making the audio thread wait for the disk.
+//
+// Files exist only on native; on firmware rec_start() fails.
+//
+#   if !defined(STM32F429xx) && !defined(ESP_PLATFORM)
+#       define REC_FILES        (1)
+#       include <stdio.h>
+#       include <thread>
+#   else
+#       define REC_FILES        (0)
+#   endif
+
+#   define REC_RING_FRAMES      (1U << 18)  /* 5.4 s at 48 kHz, power of two */
+#   define REC_CHUNK_FRAMES     (16384U)    /* 64 KB per write */
+#   define REC_POLL_MS          (20)
+
+typedef struct rec_stats_t
+{
+    uint64_t written;       /* Frames on disk */
+    uint32_t dropped;       /* Frames lost because the ring was full */
+    uint32_t peak_pct;      /* Highest ring fill seen by the writer */
+} rec_stats_t;
+
+typedef struct rec_t
+{
+    int16_t * p_ring;       /* Interleaved stereo, REC_RING_FRAMES frames */
+    uint32_t sample_rate;
+    std::atomic<uint32_t> head;     /* Audio side */
+    std::atomic<uint32_t> tail;     /* Writer side */
+    std::atomic<uint8_t> b_armed;
+    std::atomic<uint8_t> b_stop;
+    std::atomic<uint32_t> dropped;
+    uint32_t peak;
+    uint64_t written;
+    uint32_t take;          /* Number of the next file */
+#   if REC_FILES
+    FILE * p_file;
+    std::thread writer;
+#   endif
+} rec_t;
+
+// `p_ring` holds REC_RING_FRAMES stereo frames. `p_rec` must come from
+// rec_create() or be constructed (it holds a thread).
+//
+rec_t * rec_create(void * p_mem, int16_t * p_ring, uint32_t sample_rate);
+
+// UI side: rec_start() opens rec_NNN.wav in the working directory and
+// arms the recorder; rec_stop() disarms it and lets the writer drain the
+// ring, fix the header and close the file in the background.
+//
+uint8_t rec_start(rec_t * p_rec);
+void rec_stop(rec_t * p_rec);
+uint8_t rec_is_armed(const rec_t * p_rec);
+void rec_get_stats(const rec_t * p_rec, rec_stats_t * p_stats);
+
+// Audio side.
+//
+void rec_write(rec_t * p_rec, const int16_t * p_in, uint32_t frames);
+
+#endif /* REC_H */
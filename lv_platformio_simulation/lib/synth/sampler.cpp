@@ -0,0 +1,639 @@
+#include "sampler.h"
+#include <string.h>
+#include <math.h>
+#include <new>
+#if SAMPLER_FILES
+#   include <stdio.h>
+#   include <stdlib.h>
+#   include <chrono>
+#   if !defined(_WIN32)
+#       include <fcntl.h>
+#       include <sys/mman.h>
+#       include <sys/stat.h>
+#       include <unistd.h>
+#   endif
+#endif
+
+static_assert(sizeof(sampler_zone_t) == 12, "sampler_zone_t layout");
+static_assert(sizeof(sampler_set_header_t) == 16, "set header layout");
+static_assert(0 == (SAMPLER_RING_FRAMES & (SAMPLER_RING_FRAMES - 1)),
+              "SAMPLER_RING_FRAMES must be a power of two");
+static_assert(SAMPLER_NUM_STREAM < 255, "stream numbers are 8-bit");
+
+#define SAMPLER_FILL_BITS   (24)
+#define SAMPLER_FILL_MASK   ((1U << SAMPLER_FILL_BITS) - 1U)
+
+// Synthesized set made when the file is missing: one zone per octave,
+// strings of decaying, slightly stretched partials.
+//
+#define SAMPLER_DEMO_ROOT       (36)
+#define SAMPLER_DEMO_ZONES      (6)
+#define SAMPLER_DEMO_SECONDS    (3)
+#define SAMPLER_DEMO_PARTIALS   (8)
+#define SAMPLER_DEMO_RATE       (48000)
+#define SAMPLER_PI              (3.14159265358979)
+
+static uint8_t
+read_memory (void * p_ctx, uint32_t frame, int16_t * p_dst, uint32_t frames)
+{
+    const sampler_set_t * p_set = (const sampler_set_t *) p_ctx;
+
+    memcpy(p_dst, &p_set->p_data[frame], frames * sizeof(int16_t));
+
+    return (1);
+}   /* read_memory() */
+
+static inline uint32_t
+attack_frames (const sampler_zone_t * p_zone)
+{
+    return ((p_zone->length < SAMPLER_ATTACK_FRAMES) ? p_zone->length
+                                                     : SAMPLER_ATTACK_FRAMES);
+}   /* attack_frames() */
+
+uint8_t
+sampler_set_open (sampler_set_t * p_set, const void * p_data, size_t size)
+{
+    const sampler_set_header_t * p_hdr = (const sampler_set_header_t *) p_data;
+    const sampler_zone_t * p_zone = (const sampler_zone_t *) (p_hdr + 1);
+    size_t frames = 0;
+
+    if ((NULL == p_data) || (size < sizeof(*p_hdr))
+        || (SAMPLER_MAGIC != p_hdr->magic)
+        || (SAMPLER_VERSION != p_hdr->version) || (0 == p_hdr->num_zone)
+        || (0 == p_hdr->sample_rate)
+        || (p_hdr->data_offset < sizeof(*p_hdr)
+                                 + p_hdr->num_zone * sizeof(sampler_zone_t))
+        || (0 != (p_hdr->data_offset % sizeof(int16_t)))
+        || (size < p_hdr->data_offset))
+    {
+        return (0);
+    }
+
+    frames = (size - p_hdr->data_offset) / sizeof(int16_t);
+
+    for (uint32_t idx = 0; idx < p_hdr->num_zone; ++idx)
+    {
+        if ((p_zone[idx].lo > p_zone[idx].hi) || (p_zone[idx].length < 2)
+            || (p_zone[idx].length > SAMPLER_MAX_FRAMES)
+            || (p_zone[idx].start > frames)
+            || (p_zone[idx].length > frames - p_zone[idx].start))
+        {
+            return (0);
+        }
+    }
+
+    p_set->p_zone = p_zone;
+    p_set->num_zone = p_hdr->num_zone;
+    p_set->sample_rate = p_hdr->sample_rate;
+    p_set->p_data = (const int16_t *) ((const uint8_t *) p_data
+                                       + p_hdr->data_offset);
+    p_set->read = read_memory;
+    p_set->p_read_ctx = p_set;
+    p_set->p_map = NULL;
+    p_set->map_size = 0;
+
+    return (1);
+}   /* sampler_set_open() */
+
+#if SAMPLER_FILES
+static uint8_t
+set_create (const char * p_path, uint32_t sample_rate)
+{
+    const uint32_t length = SAMPLER_DEMO_SECONDS * sample_rate;
+    sampler_set_header_t hdr = {SAMPLER_MAGIC, SAMPLER_VERSION,
+                                SAMPLER_DEMO_ZONES, sample_rate,
+                                (uint32_t) (sizeof(sampler_set_header_t)
+                                            + SAMPLER_DEMO_ZONES
+                                              * sizeof(sampler_zone_t))};
+    sampler_zone_t zone[SAMPLER_DEMO_ZONES];
+    int16_t * p_pcm = (int16_t *) malloc(length * sizeof(int16_t));
+    FILE * p_file = NULL;
+    uint8_t b_ok = 0;
+
+    for (uint32_t idx = 0; idx < SAMPLER_DEMO_ZONES; ++idx)
+    {
+        uint8_t root = (uint8_t) (SAMPLER_DEMO_ROOT + 12 * idx);
+
+        zone[idx].lo = (0 == idx) ? 0 : (uint8_t) (root - 6);
+        zone[idx].hi = (SAMPLER_DEMO_ZONES - 1 == idx) ? 127
+                                                       : (uint8_t) (root + 5);
+        zone[idx].root = root;
+        zone[idx].reserved = 0;
+        zone[idx].start = idx * length;
+        zone[idx].length = length;
+    }
+
+    p_file = fopen(p_path, "wb");
+
+    if ((NULL == p_pcm) || (NULL == p_file))
+    {
+        goto done;
+    }
+
+    b_ok = (1 == fwrite(&hdr, sizeof(hdr), 1, p_file))
+           && (1 == fwrite(zone, sizeof(zone), 1, p_file));
+
+    for (uint32_t idx = 0; b_ok && (idx < SAMPLER_DEMO_ZONES); ++idx)
+    {
+        double freq = 440.0 * pow(2.0, (zone[idx].root - 69) / 12.0);
+
+        for (uint32_t frame = 0; frame < length; ++frame)
+        {
+            double t = (double) frame / sample_rate;
+            double sum = 0.0;
+
+            for (uint32_t h = 1; h <= SAMPLER_DEMO_PARTIALS; ++h)
+            {
+                double partial = freq * h * sqrt(1.0 + 0.0004 * h * h);
+
+                if (partial < 0.45 * sample_rate)
+                {
+                    sum += sin(2.0 * SAMPLER_PI * partial * t)
+                           * exp(-t * (0.8 + 0.6 * h)) / h;
+                }
+            }
+
+            sum *= (t < 0.002) ? (t / 0.002) : 1.0;
+            p_pcm[frame] = (int16_t) (sum * 0.35 * 32767.0);
+        }
+
+        b_ok = (length == fwrite(p_pcm, sizeof(int16_t), length, p_file));
+    }
+
+done:
+    if (NULL != p_file)
+    {
+        b_ok = (0 == fclose(p_file)) && b_ok;
+    }
+
+    free(p_pcm);
+
+    return (b_ok);
+}   /* set_create() */
+#endif
+
+uint8_t
+sampler_set_map (sampler_set_t * p_set, const char * p_path)
+{
+#if SAMPLER_FILES
+    void * p_map = NULL;
+    size_t size = 0;
+
+#   if !defined(_WIN32)
+    struct stat st;
+    int fd = open(p_path, O_RDONLY);
+
+    if ((fd < 0) && set_create(p_path, SAMPLER_DEMO_RATE))
+    {
+        fd = open(p_path, O_RDONLY);
+    }
+
+    if ((fd < 0) || (0 != fstat(fd, &st)))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        return (0);
+    }
+
+    // Read-only and demand paged: the pages past the attacks are faulted
+    // in by the prefetcher, never by the audio thread.
+    //
+    size = (size_t) st.st_size;
+    p_map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (MAP_FAILED == p_map)
+    {
+        return (0);
+    }
+#   else
+    // No mmap on MinGW: the whole set is read into memory.
+    //
+    FILE * p_file = fopen(p_path, "rb");
+
+    if ((NULL == p_file) && set_create(p_path, SAMPLER_DEMO_RATE))
+    {
+        p_file = fopen(p_path, "rb");
+    }
+
+    if (NULL == p_file)
+    {
+        return (0);
+    }
+
+    fseek(p_file, 0, SEEK_END);
+    size = (size_t) ftell(p_file);
+    fseek(p_file, 0, SEEK_SET);
+    p_map = malloc(size);
+
+    if ((NULL != p_map) && (1 != fread(p_map, size, 1, p_file)))
+    {
+        free(p_map);
+        p_map = NULL;
+    }
+
+    fclose(p_file);
+
+    if (NULL == p_map)
+    {
+        return (0);
+    }
+#   endif
+
+    if (!sampler_set_open(p_set, p_map, size))
+    {
+        p_set->p_map = p_map;
+        p_set->map_size = size;
+        sampler_set_unmap(p_set);
+
+        return (0);
+    }
+
+    p_set->p_map = p_map;
+    p_set->map_size = size;
+
+    return (1);
+#else
+    (void) p_set;
+    (void) p_path;
+
+    return (0);
+#endif
+}   /* sampler_set_map() */
+
+void
+sampler_set_unmap (sampler_set_t * p_set)
+{
+#if SAMPLER_FILES
+    if (NULL != p_set->p_map)
+    {
+#   if !defined(_WIN32)
+        munmap(p_set->p_map, p_set->map_size);
+#   else
+        free(p_set->p_map);
+#   endif
+    }
+#endif
+
+    memset(p_set, 0, sizeof(*p_set));
+}   /* sampler_set_unmap() */
+
+sampler_t *
+sampler_create (void * p_mem, mem_arena_t * p_arena,
+                const sampler_set_t * p_set, uint32_t sample_rate)
+{
+    sampler_t * p_sampler = NULL;
+
+    if (NULL == p_mem)
+    {
+        return (NULL);
+    }
+
+    p_sampler = new (p_mem) sampler_t();
+    p_sampler->p_set = p_set;
+    p_sampler->sample_rate = sample_rate;
+    p_sampler->p_attack = (int16_t *) mem_arena_alloc(p_arena,
+                            p_set->num_zone * SAMPLER_ATTACK_FRAMES
+                            * sizeof(int16_t));
+
+    if (NULL == p_sampler->p_attack)
+    {
+        return (NULL);
+    }
+
+    for (uint32_t idx = 0; idx < p_set->num_zone; ++idx)
+    {
+        const sampler_zone_t * p_zone = &p_set->p_zone[idx];
+
+        if (!p_set->read(p_set->p_read_ctx, p_zone->start,
+                         &p_sampler->p_attack[idx * SAMPLER_ATTACK_FRAMES],
+                         attack_frames(p_zone)))
+        {
+            return (NULL);
+        }
+    }
+
+    for (uint32_t idx = 0; idx < SAMPLER_NUM_STREAM; ++idx)
+    {
+        sampler_stream_t * p_stream = &p_sampler->stream[idx];
+
+        p_stream->p_ring = (int16_t *) mem_arena_alloc(p_arena,
+                                SAMPLER_RING_FRAMES * sizeof(int16_t));
+
+        if (NULL == p_stream->p_ring)
+        {
+            return (NULL);
+        }
+
+        p_stream->p_zone.store(NULL);
+        p_stream->gen.store(0);
+        p_stream->read.store(0);
+        p_stream->fill.store(0);
+        p_stream->b_busy = 0;
+        p_stream->seen_gen = 0;
+        p_stream->p_fill_zone = NULL;
+        p_stream->filled = 0;
+    }
+
+    p_sampler->underruns.store(0);
+    p_sampler->underrun_frames.store(0);
+    p_sampler->no_stream = 0;
+    p_sampler->streamed.store(0);
+    p_sampler->b_stop.store(0);
+
+    return (p_sampler);
+}   /* sampler_create() */
+
+uint32_t
+sampler_prefetch (sampler_t * p_sampler)
+{
+    const sampler_set_t * p_set = p_sampler->p_set;
+    uint32_t total = 0;
+
+    for (uint32_t idx = 0; idx < SAMPLER_NUM_STREAM; ++idx)
+    {
+        sampler_stream_t * p_stream = &p_sampler->stream[idx];
+        uint32_t gen = p_stream->gen.load(std::memory_order_acquire);
+        const sampler_zone_t * p_zone = NULL;
+        uint32_t attack = 0;
+        uint32_t count = 0;
+        uint32_t space = 0;
+
+        // A new start: the old ring content is dropped, `read` was reset
+        // before `gen` moved.
+        //
+        if (gen != p_stream->seen_gen)
+        {
+            p_stream->seen_gen = gen;
+            p_stream->p_fill_zone = p_stream->p_zone.load(
+                                                std::memory_order_relaxed);
+            p_stream->filled = 0;
+        }
+
+        p_zone = p_stream->p_fill_zone;
+
+        if (NULL == p_zone)
+        {
+            continue;
+        }
+
+        attack = attack_frames(p_zone);
+        count = p_zone->length - attack - p_stream->filled;
+        space = SAMPLER_RING_FRAMES
+                - (p_stream->filled
+                   - p_stream->read.load(std::memory_order_acquire));
+        count = (count < space) ? count : space;
+        count = (count < SAMPLER_CHUNK_FRAMES) ? count : SAMPLER_CHUNK_FRAMES;
+
+        // At most two pieces, around the end of the ring.
+        //
+        for (uint32_t done = 0; done < count;)
+        {
+            uint32_t at = (p_stream->filled + done) & (SAMPLER_RING_FRAMES - 1);
+            uint32_t piece = SAMPLER_RING_FRAMES - at;
+
+            piece = (piece < count - done) ? piece : (count - done);
+
+            if (!p_set->read(p_set->p_read_ctx,
+                             p_zone->start + attack + p_stream->filled + done,
+                             &p_stream->p_ring[at], piece))
+            {
+                count = done;
+                break;
+            }
+
+            done += piece;
+        }
+
+        if (0 != count)
+        {
+            p_stream->filled += count;
+            p_stream->fill.store(((gen & 0xFFU) << SAMPLER_FILL_BITS)
+                                 | p_stream->filled,
+                                 std::memory_order_release);
+            total += count;
+        }
+    }
+
+    p_sampler->streamed.fetch_add(total, std::memory_order_relaxed);
+
+    return (total);
+}   /* sampler_prefetch() */
+
+#if SAMPLER_FILES
+static void
+prefetcher (sampler_t * p_sampler)
+{
+    while (!p_sampler->b_stop.load(std::memory_order_relaxed))
+    {
+        // Keep going while there is work, rest once every ring is full.
+        //
+        if (0 == sampler_prefetch(p_sampler))
+        {
+            std::this_thread::sleep_for(
+                                std::chrono::milliseconds(SAMPLER_POLL_MS));
+        }
+    }
+}   /* prefetcher() */
+#endif
+
+uint8_t
+sampler_start (sampler_t * p_sampler)
+{
+#if SAMPLER_FILES
+    if (p_sampler->prefetcher.joinable())
+    {
+        return (1);
+    }
+
+    p_sampler->b_stop.store(0);
+    p_sampler->prefetcher = std::thread(prefetcher, p_sampler);
+
+    return (1);
+#else
+    (void) p_sampler;
+
+    return (0);
+#endif
+}   /* sampler_start() */
+
+void
+sampler_stop (sampler_t * p_sampler)
+{
+#if SAMPLER_FILES
+    if (p_sampler->prefetcher.joinable())
+    {
+        p_sampler->b_stop.store(1);
+        p_sampler->prefetcher.join();
+    }
+#else
+    (void) p_sampler;
+#endif
+}   /* sampler_stop() */
+
+void
+sampler_get_stats (const sampler_t * p_sampler, sampler_stats_t * p_stats)
+{
+    p_stats->active = 0;
+
+    for (uint32_t idx = 0; idx < SAMPLER_NUM_STREAM; ++idx)
+    {
+        p_stats->active += p_sampler->stream[idx].b_busy;
+    }
+
+    p_stats->underruns = p_sampler->underruns.load(std::memory_order_relaxed);
+    p_stats->underrun_frames = p_sampler->underrun_frames.load(
+                                                std::memory_order_relaxed);
+    p_stats->no_stream = p_sampler->no_stream;
+    p_stats->streamed = p_sampler->streamed.load(std::memory_order_relaxed);
+}   /* sampler_get_stats() */
+
+uint8_t
+sampler_voice_start (sampler_t * p_sampler, sampler_voice_t * p_voice,
+                     uint8_t note)
+{
+    const sampler_set_t * p_set = p_sampler->p_set;
+    const sampler_zone_t * p_zone = NULL;
+    sampler_stream_t * p_stream = NULL;
+    uint32_t zone = 0;
+
+    for (zone = 0; zone < p_set->num_zone; ++zone)
+    {
+        if ((note >= p_set->p_zone[zone].lo) && (note <= p_set->p_zone[zone].hi))
+        {
+            p_zone = &p_set->p_zone[zone];
+            break;
+        }
+    }
+
+    if (NULL == p_zone)
+    {
+        return (0);
+    }
+
+    // A retrigger restarts the voice's own stream.
+    //
+    if (0 == p_voice->stream)
+    {
+        for (uint32_t idx = 0; idx < SAMPLER_NUM_STREAM; ++idx)
+        {
+            if (!p_sampler->stream[idx].b_busy)
+            {
+                p_voice->stream = (uint8_t) (idx + 1);
+                break;
+            }
+        }
+    }
+
+    if (0 == p_voice->stream)
+    {
+        ++p_sampler->no_stream;
+        return (0);
+    }
+
+    p_stream = &p_sampler->stream[p_voice->stream - 1];
+    p_stream->b_busy = 1;
+    p_stream->p_zone.store(p_zone, std::memory_order_relaxed);
+    p_stream->read.store(0, std::memory_order_relaxed);
+    p_stream->gen.fetch_add(1, std::memory_order_release);
+
+    p_voice->p_zone = p_zone;
+    p_voice->p_attack = &p_sampler->p_attack[zone * SAMPLER_ATTACK_FRAMES];
+    p_voice->pos = 0;
+    p_voice->inc = (uint64_t) (exp2((note - p_zone->root) / 12.0)
+                               * p_set->sample_rate / p_sampler->sample_rate
+                               * 4294967296.0);
+    p_voice->note_inc = p_voice->inc;
+
+    return (1);
+}   /* sampler_voice_start() */
+
+uint8_t
+sampler_voice_render (sampler_t * p_sampler, sampler_voice_t * p_voice,
+                      float * p_out, uint32_t frames)
+{
+    sampler_stream_t * p_stream = &p_sampler->stream[p_voice->stream - 1];
+    const sampler_zone_t * p_zone = p_voice->p_zone;
+    const int16_t * p_attack = p_voice->p_attack;
+    const int16_t * p_ring = p_stream->p_ring;
+    const uint32_t attack = attack_frames(p_zone);
+    uint32_t gen = p_stream->gen.load(std::memory_order_relaxed);
+    uint32_t fill = p_stream->fill.load(std::memory_order_acquire);
+    uint32_t avail = attack;
+    uint64_t pos = p_voice->pos;
+    uint8_t b_more = 1;
+    uint32_t idx = 0;
+
+    if ((fill >> SAMPLER_FILL_BITS) == (gen & 0xFFU))
+    {
+        avail += fill & SAMPLER_FILL_MASK;
+    }
+
+    for (idx = 0; idx < frames; ++idx)
+    {
+        uint32_t frame = (uint32_t) (pos >> 32);
+        float frac = (float) (uint32_t) pos * (1.0f / 4294967296.0f);
+        float a = 0.0f;
+        float b = 0.0f;
+
+        if (frame + 1 >= p_zone->length)
+        {
+            b_more = 0;
+            break;
+        }
+
+        if (frame + 1 >= avail)
+        {
+            p_sampler->underruns.fetch_add(1, std::memory_order_relaxed);
+            p_sampler->underrun_frames.fetch_add(frames - idx,
+                                                 std::memory_order_relaxed);
+            break;
+        }
+
+        a = (frame < attack) ? p_attack[frame]
+                             : p_ring[(frame - attack) & (SAMPLER_RING_FRAMES - 1)];
+        b = (frame + 1 < attack) ? p_attack[frame + 1]
+                                 : p_ring[(frame + 1 - attack)
+                                          & (SAMPLER_RING_FRAMES - 1)];
+        p_out[idx] = (a + (b - a) * frac) * (1.0f / 32768.0f);
+        pos += p_voice->inc;
+    }
+
+    // Silence for what could not be played; the position holds, so a
+    // late stream resumes where it stopped.
+    //
+    for (; idx < frames; ++idx)
+    {
+        p_out[idx] = 0.0f;
+    }
+
+    p_voice->pos = pos;
+
+    if ((uint32_t) (pos >> 32) > attack)
+    {
+        p_stream->read.store((uint32_t) (pos >> 32) - attack,
+                             std::memory_order_release);
+    }
+
+    return (b_more);
+}   /* sampler_voice_render() */
+
+void
+sampler_voice_stop (sampler_t * p_sampler, sampler_voice_t * p_voice)
+{
+    sampler_stream_t * p_stream = NULL;
+
+    if (0 == p_voice->stream)
+    {
+        return;
+    }
+
+    p_stream = &p_sampler->stream[p_voice->stream - 1];
+    p_stream->p_zone.store(NULL, std::memory_order_relaxed);
+    p_stream->gen.fetch_add(1, std::memory_order_release);
+    p_stream->b_busy = 0;
+    p_voice->stream = 0;
+}   /* sampler_voice_stop() */
@@ -0,0 +1,190 @@
+#ifndef SAMPLER_H
+
+#   define SAMPLER_H
+#   include <stdint.h>
+#   include <stddef.h>
+#   include <atomic>
+#   include "mem.h"
+
+// Sampled instrument: a set of mono 16-bit multisamples (zones, one per
+// key range), far larger than RAM. Only the attack of each zone is copied
+// into RAM; the rest streams from the set image into a ring per voice,
+// kept ahead of the playback position by a prefetch thread (native) or
+// a timer on the UI loop (firmware). The audio side never waits and never
+// touches the image: a voice that catches up with its ring plays silence
+// and counts an underrun until the data arrives.
+//
+// Set image: header, zone table, then the sample data. Little-endian,
+// fixed layout, used in place like a preset bank.
+//
+#   if !defined(STM32F429xx) && !defined(ESP_PLATFORM)
+#       define SAMPLER_FILES        (1)
+#       include <thread>
+#   else
+#       define SAMPLER_FILES        (0)
+#   endif
+
+#   define SAMPLER_MAGIC        (0x4C504D53U)   /* "SMPL" */
+#   define SAMPLER_VERSION      (1)
+#   ifndef SAMPLER_NUM_STREAM
+#       define SAMPLER_NUM_STREAM   (16)    /* Streamed voices at once */
+#   endif
+#   ifndef SAMPLER_ATTACK_FRAMES
+#       define SAMPLER_ATTACK_FRAMES (4096U)   /* Preloaded per zone */
+#   endif
+#   ifndef SAMPLER_RING_FRAMES
+#       define SAMPLER_RING_FRAMES  (8192U)    /* Per stream, power of two */
+#   endif
+#   define SAMPLER_CHUNK_FRAMES     (2048U)    /* Largest copy per stream, pass */
+#   define SAMPLER_POLL_MS          (2)
+#   define SAMPLER_MAX_FRAMES       ((1U << 24) + SAMPLER_ATTACK_FRAMES)
+#   ifndef SAMPLER_SET_PATH
+#       define SAMPLER_SET_PATH     "samples.bin"
+#   endif
+
+typedef struct sampler_zone_t
+{
+    uint8_t lo;             /* MIDI notes, inclusive */
+    uint8_t hi;
+    uint8_t root;           /* Note recorded */
+    uint8_t reserved;
+    uint32_t start;         /* Frames into the sample data */
+    uint32_t length;        /* Frames */
+} sampler_zone_t;
+
+typedef struct sampler_set_header_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t num_zone;
+    uint32_t sample_rate;
+    uint32_t data_offset;   /* Bytes from the start of the image */
+} sampler_set_header_t;
+
+// Copy `frames` frames from `frame` of the sample data. The default reads
+// the image in memory (mapped file, flash); a board streaming from SD sets
+// its own before sampler_create().
+//
+typedef uint8_t (*sampler_read_fn_t)(void * p_ctx, uint32_t frame,
+                                     int16_t * p_dst, uint32_t frames);
+
+typedef struct sampler_set_t
+{
+    const sampler_zone_t * p_zone;
+    uint32_t num_zone;
+    uint32_t sample_rate;
+    const int16_t * p_data;
+    sampler_read_fn_t read;
+    void * p_read_ctx;
+    void * p_map;           /* Native: the mapped file, else NULL */
+    size_t map_size;
+} sampler_set_t;
+
+// One per streamed voice. The audio side claims it and publishes a start
+// by bumping `gen`; the prefetcher notices, refills from the zone start
+// and publishes what it has as gen:8 | frames:24 in `fill`.
+//
+typedef struct sampler_stream_t
+{
+    int16_t * p_ring;
+    std::atomic<const sampler_zone_t *> p_zone;     /* Audio side */
+    std::atomic<uint32_t> gen;                      /* Audio side */
+    std::atomic<uint32_t> read;     /* Audio side: first frame still needed */
+    std::atomic<uint32_t> fill;     /* Prefetch side */
+    uint8_t b_busy;                 /* Audio side */
+    uint32_t seen_gen;              /* Prefetch side from here */
+    const sampler_zone_t * p_fill_zone;
+    uint32_t filled;
+} sampler_stream_t;
+
+// Playback state, inside the synth voice.
+//
+typedef struct sampler_voice_t
+{
+    uint8_t stream;         /* 1 + stream index, 0: not a sample voice */
+    const sampler_zone_t * p_zone;
+    const int16_t * p_attack;
+    uint64_t pos;           /* Frames, 32.32 */
+    uint64_t inc;
+    uint64_t note_inc;      /* inc at the note's own pitch */
+} sampler_voice_t;
+
+typedef struct sampler_stats_t
+{
+    uint32_t active;        /* Streams playing */
+    uint32_t underruns;     /* Blocks in which a voice ran dry */
+    uint32_t underrun_frames;
+    uint32_t no_stream;     /* Notes dropped, every stream busy */
+    uint64_t streamed;      /* Frames copied by the prefetcher */
+} sampler_stats_t;
+
+typedef struct sampler_t
+{
+    const sampler_set_t * p_set;
+    uint32_t sample_rate;
+    int16_t * p_attack;     /* SAMPLER_ATTACK_FRAMES per zone */
+    sampler_stream_t stream[SAMPLER_NUM_STREAM];
+    std::atomic<uint32_t> underruns;
+    std::atomic<uint32_t> underrun_frames;
+    uint32_t no_stream;
+    std::atomic<uint64_t> streamed;
+    std::atomic<uint8_t> b_stop;
+#   if SAMPLER_FILES
+    std::thread prefetcher;
+#   endif
+} sampler_t;
+
+typedef struct sampler_bench_t
+{
+    float render_ns;        /* One voice, one SYNTH_BLOCK_SIZE block */
+    float stream_mb_s;      /* Prefetch copy rate from the set */
+    uint32_t max_voice;     /* Fewest of the CPU and the streaming limits */
+    uint32_t underruns;     /* Real-time run with every stream playing */
+} sampler_bench_t;
+
+// Use the set image at `p_data` in place. Fails on a bad header, zone
+// table or size.
+//
+uint8_t sampler_set_open(sampler_set_t * p_set, const void * p_data,
+                         size_t size);
+
+// Native: map the set file, made from a synthesized piano when missing.
+// Firmware: fails, a board opens its own image.
+//
+uint8_t sampler_set_map(sampler_set_t * p_set, const char * p_path);
+void sampler_set_unmap(sampler_set_t * p_set);
+
+// Preload the attacks and the rings from `p_arena`. `p_mem` holds a
+// sampler_t (it holds a thread). NULL when the arena is too small.
+//
+sampler_t * sampler_create(void * p_mem, mem_arena_t * p_arena,
+                           const sampler_set_t * p_set, uint32_t sample_rate);
+
+// Native: run the prefetcher on its own thread. Elsewhere call
+// sampler_prefetch() every few ms from a lower priority context than
+// audio; it returns the frames copied.
+//
+uint8_t sampler_start(sampler_t * p_sampler);
+void sampler_stop(sampler_t * p_sampler);
+uint32_t sampler_prefetch(sampler_t * p_sampler);
+
+void sampler_get_stats(const sampler_t * p_sampler, sampler_stats_t * p_stats);
+
+// Audio side. sampler_voice_start() claims a stream (or restarts the
+// voice's own) for `note`, 0 when no zone holds it or every stream is
+// busy. sampler_voice_render() writes `frames` samples, 0 once the sample
+// has ended. sampler_voice_stop() gives the stream back.
+//
+uint8_t sampler_voice_start(sampler_t * p_sampler, sampler_voice_t * p_voice,
+                            uint8_t note);
+uint8_t sampler_voice_render(sampler_t * p_sampler, sampler_voice_t * p_voice,
+                             float * p_out, uint32_t frames);
+void sampler_voice_stop(sampler_t * p_sampler, sampler_voice_t * p_voice);
+
+// Most streamed voices this host keeps up with, `p_set` played at its
+// root notes with the prefetcher on its own thread. Native only.
+//
+uint8_t sampler_bench(const sampler_set_t * p_set, uint32_t num_block,
+                      sampler_bench_t * p_result);
+
+#endif /* SAMPLER_H */
@@ -0,0 +1,158 @@
+#include "sampler.h"
+#include "synth.h"
+#include "perf.h"
+#include <stdlib.h>
+#include <string.h>
+#if SAMPLER_FILES
+#   include <chrono>
+#endif
+
+#if SAMPLER_FILES
+static void
+start_all (sampler_t * p_sampler, sampler_voice_t * p_voice)
+{
+    const sampler_set_t * p_set = p_sampler->p_set;
+
+    // Every zone at its root, so a voice reads the set at its own rate.
+    //
+    for (uint32_t idx = 0; idx < SAMPLER_NUM_STREAM; ++idx)
+    {
+        sampler_voice_start(p_sampler, &p_voice[idx],
+                            p_set->p_zone[idx % p_set->num_zone].root);
+    }
+}   /* start_all() */
+
+static void
+render_all (sampler_t * p_sampler, sampler_voice_t * p_voice, float * p_out)
+{
+    for (uint32_t idx = 0; idx < SAMPLER_NUM_STREAM; ++idx)
+    {
+        if ((0 != p_voice[idx].stream)
+            && !sampler_voice_render(p_sampler, &p_voice[idx], p_out,
+                                     SYNTH_BLOCK_SIZE))
+        {
+            sampler_voice_start(p_sampler, &p_voice[idx],
+                                p_voice[idx].p_zone->root);
+        }
+    }
+}   /* render_all() */
+#endif
+
+uint8_t
+sampler_bench (const sampler_set_t * p_set, uint32_t num_block,
+               sampler_bench_t * p_result)
+{
+#if SAMPLER_FILES
+    static float out[SYNTH_BLOCK_SIZE];
+    static sampler_voice_t voice[SAMPLER_NUM_STREAM];
+    uint32_t arena_size = (p_set->num_zone * SAMPLER_ATTACK_FRAMES
+                           + SAMPLER_NUM_STREAM * SAMPLER_RING_FRAMES)
+                          * sizeof(int16_t) + 1024U;
+    uint64_t deadline_ns = (uint64_t) SYNTH_BLOCK_SIZE * 1000000000ULL
+                           / SYNTH_SAMPLE_RATE;
+    void * p_mem = malloc(arena_size);
+    void * p_obj = malloc(sizeof(sampler_t));
+    sampler_t * p_sampler = NULL;
+    mem_arena_t arena;
+    sampler_stats_t before;
+    sampler_stats_t after;
+    uint64_t bytes = 0;
+    uint64_t ns = 0;
+    uint32_t start = 0;
+    uint32_t cpu_max = 0;
+    uint32_t stream_max = 0;
+    uint8_t ret = 0;
+
+    if ((NULL == p_mem) || (NULL == p_obj) || (0 == num_block))
+    {
+        goto done;
+    }
+
+    perf_init();
+    memset(voice, 0, sizeof(voice));
+    mem_arena_init(&arena, p_mem, arena_size);
+    p_sampler = sampler_create(p_obj, &arena, p_set, SYNTH_SAMPLE_RATE);
+
+    if (NULL == p_sampler)
+    {
+        goto done;
+    }
+
+    // Streaming: every ring filled from cold, as after a chord.
+    //
+    start_all(p_sampler, voice);
+    start = perf_ticks();
+
+    for (uint32_t count = 1; 0 != count;)
+    {
+        count = sampler_prefetch(p_sampler);
+        bytes += count * sizeof(int16_t);
+    }
+
+    ns = perf_ticks_to_ns(perf_ticks() - start);
+    p_result->stream_mb_s = (0 == ns) ? 0.0f
+                                      : (float) bytes * 1000.0f / (float) ns;
+
+    // Render cost with the rings kept full outside the timing.
+    //
+    ns = 0;
+
+    for (uint32_t block = 0; block < num_block; ++block)
+    {
+        start = perf_ticks();
+        render_all(p_sampler, voice, out);
+        ns += perf_ticks_to_ns(perf_ticks() - start);
+        sampler_prefetch(p_sampler);
+    }
+
+    p_result->render_ns = (float) ns / num_block / SAMPLER_NUM_STREAM;
+
+    // Voices the CPU renders inside a block, and the prefetcher feeds.
+    //
+    cpu_max = (p_result->render_ns > 0.0f)
+              ? (uint32_t) (deadline_ns / p_result->render_ns) : 0;
+    stream_max = (uint32_t) (p_result->stream_mb_s * 1e6f
+                             / (p_set->sample_rate * sizeof(int16_t)));
+    p_result->max_voice = (cpu_max < stream_max) ? cpu_max : stream_max;
+
+    // Real time, every stream restarted at once with the prefetch thread
+    // doing the feeding.
+    //
+    for (uint32_t idx = 0; idx < SAMPLER_NUM_STREAM; ++idx)
+    {
+        sampler_voice_stop(p_sampler, &voice[idx]);
+    }
+
+    sampler_get_stats(p_sampler, &before);
+    sampler_start(p_sampler);
+    start_all(p_sampler, voice);
+
+    {
+        auto next = std::chrono::steady_clock::now();
+
+        for (uint32_t block = 0; block < num_block; ++block)
+        {
+            render_all(p_sampler, voice, out);
+            next += std::chrono::nanoseconds(deadline_ns);
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    sampler_stop(p_sampler);
+    sampler_get_stats(p_sampler, &after);
+    p_result->underruns = after.underruns - before.underruns;
+    ret = 1;
+
+done:
+    free(p_mem);
+    free(p_obj);
+
+    return (ret);
+#else
+    (void) p_set;
+    (void) num_block;
+    (void) p_result;
+
+    return (0);
+#endif
+}   /* sampler_bench() */
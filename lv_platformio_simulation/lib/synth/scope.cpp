@@ -0,0 +1,177 @@
+#include "scope.h"
+#include <string.h>
+#include <math.h>
+
+#define SCOPE_FRESH         (0x80U)
+#define SCOPE_INDEX_MASK    (0x03U)
+#define SCOPE_SPAN          (SCOPE_SIZE / 2)    /* Samples shown by the scope */
+
+static_assert(SCOPE_FFT_SIZE <= SCOPE_SIZE, "SCOPE_FFT_SIZE too big");
+static_assert(SCOPE_FFT_SIZE / 2 < 256, "bin edges are uint8_t");
+
+void
+scope_init (scope_t * p_scope)
+{
+    memset(p_scope->buf, 0, sizeof(p_scope->buf));
+    p_scope->back = 0;
+    p_scope->middle.store(1);
+    p_scope->front = 2;
+    p_scope->fill = 0;
+}   /* scope_init() */
+
+void
+scope_write (scope_t * p_scope, const int16_t * p_in, uint32_t frames)
+{
+    while (frames > 0)
+    {
+        int16_t * p_buf = p_scope->buf[p_scope->back];
+        uint32_t count = SCOPE_SIZE - p_scope->fill;
+
+        count = (frames < count) ? frames : count;
+
+        for (uint32_t idx = 0; idx < count; ++idx)
+        {
+            p_buf[p_scope->fill + idx] = (int16_t) (((int32_t) p_in[2 * idx]
+                                                     + p_in[2 * idx + 1]) / 2);
+        }
+
+        p_in += 2 * count;
+        frames -= count;
+        p_scope->fill += count;
+
+        if (SCOPE_SIZE == p_scope->fill)
+        {
+            // Publish the full buffer, take back whichever the UI left.
+            //
+            p_scope->back = p_scope->middle.exchange(p_scope->back
+                                                     | SCOPE_FRESH,
+                                                     std::memory_order_acq_rel)
+                            & SCOPE_INDEX_MASK;
+            p_scope->fill = 0;
+        }
+    }
+}   /* scope_write() */
+
+const int16_t *
+scope_read (scope_t * p_scope)
+{
+    if (0 == (p_scope->middle.load(std::memory_order_relaxed) & SCOPE_FRESH))
+    {
+        return (NULL);
+    }
+
+    p_scope->front = p_scope->middle.exchange(p_scope->front,
+                                              std::memory_order_acq_rel)
+                     & SCOPE_INDEX_MASK;
+
+    return (p_scope->buf[p_scope->front]);
+}   /* scope_read() */
+
+void
+scope_waveform (const int16_t * p_snap, int32_t * p_point)
+{
+    const uint32_t stride = SCOPE_SPAN / SCOPE_POINTS;
+    uint32_t start = 0;
+
+    // Trigger on the first rising zero crossing, so a steady tone stands
+    // still on screen.
+    //
+    for (uint32_t idx = 1; idx < SCOPE_SIZE - SCOPE_SPAN; ++idx)
+    {
+        if ((p_snap[idx - 1] < 0) && (p_snap[idx] >= 0))
+        {
+            start = idx;
+            break;
+        }
+    }
+
+    for (uint32_t point = 0; point < SCOPE_POINTS; ++point)
+    {
+        int32_t value = SCOPE_RANGE / 2
+                        + (int32_t) p_snap[start + point * stride]
+                          * (SCOPE_RANGE / 2) / 32768;
+
+        p_point[point] = value;
+    }
+}   /* scope_waveform() */
+
+uint8_t
+scope_fft_init (scope_fft_t * p_fft)
+{
+    const float half = SCOPE_FFT_SIZE / 2;
+    float gain = 0.0f;
+
+    if (!fft_init(&p_fft->fft, p_fft->twiddle, SCOPE_FFT_SIZE))
+    {
+        return (0);
+    }
+
+    // The window costs trig calls: build it once, not per frame.
+    //
+    for (uint32_t idx = 0; idx < SCOPE_FFT_SIZE; ++idx)
+    {
+        p_fft->window[idx] = 1.0f;
+    }
+
+    fft_window(p_fft->window, SCOPE_FFT_SIZE);
+
+    for (uint32_t idx = 0; idx < SCOPE_FFT_SIZE; ++idx)
+    {
+        gain += p_fft->window[idx];
+    }
+
+    // A full-scale sine peaks at (sum of the window / 2) in magnitude.
+    //
+    p_fft->ref = (gain / 2.0f) * (gain / 2.0f);
+
+    // Bins 1 to SCOPE_FFT_SIZE / 2 on a log axis, at least one per point.
+    //
+    for (uint32_t point = 0; point <= SCOPE_POINTS; ++point)
+    {
+        uint32_t bin = (uint32_t) powf(half, (float) point / SCOPE_POINTS);
+        uint32_t prev = (0 == point) ? 0 : p_fft->bin[point - 1];
+
+        bin = (bin <= prev) ? prev + 1 : bin;
+        p_fft->bin[point] = (uint8_t) ((bin > half) ? half : bin);
+    }
+
+    return (1);
+}   /* scope_fft_init() */
+
+void
+scope_spectrum (scope_fft_t * p_fft, const int16_t * p_snap,
+                int32_t * p_point)
+{
+    for (uint32_t idx = 0; idx < SCOPE_FFT_SIZE; ++idx)
+    {
+        p_fft->re[idx] = (float) p_snap[idx] * (1.0f / 32768.0f)
+                         * p_fft->window[idx];
+        p_fft->im[idx] = 0.0f;
+    }
+
+    fft_forward(&p_fft->fft, p_fft->re, p_fft->im);
+    fft_power(&p_fft->fft, p_fft->re, p_fft->im, p_fft->power);
+
+    for (uint32_t point = 0; point < SCOPE_POINTS; ++point)
+    {
+        uint32_t last = p_fft->bin[point + 1];
+        float peak = 0.0f;
+        float db = SCOPE_FLOOR_DB;
+
+        last = (last > p_fft->bin[point]) ? last : p_fft->bin[point] + 1;
+
+        for (uint32_t bin = p_fft->bin[point]; bin < last; ++bin)
+        {
+            peak = (p_fft->power[bin] > peak) ? p_fft->power[bin] : peak;
+        }
+
+        if (peak > 0.0f)
+        {
+            db = 10.0f * log10f(peak / p_fft->ref);
+            db = (db < SCOPE_FLOOR_DB) ? SCOPE_FLOOR_DB : db;
+            db = (db > 0.0f) ? 0.0f : db;
+        }
+
+        p_point[point] = (int32_t) ((1.0f - db / SCOPE_FLOOR_DB) * SCOPE_RANGE);
+    }
+}   /* scope_spectrum() */
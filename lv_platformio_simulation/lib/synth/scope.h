@@ -0,0 +1,61 @@
+#ifndef SCOPE_H
+
+#   define SCOPE_H
+#   include <stdint.h>
+#   include <atomic>
+#   include "fft.h"
+
+// Snapshot of the latest output for the on-screen scope. The audio thread
+// fills one buffer while the UI reads another; the third is the hand-off,
+// swapped with a single atomic exchange on each side, so neither side
+// ever waits and the UI always gets the newest complete snapshot.
+//
+#   define SCOPE_SIZE       (512)   /* Mono samples per snapshot */
+#   define SCOPE_FFT_SIZE   (256)   /* Power of two, <= SCOPE_SIZE */
+#   define SCOPE_POINTS     (64)    /* Chart points */
+#   define SCOPE_RANGE      (100)   /* Chart values are 0 to SCOPE_RANGE */
+#   define SCOPE_FLOOR_DB   (-80.0f)
+
+typedef struct scope_t
+{
+    int16_t buf[3][SCOPE_SIZE];
+    std::atomic<uint8_t> middle;    /* Index, plus SCOPE_FRESH once written */
+    uint8_t back;                   /* Audio side */
+    uint8_t front;                  /* UI side */
+    uint32_t fill;
+} scope_t;
+
+// Spectrum work area, owned by whoever draws (the UI thread).
+//
+typedef struct scope_fft_t
+{
+    fft_t fft;
+    float twiddle[SCOPE_FFT_SIZE];
+    float window[SCOPE_FFT_SIZE];
+    float re[SCOPE_FFT_SIZE];
+    float im[SCOPE_FFT_SIZE];
+    float power[SCOPE_FFT_SIZE / 2 + 1];
+    uint8_t bin[SCOPE_POINTS + 1];  /* Log-spaced bin edges per point */
+    float ref;                      /* Power of a full-scale sine */
+} scope_fft_t;
+
+void scope_init(scope_t * p_scope);
+
+// Audio side: interleaved stereo, summed to mono.
+//
+void scope_write(scope_t * p_scope, const int16_t * p_in, uint32_t frames);
+
+// UI side: the newest snapshot, or NULL if none arrived since the last
+// call. Valid until the next call.
+//
+const int16_t * scope_read(scope_t * p_scope);
+
+// Snapshot to SCOPE_POINTS chart values: the waveform from its first
+// rising zero crossing, or the spectrum on a log-frequency axis.
+//
+void scope_waveform(const int16_t * p_snap, int32_t * p_point);
+uint8_t scope_fft_init(scope_fft_t * p_fft);
+void scope_spectrum(scope_fft_t * p_fft, const int16_t * p_snap,
+                    int32_t * p_point);
+
+#endif /* SCOPE_H */
@@ -0,0 +1,340 @@
+#include "seq.h"
+#include <string.h>
+
+#define SEQ_FRESH           (0x80U)
+#define SEQ_INDEX_MASK      (0x03U)
+
+// Unswung start of `step`: integer maths from the tempo origin, so the
+// grid never drifts however long it runs.
+//
+static uint64_t
+step_grid (const seq_t * p_seq, uint32_t step)
+{
+    return (p_seq->origin + (uint64_t) (step - p_seq->origin_step)
+                            * p_seq->sample_rate * 15U / p_seq->bpm);
+}   /* step_grid() */
+
+static uint64_t
+step_time (const seq_t * p_seq, const seq_pattern_t * p_pat, uint32_t step)
+{
+    // Swing in the same division, so a swung step is rounded once.
+    //
+    uint64_t num = (uint64_t) (step - p_seq->origin_step) * 50U
+                   + ((step & 1U) ? p_pat->swing_pct - 50U : 0U);
+
+    return (p_seq->origin + num * p_seq->sample_rate * 15U
+                            / ((uint64_t) p_seq->bpm * 50U));
+}   /* step_time() */
+
+static uint8_t
+arp_note (const seq_pattern_t * p_pat, uint32_t step)
+{
+    uint8_t note[128];
+    uint32_t num_held = 0;
+    uint32_t num = 0;
+    uint32_t pos = 0;
+
+    for (uint32_t idx = 0; idx < 128; ++idx)
+    {
+        if (p_pat->held[idx >> 5] & (1UL << (idx & 31U)))
+        {
+            note[num_held++] = (uint8_t) idx;
+        }
+    }
+
+    if (0 == num_held)
+    {
+        return (SEQ_REST);
+    }
+
+    num = num_held * p_pat->octaves;
+
+    switch (p_pat->arp)
+    {
+        case SEQ_ARP_DOWN:
+            pos = num - 1 - step % num;
+        break;
+
+        case SEQ_ARP_UPDOWN:
+            // Ends are not repeated: 0 1 2 1 0 1 2 ...
+            //
+            pos = (num > 1) ? step % (2 * num - 2) : 0;
+            pos = (pos >= num) ? 2 * num - 2 - pos : pos;
+        break;
+
+        default:
+            pos = step % num;
+        break;
+    }
+
+    pos = note[pos % num_held] + 12U * (pos / num_held);
+
+    return ((pos > 127) ? SEQ_REST : (uint8_t) pos);
+}   /* arp_note() */
+
+// Starts `note` on every layer whose zone holds it, remembering where it
+// went: the note off closes the same voices whatever the pattern says by
+// then.
+//
+static void
+seq_note_on (seq_t * p_seq, const seq_pattern_t * p_pat, uint8_t note,
+             uint8_t velocity, seq_emit_t emit, void * p_ctx)
+{
+    p_seq->num_off = 0;
+
+    for (uint32_t idx = 0; idx < p_pat->num_layer; ++idx)
+    {
+        const seq_layer_t * p_layer = &p_pat->layer[idx];
+        int32_t layer_note = (int32_t) note + p_layer->transpose;
+
+        if ((note < p_layer->zone_lo) || (note > p_layer->zone_hi)
+            || (layer_note < 0) || (layer_note > 127))
+        {
+            continue;
+        }
+
+        emit(p_ctx, p_layer->part, (uint8_t) layer_note, velocity);
+        p_seq->off_part[p_seq->num_off] = p_layer->part;
+        p_seq->off_note[p_seq->num_off] = (uint8_t) layer_note;
+        ++p_seq->num_off;
+    }
+}   /* seq_note_on() */
+
+static void
+seq_note_off (seq_t * p_seq, seq_emit_t emit, void * p_ctx)
+{
+    for (uint32_t idx = 0; idx < p_seq->num_off; ++idx)
+    {
+        emit(p_ctx, p_seq->off_part[idx], p_seq->off_note[idx], 0);
+    }
+
+    p_seq->num_off = 0;
+}   /* seq_note_off() */
+
+static const seq_pattern_t *
+seq_pattern (seq_t * p_seq)
+{
+    if (p_seq->middle.load(std::memory_order_relaxed) & SEQ_FRESH)
+    {
+        p_seq->front = p_seq->middle.exchange(p_seq->front,
+                                              std::memory_order_acq_rel)
+                       & SEQ_INDEX_MASK;
+    }
+
+    return (&p_seq->pattern[p_seq->front]);
+}   /* seq_pattern() */
+
+void
+seq_init (seq_t * p_seq, uint32_t sample_rate, uint8_t part)
+{
+    seq_pattern_t * p_pat = &p_seq->edit;
+
+    memset(p_pat, 0, sizeof(*p_pat));
+    p_pat->mode = SEQ_MODE_OFF;
+    p_pat->arp = SEQ_ARP_UP;
+    p_pat->octaves = 1;
+    p_pat->num_step = 16;
+    p_pat->gate_pct = 50;
+    p_pat->swing_pct = 50;
+    p_pat->bpm = 120;
+    p_pat->num_layer = 1;
+    p_pat->layer[0].part = part;
+    p_pat->layer[0].zone_lo = 0;
+    p_pat->layer[0].zone_hi = 127;
+    p_pat->layer[0].transpose = 0;
+
+    for (uint32_t idx = 0; idx < SEQ_MAX_STEP; ++idx)
+    {
+        p_pat->step[idx].note = SEQ_REST;
+        p_pat->step[idx].velocity = 100;
+    }
+
+    for (uint32_t idx = 0; idx < 3; ++idx)
+    {
+        p_seq->pattern[idx] = *p_pat;
+    }
+
+    p_seq->back = 0;
+    p_seq->middle.store(1);
+    p_seq->front = 2;
+    p_seq->rec_step = 0;
+    p_seq->sample_rate = sample_rate;
+    p_seq->now = 0;
+    p_seq->origin = 0;
+    p_seq->origin_step = 0;
+    p_seq->bpm = p_pat->bpm;
+    p_seq->step = 0;
+    p_seq->next_on = 0;
+    p_seq->next_off = 0;
+    p_seq->num_off = 0;
+    p_seq->b_sounding = 0;
+    p_seq->b_running = 0;
+}   /* seq_init() */
+
+seq_pattern_t *
+seq_edit (seq_t * p_seq)
+{
+    return (&p_seq->edit);
+}   /* seq_edit() */
+
+void
+seq_commit (seq_t * p_seq)
+{
+    seq_pattern_t * p_pat = &p_seq->edit;
+
+    // Clamp here, so the audio side can trust every field.
+    //
+    p_pat->mode = (p_pat->mode < SEQ_NUM_MODE) ? p_pat->mode
+                                               : (uint8_t) SEQ_MODE_OFF;
+    p_pat->arp = (p_pat->arp < SEQ_NUM_ARP) ? p_pat->arp
+                                            : (uint8_t) SEQ_ARP_UP;
+    p_pat->octaves = (p_pat->octaves < 1) ? 1
+                   : ((p_pat->octaves > 4) ? 4 : p_pat->octaves);
+    p_pat->num_step = (p_pat->num_step < 1) ? 1
+                    : ((p_pat->num_step > SEQ_MAX_STEP) ? SEQ_MAX_STEP
+                                                        : p_pat->num_step);
+    p_pat->gate_pct = (p_pat->gate_pct < 1) ? 1
+                    : ((p_pat->gate_pct > 100) ? 100 : p_pat->gate_pct);
+    p_pat->swing_pct = (p_pat->swing_pct < 50) ? 50
+                     : ((p_pat->swing_pct > 75) ? 75 : p_pat->swing_pct);
+    p_pat->bpm = (p_pat->bpm < SEQ_MIN_BPM) ? SEQ_MIN_BPM
+               : ((p_pat->bpm > SEQ_MAX_BPM) ? SEQ_MAX_BPM : p_pat->bpm);
+    p_pat->num_layer = (p_pat->num_layer > SEQ_MAX_LAYER) ? SEQ_MAX_LAYER
+                                                          : p_pat->num_layer;
+
+    p_seq->pattern[p_seq->back] = *p_pat;
+    p_seq->back = p_seq->middle.exchange(p_seq->back | SEQ_FRESH,
+                                         std::memory_order_acq_rel)
+                  & SEQ_INDEX_MASK;
+}   /* seq_commit() */
+
+void
+seq_hold (seq_t * p_seq, uint8_t note, uint8_t b_held)
+{
+    uint32_t * p_word = &p_seq->edit.held[(note >> 5) & 3U];
+
+    if (b_held)
+    {
+        *p_word |= 1UL << (note & 31U);
+    }
+    else
+    {
+        *p_word &= ~(1UL << (note & 31U));
+    }
+
+    seq_commit(p_seq);
+}   /* seq_hold() */
+
+void
+seq_record (seq_t * p_seq, uint8_t note, uint8_t velocity)
+{
+    seq_pattern_t * p_pat = &p_seq->edit;
+
+    if (p_seq->rec_step >= p_pat->num_step)
+    {
+        p_seq->rec_step = 0;
+    }
+
+    p_pat->step[p_seq->rec_step].note = note;
+    p_pat->step[p_seq->rec_step].velocity = velocity;
+    ++p_seq->rec_step;
+    seq_commit(p_seq);
+}   /* seq_record() */
+
+uint32_t
+seq_run (seq_t * p_seq, uint32_t max_frames, seq_emit_t emit, void * p_ctx)
+{
+    const seq_pattern_t * p_pat = seq_pattern(p_seq);
+    uint64_t until = p_seq->now + max_frames;
+
+    if (p_seq->b_sounding && (p_seq->next_off <= p_seq->now))
+    {
+        seq_note_off(p_seq, emit, p_ctx);
+        p_seq->b_sounding = 0;
+    }
+
+    if (SEQ_MODE_OFF == p_pat->mode)
+    {
+        p_seq->b_running = 0;
+    }
+    else if (!p_seq->b_running)
+    {
+        // Step 0 lands on the sample the pattern was switched on.
+        //
+        p_seq->b_running = 1;
+        p_seq->bpm = p_pat->bpm;
+        p_seq->origin = p_seq->now;
+        p_seq->origin_step = 0;
+        p_seq->step = 0;
+        p_seq->next_on = p_seq->now;
+    }
+    else if (p_pat->bpm != p_seq->bpm)
+    {
+        // New tempo from the next step on: re-anchor the grid there.
+        //
+        p_seq->origin = step_grid(p_seq, p_seq->step);
+        p_seq->origin_step = p_seq->step;
+        p_seq->bpm = p_pat->bpm;
+        p_seq->next_on = step_time(p_seq, p_pat, p_seq->step);
+    }
+
+    if (p_seq->b_running && (p_seq->next_on <= p_seq->now))
+    {
+        uint32_t len = (uint32_t) (step_grid(p_seq, p_seq->step + 1)
+                                   - step_grid(p_seq, p_seq->step));
+        uint8_t note = SEQ_REST;
+        uint8_t velocity = 100;
+
+        if (SEQ_MODE_ARP == p_pat->mode)
+        {
+            note = arp_note(p_pat, p_seq->step);
+        }
+        else
+        {
+            const seq_step_t * p_step = &p_pat->step[p_seq->step
+                                                     % p_pat->num_step];
+
+            note = p_step->note;
+            velocity = p_step->velocity;
+        }
+
+        if ((SEQ_REST != note) && (0 != velocity))
+        {
+            if (p_seq->b_sounding)
+            {
+                seq_note_off(p_seq, emit, p_ctx);
+            }
+
+            seq_note_on(p_seq, p_pat, note, velocity, emit, p_ctx);
+            p_seq->b_sounding = 1;
+            p_seq->next_off = p_seq->now + len * p_pat->gate_pct / 100U;
+            p_seq->next_off += (p_seq->next_off == p_seq->now) ? 1 : 0;
+        }
+
+        ++p_seq->step;
+        p_seq->next_on = step_time(p_seq, p_pat, p_seq->step);
+    }
+
+    if (p_seq->b_running && (p_seq->next_on < until))
+    {
+        until = p_seq->next_on;
+    }
+
+    if (p_seq->b_sounding && (p_seq->next_off < until))
+    {
+        until = p_seq->next_off;
+    }
+
+    // Something due now (a late tempo change): at least one frame, so the
+    // caller always makes progress.
+    //
+    if (until <= p_seq->now)
+    {
+        until = p_seq->now + 1;
+    }
+
+    max_frames = (uint32_t) (until - p_seq->now);
+    p_seq->now = until;
+
+    return (max_frames);
+}   /* seq_run() */
@@ -0,0 +1,135 @@
+#ifndef SEQ_H
+
+#   define SEQ_H
+#   include <stdint.h>
+#   include <atomic>
+
+// Arpeggiator and step sequencer clocked by the samples rendered, not by
+// the UI: synth_render() cuts its blocks at every step, so notes start on
+// their exact sample whatever the callback size or the UI load.
+//
+// The UI edits its own copy of the pattern and publishes it with
+// seq_commit(); the audio side picks up the newest one through a
+// triple buffer, the same hand-off the scope uses the other way round.
+//
+#   define SEQ_MAX_STEP     (32)
+#   define SEQ_REST         (0xFF)  /* Step note that plays nothing */
+#   define SEQ_MIN_BPM      (20)
+#   define SEQ_MAX_BPM      (300)
+#   define SEQ_MAX_LAYER    (4)     /* Parts one sequencer can play */
+
+typedef enum seq_mode_t
+{
+    SEQ_MODE_OFF = 0,
+    SEQ_MODE_ARP,           /* Cycles through the held keys */
+    SEQ_MODE_STEP,          /* Plays the step pattern */
+    SEQ_NUM_MODE
+} seq_mode_t;
+
+typedef enum seq_arp_t
+{
+    SEQ_ARP_UP = 0,
+    SEQ_ARP_DOWN,
+    SEQ_ARP_UPDOWN,
+    SEQ_NUM_ARP
+} seq_arp_t;
+
+typedef struct seq_step_t
+{
+    uint8_t note;           /* SEQ_REST for a pause */
+    uint8_t velocity;
+} seq_step_t;
+
+// Where a sequenced note sounds: like a key, on every layer whose zone
+// holds it, moved by that layer's transpose.
+//
+typedef struct seq_layer_t
+{
+    uint8_t part;
+    uint8_t zone_lo;        /* MIDI notes, inclusive */
+    uint8_t zone_hi;
+    int8_t transpose;
+} seq_layer_t;
+
+// Steps are sixteenth notes; swing delays every odd one by
+// (swing_pct - 50) / 50 of a step, so 50 is straight and 66 is triplet.
+//
+typedef struct seq_pattern_t
+{
+    uint8_t mode;
+    uint8_t arp;
+    uint8_t octaves;        /* Arp range, 1 to 4 */
+    uint8_t num_step;       /* 1 to SEQ_MAX_STEP, usually 16 or 32 */
+    uint8_t gate_pct;       /* Note length, 1 to 100 % of the step */
+    uint8_t swing_pct;      /* 50 to 75 */
+    uint16_t bpm;
+    seq_step_t step[SEQ_MAX_STEP];
+    uint32_t held[4];       /* Arp keys, one bit per MIDI note */
+    uint8_t num_layer;      /* Up to SEQ_MAX_LAYER */
+    seq_layer_t layer[SEQ_MAX_LAYER];
+} seq_pattern_t;
+
+// Called by seq_run() on the audio thread, once per layer sounding the
+// note, velocity 0 for a note off.
+//
+typedef void (*seq_emit_t)(void * p_ctx, uint8_t part, uint8_t note,
+                           uint8_t velocity);
+
+typedef struct seq_t
+{
+    seq_pattern_t pattern[3];
+    std::atomic<uint8_t> middle;
+    uint8_t back;           /* UI side */
+    seq_pattern_t edit;     /* UI side, published by seq_commit() */
+    uint8_t rec_step;       /* UI side, next step written by seq_record() */
+    uint8_t front;          /* Audio side from here on */
+    uint32_t sample_rate;
+    uint64_t now;           /* Samples since seq_init() */
+    uint64_t origin;        /* Time of step `origin_step` at `bpm` */
+    uint32_t origin_step;
+    uint16_t bpm;
+    uint32_t step;          /* Steps played since the pattern started */
+    uint64_t next_on;
+    uint64_t next_off;
+    uint8_t num_off;        /* Layer notes the next note off closes */
+    uint8_t off_part[SEQ_MAX_LAYER];
+    uint8_t off_note[SEQ_MAX_LAYER];
+    uint8_t b_sounding;
+    uint8_t b_running;
+} seq_t;
+
+typedef struct seq_bench_t
+{
+    uint32_t num_note;
+    uint32_t max_err;       /* Samples off the ideal grid, 0 if exact */
+    uint32_t max_block_err; /* Same grid, notes quantized to callbacks */
+    uint32_t num_commit;    /* Pattern edits published meanwhile */
+} seq_bench_t;
+
+// Notes go to `part`, whole range, until the pattern's layers say
+// otherwise.
+//
+void seq_init(seq_t * p_seq, uint32_t sample_rate, uint8_t part);
+
+// UI side. seq_edit() returns the working copy; nothing reaches audio
+// until seq_commit().
+//
+seq_pattern_t * seq_edit(seq_t * p_seq);
+void seq_commit(seq_t * p_seq);
+void seq_hold(seq_t * p_seq, uint8_t note, uint8_t b_held);
+void seq_record(seq_t * p_seq, uint8_t note, uint8_t velocity);
+
+// Audio side: plays the events due now and returns how many frames, up
+// to `max_frames`, can be rendered before the next one.
+//
+uint32_t seq_run(seq_t * p_seq, uint32_t max_frames, seq_emit_t emit,
+                 void * p_ctx);
+
+// Note onsets against the ideal swung grid over `seconds` of audio
+// rendered in random callback sizes, with another thread (native)
+// committing edits all along.
+//
+uint8_t seq_bench(uint16_t bpm, uint8_t swing_pct, uint32_t seconds,
+                  seq_bench_t * p_result);
+
+#endif /* SEQ_H */
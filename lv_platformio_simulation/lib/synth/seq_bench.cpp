@@ -0,0 +1,139 @@
+#include "seq.h"
+#include <math.h>
+#if !defined(STM32F429xx) && !defined(ESP_PLATFORM)
+#   define SEQ_BENCH_UI_THREAD  (1)
+#   include <thread>
+#endif
+
+#define BENCH_RATE          (48000U)
+#define BENCH_MAX_CALLBACK  (512U)
+
+typedef struct bench_ctx_t
+{
+    const seq_t * p_seq;
+    uint16_t bpm;
+    uint8_t swing_pct;
+    uint64_t callback_start;
+    seq_bench_t * p_result;
+} bench_ctx_t;
+
+static void
+bench_emit (void * p_ctx, uint8_t part, uint8_t note, uint8_t velocity)
+{
+    bench_ctx_t * p_bench = (bench_ctx_t *) p_ctx;
+    seq_bench_t * p_result = p_bench->p_result;
+    uint32_t step = p_result->num_note;
+    uint64_t now = p_bench->p_seq->now;
+    double ideal = 0.0;
+    uint64_t expect = 0;
+    uint32_t err = 0;
+
+    (void) part;
+    (void) note;
+
+    if (0 == velocity)
+    {
+        return;
+    }
+
+    // Every step plays: the n-th onset belongs to step n.
+    //
+    ideal = ((double) step + ((step & 1U) ? (p_bench->swing_pct - 50) / 50.0
+                                          : 0.0))
+            * BENCH_RATE * 60.0 / (4.0 * p_bench->bpm);
+    expect = (uint64_t) floor(ideal + 1e-9);
+    err = (uint32_t) ((now > expect) ? now - expect : expect - now);
+
+    p_result->max_err = (err > p_result->max_err) ? err : p_result->max_err;
+    err = (uint32_t) (expect - ((expect > p_bench->callback_start)
+                                ? p_bench->callback_start : expect));
+    p_result->max_block_err = (err > p_result->max_block_err)
+                              ? err : p_result->max_block_err;
+    ++p_result->num_note;
+}   /* bench_emit() */
+
+uint8_t
+seq_bench (uint16_t bpm, uint8_t swing_pct, uint32_t seconds,
+           seq_bench_t * p_result)
+{
+    static seq_t seq;
+    seq_pattern_t * p_pat = seq_edit(&seq);
+    bench_ctx_t ctx = {&seq, bpm, swing_pct, 0, p_result};
+    uint64_t total = (uint64_t) seconds * BENCH_RATE;
+    uint32_t rand = 12345U;
+#if SEQ_BENCH_UI_THREAD
+    std::atomic<uint8_t> b_stop(0);
+    std::atomic<uint32_t> num_commit(0);
+#endif
+
+    if ((bpm < SEQ_MIN_BPM) || (bpm > SEQ_MAX_BPM) || (swing_pct < 50)
+        || (swing_pct > 75))
+    {
+        return (0);
+    }
+
+    p_result->num_note = 0;
+    p_result->max_err = 0;
+    p_result->max_block_err = 0;
+    p_result->num_commit = 0;
+
+    seq_init(&seq, BENCH_RATE, 0);
+    p_pat->mode = SEQ_MODE_STEP;
+    p_pat->bpm = bpm;
+    p_pat->swing_pct = swing_pct;
+
+    for (uint32_t idx = 0; idx < SEQ_MAX_STEP; ++idx)
+    {
+        p_pat->step[idx].note = (uint8_t) (48 + idx);
+    }
+
+    seq_commit(&seq);
+
+#if SEQ_BENCH_UI_THREAD
+    // Stands for a busy UI: edits that change nothing in time, published
+    // as fast as it can.
+    //
+    std::thread ui([&]()
+    {
+        while (!b_stop.load(std::memory_order_relaxed))
+        {
+            seq_pattern_t * p_edit = seq_edit(&seq);
+
+            p_edit->step[0].velocity = (p_edit->step[0].velocity == 100)
+                                       ? 101 : 100;
+            seq_commit(&seq);
+            num_commit.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+#endif
+
+    // Random callback sizes, as an audio driver under load would ask.
+    //
+    while (seq.now < total)
+    {
+        uint32_t frames = 0;
+
+        rand = rand * 1664525U + 1013904223U;
+        frames = 1 + (rand >> 8) % BENCH_MAX_CALLBACK;
+        ctx.callback_start = seq.now;
+
+        while (frames > 0)
+        {
+            frames -= seq_run(&seq, frames, bench_emit, &ctx);
+        }
+
+#if SEQ_BENCH_UI_THREAD
+        // Let the editor in between callbacks even on a single core.
+        //
+        std::this_thread::yield();
+#endif
+    }
+
+#if SEQ_BENCH_UI_THREAD
+    b_stop.store(1, std::memory_order_relaxed);
+    ui.join();
+    p_result->num_commit = num_commit.load();
+#endif
+
+    return (1);
+}   /* seq_bench() */
@@ -0,0 +1,972 @@
+#include "synth.h"
+#include <string.h>
+#include <math.h>
+#if WSCHED_THREADS
+#   include <new>
+#endif
+
+#define SYNTH_ATTACK_MS     (3)
+#define SYNTH_RELEASE_MS    (40)
+#define SYNTH_VOICE_GAIN    (0.25f)
+
+static_assert(SYNTH_NUM_PART <= MOD_NUM_PART, "mod matrix parts");
+
+static uint8_t
+queue_push (synth_queue_t * p_queue, const synth_event_t * p_event)
+{
+    uint32_t head = p_queue->head.load(std::memory_order_relaxed);
+    uint32_t tail = p_queue->tail.load(std::memory_order_acquire);
+
+    if ((head - tail) >= SYNTH_NUM_EVENT)
+    {
+        return (0);
+    }
+
+    p_queue->event[head & (SYNTH_NUM_EVENT - 1)] = *p_event;
+    p_queue->head.store(head + 1, std::memory_order_release);
+
+    return (1);
+}   /* queue_push() */
+
+static uint8_t
+queue_pop (synth_queue_t * p_queue, synth_event_t * p_event)
+{
+    uint32_t tail = p_queue->tail.load(std::memory_order_relaxed);
+    uint32_t head = p_queue->head.load(std::memory_order_acquire);
+
+    if (head == tail)
+    {
+        return (0);
+    }
+
+    *p_event = p_queue->event[tail & (SYNTH_NUM_EVENT - 1)];
+    p_queue->tail.store(tail + 1, std::memory_order_release);
+
+    return (1);
+}   /* queue_pop() */
+
+static void
+voice_start (synth_t * p_synth, uint8_t part, uint8_t note, uint8_t velocity)
+{
+    synth_voice_t * p_voice = NULL;
+    synth_voice_t * p_oldest = &p_synth->voice[0];
+    const synth_part_t * p_part = &p_synth->part[part];
+    const uint8_t wave = p_part->wave;
+    uint8_t b_restart = 0;
+
+    // Retrigger the same note of the same part, else take a free voice,
+    // else steal the oldest one whatever part it plays.
+    //
+    for (uint32_t idx = 0; idx < SYNTH_NUM_VOICE; ++idx)
+    {
+        synth_voice_t * p_cand = &p_synth->voice[idx];
+
+        if (p_cand->active && (note == p_cand->note)
+            && (part == p_cand->part))
+        {
+            p_voice = p_cand;
+            break;
+        }
+
+        if ((NULL == p_voice) && !p_cand->active)
+        {
+            p_voice = p_cand;
+        }
+
+        if (p_cand->age < p_oldest->age)
+        {
+            p_oldest = p_cand;
+        }
+    }
+
+    if (NULL == p_voice)
+    {
+        p_voice = p_oldest;
+    }
+
+    // Sampled parts stream from the set. Without a stream (or a zone) for
+    // the note it is dropped, and the voice picked keeps playing.
+    //
+    if ((SYNTH_WAVE_SAMPLE == wave) && (NULL != p_synth->p_sampler))
+    {
+        if (!sampler_voice_start(p_synth->p_sampler, &p_voice->sample, note))
+        {
+            return;
+        }
+    }
+    else if (NULL != p_synth->p_sampler)
+    {
+        sampler_voice_stop(p_synth->p_sampler, &p_voice->sample);
+    }
+
+    if (!p_voice->active)
+    {
+        p_voice->osc.phase = 0;
+        p_voice->env = 0.0f;
+        b_restart = 1;
+    }
+
+    p_voice->active = 1;
+    p_voice->gate = 1;
+    p_voice->note = note;
+    p_voice->part = part;
+    p_voice->osc.phase_inc = p_synth->p_tables->note_inc[note
+                                                         & (SYNTH_NUM_NOTE - 1)];
+    p_voice->osc.wave = (wave < OSC_NUM_WAVE) ? wave : (uint8_t) OSC_SINE;
+    p_voice->osc.mode = p_part->mode;
+    p_voice->velocity = (float) velocity / 127.0f;
+    p_voice->env_step = 1000.0f / (SYNTH_ATTACK_MS * p_synth->sample_rate);
+    p_voice->age = ++p_synth->age;
+
+    if ((wave >= SYNTH_WAVE_FM) && (wave < SYNTH_WAVE_SAMPLE))
+    {
+        fm_voice_start(&p_voice->fm, (fm_patch_id_t) (wave - SYNTH_WAVE_FM),
+                       p_voice->osc.phase_inc, p_synth->sample_rate);
+    }
+    else
+    {
+        p_voice->fm.patch = 0;
+    }
+
+    if ((wave < OSC_NUM_WAVE) && (p_part->unison > 1))
+    {
+        unison_start(&p_voice->unison, p_voice->osc.phase_inc,
+                     p_part->unison, p_part->detune, b_restart);
+    }
+    else
+    {
+        p_voice->unison.count = 0;
+    }
+
+    mod_voice_start(&p_voice->mod, b_restart);
+}   /* voice_start() */
+
+static void
+voice_stop (synth_t * p_synth, uint8_t part, uint8_t note)
+{
+    for (uint32_t idx = 0; idx < SYNTH_NUM_VOICE; ++idx)
+    {
+        synth_voice_t * p_voice = &p_synth->voice[idx];
+
+        if (p_voice->active && p_voice->gate && (note == p_voice->note)
+            && (part == p_voice->part))
+        {
+            p_voice->gate = 0;
+            p_voice->env_step = -1000.0f
+                                / (SYNTH_RELEASE_MS * p_synth->sample_rate);
+            mod_voice_release(&p_voice->mod);
+
+            // FM patches release on their own operator envelopes.
+            //
+            if (0 != p_voice->fm.patch)
+            {
+                fm_voice_release(&p_voice->fm);
+                p_voice->env_step = 0.0f;
+            }
+        }
+    }
+}   /* voice_stop() */
+
+// Mix a rendered voice into `p_out` under its envelope, and into `p_side`
+// when it is stereo (`p_side_buf` not NULL) or panned by the matrix.
+//
+static void
+voice_mix (synth_t * p_synth, synth_voice_t * p_voice, const float * p_buf,
+           const float * p_side_buf, float * p_out, float * p_side,
+           uint32_t frames, uint8_t b_more)
+{
+    mod_voice_t * p_mod = &p_voice->mod;
+    float env = p_voice->env;
+    float gain = p_mod->gain;
+    float pan = p_mod->pan;
+    const float level = p_voice->velocity
+                        * p_synth->part[p_voice->part].volume;
+    const uint8_t b_pan = (0.0f != pan) || (0.0f != p_mod->pan_step);
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        env += p_voice->env_step;
+        gain += p_mod->gain_step;
+        pan += p_mod->pan_step;
+
+        if (env >= 1.0f)
+        {
+            env = 1.0f;
+        }
+        else if (env <= 0.0f)
+        {
+            env = 0.0f;
+            p_voice->active = 0;
+            break;
+        }
+
+        float amp = env * level * gain;
+        float mid = p_buf[idx] * amp;
+
+        p_out[idx] += mid;
+
+        if (NULL != p_side_buf)
+        {
+            p_side[idx] += p_side_buf[idx] * amp;
+        }
+
+        // Left is mid + side: panning right takes that much of the mid
+        // away from the side.
+        //
+        if (b_pan)
+        {
+            p_side[idx] -= mid * pan;
+        }
+    }
+
+    // The ramps hold where they ended until the matrix moves them again.
+    //
+    p_voice->env = env;
+    p_mod->gain = gain;
+    p_mod->pan = pan;
+    p_mod->gain_step = 0.0f;
+    p_mod->pan_step = 0.0f;
+
+    // Streams go back once the voice is silent or the sample has ended;
+    // FM voices end once their carriers have died away.
+    //
+    if (!b_more)
+    {
+        p_voice->active = 0;
+    }
+
+    if (!p_voice->active && (0 != p_voice->sample.stream))
+    {
+        sampler_voice_stop(p_synth->p_sampler, &p_voice->sample);
+    }
+}   /* voice_mix() */
+
+static void
+fm_flush (synth_t * p_synth, synth_voice_t * const * pp_voice, uint32_t count,
+          float (* p_buf)[SYNTH_BLOCK_SIZE], float * p_out, float * p_side,
+          uint32_t frames)
+{
+    fm_voice_t * pp_fm[FM_LANES];
+    float * pp_buf[FM_LANES];
+    uint32_t alive = 0;
+
+    for (uint32_t lane = 0; lane < count; ++lane)
+    {
+        pp_fm[lane] = &pp_voice[lane]->fm;
+        pp_buf[lane] = p_buf[lane];
+    }
+
+    alive = fm_render(pp_fm, count, pp_buf, frames);
+
+    for (uint32_t lane = 0; lane < count; ++lane)
+    {
+        voice_mix(p_synth, pp_voice[lane], p_buf[lane], NULL, p_out, p_side,
+                  frames, (alive >> lane) & 1U);
+    }
+}   /* fm_flush() */
+
+// Mix voices `first` up to `last` into `p_out` (mid) and `p_side`. FM
+// voices are gathered and rendered FM_LANES at a time into `p_buf`, which
+// holds FM_LANES blocks; unison voices use two of them for mid and side.
+//
+static void
+render_voices (synth_t * p_synth, uint32_t first, uint32_t last,
+               float (* p_buf)[SYNTH_BLOCK_SIZE], float * p_out,
+               float * p_side, uint32_t frames)
+{
+    synth_voice_t * p_fm[FM_LANES];
+    uint32_t count = 0;
+
+    for (uint32_t idx = first; idx < last; ++idx)
+    {
+        synth_voice_t * p_voice = &p_synth->voice[idx];
+        uint8_t b_more = 1;
+
+        if (!p_voice->active)
+        {
+            continue;
+        }
+
+        if (0 != p_voice->fm.patch)
+        {
+            p_fm[count++] = p_voice;
+
+            if (FM_LANES == count)
+            {
+                fm_flush(p_synth, p_fm, count, p_buf, p_out, p_side, frames);
+                count = 0;
+            }
+
+            continue;
+        }
+
+        if (p_voice->unison.count > 1)
+        {
+            memset(p_buf[0], 0, frames * sizeof(float));
+            memset(p_buf[1], 0, frames * sizeof(float));
+            unison_render(&p_voice->unison, (osc_wave_t) p_voice->osc.wave,
+                          p_synth->part[p_voice->part].spread, p_buf[0],
+                          p_buf[1], frames);
+            voice_mix(p_synth, p_voice, p_buf[0], p_buf[1], p_out, p_side,
+                      frames, 1);
+            continue;
+        }
+
+        if (0 != p_voice->sample.stream)
+        {
+            b_more = sampler_voice_render(p_synth->p_sampler,
+                                          &p_voice->sample, p_buf[0], frames);
+        }
+        else
+        {
+            osc_render(&p_voice->osc, p_buf[0], frames);
+        }
+
+        voice_mix(p_synth, p_voice, p_buf[0], NULL, p_out, p_side, frames,
+                  b_more);
+    }
+
+    if (0 != count)
+    {
+        fm_flush(p_synth, p_fm, count, p_buf, p_out, p_side, frames);
+    }
+}   /* render_voices() */
+
+#if WSCHED_THREADS
+static void
+render_task (void * p_ctx, uint32_t task, uint32_t worker)
+{
+    synth_t * p_synth = (synth_t *) p_ctx;
+    float * p_out = p_synth->task_buf[task];
+    float * p_side = p_synth->task_side[task];
+    uint32_t first = task * SYNTH_TASK_VOICES;
+    uint32_t last = first + SYNTH_TASK_VOICES;
+    uint8_t b_active = 0;
+
+    last = (last > SYNTH_NUM_VOICE) ? SYNTH_NUM_VOICE : last;
+
+    for (uint32_t idx = first; idx < last; ++idx)
+    {
+        b_active |= p_synth->voice[idx].active;
+    }
+
+    if (b_active)
+    {
+        memset(p_out, 0, p_synth->task_frames * sizeof(float));
+        memset(p_side, 0, p_synth->task_frames * sizeof(float));
+        render_voices(p_synth, first, last,
+                      p_synth->b_parallel
+                      ? &p_synth->p_scratch[worker * FM_LANES]
+                      : p_synth->voice_buf,
+                      p_out, p_side, p_synth->task_frames);
+    }
+
+    p_synth->task_active[task] = b_active;
+}   /* render_task() */
+
+static void
+render_voices_chunked (synth_t * p_synth, float * p_mix, float * p_side,
+                       uint32_t frames)
+{
+    // Serial render goes through the same chunks, so one thread and many
+    // produce the same samples.
+    //
+    p_synth->task_frames = frames;
+
+    if (p_synth->b_parallel)
+    {
+        wsched_run(p_synth->p_sched, SYNTH_NUM_TASK, render_task, p_synth);
+    }
+    else
+    {
+        for (uint32_t task = 0; task < SYNTH_NUM_TASK; ++task)
+        {
+            render_task(p_synth, task, 0);
+        }
+    }
+
+    for (uint32_t task = 0; task < SYNTH_NUM_TASK; ++task)
+    {
+        if (p_synth->task_active[task])
+        {
+            for (uint32_t idx = 0; idx < frames; ++idx)
+            {
+                p_mix[idx] += p_synth->task_buf[task][idx];
+                p_side[idx] += p_synth->task_side[task][idx];
+            }
+        }
+    }
+}   /* render_voices_chunked() */
+#endif
+
+static void
+seq_emit (void * p_ctx, uint8_t part, uint8_t note, uint8_t velocity)
+{
+    synth_t * p_synth = (synth_t *) p_ctx;
+
+    if (0 != velocity)
+    {
+        voice_start(p_synth, part % SYNTH_NUM_PART, note, velocity);
+    }
+    else
+    {
+        voice_stop(p_synth, part % SYNTH_NUM_PART, note);
+    }
+}   /* seq_emit() */
+
+// Pitch modulation: the voice's note moved by its matrix pitch, on
+// whichever engine plays it.
+//
+static void
+voice_retune (synth_t * p_synth, synth_voice_t * p_voice)
+{
+    const uint32_t note_inc = p_synth->p_tables->note_inc[
+                    p_voice->note & (SYNTH_NUM_NOTE - 1)];
+    const float ratio = exp2f(p_voice->mod.pitch * (1.0f / 12.0f));
+    const float inc = ratio * (float) note_inc;
+    uint32_t phase_inc = (inc < 2147483648.0f) ? (uint32_t) inc : 0x80000000U;
+
+    // Back on the note exactly, not to within a float.
+    //
+    phase_inc = (0.0f == p_voice->mod.pitch) ? note_inc : phase_inc;
+
+    p_voice->osc.phase_inc = phase_inc;
+
+    if (0 != p_voice->fm.patch)
+    {
+        fm_voice_set_inc(&p_voice->fm, phase_inc);
+    }
+
+    if (p_voice->unison.count > 1)
+    {
+        unison_start(&p_voice->unison, phase_inc, p_voice->unison.count,
+                     p_synth->part[p_voice->part].detune, 0);
+    }
+
+    if (0 != p_voice->sample.stream)
+    {
+        p_voice->sample.inc = (0.0f == p_voice->mod.pitch)
+                              ? p_voice->sample.note_inc
+                              : (uint64_t) ((double) p_voice->sample.note_inc
+                                            * ratio);
+    }
+}   /* voice_retune() */
+
+// Run the matrix for the coming block: the engine filter, then the voices
+// of every part it routes. An empty matrix returns right away.
+//
+static void
+modulate (synth_t * p_synth, uint32_t frames)
+{
+    float cutoff = 0.0f;
+    const uint32_t mask = mod_run(&p_synth->mod, frames, &cutoff);
+
+    fx_set_cutoff_mod(&p_synth->fx, cutoff);
+
+    if (0 == mask)
+    {
+        return;
+    }
+
+    for (uint32_t idx = 0; idx < SYNTH_NUM_VOICE; ++idx)
+    {
+        synth_voice_t * p_voice = &p_synth->voice[idx];
+
+        if (p_voice->active && ((mask >> p_voice->part) & 1U)
+            && mod_voice_run(&p_synth->mod, &p_voice->mod, p_voice->part,
+                             p_voice->velocity, frames))
+        {
+            voice_retune(p_synth, p_voice);
+        }
+    }
+}   /* modulate() */
+
+static void
+apply_preset (synth_t * p_synth, const preset_t * p_preset)
+{
+    // Parameters only: sounding voices keep their phase and envelope and
+    // the effect lines keep their tails, so the switch does not click.
+    //
+    uint32_t num_part = (SYNTH_NUM_PART < PRESET_NUM_PART) ? SYNTH_NUM_PART
+                                                           : PRESET_NUM_PART;
+
+    for (uint32_t part = 0; part < num_part; ++part)
+    {
+        p_synth->part[part].volume = (float) p_preset->part[part].volume
+                                     / 100.0f;
+        p_synth->part[part].wave = p_preset->part[part].wave
+                                   % SYNTH_NUM_WAVE;
+        p_synth->part[part].mode = p_preset->part[part].mode % OSC_NUM_MODE;
+        p_synth->part[part].unison = (p_preset->part[part].unison > UNISON_MAX)
+                                     ? UNISON_MAX
+                                     : p_preset->part[part].unison;
+        p_synth->part[part].detune = p_preset->detune[part];
+        p_synth->part[part].spread = (p_preset->spread[part] > 1.0f) ? 1.0f
+                                   : ((p_preset->spread[part] < 0.0f)
+                                      ? 0.0f : p_preset->spread[part]);
+    }
+
+    for (uint32_t id = 0; id < FX_NUM; ++id)
+    {
+        fx_enable(&p_synth->fx, (fx_id_t) id, (p_preset->fx_mask >> id) & 1U);
+    }
+
+    for (uint32_t idx = 0; idx < PRESET_NUM_FX_PARAM; ++idx)
+    {
+        fx_id_t id;
+        fx_param_t param;
+
+        preset_fx_param(idx, &id, &param);
+        fx_set_param(&p_synth->fx, id, param, p_preset->fx[idx]);
+    }
+}   /* apply_preset() */
+
+static void
+process_events (synth_t * p_synth)
+{
+    synth_event_t event;
+
+    while (queue_pop(&p_synth->queue, &event))
+    {
+        synth_part_t * p_part = &p_synth->part[event.part % SYNTH_NUM_PART];
+
+        switch (event.type)
+        {
+            case SYNTH_EVENT_NOTE_ON:
+                voice_start(p_synth, event.part % SYNTH_NUM_PART, event.arg1,
+                            event.arg2);
+            break;
+
+            case SYNTH_EVENT_NOTE_OFF:
+                voice_stop(p_synth, event.part % SYNTH_NUM_PART, event.arg1);
+            break;
+
+            case SYNTH_EVENT_VOLUME:
+                p_part->volume = event.value;
+            break;
+
+            case SYNTH_EVENT_WAVEFORM:
+                p_part->wave = event.arg1;
+                p_part->mode = event.arg2;
+            break;
+
+            case SYNTH_EVENT_FX_ENABLE:
+                fx_enable(&p_synth->fx, (fx_id_t) event.arg1, event.arg2);
+            break;
+
+            case SYNTH_EVENT_FX_PARAM:
+                fx_set_param(&p_synth->fx, (fx_id_t) event.arg1,
+                             (fx_param_t) event.arg2, event.value);
+            break;
+
+            case SYNTH_EVENT_UNISON:
+                p_part->unison = event.arg1;
+                p_part->spread = (float) event.arg2 / 100.0f;
+                p_part->detune = event.value;
+            break;
+
+            case SYNTH_EVENT_CC:
+                mod_set_cc(&p_synth->mod, event.arg1, event.arg2);
+            break;
+
+            default:
+            break;
+        }
+    }
+}   /* process_events() */
+
+static void
+render_block (synth_t * p_synth, int16_t * p_out, uint32_t frames)
+{
+    float * p_left = p_synth->mix_left;
+    float * p_right = p_synth->mix_right;
+    float * p_side = p_synth->mix_side;
+    const float gain = SYNTH_VOICE_GAIN;
+    const preset_t * p_preset = p_synth->p_preset_next.exchange(
+                    NULL, std::memory_order_acquire);
+
+    if (NULL != p_preset)
+    {
+        apply_preset(p_synth, p_preset);
+    }
+
+    process_events(p_synth);
+    modulate(p_synth, frames);
+    memset(p_left, 0, frames * sizeof(float));
+    memset(p_side, 0, frames * sizeof(float));
+
+#if WSCHED_THREADS
+    render_voices_chunked(p_synth, p_left, p_side, frames);
+#else
+    render_voices(p_synth, 0, SYNTH_NUM_VOICE, p_synth->voice_buf, p_left,
+                  p_side, frames);
+#endif
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        p_right[idx] = p_left[idx] - p_side[idx];
+        p_left[idx] += p_side[idx];
+    }
+
+    fx_process(&p_synth->fx, p_left, p_right, frames);
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        float left = p_left[idx] * gain * 32767.0f;
+        float right = p_right[idx] * gain * 32767.0f;
+
+        left = (left > 32767.0f) ? 32767.0f
+                                 : ((left < -32768.0f) ? -32768.0f : left);
+        right = (right > 32767.0f) ? 32767.0f
+                                   : ((right < -32768.0f) ? -32768.0f : right);
+        p_out[2 * idx] = (int16_t) left;
+        p_out[2 * idx + 1] = (int16_t) right;
+    }
+
+    if (NULL != p_synth->p_looper)
+    {
+        looper_process(p_synth->p_looper, p_out, frames);
+    }
+
+    if (NULL != p_synth->p_scope)
+    {
+        scope_write(p_synth->p_scope, p_out, frames);
+    }
+
+    if (NULL != p_synth->p_rec)
+    {
+        rec_write(p_synth->p_rec, p_out, frames);
+    }
+}   /* render_block() */
+
+uint8_t
+synth_init (synth_t * p_synth, mem_arena_t * p_arena, uint32_t sample_rate)
+{
+#if WSCHED_THREADS
+    p_synth->p_sched = NULL;
+    p_synth->p_scratch = NULL;
+    p_synth->b_parallel = 0;
+#endif
+
+    p_synth->p_tables = synth_tables_acquire(sample_rate);
+
+    if (NULL == p_synth->p_tables)
+    {
+        return (0);
+    }
+
+    memset(p_synth->voice, 0, sizeof(p_synth->voice));
+    p_synth->queue.head.store(0);
+    p_synth->queue.tail.store(0);
+    p_synth->sample_rate = sample_rate;
+    p_synth->age = 0;
+    p_synth->num_part = 0;
+    p_synth->p_scope = NULL;
+    p_synth->p_seq = NULL;
+    p_synth->p_looper = NULL;
+    p_synth->p_rec = NULL;
+    p_synth->p_sampler = NULL;
+    p_synth->p_preset_next.store(NULL);
+    preset_init(&p_synth->ctl, "");
+    mod_init(&p_synth->mod, sample_rate, SYNTH_BLOCK_SIZE, SYNTH_NUM_PART);
+
+    for (uint32_t part = 0; part < SYNTH_NUM_PART; ++part)
+    {
+        p_synth->part[part].volume = 1.0f;
+        p_synth->part[part].wave = OSC_SINE;
+        p_synth->part[part].mode = OSC_DEFAULT_MODE;
+        p_synth->part[part].unison = 1;
+        p_synth->part[part].detune = UNISON_DETUNE;
+        p_synth->part[part].spread = UNISON_SPREAD;
+    }
+
+    return (fx_init(&p_synth->fx, p_arena, sample_rate));
+}   /* synth_init() */
+
+void
+synth_deinit (synth_t * p_synth)
+{
+#if WSCHED_THREADS
+    if (p_synth->b_parallel)
+    {
+        wsched_stop(p_synth->p_sched);
+        p_synth->b_parallel = 0;
+    }
+#endif
+
+    synth_tables_release(p_synth->p_tables);
+    p_synth->p_tables = NULL;
+}   /* synth_deinit() */
+
+int32_t
+synth_part_add (synth_t * p_synth)
+{
+    if (p_synth->num_part >= SYNTH_NUM_PART)
+    {
+        return (-1);
+    }
+
+    return ((int32_t) p_synth->num_part++);
+}   /* synth_part_add() */
+
+uint8_t
+synth_set_threads (synth_t * p_synth, mem_arena_t * p_arena,
+                   uint32_t num_thread)
+{
+#if WSCHED_THREADS
+    if (num_thread > WSCHED_MAX_WORKER)
+    {
+        return (0);
+    }
+
+    if (p_synth->b_parallel)
+    {
+        wsched_stop(p_synth->p_sched);
+        p_synth->b_parallel = 0;
+    }
+
+    if (num_thread <= 1)
+    {
+        return (1);
+    }
+
+    // The scheduler (cache-line aligned) and the per-worker scratch come
+    // from the arena once; a later call on the same synth reuses them.
+    //
+    if (NULL == p_synth->p_sched)
+    {
+        uintptr_t addr = (uintptr_t) mem_arena_alloc(p_arena,
+                                                      sizeof(wsched_t) + 64U);
+        void * p_mem = (void *) ((addr + 63U) & ~(uintptr_t) 63U);
+
+        p_synth->p_scratch = (float (*)[SYNTH_BLOCK_SIZE]) mem_arena_alloc(
+                        p_arena, WSCHED_MAX_WORKER * FM_LANES
+                                 * SYNTH_BLOCK_SIZE * sizeof(float));
+
+        if ((0 == addr) || (NULL == p_synth->p_scratch))
+        {
+            return (0);
+        }
+
+        p_synth->p_sched = new (p_mem) wsched_t();
+    }
+
+    p_synth->b_parallel = wsched_start(p_synth->p_sched, num_thread);
+
+    return (p_synth->b_parallel);
+#else
+    (void) p_synth;
+    (void) p_arena;
+
+    return (num_thread <= 1);
+#endif
+}   /* synth_set_threads() */
+
+void
+synth_set_scope (synth_t * p_synth, scope_t * p_scope)
+{
+    p_synth->p_scope = p_scope;
+}   /* synth_set_scope() */
+
+void
+synth_set_seq (synth_t * p_synth, seq_t * p_seq)
+{
+    p_synth->p_seq = p_seq;
+}   /* synth_set_seq() */
+
+void
+synth_set_looper (synth_t * p_synth, looper_t * p_looper)
+{
+    p_synth->p_looper = p_looper;
+}   /* synth_set_looper() */
+
+void
+synth_set_rec (synth_t * p_synth, rec_t * p_rec)
+{
+    p_synth->p_rec = p_rec;
+}   /* synth_set_rec() */
+
+void
+synth_set_sampler (synth_t * p_synth, sampler_t * p_sampler)
+{
+    p_synth->p_sampler = p_sampler;
+}   /* synth_set_sampler() */
+
+uint8_t
+synth_note_on (synth_t * p_synth, uint8_t part, uint8_t note,
+               uint8_t velocity)
+{
+    synth_event_t event = {SYNTH_EVENT_NOTE_ON, part, note, velocity, 0.0f};
+
+    return (queue_push(&p_synth->queue, &event));
+}   /* synth_note_on() */
+
+uint8_t
+synth_note_off (synth_t * p_synth, uint8_t part, uint8_t note)
+{
+    synth_event_t event = {SYNTH_EVENT_NOTE_OFF, part, note, 0, 0.0f};
+
+    return (queue_push(&p_synth->queue, &event));
+}   /* synth_note_off() */
+
+uint8_t
+synth_set_volume (synth_t * p_synth, uint8_t part, uint8_t volume)
+{
+    synth_event_t event = {SYNTH_EVENT_VOLUME, part, 0, 0,
+                           (float) volume / 100.0f};
+
+    if (part < PRESET_NUM_PART)
+    {
+        p_synth->ctl.part[part].volume = volume;
+    }
+
+    return (queue_push(&p_synth->queue, &event));
+}   /* synth_set_volume() */
+
+uint8_t
+synth_set_waveform (synth_t * p_synth, uint8_t part, uint8_t wave,
+                    osc_mode_t mode)
+{
+    synth_event_t event = {SYNTH_EVENT_WAVEFORM, part, wave, (uint8_t) mode,
+                           0.0f};
+
+    if (wave >= SYNTH_NUM_WAVE)
+    {
+        return (0);
+    }
+
+    if (part < PRESET_NUM_PART)
+    {
+        p_synth->ctl.part[part].wave = wave;
+        p_synth->ctl.part[part].mode = (uint8_t) mode;
+    }
+
+    return (queue_push(&p_synth->queue, &event));
+}   /* synth_set_waveform() */
+
+uint8_t
+synth_set_unison (synth_t * p_synth, uint8_t part, uint8_t count,
+                  float detune_cents, float spread)
+{
+    synth_event_t event = {SYNTH_EVENT_UNISON, part, 0, 0, detune_cents};
+
+    count = (count > UNISON_MAX) ? UNISON_MAX : ((0 == count) ? 1 : count);
+    spread = (spread > 1.0f) ? 1.0f : ((spread < 0.0f) ? 0.0f : spread);
+    event.arg1 = count;
+    event.arg2 = (uint8_t) (spread * 100.0f + 0.5f);
+
+    if (part < PRESET_NUM_PART)
+    {
+        p_synth->ctl.part[part].unison = count;
+        p_synth->ctl.detune[part] = detune_cents;
+        p_synth->ctl.spread[part] = (float) event.arg2 / 100.0f;
+    }
+
+    return (queue_push(&p_synth->queue, &event));
+}   /* synth_set_unison() */
+
+uint8_t
+synth_set_cc (synth_t * p_synth, uint8_t cc, uint8_t value)
+{
+    synth_event_t event = {SYNTH_EVENT_CC, 0, cc, value, 0.0f};
+
+    return (queue_push(&p_synth->queue, &event));
+}   /* synth_set_cc() */
+
+uint8_t
+synth_fx_enable (synth_t * p_synth, fx_id_t id, uint8_t enable)
+{
+    synth_event_t event = {SYNTH_EVENT_FX_ENABLE, 0, (uint8_t) id, enable,
+                           0.0f};
+
+    p_synth->ctl.fx_mask = (uint8_t) ((p_synth->ctl.fx_mask & ~(1U << id))
+                                      | ((enable ? 1U : 0U) << id));
+
+    return (queue_push(&p_synth->queue, &event));
+}   /* synth_fx_enable() */
+
+uint8_t
+synth_fx_param (synth_t * p_synth, fx_id_t id, fx_param_t param, float value)
+{
+    synth_event_t event = {SYNTH_EVENT_FX_PARAM, 0, (uint8_t) id,
+                           (uint8_t) param, value};
+    int32_t idx = preset_fx_index(id, param);
+
+    if (idx >= 0)
+    {
+        p_synth->ctl.fx[idx] = value;
+    }
+
+    return (queue_push(&p_synth->queue, &event));
+}   /* synth_fx_param() */
+
+mod_patch_t *
+synth_mod_edit (synth_t * p_synth)
+{
+    return (mod_edit(&p_synth->mod));
+}   /* synth_mod_edit() */
+
+uint8_t
+synth_mod_commit (synth_t * p_synth)
+{
+    if (!mod_commit(&p_synth->mod))
+    {
+        return (0);
+    }
+
+    p_synth->ctl.mod = *mod_edit(&p_synth->mod);
+
+    return (1);
+}   /* synth_mod_commit() */
+
+void
+synth_set_preset (synth_t * p_synth, const preset_t * p_preset)
+{
+    // The matrix is compiled here, on the control side that owns it; the
+    // program is picked up at the block boundary with the rest.
+    //
+    p_synth->ctl = *p_preset;
+    *mod_edit(&p_synth->mod) = p_preset->mod;
+
+    if (!mod_commit(&p_synth->mod))
+    {
+        static const mod_patch_t patch = MOD_PATCH_DEFAULT;
+
+        *mod_edit(&p_synth->mod) = patch;
+        (void) mod_commit(&p_synth->mod);
+    }
+
+    p_synth->ctl.mod = *mod_edit(&p_synth->mod);
+    p_synth->p_preset_next.store(p_preset, std::memory_order_release);
+}   /* synth_set_preset() */
+
+void
+synth_get_preset (const synth_t * p_synth, preset_t * p_preset)
+{
+    *p_preset = p_synth->ctl;
+}   /* synth_get_preset() */
+
+void
+synth_render (synth_t * p_synth, int16_t * p_out, uint32_t frames)
+{
+    while (frames > 0)
+    {
+        uint32_t block = (frames > SYNTH_BLOCK_SIZE) ? SYNTH_BLOCK_SIZE
+                                                     : frames;
+
+        // Fast routings update more often than once a block.
+        //
+        block = mod_begin(&p_synth->mod, block);
+
+        // Sequencer notes start on their sample: render up to the next one.
+        //
+        if (NULL != p_synth->p_seq)
+        {
+            block = seq_run(p_synth->p_seq, block, seq_emit, p_synth);
+        }
+
+        render_block(p_synth, p_out, block);
+        p_out += 2 * block;
+        frames -= block;
+    }
+}   /* synth_render() */
@@ -0,0 +1,257 @@
+#ifndef SYNTH_H
+
+#   define SYNTH_H
+#   include <stdint.h>
+#   include <atomic>
+#   include "fx.h"
+#   include "osc.h"
+#   include "wsched.h"
+#   include "synth_tables.h"
+#   include "scope.h"
+#   include "seq.h"
+#   include "looper.h"
+#   include "rec.h"
+#   include "preset.h"
+#   include "sampler.h"
+#   include "fm.h"
+#   include "unison.h"
+#   include "mod.h"
+
+#   ifndef SYNTH_SAMPLE_RATE
+#       define SYNTH_SAMPLE_RATE    (48000)
+#   endif
+#   define SYNTH_BLOCK_SIZE     (64)
+#   ifndef SYNTH_NUM_VOICE
+#       if WSCHED_THREADS
+#           define SYNTH_NUM_VOICE  (128)   /* One per MIDI note */
+#       else
+#           define SYNTH_NUM_VOICE  (16)
+#       endif
+#   endif
+#   define SYNTH_NUM_EVENT      (64)     /* Power of two */
+
+// Part waveforms, in waveform dropdown order: the oscillator shapes, the
+// FM patches, then the sample set.
+//
+#   define SYNTH_WAVE_FM        (OSC_NUM_WAVE)
+#   define SYNTH_WAVE_SAMPLE    (SYNTH_WAVE_FM + FM_NUM_PATCH)
+#   define SYNTH_NUM_WAVE       (SYNTH_WAVE_SAMPLE + 1)
+
+// Parts are the timbres (instruments) sharing one engine: they draw from
+// the same voice pool and play through the same effects, so an extra part
+// costs a few bytes rather than another set of voices and delay lines.
+//
+#   ifndef SYNTH_NUM_PART
+#       define SYNTH_NUM_PART   (4)
+#   endif
+
+// Parallel render splits the voices into fixed chunks, each mixed into its
+// own buffer; the chunks are then summed in order, so the output does not
+// depend on the thread count or on which thread ran which chunk.
+//
+#   define SYNTH_TASK_VOICES    (4)
+#   define SYNTH_NUM_TASK       ((SYNTH_NUM_VOICE + SYNTH_TASK_VOICES - 1) \
+                                 / SYNTH_TASK_VOICES)
+
+typedef enum synth_event_type_t
+{
+    SYNTH_EVENT_NOTE_ON = 0,
+    SYNTH_EVENT_NOTE_OFF,
+    SYNTH_EVENT_VOLUME,
+    SYNTH_EVENT_WAVEFORM,
+    SYNTH_EVENT_FX_ENABLE,
+    SYNTH_EVENT_FX_PARAM,
+    SYNTH_EVENT_UNISON,
+    SYNTH_EVENT_CC
+} synth_event_type_t;
+
+typedef struct synth_event_t
+{
+    uint8_t type;
+    uint8_t part;
+    uint8_t arg1;
+    uint8_t arg2;
+    float value;
+} synth_event_t;
+
+// Single producer (UI) / single consumer (audio) ring of events, drained
+// at the start of every block.
+//
+typedef struct synth_queue_t
+{
+    synth_event_t event[SYNTH_NUM_EVENT];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+} synth_queue_t;
+
+typedef struct synth_voice_t
+{
+    uint8_t active;
+    uint8_t gate;
+    uint8_t note;
+    uint8_t part;
+    osc_t osc;
+    sampler_voice_t sample; /* Parts playing SYNTH_WAVE_SAMPLE */
+    fm_voice_t fm;          /* Parts playing an FM patch */
+    unison_t unison;        /* Oscillator parts with unison on */
+    mod_voice_t mod;
+    float velocity;
+    float env;
+    float env_step;
+    uint32_t age;
+} synth_voice_t;
+
+typedef struct synth_part_t
+{
+    float volume;
+    uint8_t wave;
+    uint8_t mode;
+    uint8_t unison;         /* Copies per voice, 1: off */
+    float detune;           /* Cents, either side */
+    float spread;           /* 0 .. 1 */
+} synth_part_t;
+
+typedef struct synth_t
+{
+    uint32_t sample_rate;
+    const synth_tables_t * p_tables;
+    synth_queue_t queue;
+    synth_voice_t voice[SYNTH_NUM_VOICE];
+    uint32_t age;
+    synth_part_t part[SYNTH_NUM_PART];
+    uint8_t num_part;
+    fx_rack_t fx;
+    scope_t * p_scope;
+    seq_t * p_seq;
+    looper_t * p_looper;
+    rec_t * p_rec;
+    sampler_t * p_sampler;
+    std::atomic<const preset_t *> p_preset_next;    /* Taken by the audio side */
+    preset_t ctl;           /* Control side view of the sound, for storing */
+    mod_t mod;
+    float mix_left[SYNTH_BLOCK_SIZE];
+    float mix_right[SYNTH_BLOCK_SIZE];
+    float mix_side[SYNTH_BLOCK_SIZE];   /* Left - right, over two */
+    float voice_buf[FM_LANES][SYNTH_BLOCK_SIZE];
+#   if WSCHED_THREADS
+    wsched_t * p_sched;
+    uint8_t b_parallel;
+    float (* p_scratch)[SYNTH_BLOCK_SIZE];  /* FM_LANES per worker */
+    uint32_t task_frames;
+    uint8_t task_active[SYNTH_NUM_TASK];
+    float task_buf[SYNTH_NUM_TASK][SYNTH_BLOCK_SIZE];
+    float task_side[SYNTH_NUM_TASK][SYNTH_BLOCK_SIZE];
+#   endif
+} synth_t;
+
+typedef struct synth_bench_t
+{
+    float mean_us;
+    float worst_us;
+    float miss_pct;         /* Blocks over SYNTH_BLOCK_SIZE / sample rate */
+    uint32_t checksum;      /* Of the output: equal for every thread count */
+    float fx_us[FX_NUM];    /* Mean per block of each stage, fx_get_cost() */
+} synth_bench_t;
+
+uint8_t synth_init(synth_t * p_synth, mem_arena_t * p_arena,
+                   uint32_t sample_rate);
+
+// Stops the render threads and drops the shared tables. The arena memory
+// stays with the arena.
+//
+void synth_deinit(synth_t * p_synth);
+
+// Claim the next part for an instrument, -1 when all are taken. Init time
+// only, before audio starts.
+//
+int32_t synth_part_add(synth_t * p_synth);
+
+// Render voices on `num_thread` threads (the audio thread included), 1 to
+// go back to serial. Native only, call while audio is stopped.
+//
+uint8_t synth_set_threads(synth_t * p_synth, mem_arena_t * p_arena,
+                          uint32_t num_thread);
+
+// Copy the output into `p_scope` (NULL to stop). Call while audio is
+// stopped.
+//
+void synth_set_scope(synth_t * p_synth, scope_t * p_scope);
+
+// Play `p_seq` (NULL to stop) on the audio clock: blocks are cut at each
+// of its events. Call while audio is stopped.
+//
+void synth_set_seq(synth_t * p_synth, seq_t * p_seq);
+
+// Output taps, in this order after the engine: the looper mixes into the
+// output, the recorder copies the result. NULL to remove, call while
+// audio is stopped.
+//
+void synth_set_looper(synth_t * p_synth, looper_t * p_looper);
+void synth_set_rec(synth_t * p_synth, rec_t * p_rec);
+
+// Sample set played by parts set to SYNTH_WAVE_SAMPLE (NULL: they play a
+// sine).
+// Call while audio is stopped.
+//
+void synth_set_sampler(synth_t * p_synth, sampler_t * p_sampler);
+
+// Control side, safe to call from the UI thread while audio is running.
+//
+uint8_t synth_note_on(synth_t * p_synth, uint8_t part, uint8_t note,
+                      uint8_t velocity);
+uint8_t synth_note_off(synth_t * p_synth, uint8_t part, uint8_t note);
+uint8_t synth_set_volume(synth_t * p_synth, uint8_t part, uint8_t volume);
+
+// `wave` is a SYNTH_WAVE_* index (an oscillator shape, an FM patch or the
+// sample set); 0 and nothing sent past SYNTH_NUM_WAVE.
+//
+uint8_t synth_set_waveform(synth_t * p_synth, uint8_t part, uint8_t wave,
+                           osc_mode_t mode);
+
+// Play each note of `part` as `count` detuned copies (1 to UNISON_MAX, 1:
+// off), `detune_cents` either side, `spread` 0 (mono) to 1 across the
+// stereo field. Oscillator waveforms only; notes already sounding keep
+// their stack.
+//
+uint8_t synth_set_unison(synth_t * p_synth, uint8_t part, uint8_t count,
+                         float detune_cents, float spread);
+// MIDI control change: a source of the modulation matrix.
+//
+uint8_t synth_set_cc(synth_t * p_synth, uint8_t cc, uint8_t value);
+uint8_t synth_fx_enable(synth_t * p_synth, fx_id_t id, uint8_t enable);
+uint8_t synth_fx_param(synth_t * p_synth, fx_id_t id, fx_param_t param,
+                       float value);
+
+// Modulation matrix, see mod.h: edit the routings, then commit them;
+// voices pick the new routings up at the next block. A committed matrix
+// is part of the preset synth_get_preset() returns.
+//
+mod_patch_t * synth_mod_edit(synth_t * p_synth);
+uint8_t synth_mod_commit(synth_t * p_synth);
+
+// Switch the whole sound to `p_preset` at the next block boundary: one
+// pointer store, no queue slots, no copy on the audio side. The record is
+// read once, when the block applies it, so it must stay in place (bank
+// image, flash) until then. A later switch before that block replaces it.
+// Events still queued when the block starts apply after the preset, so a
+// change made right after the switch is not lost. The preset's matrix
+// replaces the one being edited; a matrix the engine cannot run (a part
+// it does not have) leaves every slot off.
+//
+void synth_set_preset(synth_t * p_synth, const preset_t * p_preset);
+
+// The sound as set from the control side so far, to store as a preset.
+//
+void synth_get_preset(const synth_t * p_synth, preset_t * p_preset);
+
+// Audio side: interleaved stereo, any number of frames.
+//
+void synth_render(synth_t * p_synth, int16_t * p_out, uint32_t frames);
+
+// Render time per block for `num_voice` voices of uneven cost, through
+// the whole effects rack.
+//
+uint8_t synth_bench(uint32_t num_voice, uint32_t num_thread,
+                    uint32_t num_block, synth_bench_t * p_result);
+
+#endif /* SYNTH_H */
@@ -0,0 +1,116 @@
+#include "synth.h"
+#include "perf.h"
+#include <stdlib.h>
+
+#define BENCH_WARMUP        (16)
+#define BENCH_BATCH         (30)    /* Voices started per block, 2 events each */
+
+uint8_t
+synth_bench (uint32_t num_voice, uint32_t num_thread, uint32_t num_block,
+             synth_bench_t * p_result)
+{
+    static int16_t out[2 * SYNTH_BLOCK_SIZE];
+    uint32_t arena_size = FX_ARENA_SIZE(SYNTH_SAMPLE_RATE) + sizeof(synth_t)
+                          + 64U * 1024U;
+    uint64_t deadline_ns = (uint64_t) SYNTH_BLOCK_SIZE * 1000000000ULL
+                           / SYNTH_SAMPLE_RATE;
+    void * p_mem = malloc(arena_size);
+    mem_arena_t arena;
+    synth_t * p_synth = NULL;
+    uint64_t total_ns = 0;
+    uint32_t worst_ns = 0;
+    uint32_t miss = 0;
+    uint32_t hash = 2166136261U;
+    uint8_t ret = 0;
+
+    if ((NULL == p_mem) || (num_voice > SYNTH_NUM_VOICE) || (0 == num_block))
+    {
+        free(p_mem);
+
+        return (0);
+    }
+
+    perf_init();
+    mem_arena_init(&arena, p_mem, arena_size);
+    p_synth = (synth_t *) mem_arena_alloc(&arena, sizeof(synth_t));
+
+    if ((NULL == p_synth)
+        || !synth_init(p_synth, &arena, SYNTH_SAMPLE_RATE)
+        || !synth_set_threads(p_synth, &arena, num_thread))
+    {
+        goto done;
+    }
+
+    synth_set_volume(p_synth, 0, 1);
+
+    for (uint32_t id = 0; id < FX_NUM; ++id)
+    {
+        synth_fx_enable(p_synth, (fx_id_t) id, 1);
+    }
+
+    // Mixed waveforms and oscillator modes, so voices differ in cost and
+    // the work has to be balanced by stealing rather than by the split.
+    //
+    for (uint32_t voice = 0; voice < num_voice; ++voice)
+    {
+        synth_set_waveform(p_synth, 0, (uint8_t) (voice % 3),
+                           (0 == (voice / 3) % 2) ? OSC_MODE_TABLE
+                                                  : OSC_MODE_BLEP);
+        synth_note_on(p_synth, 0, (uint8_t) voice, 100);
+
+        if (BENCH_BATCH - 1 == voice % BENCH_BATCH)
+        {
+            synth_render(p_synth, out, SYNTH_BLOCK_SIZE);
+        }
+    }
+
+    for (uint32_t block = 0; block < BENCH_WARMUP; ++block)
+    {
+        synth_render(p_synth, out, SYNTH_BLOCK_SIZE);
+    }
+
+    for (uint32_t block = 0; block < num_block; ++block)
+    {
+        uint32_t start = perf_ticks();
+        uint32_t ns = 0;
+
+        synth_render(p_synth, out, SYNTH_BLOCK_SIZE);
+        ns = perf_ticks_to_ns(perf_ticks() - start);
+        total_ns += ns;
+        worst_ns = (ns > worst_ns) ? ns : worst_ns;
+        miss += (ns > deadline_ns) ? 1 : 0;
+
+        for (uint32_t idx = 0; idx < 2 * SYNTH_BLOCK_SIZE; ++idx)
+        {
+            hash = (hash ^ (uint16_t) out[idx]) * 16777619U;
+        }
+    }
+
+    p_result->mean_us = (float) total_ns / num_block / 1000.0f;
+    p_result->worst_us = (float) worst_ns / 1000.0f;
+    p_result->miss_pct = 100.0f * miss / num_block;
+    p_result->checksum = hash;
+
+    for (uint32_t id = 0; id < FX_NUM; ++id)
+    {
+        const perf_counter_t * p_cost = fx_get_cost(&p_synth->fx,
+                                                    (fx_id_t) id);
+        uint64_t mean = (0 == p_cost->count) ? 0
+                        : p_cost->total / p_cost->count;
+
+        p_result->fx_us[id] = (float) perf_ticks_to_ns((uint32_t) mean)
+                              / 1000.0f;
+    }
+
+    ret = 1;
+
+done:
+    if (NULL != p_synth)
+    {
+        synth_deinit(p_synth);
+    }
+
+    free(p_mem);
+
+    return (ret);
+}   /* synth_bench() */
@@ -0,0 +1,125 @@
+#include "synth_tables.h"
+#include "osc.h"
+#include <atomic>
+#include <math.h>
+
+static synth_tables_t g_tables[SYNTH_TABLE_SLOTS] = {};
+static std::atomic_flag g_lock = ATOMIC_FLAG_INIT;
+
+static void
+tables_lock (void)
+{
+    while (g_lock.test_and_set(std::memory_order_acquire))
+    {
+    }
+}   /* tables_lock() */
+
+static void
+tables_unlock (void)
+{
+    g_lock.clear(std::memory_order_release);
+}   /* tables_unlock() */
+
+static void
+tables_build (synth_tables_t * p_tables, uint32_t sample_rate)
+{
+    for (uint32_t idx = 0; idx < SYNTH_NUM_NOTE; ++idx)
+    {
+        double freq = pow(2.0, ((double) idx - 69.0) / 12.0) * 440.0;
+
+        p_tables->note_inc[idx] = (uint32_t) (freq / sample_rate
+                                              * 4294967296.0);
+    }
+
+    p_tables->sample_rate = sample_rate;
+}   /* tables_build() */
+
+const synth_tables_t *
+synth_tables_acquire (uint32_t sample_rate)
+{
+    synth_tables_t * p_hit = NULL;
+    synth_tables_t * p_free = NULL;
+
+    if (0 == sample_rate)
+    {
+        return (NULL);
+    }
+
+    tables_lock();
+    osc_init();
+
+    for (uint32_t idx = 0; idx < SYNTH_TABLE_SLOTS; ++idx)
+    {
+        synth_tables_t * p_slot = &g_tables[idx];
+
+        if (sample_rate == p_slot->sample_rate)
+        {
+            p_hit = p_slot;
+            break;
+        }
+
+        if ((NULL == p_free) && (0 == p_slot->ref))
+        {
+            p_free = p_slot;
+        }
+    }
+
+    if ((NULL == p_hit) && (NULL != p_free))
+    {
+        tables_build(p_free, sample_rate);
+        p_hit = p_free;
+    }
+
+    if (NULL != p_hit)
+    {
+        ++p_hit->ref;
+    }
+
+    tables_unlock();
+
+    return (p_hit);
+}   /* synth_tables_acquire() */
+
+void
+synth_tables_release (const synth_tables_t * p_tables)
+{
+    if (NULL == p_tables)
+    {
+        return;
+    }
+
+    tables_lock();
+
+    for (uint32_t idx = 0; idx < SYNTH_TABLE_SLOTS; ++idx)
+    {
+        // Unreferenced slots keep their rate, so an engine restarted at
+        // the same rate skips the rebuild.
+        //
+        if ((p_tables == &g_tables[idx]) && (g_tables[idx].ref > 0))
+        {
+            --g_tables[idx].ref;
+        }
+    }
+
+    tables_unlock();
+}   /* synth_tables_release() */
+
+uint32_t
+synth_tables_refs (uint32_t sample_rate)
+{
+    uint32_t ref = 0;
+
+    tables_lock();
+
+    for (uint32_t idx = 0; idx < SYNTH_TABLE_SLOTS; ++idx)
+    {
+        if (sample_rate == g_tables[idx].sample_rate)
+        {
+            ref = g_tables[idx].ref;
+        }
+    }
+
+    tables_unlock();
+
+    return (ref);
+}   /* synth_tables_refs() */
@@ -0,0 +1,29 @@
+#ifndef SYNTH_TABLES_H
+
+#   define SYNTH_TABLES_H
+#   include <stdint.h>
+
+// Read-only tables shared by every engine running at the same sample rate.
+// The first acquire builds them (and the oscillator wavetables, which do
+// not depend on the rate), later ones only take a reference; a slot whose
+// last reference is released is rebuilt for the next rate asked for.
+//
+#   define SYNTH_NUM_NOTE           (128)
+#   ifndef SYNTH_TABLE_SLOTS
+#       define SYNTH_TABLE_SLOTS    (2)     /* Distinct live sample rates */
+#   endif
+
+typedef struct synth_tables_t
+{
+    uint32_t sample_rate;
+    uint32_t ref;
+    uint32_t note_inc[SYNTH_NUM_NOTE];  /* Oscillator phase step per note */
+} synth_tables_t;
+
+// Init time only: both take a lock, so do not call them from audio.
+//
+const synth_tables_t * synth_tables_acquire(uint32_t sample_rate);
+void synth_tables_release(const synth_tables_t * p_tables);
+uint32_t synth_tables_refs(uint32_t sample_rate);
+
+#endif /* SYNTH_TABLES_H */
@@ -0,0 +1,189 @@
+#include "unison.h"
+#include <math.h>
+
+#define UNISON_FRAC_SCALE   (1.0f / (float) (1U << OSC_FRAC_BITS))
+#define UNISON_FRAC_MASK    ((1U << OSC_FRAC_BITS) - 1)
+#define UNISON_T_SCALE      (1.0f / 16777216.0f)    /* Phase >> 8 to 0 .. 1 */
+#define UNISON_CHUNK        (64)    /* Frames per pass, multiple of lanes */
+
+// UNISON_LANES samples at once. GCC and Clang map these onto the host's
+// SIMD registers, or split them into scalars on cores without any.
+//
+typedef float v4f_t __attribute__((vector_size(4 * sizeof(float))));
+typedef uint32_t v4u_t __attribute__((vector_size(4 * sizeof(uint32_t))));
+typedef int32_t v4i_t __attribute__((vector_size(4 * sizeof(int32_t))));
+
+static_assert(4 == UNISON_LANES, "unison lanes are four floats wide");
+
+// Position of copy `idx` of `count` in the stack, -1 .. 1.
+//
+static inline float
+stack_pos (uint32_t idx, uint32_t count)
+{
+    return ((count > 1) ? 2.0f * (float) idx / (float) (count - 1) - 1.0f
+                        : 0.0f);
+}   /* stack_pos() */
+
+static inline v4f_t
+phase_to_t (v4u_t phase)
+{
+    return (__builtin_convertvector((v4i_t) (phase >> 8), v4f_t)
+            * UNISON_T_SCALE);
+}   /* phase_to_t() */
+
+// PolyBLEP residual around the reset at t = 0 (branch-free: every lane
+// computes both sides and keeps the one it is near, if any).
+//
+static inline v4f_t
+poly_blep (v4f_t t, v4f_t dt, v4f_t inv_dt)
+{
+    v4f_t x0 = t * inv_dt - 1.0f;
+    v4f_t x1 = (t - 1.0f) * inv_dt + 1.0f;
+    v4f_t blep = (t < dt) ? -x0 * x0 : 0.0f;
+
+    return ((t > 1.0f - dt) ? x1 * x1 : blep);
+}   /* poly_blep() */
+
+// One copy into `p_mid` / `p_side` (UNISON_LANES frames per vector).
+// Saw and square are computed, the lanes holding consecutive samples so
+// nothing is summed across them; the other waves read `p_table`.
+//
+static void
+render_copy (uint32_t * p_phase, uint32_t inc, osc_wave_t wave,
+             const float * p_table, float gain_mid, float gain_side,
+             v4f_t * p_mid, v4f_t * p_side, uint32_t frames)
+{
+    const uint32_t num_vec = (frames + UNISON_LANES - 1) / UNISON_LANES;
+    const float dt_lane = (float) inc * (1.0f / 4294967296.0f);
+    const v4f_t dt = {dt_lane, dt_lane, dt_lane, dt_lane};
+    const v4f_t inv_dt = 1.0f / dt;
+    v4u_t phase = *p_phase + (v4u_t) {0, inc, 2 * inc, 3 * inc};
+
+    if (OSC_SAW == wave)
+    {
+        for (uint32_t vec = 0; vec < num_vec; ++vec)
+        {
+            // Reset at half the period, in phase with the table saw.
+            //
+            v4f_t t = phase_to_t(phase + 0x80000000U);
+            v4f_t y = 2.0f * t - 1.0f - poly_blep(t, dt, inv_dt);
+
+            p_mid[vec] += y * gain_mid;
+            p_side[vec] += y * gain_side;
+            phase += UNISON_LANES * inc;
+        }
+    }
+    else if (OSC_SQUARE == wave)
+    {
+        for (uint32_t vec = 0; vec < num_vec; ++vec)
+        {
+            v4f_t t = phase_to_t(phase);
+            v4f_t t2 = phase_to_t(phase + 0x80000000U);
+            v4f_t y = (t < 0.5f) ? 1.0f : -1.0f;
+
+            y += poly_blep(t, dt, inv_dt) - poly_blep(t2, dt, inv_dt);
+            p_mid[vec] += y * gain_mid;
+            p_side[vec] += y * gain_side;
+            phase += UNISON_LANES * inc;
+        }
+    }
+    else
+    {
+        float * p_mid_out = (float *) p_mid;
+        float * p_side_out = (float *) p_side;
+        uint32_t pos_phase = *p_phase;
+
+        for (uint32_t idx = 0; idx < frames; ++idx)
+        {
+            uint32_t pos = pos_phase >> OSC_FRAC_BITS;
+            float frac = (float) (pos_phase & UNISON_FRAC_MASK)
+                         * UNISON_FRAC_SCALE;
+            float a = p_table[pos];
+            float s = a + (p_table[pos + 1] - a) * frac;
+
+            p_mid_out[idx] += s * gain_mid;
+            p_side_out[idx] += s * gain_side;
+            pos_phase += inc;
+        }
+    }
+
+    *p_phase += frames * inc;
+}   /* render_copy() */
+
+void
+unison_start (unison_t * p_unison, uint32_t inc, uint8_t count,
+              float detune_cents, uint8_t b_restart)
+{
+    count = (count > UNISON_MAX) ? UNISON_MAX : ((0 == count) ? 1 : count);
+
+    for (uint32_t idx = 0; idx < count; ++idx)
+    {
+        float cents = stack_pos(idx, count) * detune_cents;
+
+        // As an offset, so a copy at the centre stays exactly on the note.
+        //
+        p_unison->inc[idx] = inc + (uint32_t) (int32_t) ((float) inc
+                                 * (exp2f(cents / 1200.0f) - 1.0f));
+
+        // Scattered start phases (a fixed hash, so renders repeat): evenly
+        // spaced ones would cancel into a quiet saw an octave up.
+        //
+        if (b_restart || (idx >= p_unison->count))
+        {
+            uint32_t hash = (idx + 1U) * 0x9E3779B9U;
+
+            hash ^= hash >> 15;
+            hash *= 0x2C1B3C6DU;
+            hash ^= hash >> 12;
+            p_unison->phase[idx] = (0 == idx) ? 0 : hash;
+        }
+    }
+
+    p_unison->count = count;
+}   /* unison_start() */
+
+void
+unison_render (unison_t * p_unison, osc_wave_t wave, float spread,
+               float * p_mid, float * p_side, uint32_t frames)
+{
+    const uint32_t count = p_unison->count;
+    const float gain = 1.0f / sqrtf((float) count);
+    v4f_t mid[UNISON_CHUNK / UNISON_LANES];
+    v4f_t side[UNISON_CHUNK / UNISON_LANES];
+
+    // The top copy picks the table, so none of them aliases.
+    //
+    const float * p_table = osc_table(wave, p_unison->inc[count - 1]);
+
+    while (frames > 0)
+    {
+        uint32_t chunk = (frames > UNISON_CHUNK) ? UNISON_CHUNK : frames;
+
+        for (uint32_t vec = 0; vec < UNISON_CHUNK / UNISON_LANES; ++vec)
+        {
+            mid[vec] = (v4f_t) {0.0f, 0.0f, 0.0f, 0.0f};
+            side[vec] = mid[vec];
+        }
+
+        // Neighbours in pitch go to opposite sides.
+        //
+        for (uint32_t copy = 0; copy < count; ++copy)
+        {
+            render_copy(&p_unison->phase[copy], p_unison->inc[copy], wave,
+                        p_table, gain,
+                        gain * spread * stack_pos(copy, count)
+                        * ((copy & 1U) ? -1.0f : 1.0f),
+                        mid, side, chunk);
+        }
+
+        for (uint32_t idx = 0; idx < chunk; ++idx)
+        {
+            p_mid[idx] += ((const float *) mid)[idx];
+            p_side[idx] += ((const float *) side)[idx];
+        }
+
+        p_mid += chunk;
+        p_side += chunk;
+        frames -= chunk;
+    }
+}   /* unison_render() */
@@ -0,0 +1,63 @@
+#ifndef UNISON_H
+
+#   define UNISON_H
+#   include <stdint.h>
+#   include "osc.h"
+
+// Unison: one voice playing a stack of detuned copies of its oscillator,
+// spread across the stereo field. The copies share the voice's note,
+// envelope and mix, so a stack of 8 costs a fraction of 8 voices. Saw and
+// square copies are computed (PolyBLEP) UNISON_LANES samples per SIMD
+// vector; sine and triangle read the band-limited tables. Detune is spread
+// evenly from -detune to +detune; neighbours in pitch go to opposite
+// sides.
+//
+// Output is mid / side: left is mid + side, right is mid - side.
+//
+#   ifndef UNISON_MAX
+#       define UNISON_MAX   (16)    /* Copies per voice, state in every voice */
+#   endif
+#   define UNISON_LANES     (4)
+#   define UNISON_DETUNE    (20.0f)     /* Cents, either side of the note */
+#   define UNISON_SPREAD    (0.6f)      /* 0: mono .. 1: hard left / right */
+
+// Inside the synth voice.
+//
+typedef struct unison_t
+{
+    uint8_t count;          /* Copies playing, 0 or 1: not a unison voice */
+    uint32_t phase[UNISON_MAX];
+    uint32_t inc[UNISON_MAX];
+} unison_t;
+
+typedef struct unison_bench_t
+{
+    uint32_t unison_ns;     /* One voice of `count` copies, one block */
+    uint32_t voices_ns;     /* `count` separate oscillators, mixed */
+    float speedup;
+    uint32_t checksum;      /* First blocks of the stack, as 16-bit PCM */
+    float peak;             /* Largest sample of those blocks, mid */
+} unison_bench_t;
+
+// Audio side. `inc` is the note's phase step. A voice already playing
+// keeps its phases (retrigger); a new one starts them spread over the
+// period so the stack does not start as one loud copy.
+//
+void unison_start(unison_t * p_unison, uint32_t inc, uint8_t count,
+                  float detune_cents, uint8_t b_restart);
+
+// Add `frames` samples of `wave` into `p_mid` and `p_side`. Each copy is
+// at 1 / sqrt(count), so a wider stack is about as loud.
+//
+void unison_render(unison_t * p_unison, osc_wave_t wave, float spread,
+                   float * p_mid, float * p_side, uint32_t frames);
+
+// A unison voice of `count` copies against `count` plain oscillator
+// voices mixed to stereo, at `note`. The checksum and peak come from a
+// fresh stack, so they are the same on every run of a build; the times
+// are the host's.
+//
+void unison_bench(uint8_t count, uint8_t note, uint32_t sample_rate,
+                  unison_bench_t * p_result);
+
+#endif /* UNISON_H */
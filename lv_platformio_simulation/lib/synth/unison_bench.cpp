@@ -0,0 +1,135 @@
+#include "unison.h"
+#include "osc.h"
+#include "perf.h"
+#include "synth.h"
+#include <math.h>
+#include <string.h>
+
+#define BENCH_WARMUP        (64)
+#define BENCH_BLOCKS        (4096)
+#define BENCH_CHECK_BLOCKS  (16)
+
+static uint32_t
+note_phase_inc (uint8_t note, uint32_t sample_rate)
+{
+    double freq = pow(2.0, ((double) note - 69.0) / 12.0) * 440.0;
+
+    return ((uint32_t) (freq / sample_rate * 4294967296.0));
+}   /* note_phase_inc() */
+
+// The same stack as separate voices: an oscillator each, mixed into mid
+// and side with its own gains as the synth would.
+//
+static void
+voices_block (osc_t * p_osc, uint32_t count, float * p_buf, float * p_mid,
+              float * p_side)
+{
+    const float gain = 1.0f / sqrtf((float) count);
+
+    for (uint32_t voice = 0; voice < count; ++voice)
+    {
+        float side = gain * UNISON_SPREAD
+                     * ((voice & 1U) ? -1.0f : 1.0f);
+
+        osc_render(&p_osc[voice], p_buf, SYNTH_BLOCK_SIZE);
+
+        for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx)
+        {
+            p_mid[idx] += p_buf[idx] * gain;
+            p_side[idx] += p_buf[idx] * side;
+        }
+    }
+}   /* voices_block() */
+
+static uint32_t
+pcm_hash (uint32_t hash, const float * p_buf, uint32_t frames)
+{
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        float value = p_buf[idx] * 32767.0f;
+        int16_t pcm = (int16_t) ((value > 32767.0f) ? 32767.0f
+                                 : ((value < -32768.0f) ? -32768.0f : value));
+
+        hash = (hash ^ (uint16_t) pcm) * 16777619U;
+    }
+
+    return (hash);
+}   /* pcm_hash() */
+
+void
+unison_bench (uint8_t count, uint8_t note, uint32_t sample_rate,
+              unison_bench_t * p_result)
+{
+    static float buf[SYNTH_BLOCK_SIZE];
+    static float mid[SYNTH_BLOCK_SIZE];
+    static float side[SYNTH_BLOCK_SIZE];
+    static osc_t osc[UNISON_MAX];
+    static unison_t unison;
+    uint32_t inc = note_phase_inc(note, sample_rate);
+    uint32_t start = 0;
+    uint64_t unison_ticks = 0;
+    uint64_t voices_ticks = 0;
+    uint32_t hash = 2166136261U;
+    float peak = 0.0f;
+
+    osc_init();
+    count = (count > UNISON_MAX) ? UNISON_MAX : ((0 == count) ? 1 : count);
+    unison_start(&unison, inc, count, UNISON_DETUNE, 1);
+
+    for (uint32_t voice = 0; voice < count; ++voice)
+    {
+        osc[voice].phase = unison.phase[voice];
+        osc[voice].phase_inc = unison.inc[voice];
+        osc[voice].wave = OSC_SAW;
+        osc[voice].mode = OSC_DEFAULT_MODE;
+    }
+
+    for (uint32_t idx = 0; idx < BENCH_CHECK_BLOCKS; ++idx)
+    {
+        memset(mid, 0, sizeof(mid));
+        memset(side, 0, sizeof(side));
+        unison_render(&unison, OSC_SAW, UNISON_SPREAD, mid, side,
+                      SYNTH_BLOCK_SIZE);
+        hash = pcm_hash(pcm_hash(hash, mid, SYNTH_BLOCK_SIZE), side,
+                        SYNTH_BLOCK_SIZE);
+
+        for (uint32_t frame = 0; frame < SYNTH_BLOCK_SIZE; ++frame)
+        {
+            peak = (fabsf(mid[frame]) > peak) ? fabsf(mid[frame]) : peak;
+        }
+    }
+
+    p_result->checksum = hash;
+    p_result->peak = peak;
+
+    for (uint32_t idx = 0; idx < BENCH_WARMUP; ++idx)
+    {
+        unison_render(&unison, OSC_SAW, UNISON_SPREAD, mid, side,
+                      SYNTH_BLOCK_SIZE);
+        voices_block(osc, count, buf, mid, side);
+    }
+
+    for (uint32_t idx = 0; idx < BENCH_BLOCKS; ++idx)
+    {
+        memset(mid, 0, sizeof(mid));
+        memset(side, 0, sizeof(side));
+        start = perf_ticks();
+        unison_render(&unison, OSC_SAW, UNISON_SPREAD, mid, side,
+                      SYNTH_BLOCK_SIZE);
+        unison_ticks += perf_ticks() - start;
+
+        memset(mid, 0, sizeof(mid));
+        memset(side, 0, sizeof(side));
+        start = perf_ticks();
+        voices_block(osc, count, buf, mid, side);
+        voices_ticks += perf_ticks() - start;
+    }
+
+    p_result->unison_ns = perf_ticks_to_ns((uint32_t) (unison_ticks
+                                                       / BENCH_BLOCKS));
+    p_result->voices_ns = perf_ticks_to_ns((uint32_t) (voices_ticks
+                                                       / BENCH_BLOCKS));
+    p_result->speedup = (0 == p_result->unison_ns)
+                        ? 0.0f
+                        : (float) p_result->voices_ns / p_result->unison_ns;
+}   /* unison_bench() */
@@ -0,0 +1,182 @@
+#include "wsched.h"
+
+#if WSCHED_THREADS
+
+#include <chrono>
+
+#define WSCHED_SPIN          (2000U)     /* Busy polls before yielding */
+#define WSCHED_YIELD         (20000U)    /* Yields before sleeping */
+#define WSCHED_SLEEP_US      (50)
+
+#define WSCHED_FIELD_MASK    (0xFFFFFFULL)
+
+static inline uint64_t
+range_pack (uint32_t epoch, uint32_t next, uint32_t end)
+{
+    return (((uint64_t) (epoch & 0xFFFFU) << 48)
+            | (((uint64_t) next & WSCHED_FIELD_MASK) << 24)
+            | ((uint64_t) end & WSCHED_FIELD_MASK));
+}   /* range_pack() */
+
+static uint8_t
+range_claim (wsched_range_t * p_range, uint32_t epoch, uint8_t b_own,
+             uint32_t * p_task)
+{
+    uint64_t cur = p_range->range.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+        uint32_t next = (uint32_t) ((cur >> 24) & WSCHED_FIELD_MASK);
+        uint32_t end = (uint32_t) (cur & WSCHED_FIELD_MASK);
+        uint64_t want = 0;
+
+        if (((uint32_t) (cur >> 48) != (epoch & 0xFFFFU)) || (next >= end))
+        {
+            return (0);
+        }
+
+        // The owner takes from the front, thieves from the back.
+        //
+        want = b_own ? range_pack(epoch, next + 1, end)
+                     : range_pack(epoch, next, end - 1);
+
+        if (p_range->range.compare_exchange_weak(cur, want,
+                                                 std::memory_order_acq_rel))
+        {
+            *p_task = b_own ? next : end - 1;
+
+            return (1);
+        }
+    }
+}   /* range_claim() */
+
+static void
+wsched_drain (wsched_t * p_sched, uint32_t worker, uint32_t epoch)
+{
+    uint32_t task = 0;
+
+    for (uint32_t step = 0; step < p_sched->num_worker; ++step)
+    {
+        uint32_t victim = (worker + step) % p_sched->num_worker;
+
+        while (range_claim(&p_sched->range[victim], epoch, 0 == step, &task))
+        {
+            p_sched->fn(p_sched->p_ctx, task, worker);
+            p_sched->done.fetch_add(1, std::memory_order_release);
+        }
+    }
+}   /* wsched_drain() */
+
+static void
+wsched_worker (wsched_t * p_sched, uint32_t worker)
+{
+    uint32_t last = 0;
+    uint32_t idle = 0;
+
+    while (!p_sched->b_stop.load(std::memory_order_relaxed))
+    {
+        uint32_t epoch = p_sched->epoch.load(std::memory_order_acquire);
+
+        if (epoch != last)
+        {
+            last = epoch;
+            idle = 0;
+            wsched_drain(p_sched, worker, epoch);
+        }
+        else if (++idle < WSCHED_SPIN)
+        {
+            continue;
+        }
+        else if (idle < WSCHED_YIELD)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            // Audio has stopped: give the core back, at the cost of one
+            // late wake-up when it restarts.
+            //
+            std::this_thread::sleep_for(
+                                std::chrono::microseconds(WSCHED_SLEEP_US));
+        }
+    }
+}   /* wsched_worker() */
+
+uint8_t
+wsched_start (wsched_t * p_sched, uint32_t num_worker)
+{
+    if ((0 == num_worker) || (num_worker > WSCHED_MAX_WORKER))
+    {
+        return (0);
+    }
+
+    p_sched->num_worker = num_worker;
+    p_sched->fn = NULL;
+    p_sched->p_ctx = NULL;
+    p_sched->epoch.store(0);
+    p_sched->done.store(0);
+    p_sched->b_stop.store(0);
+
+    for (uint32_t idx = 0; idx < WSCHED_MAX_WORKER; ++idx)
+    {
+        p_sched->range[idx].range.store(range_pack(0, 0, 0));
+    }
+
+    for (uint32_t idx = 1; idx < num_worker; ++idx)
+    {
+        p_sched->thread[idx] = std::thread(wsched_worker, p_sched, idx);
+    }
+
+    return (1);
+}   /* wsched_start() */
+
+void
+wsched_run (wsched_t * p_sched, uint32_t num_task, wsched_fn_t fn, void * p_ctx)
+{
+    uint32_t epoch = p_sched->epoch.load(std::memory_order_relaxed) + 1;
+    uint32_t num_worker = p_sched->num_worker;
+
+    // Epoch 0 means "no block yet" to idle workers.
+    //
+    epoch += (0 == (epoch & 0xFFFFU)) ? 1 : 0;
+
+    p_sched->fn = fn;
+    p_sched->p_ctx = p_ctx;
+    p_sched->done.store(0, std::memory_order_relaxed);
+
+    for (uint32_t idx = 0; idx < num_worker; ++idx)
+    {
+        p_sched->range[idx].range.store(
+                range_pack(epoch, num_task * idx / num_worker,
+                           num_task * (idx + 1) / num_worker),
+                std::memory_order_relaxed);
+    }
+
+    p_sched->epoch.store(epoch, std::memory_order_release);
+    wsched_drain(p_sched, 0, epoch);
+
+    // Barrier: every task, stolen ones included, has finished and its
+    // writes are visible once the count is complete.
+    //
+    while (p_sched->done.load(std::memory_order_acquire) < num_task)
+    {
+    }
+}   /* wsched_run() */
+
+void
+wsched_stop (wsched_t * p_sched)
+{
+    p_sched->b_stop.store(1);
+
+    for (uint32_t idx = 1; idx < p_sched->num_worker; ++idx)
+    {
+        if (p_sched->thread[idx].joinable())
+        {
+            p_sched->thread[idx].join();
+        }
+    }
+
+    p_sched->num_worker = 0;
+}   /* wsched_stop() */
+
+#endif /* WSCHED_THREADS */
@@ -0,0 +1,54 @@
+#ifndef WSCHED_H
+
+#   define WSCHED_H
+#   include <stdint.h>
+
+#   if !defined(STM32F429xx) && !defined(ESP_PLATFORM)
+#       define WSCHED_THREADS    (1)
+#   else
+#       define WSCHED_THREADS    (0)
+#   endif
+
+#   if WSCHED_THREADS
+#       include <atomic>
+#       include <thread>
+
+// Fork/join pool for one audio block at a time: wsched_run() splits tasks
+// 0..num_task-1 evenly across the workers, each drains its own range from
+// the front and, when empty, steals from the back of the others'. The
+// caller is worker 0 and returns once every task has finished. Only
+// available where threads are (native).
+//
+#       define WSCHED_MAX_WORKER (16U)
+
+typedef void (*wsched_fn_t)(void * p_ctx, uint32_t task, uint32_t worker);
+
+// Packed epoch:16 | next:24 | end:24, claimed with one CAS so the owner
+// and thieves never take the same task, and a late thief never takes one
+// from the next block.
+//
+typedef struct wsched_range_t
+{
+    alignas(64) std::atomic<uint64_t> range;
+} wsched_range_t;
+
+typedef struct wsched_t
+{
+    uint32_t num_worker;
+    wsched_fn_t fn;
+    void * p_ctx;
+    std::atomic<uint32_t> epoch;
+    std::atomic<uint32_t> done;
+    std::atomic<uint8_t> b_stop;
+    wsched_range_t range[WSCHED_MAX_WORKER];
+    std::thread thread[WSCHED_MAX_WORKER];
+} wsched_t;
+
+uint8_t wsched_start(wsched_t * p_sched, uint32_t num_worker);
+void wsched_run(wsched_t * p_sched, uint32_t num_task, wsched_fn_t fn,
+               void * p_ctx);
+void wsched_stop(wsched_t * p_sched);
+
+#   endif /* WSCHED_THREADS */
+
+#endif /* WSCHED_H */
@@ -0,0 +1,184 @@
+#include "touch_filter.h"
+#include "perf.h"
+#include <math.h>
+
+#define BENCH_MAX_SHIFT     (64)    /* Samples of delay searched */
+#define BENCH_SETTLE_S      (0.05f) /* Ignored after the finger stops */
+#define BENCH_SPIKE_PERIOD  (97)    /* One press/release spike every N */
+#define BENCH_SPIKE_PX      (25.0f)
+#define TOUCH_PI            (3.14159265f)
+
+static uint32_t g_seed = 1;
+
+static float
+bench_noise (void)
+{
+    // Deterministic LCG; four uniforms summed approximate a unit gaussian,
+    // so a trace and its scores are the same on every run and target.
+    //
+    float sum = 0.0f;
+
+    for (uint8_t idx = 0; idx < 4; ++idx)
+    {
+        g_seed = g_seed * 1664525U + 1013904223U;
+        sum += (float) (g_seed >> 8) / 16777216.0f;
+    }
+
+    return ((sum - 2.0f) * 1.7320508f);
+}   /* bench_noise() */
+
+static uint16_t
+clamp_raw (float value)
+{
+    if (value < 0.0f)
+    {
+        return (0);
+    }
+    else if (value > 4095.0f)
+    {
+        return (4095);
+    }
+
+    return ((uint16_t) (value + 0.5f));
+}   /* clamp_raw() */
+
+void
+touch_trace_synth (touch_sample_t * p_trace, uint32_t num,
+                   const touch_calib_t * p_calib, float dt, float noise_px)
+{
+    // A hold, a straight drag, another hold and then circles at 1 Hz; the
+    // mix a key press and a glide along the keyboard produce. Noise is
+    // added in screen space and mapped back to raw controller units.
+    //
+    float det = p_calib->a * p_calib->e - p_calib->b * p_calib->d;
+
+    g_seed = 1;
+
+    for (uint32_t idx = 0; idx < num; ++idx)
+    {
+        float time = idx * dt;
+        float x = 0.0f;
+        float y = 0.0f;
+        float sx = 0.0f;
+        float sy = 0.0f;
+
+        if (time < 0.3f)
+        {
+            x = 100.0f;
+            y = 150.0f;
+        }
+        else if (time < 0.6f)
+        {
+            x = 100.0f + (time - 0.3f) / 0.3f * 80.0f;
+            y = 150.0f + (time - 0.3f) / 0.3f * 60.0f;
+        }
+        else if (time < 0.9f)
+        {
+            x = 180.0f;
+            y = 210.0f;
+        }
+        else
+        {
+            x = 120.0f + 60.0f * cosf(2.0f * TOUCH_PI * (time - 0.9f));
+            y = 210.0f + 60.0f * sinf(2.0f * TOUCH_PI * (time - 0.9f));
+        }
+
+        p_trace[idx].true_x = x;
+        p_trace[idx].true_y = y;
+
+        sx = x + noise_px * bench_noise();
+        sy = y + noise_px * bench_noise();
+
+        if (0 == ((idx + 1) % BENCH_SPIKE_PERIOD))
+        {
+            sx += BENCH_SPIKE_PX;
+            sy -= BENCH_SPIKE_PX;
+        }
+
+        sx -= p_calib->c;
+        sy -= p_calib->f;
+        p_trace[idx].raw_x = clamp_raw((p_calib->e * sx - p_calib->b * sy)
+                                       / det);
+        p_trace[idx].raw_y = clamp_raw((p_calib->a * sy - p_calib->d * sx)
+                                       / det);
+    }
+}   /* touch_trace_synth() */
+
+void
+touch_bench (const touch_sample_t * p_trace, uint32_t num,
+             const touch_cfg_t * p_cfg, float dt, touch_bench_t * p_result)
+{
+    touch_filter_t filter;
+    double shift_err[BENCH_MAX_SHIFT];
+    uint32_t shift_num[BENCH_MAX_SHIFT];
+    double still_err = 0.0;
+    uint32_t still_num = 0;
+    uint32_t settle = (uint32_t) (BENCH_SETTLE_S / dt);
+    uint32_t since_move = settle;
+    uint32_t best = 0;
+    uint64_t ticks = 0;
+
+    for (uint32_t shift = 0; shift < BENCH_MAX_SHIFT; ++shift)
+    {
+        shift_err[shift] = 0.0;
+        shift_num[shift] = 0;
+    }
+
+    perf_init();
+    touch_filter_init(&filter, p_cfg);
+
+    for (uint32_t idx = 0; idx < num; ++idx)
+    {
+        uint32_t start = perf_ticks();
+        uint8_t b_moving = 0;
+
+        touch_filter_push(&filter, p_trace[idx].raw_x, p_trace[idx].raw_y,
+                          dt);
+        ticks += perf_ticks() - start;
+
+        b_moving = (idx > 0)
+                   && ((p_trace[idx].true_x != p_trace[idx - 1].true_x)
+                       || (p_trace[idx].true_y != p_trace[idx - 1].true_y));
+        since_move = b_moving ? 0 : since_move + 1;
+
+        if (since_move > settle)
+        {
+            double ex = filter.x - p_trace[idx].true_x;
+            double ey = filter.y - p_trace[idx].true_y;
+
+            still_err += ex * ex + ey * ey;
+            ++still_num;
+        }
+        else if (b_moving)
+        {
+            // Compare against the truth at every candidate delay; the one
+            // that fits best is the filter's effective latency.
+            //
+            for (uint32_t shift = 0; (shift < BENCH_MAX_SHIFT)
+                                     && (shift <= idx); ++shift)
+            {
+                double ex = filter.x - p_trace[idx - shift].true_x;
+                double ey = filter.y - p_trace[idx - shift].true_y;
+
+                shift_err[shift] += ex * ex + ey * ey;
+                ++shift_num[shift];
+            }
+        }
+    }
+
+    for (uint32_t shift = 1; shift < BENCH_MAX_SHIFT; ++shift)
+    {
+        if ((0 != shift_num[shift])
+            && (shift_err[shift] / shift_num[shift]
+                < shift_err[best] / (shift_num[best] ? shift_num[best] : 1)))
+        {
+            best = shift;
+        }
+    }
+
+    p_result->latency_ms = best * dt * 1000.0f;
+    p_result->jitter_px = still_num ? (float) sqrt(still_err / still_num)
+                                    : 0.0f;
+    p_result->ns_per_sample = num ? perf_ticks_to_ns((uint32_t) (ticks / num))
+                                  : 0;
+}   /* touch_bench() */
@@ -0,0 +1,222 @@
+#include "touch_filter.h"
+#include <string.h>
+#include <math.h>
+
+#define TOUCH_PI    (3.14159265f)
+
+static float
+euro_alpha (float cutoff, float dt)
+{
+    float tau = 1.0f / (2.0f * TOUCH_PI * cutoff);
+
+    return (1.0f / (1.0f + tau / dt));
+}   /* euro_alpha() */
+
+static float
+euro_step (const touch_cfg_t * p_cfg, touch_euro_t * p_euro, float value,
+           float dt)
+{
+    // One-euro filter: a low-pass whose cutoff rises with speed, so a still
+    // finger is smoothed hard and a moving one is followed with little lag.
+    //
+    float deriv = (value - p_euro->value) / dt;
+    float cutoff = 0.0f;
+
+    p_euro->deriv += euro_alpha(p_cfg->d_cutoff, dt) * (deriv - p_euro->deriv);
+    cutoff = p_cfg->min_cutoff + p_cfg->beta * fabsf(p_euro->deriv);
+    p_euro->value += euro_alpha(cutoff, dt) * (value - p_euro->value);
+
+    return (p_euro->value);
+}   /* euro_step() */
+
+static float
+median_of (const float * p_win, uint8_t len)
+{
+    float sorted[TOUCH_MEDIAN_MAX];
+
+    memcpy(sorted, p_win, len * sizeof(float));
+
+    for (uint8_t idx = 1; idx < len; ++idx)
+    {
+        float key = sorted[idx];
+        int8_t pos = (int8_t) idx - 1;
+
+        while ((pos >= 0) && (sorted[pos] > key))
+        {
+            sorted[pos + 1] = sorted[pos];
+            --pos;
+        }
+
+        sorted[pos + 1] = key;
+    }
+
+    return (sorted[len / 2]);
+}   /* median_of() */
+
+static int16_t
+clamp_px (float value, int16_t limit)
+{
+    if (value < 0.0f)
+    {
+        return (0);
+    }
+    else if (value > (float) (limit - 1))
+    {
+        return (limit - 1);
+    }
+
+    return ((int16_t) (value + 0.5f));
+}   /* clamp_px() */
+
+void
+touch_cfg_default (touch_cfg_t * p_cfg, int16_t width, int16_t height)
+{
+    // Matches the STMPE811 on the STM32F429 discovery in portrait, the
+    // mapping that used to be hardcoded in touchpad_get_xy().
+    //
+    p_cfg->calib.a = -1.0f / 15.0f;
+    p_cfg->calib.b = 0.0f;
+    p_cfg->calib.c = 3870.0f / 15.0f;
+    p_cfg->calib.d = 0.0f;
+    p_cfg->calib.e = 1.0f / 11.0f;
+    p_cfg->calib.f = -360.0f / 11.0f;
+    p_cfg->width = width;
+    p_cfg->height = height;
+    p_cfg->median_len = 3;
+    p_cfg->min_cutoff = 2.0f;
+    p_cfg->beta = 0.02f;
+    p_cfg->d_cutoff = 10.0f;
+}   /* touch_cfg_default() */
+
+uint8_t
+touch_calib_solve (touch_calib_t * p_calib, const float raw[3][2],
+                   const float screen[3][2])
+{
+    // Three touched targets give two 3x3 systems sharing one matrix,
+    // solved with Cramer's rule.
+    //
+    float det = raw[0][0] * (raw[1][1] - raw[2][1])
+                - raw[0][1] * (raw[1][0] - raw[2][0])
+                + (raw[1][0] * raw[2][1] - raw[2][0] * raw[1][1]);
+    float coef[2][3];
+
+    if (fabsf(det) < 1e-6f)
+    {
+        return (0);
+    }
+
+    for (uint8_t axis = 0; axis < 2; ++axis)
+    {
+        float s0 = screen[0][axis];
+        float s1 = screen[1][axis];
+        float s2 = screen[2][axis];
+
+        coef[axis][0] = (s0 * (raw[1][1] - raw[2][1])
+                         - raw[0][1] * (s1 - s2)
+                         + (s1 * raw[2][1] - s2 * raw[1][1])) / det;
+        coef[axis][1] = (raw[0][0] * (s1 - s2)
+                         - s0 * (raw[1][0] - raw[2][0])
+                         + (raw[1][0] * s2 - raw[2][0] * s1)) / det;
+        coef[axis][2] = (raw[0][0] * (raw[1][1] * s2 - raw[2][1] * s1)
+                         - raw[0][1] * (raw[1][0] * s2 - raw[2][0] * s1)
+                         + s0 * (raw[1][0] * raw[2][1]
+                                 - raw[2][0] * raw[1][1])) / det;
+    }
+
+    p_calib->a = coef[0][0];
+    p_calib->b = coef[0][1];
+    p_calib->c = coef[0][2];
+    p_calib->d = coef[1][0];
+    p_calib->e = coef[1][1];
+    p_calib->f = coef[1][2];
+
+    return (1);
+}   /* touch_calib_solve() */
+
+void
+touch_calib_apply (const touch_calib_t * p_calib, float raw_x, float raw_y,
+                   float * p_x, float * p_y)
+{
+    *p_x = p_calib->a * raw_x + p_calib->b * raw_y + p_calib->c;
+    *p_y = p_calib->d * raw_x + p_calib->e * raw_y + p_calib->f;
+}   /* touch_calib_apply() */
+
+void
+touch_filter_init (touch_filter_t * p_filter, const touch_cfg_t * p_cfg)
+{
+    memset(p_filter, 0, sizeof(*p_filter));
+    p_filter->cfg = *p_cfg;
+
+    if (p_filter->cfg.median_len > TOUCH_MEDIAN_MAX)
+    {
+        p_filter->cfg.median_len = TOUCH_MEDIAN_MAX;
+    }
+    else if (0 == p_filter->cfg.median_len)
+    {
+        p_filter->cfg.median_len = 1;
+    }
+}   /* touch_filter_init() */
+
+void
+touch_filter_reset (touch_filter_t * p_filter)
+{
+    // On lift: the next touch starts fresh instead of gliding from here.
+    //
+    p_filter->median_fill = 0;
+    p_filter->median_pos = 0;
+    p_filter->b_started = 0;
+}   /* touch_filter_reset() */
+
+void
+touch_filter_push (touch_filter_t * p_filter, uint16_t raw_x, uint16_t raw_y,
+                   float dt)
+{
+    const touch_cfg_t * p_cfg = &p_filter->cfg;
+    float pos[2];
+    uint8_t len = 0;
+
+    touch_calib_apply(&p_cfg->calib, (float) raw_x, (float) raw_y, &pos[0],
+                      &pos[1]);
+
+    // Median first, to drop the single-sample spikes the resistive panel
+    // produces on press and release; the window shrinks while filling.
+    //
+    p_filter->median[0][p_filter->median_pos] = pos[0];
+    p_filter->median[1][p_filter->median_pos] = pos[1];
+    p_filter->median_pos = (p_filter->median_pos + 1) % p_cfg->median_len;
+
+    if (p_filter->median_fill < p_cfg->median_len)
+    {
+        ++p_filter->median_fill;
+    }
+
+    len = p_filter->median_fill | 1;
+
+    if (len > p_filter->median_fill)
+    {
+        len -= 2;
+    }
+
+    for (uint8_t axis = 0; axis < 2; ++axis)
+    {
+        float value = (len == p_filter->median_fill)
+                      ? median_of(p_filter->median[axis], len)
+                      : pos[axis];
+
+        if (!p_filter->b_started)
+        {
+            p_filter->euro[axis].value = value;
+            p_filter->euro[axis].deriv = 0.0f;
+        }
+        else
+        {
+            value = euro_step(p_cfg, &p_filter->euro[axis], value, dt);
+        }
+
+        pos[axis] = value;
+    }
+
+    p_filter->b_started = 1;
+    p_filter->x = clamp_px(pos[0], p_cfg->width);
+    p_filter->y = clamp_px(pos[1], p_cfg->height);
+}   /* touch_filter_push() */
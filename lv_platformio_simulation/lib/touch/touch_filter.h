@@ -0,0 +1,94 @@
+#ifndef TOUCH_FILTER_H
+
+#   define TOUCH_FILTER_H
+#   include <stdint.h>
+
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+
+#   define TOUCH_MEDIAN_MAX     (5)
+
+// Raw to screen mapping:
+//   x = a * raw_x + b * raw_y + c
+//   y = d * raw_x + e * raw_y + f
+//
+typedef struct touch_calib_t
+{
+    float a;
+    float b;
+    float c;
+    float d;
+    float e;
+    float f;
+} touch_calib_t;
+
+typedef struct touch_cfg_t
+{
+    touch_calib_t calib;
+    int16_t width;
+    int16_t height;
+    uint8_t median_len;     /* 1 (off), 3 or 5 */
+    float min_cutoff;       /* Hz, smoothing while still */
+    float beta;             /* Cutoff increase per px/s of speed */
+    float d_cutoff;         /* Hz, speed estimate smoothing */
+} touch_cfg_t;
+
+typedef struct touch_euro_t
+{
+    float value;
+    float deriv;
+} touch_euro_t;
+
+typedef struct touch_filter_t
+{
+    touch_cfg_t cfg;
+    float median[2][TOUCH_MEDIAN_MAX];
+    uint8_t median_fill;
+    uint8_t median_pos;
+    touch_euro_t euro[2];
+    uint8_t b_started;
+    int16_t x;
+    int16_t y;
+} touch_filter_t;
+
+typedef struct touch_sample_t
+{
+    uint16_t raw_x;
+    uint16_t raw_y;
+    float true_x;           /* Ground truth, for benchmarking only */
+    float true_y;
+} touch_sample_t;
+
+typedef struct touch_bench_t
+{
+    float latency_ms;       /* Best-fit delay behind the truth while moving */
+    float jitter_px;        /* RMS error while the finger is still */
+    uint32_t ns_per_sample;
+} touch_bench_t;
+
+void touch_cfg_default(touch_cfg_t * p_cfg, int16_t width, int16_t height);
+uint8_t touch_calib_solve(touch_calib_t * p_calib, const float raw[3][2],
+                          const float screen[3][2]);
+void touch_calib_apply(const touch_calib_t * p_calib, float raw_x,
+                       float raw_y, float * p_x, float * p_y);
+
+void touch_filter_init(touch_filter_t * p_filter, const touch_cfg_t * p_cfg);
+void touch_filter_reset(touch_filter_t * p_filter);
+void touch_filter_push(touch_filter_t * p_filter, uint16_t raw_x,
+                       uint16_t raw_y, float dt);
+
+// Replay a trace through the filter at a fixed sample period.
+//
+void touch_bench(const touch_sample_t * p_trace, uint32_t num,
+                 const touch_cfg_t * p_cfg, float dt,
+                 touch_bench_t * p_result);
+void touch_trace_synth(touch_sample_t * p_trace, uint32_t num,
+                       const touch_calib_t * p_calib, float dt,
+                       float noise_px);
+
+#   ifdef __cplusplus
+} /* extern "C" */
+#   endif
+
+#endif /* TOUCH_FILTER_H */
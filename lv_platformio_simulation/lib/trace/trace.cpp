@@ -0,0 +1,330 @@
+#include "trace.h"
+#include "perf.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if TRACE_ENABLE
+
+#   if !defined(STM32F429xx) && !defined(ESP_PLATFORM)
+#       define TRACE_NATIVE     (1)
+#       include <signal.h>
+#   endif
+
+static_assert(0 == (TRACE_EVENTS & (TRACE_EVENTS - 1)),
+              "TRACE_EVENTS must be a power of two");
+
+typedef struct trace_rec_t
+{
+    uint64_t ticks;
+    const char * p_name;
+    uint32_t phase;
+} trace_rec_t;
+
+// Written by one thread (plus its ISRs on firmware, hence the atomic
+// index); read only by the exporter.
+//
+typedef struct trace_ring_t
+{
+    std::atomic<uint32_t> head;
+    const char * p_thread;
+    trace_rec_t rec[TRACE_EVENTS];
+} trace_ring_t;
+
+#   if TRACE_NATIVE
+static trace_ring_t g_trace[TRACE_MAX_THREADS];
+static std::atomic<uint32_t> g_num_ring(0);
+static thread_local trace_ring_t * tp_ring = NULL;
+#   else
+trace_ring_t g_trace[1];
+#   endif
+
+static std::atomic<uint8_t> gb_enabled(1);
+
+static inline uint64_t
+trace_now (void)
+{
+#   if TRACE_NATIVE
+    // The 32-bit perf counter wraps every 4 s in nanoseconds: too short
+    // for a timeline.
+    //
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec);
+#   else
+    return (perf_ticks());
+#   endif
+}   /* trace_now() */
+
+static trace_ring_t *
+trace_ring (void)
+{
+#   if TRACE_NATIVE
+    if (NULL == tp_ring)
+    {
+        uint32_t idx = g_num_ring.fetch_add(1, std::memory_order_relaxed);
+
+        if (idx >= TRACE_MAX_THREADS)
+        {
+            g_num_ring.store(TRACE_MAX_THREADS, std::memory_order_relaxed);
+
+            return (NULL);
+        }
+
+        tp_ring = &g_trace[idx];
+    }
+
+    return (tp_ring);
+#   else
+    return (&g_trace[0]);
+#   endif
+}   /* trace_ring() */
+
+void
+trace_event (const char * p_name, trace_phase_t phase)
+{
+    trace_ring_t * p_ring = trace_ring();
+    uint64_t ticks = trace_now();
+    uint32_t pos = 0;
+
+    if ((NULL == p_ring) || !gb_enabled.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    pos = p_ring->head.fetch_add(1, std::memory_order_relaxed);
+    p_ring->rec[pos & (TRACE_EVENTS - 1)].ticks = ticks;
+    p_ring->rec[pos & (TRACE_EVENTS - 1)].p_name = p_name;
+    p_ring->rec[pos & (TRACE_EVENTS - 1)].phase = (uint32_t) phase;
+}   /* trace_event() */
+
+void
+trace_thread_name (const char * p_name)
+{
+    trace_ring_t * p_ring = trace_ring();
+
+    if (NULL != p_ring)
+    {
+        p_ring->p_thread = p_name;
+    }
+}   /* trace_thread_name() */
+
+static uint64_t
+ticks_to_ns (uint64_t ticks)
+{
+#   if TRACE_NATIVE
+    return (ticks);
+#   else
+    return (ticks * 1000U / PERF_TICKS_PER_US);
+#   endif
+}   /* ticks_to_ns() */
+
+void
+trace_write (trace_sink_t sink)
+{
+    static const char g_phase[] = {'B', 'E', 'i', 'b', 'e'};
+    char line[192];
+    uint32_t num_ring = 1;
+    uint64_t base = UINT64_MAX;
+    uint8_t b_first = 1;
+    int len = 0;
+
+    gb_enabled.store(0, std::memory_order_relaxed);
+
+#   if TRACE_NATIVE
+    num_ring = g_num_ring.load(std::memory_order_acquire);
+#   endif
+
+    // Timestamps start at the oldest event still held by any ring.
+    //
+    for (uint32_t tid = 0; tid < num_ring; ++tid)
+    {
+        uint32_t head = g_trace[tid].head.load(std::memory_order_acquire);
+        uint32_t first = (head > TRACE_EVENTS) ? head - TRACE_EVENTS : 0;
+
+        if ((head != first) && (g_trace[tid].rec[first & (TRACE_EVENTS - 1)].ticks
+                                < base))
+        {
+            base = g_trace[tid].rec[first & (TRACE_EVENTS - 1)].ticks;
+        }
+    }
+
+    sink("{\"traceEvents\":[\n", 17);
+
+    for (uint32_t tid = 0; tid < num_ring; ++tid)
+    {
+        trace_ring_t * p_ring = &g_trace[tid];
+        uint32_t head = p_ring->head.load(std::memory_order_acquire);
+        uint32_t first = (head > TRACE_EVENTS) ? head - TRACE_EVENTS : 0;
+        uint64_t ticks = 0;
+        uint32_t depth = 0;
+#   if !TRACE_NATIVE
+        uint32_t prev = 0;
+#   endif
+
+        len = snprintf(line, sizeof(line),
+                       "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                       "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                       b_first ? "" : ",\n", (unsigned) tid,
+                       p_ring->p_thread ? p_ring->p_thread : "thread");
+        sink(line, (uint32_t) len);
+        b_first = 0;
+
+        for (uint32_t pos = first; pos != head; ++pos)
+        {
+            const trace_rec_t * p_rec = &p_ring->rec[pos & (TRACE_EVENTS - 1)];
+            uint64_t ns = 0;
+
+            // The firmware counter is 32 bits: unwrap it along the ring.
+            //
+#   if TRACE_NATIVE
+            ticks = p_rec->ticks;
+#   else
+            ticks = (pos == first) ? p_rec->ticks
+                                   : ticks + (int32_t) ((uint32_t) p_rec->ticks
+                                                        - prev);
+            prev = (uint32_t) p_rec->ticks;
+#   endif
+            ns = ticks_to_ns(ticks - base);
+
+            // The ring may have overwritten the begin of the oldest scopes.
+            //
+            if (TRACE_PH_BEGIN == p_rec->phase)
+            {
+                ++depth;
+            }
+            else if (TRACE_PH_END == p_rec->phase)
+            {
+                if (0 == depth)
+                {
+                    continue;
+                }
+
+                --depth;
+            }
+
+            len = snprintf(line, sizeof(line),
+                           ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03u,"
+                           "\"pid\":1,\"tid\":%u%s}",
+                           p_rec->p_name, g_phase[p_rec->phase],
+                           (unsigned long long) (ns / 1000U),
+                           (unsigned) (ns % 1000U), (unsigned) tid,
+                           (TRACE_PH_INSTANT == p_rec->phase) ? ",\"s\":\"t\""
+                           : (p_rec->phase >= TRACE_PH_ASYNC_BEGIN)
+                             ? ",\"cat\":\"async\",\"id\":1" : "");
+            sink(line, (uint32_t) len);
+        }
+    }
+
+    sink("\n]}\n", 4);
+    gb_enabled.store(1, std::memory_order_relaxed);
+}   /* trace_write() */
+
+static FILE * gp_file = NULL;
+
+static void
+trace_file_sink (const char * p_text, uint32_t len)
+{
+    fwrite(p_text, 1, len, (NULL != gp_file) ? gp_file : stdout);
+}   /* trace_file_sink() */
+
+void
+trace_dump (void)
+{
+    gp_file = NULL;
+    trace_write(trace_file_sink);
+    fflush(stdout);
+}   /* trace_dump() */
+
+uint8_t
+trace_save (const char * p_path)
+{
+    gp_file = fopen(p_path, "w");
+
+    if (NULL == gp_file)
+    {
+        return (0);
+    }
+
+    trace_write(trace_file_sink);
+    fclose(gp_file);
+    gp_file = NULL;
+
+    return (1);
+}   /* trace_save() */
+
+#   if TRACE_NATIVE
+static void
+trace_at_exit (void)
+{
+    if (trace_save(TRACE_FILE))
+    {
+        fprintf(stderr, "trace: wrote %s\n", TRACE_FILE);
+    }
+}   /* trace_at_exit() */
+
+static void
+trace_on_signal (int signum)
+{
+    (void) signum;
+
+    // Not async-signal-safe, but this is a debugging aid on the emulator.
+    //
+    exit(EXIT_SUCCESS);
+}   /* trace_on_signal() */
+#   endif
+
+void
+trace_start (void)
+{
+#   if TRACE_NATIVE
+    atexit(trace_at_exit);
+    signal(SIGINT, trace_on_signal);
+    signal(SIGTERM, trace_on_signal);
+#   else
+    perf_init();
+#   endif
+}   /* trace_start() */
+
+#else /* TRACE_ENABLE */
+
+void
+trace_start (void)
+{
+}   /* trace_start() */
+
+void
+trace_event (const char * p_name, trace_phase_t phase)
+{
+    (void) p_name;
+    (void) phase;
+}   /* trace_event() */
+
+void
+trace_thread_name (const char * p_name)
+{
+    (void) p_name;
+}   /* trace_thread_name() */
+
+void
+trace_write (trace_sink_t sink)
+{
+    (void) sink;
+}   /* trace_write() */
+
+void
+trace_dump (void)
+{
+}   /* trace_dump() */
+
+uint8_t
+trace_save (const char * p_path)
+{
+    (void) p_path;
+
+    return (0);
+}   /* trace_save() */
+
+#endif /* TRACE_ENABLE */
@@ -0,0 +1,100 @@
+#ifndef TRACE_H
+
+#   define TRACE_H
+#   include <stdint.h>
+
+// Timeline of scoped begin/end markers, exported as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev). Each thread records into its own
+// lock-free ring that keeps the latest TRACE_EVENTS events, so after a
+// glitch the trace shows what ran just before it.
+//
+// - native: one ring per thread, saved to TRACE_FILE at exit or Ctrl-C.
+// - firmware: one ring in RAM (g_trace), written out by trace_dump(),
+//   e.g. `call trace_dump()` from the debugger.
+//
+// With TRACE_ENABLE 0 (the default) every marker compiles to nothing.
+//
+#   ifndef TRACE_ENABLE
+#       define TRACE_ENABLE         (0)
+#   endif
+#   ifndef TRACE_EVENTS
+#       if defined(STM32F429xx) || defined(ESP_PLATFORM)
+#           define TRACE_EVENTS     (512U)  /* Power of two */
+#       else
+#           define TRACE_EVENTS     (16384U)
+#       endif
+#   endif
+#   define TRACE_MAX_THREADS        (8U)
+#   define TRACE_FILE               "trace.json"
+
+#   ifdef __cplusplus
+extern "C" {
+#   endif
+
+typedef enum trace_phase_t
+{
+    TRACE_PH_BEGIN = 0,
+    TRACE_PH_END,
+    TRACE_PH_INSTANT,
+    TRACE_PH_ASYNC_BEGIN,   /* May end on another thread or in an ISR */
+    TRACE_PH_ASYNC_END
+} trace_phase_t;
+
+typedef void (*trace_sink_t)(const char * p_text, uint32_t len);
+
+void trace_start(void);
+void trace_event(const char * p_name, trace_phase_t phase);
+void trace_thread_name(const char * p_name);
+void trace_write(trace_sink_t sink);
+void trace_dump(void);
+uint8_t trace_save(const char * p_path);
+
+#   ifdef __cplusplus
+} /* extern "C" */
+#   endif
+
+// Names must be string literals: only the pointer is recorded.
+//
+#   if TRACE_ENABLE
+#       define TRACE_BEGIN(name)        trace_event((name), TRACE_PH_BEGIN)
+#       define TRACE_END(name)          trace_event((name), TRACE_PH_END)
+#       define TRACE_INSTANT(name)      trace_event((name), TRACE_PH_INSTANT)
+#       define TRACE_ASYNC_BEGIN(name)  trace_event((name), TRACE_PH_ASYNC_BEGIN)
+#       define TRACE_ASYNC_END(name)    trace_event((name), TRACE_PH_ASYNC_END)
+#       define TRACE_THREAD(name)       trace_thread_name(name)
+#   else
+#       define TRACE_BEGIN(name)        do { } while (0)
+#       define TRACE_END(name)          do { } while (0)
+#       define TRACE_INSTANT(name)      do { } while (0)
+#       define TRACE_ASYNC_BEGIN(name)  do { } while (0)
+#       define TRACE_ASYNC_END(name)    do { } while (0)
+#       define TRACE_THREAD(name)       do { } while (0)
+#   endif
+
+#   ifdef __cplusplus
+#       if TRACE_ENABLE
+typedef struct trace_scope_t
+{
+    const char * p_name;
+
+    trace_scope_t (const char * p_scope_name) : p_name(p_scope_name)
+    {
+        trace_event(p_name, TRACE_PH_BEGIN);
+    }
+
+    ~trace_scope_t ()
+    {
+        trace_event(p_name, TRACE_PH_END);
+    }
+} trace_scope_t;
+
+#           define TRACE_CAT2(a, b)     a##b
+#           define TRACE_CAT(a, b)      TRACE_CAT2(a, b)
+#           define TRACE_SCOPE(name)    trace_scope_t TRACE_CAT(trace_scope_, \
+                                                      __LINE__)(name)
+#       else
+#           define TRACE_SCOPE(name)    do { } while (0)
+#       endif
+#   endif
+
+#endif /* TRACE_H */
@@ -13,28 +13,65 @@
 #include "app_hal.h"
 #include <stdio.h>
 #include "instrument.h"
+#include "synth.h"
+#include "mem.h"
+#include "dlog.h"
+#include "trace.h"
 
 #include "demos/lv_demos.h"
 
 int
 main (void)
 {
+	dlog_start();
+	trace_start();
+	TRACE_THREAD("ui");
 	lv_init();
 
 	hal_setup();
 
+	synth_t * p_engine = instrument_engine_create();
 	instrument_t my_piano = {0};
-	uint8_t ret = init_instrument(&my_piano);
 
-	if (0 == ret)
+	if ((NULL == p_engine) || (0 == init_instrument(&my_piano, p_engine)))
 	{
 		exit(EXIT_FAILURE);
 	}
 
+	// Presets in place: the mapped bank file on native, flash on boards.
+	//
+	static preset_bank_t bank;
+
+	if (0 == preset_bank_map(&bank, PRESET_BANK_PATH))
+	{
+		DLOG("presets: factory bank\n");
+	}
+
+	instrument_set_bank(&my_piano, &bank);
+
 	create_instrument(&my_piano);
 
-	lv_log("Hello %s\n", "World");
-	fflush(NULL);
+	if (0 == hal_audio_start(SYNTH_SAMPLE_RATE, SYNTH_BLOCK_SIZE,
+							 instrument_render, p_engine))
+	{
+		DLOG("No audio output\n");
+	}
+
+	// Report what the UI and the engine actually took, to size LV_MEM_SIZE
+	// and MEM_AUDIO_SIZE per board.
+	//
+	for (uint32_t id = 0; id < MEM_NUM; ++id)
+	{
+		mem_stats_t stats;
+
+		mem_get_stats((mem_id_t) id, &stats);
+		DLOG("mem %-9s %6u / %6u bytes, peak %6u, %4u allocs, frag %u%%\n",
+			 stats.p_name, (unsigned) stats.live, (unsigned) stats.size,
+			 (unsigned) stats.peak, (unsigned) stats.count,
+			 (unsigned) stats.frag_pct);
+	}
+
+	DLOG("Hello %s\n", "World");
 
 	hal_loop();
 }	/* main() */
\ No newline at end of file
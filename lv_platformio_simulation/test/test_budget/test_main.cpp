@@ -0,0 +1,181 @@
+#include <unity.h>
+#include <stdio.h>
+#include "budget.h"
+
+#define TEST_RATE       (48000U)
+#define TEST_BLOCK      (64U)       /* 1333 us */
+
+void
+setUp (void)
+{
+}   /* setUp() */
+
+void
+tearDown (void)
+{
+}   /* tearDown() */
+
+static void
+feed_load (budget_t * p_budget, uint32_t pct, uint32_t blocks)
+{
+    for (uint32_t idx = 0; idx < blocks; ++idx)
+    {
+        budget_audio_done(p_budget, p_budget->cfg.block_us * pct / 100U, 0);
+    }
+}   /* feed_load() */
+
+static void
+test_levels (void)
+{
+    budget_cfg_t cfg;
+    budget_t budget;
+
+    budget_cfg_default(&cfg, TEST_RATE, TEST_BLOCK);
+    budget_init(&budget, &cfg);
+    TEST_ASSERT_EQUAL_UINT32(1333, cfg.block_us);
+
+    feed_load(&budget, 30, 64);
+    TEST_ASSERT_EQUAL_UINT8(BUDGET_NORMAL, budget.stats.level);
+    TEST_ASSERT_EQUAL_UINT32(cfg.refr_ms[BUDGET_NORMAL],
+                             budget_refr_ms(&budget));
+
+    feed_load(&budget, 60, 64);
+    TEST_ASSERT_EQUAL_UINT8(BUDGET_REDUCED, budget.stats.level);
+    TEST_ASSERT_EQUAL_UINT32(2 * cfg.refr_ms[BUDGET_NORMAL],
+                             budget_refr_ms(&budget));
+
+    feed_load(&budget, 90, 64);
+    TEST_ASSERT_EQUAL_UINT8(BUDGET_MINIMAL, budget.stats.level);
+
+    // Just under a threshold is not enough to come back down.
+    //
+    feed_load(&budget, 70, 64);
+    TEST_ASSERT_EQUAL_UINT8(BUDGET_MINIMAL, budget.stats.level);
+
+    feed_load(&budget, 30, 64);
+    TEST_ASSERT_EQUAL_UINT8(BUDGET_NORMAL, budget.stats.level);
+    TEST_ASSERT_EQUAL_UINT32(4, budget.stats.level_changes);
+    TEST_ASSERT_EQUAL_UINT32(cfg.block_us * 90 / 100,
+                             budget.stats.audio_peak_us);
+}   /* test_levels() */
+
+static void
+test_defer (void)
+{
+    budget_cfg_t cfg;
+    budget_t budget;
+    budget_stats_t stats;
+
+    budget_cfg_default(&cfg, TEST_RATE, TEST_BLOCK);
+    cfg.max_defer = 3;
+    budget_init(&budget, &cfg);
+    feed_load(&budget, 40, 8);
+
+    // The first pass has no estimate and goes; a long one is remembered.
+    //
+    TEST_ASSERT_EQUAL_UINT8(1, budget_ui_begin(&budget, 2000));
+    budget_ui_done(&budget, 5000);
+
+    for (uint32_t round = 0; round < 2; ++round)
+    {
+        for (uint32_t idx = 0; idx < cfg.max_defer; ++idx)
+        {
+            TEST_ASSERT_EQUAL_UINT8(0, budget_ui_begin(&budget, 2000));
+        }
+
+        TEST_ASSERT_EQUAL_UINT8(1, budget_ui_begin(&budget, 2000));
+        budget_ui_done(&budget, 5000);
+    }
+
+    // Plenty of time before the next block: runs without waiting.
+    //
+    TEST_ASSERT_EQUAL_UINT8(1, budget_ui_begin(&budget, 10000));
+    budget_ui_done(&budget, 200);
+
+    budget_get_stats(&budget, &stats);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.passes);
+    TEST_ASSERT_EQUAL_UINT32(2 * cfg.max_defer, stats.deferred);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.forced);
+
+    // The estimate decays, so a short pass fits again after a few.
+    //
+    TEST_ASSERT_TRUE(stats.ui_us < 5000);
+    TEST_ASSERT_TRUE(stats.ui_us > 200);
+}   /* test_defer() */
+
+static void
+test_sim (void)
+{
+    // About 55 % of the core on audio with two blocks of codec queue, and
+    // a 6 ms redraw while the screen animates: the old loop lets every
+    // redraw hold up the audio past the queue.
+    //
+    budget_sim_cfg_t cfg = {TEST_RATE, TEST_BLOCK, 2, 730, 6000, 150, 1,
+                            500, 500, 20, 0};
+    budget_sim_t plain;
+    budget_sim_t budget;
+    budget_sim_t split;
+
+    budget_sim(&cfg, &plain);
+    cfg.b_budget = 1;
+    budget_sim(&cfg, &budget);
+    cfg.ui_chunks = 10;
+    budget_sim(&cfg, &split);
+
+    printf("bench budget plain: %u late of %u blocks, %.1f fps\n",
+           (unsigned) plain.stats.late, (unsigned) plain.blocks, plain.fps);
+    printf("bench budget unsplit: %u late, %.1f fps, %u deferred, "
+           "%u forced\n", (unsigned) budget.stats.late, budget.fps,
+           (unsigned) budget.stats.deferred, (unsigned) budget.stats.forced);
+    printf("bench budget split: %u late, %.1f fps, %u deferred, "
+           "load %u%%, level %u\n", (unsigned) split.stats.late, split.fps,
+           (unsigned) split.stats.deferred, (unsigned) split.stats.load_pct,
+           (unsigned) split.stats.level);
+
+    // Same audio either way; the sample clock does not depend on the UI.
+    //
+    TEST_ASSERT_UINT32_WITHIN(2, plain.blocks, budget.blocks);
+    TEST_ASSERT_TRUE(plain.stats.late > 0);
+
+    // Passes that cannot fit only go when forced, so fewer blocks are late.
+    //
+    TEST_ASSERT_TRUE(budget.stats.forced > 0);
+    TEST_ASSERT_TRUE(budget.stats.late < plain.stats.late);
+
+    // Split into flushes, every pass fits: no late block and the screen
+    // still moves at the stretched rate.
+    //
+    TEST_ASSERT_EQUAL_UINT32(0, split.stats.late);
+    TEST_ASSERT_EQUAL_UINT32(0, split.stats.forced);
+    TEST_ASSERT_EQUAL_UINT8(BUDGET_REDUCED, split.stats.level);
+    TEST_ASSERT_TRUE(split.fps > 5.0f);
+}   /* test_sim() */
+
+static void
+test_sim_idle (void)
+{
+    // Light audio: nothing is deferred and the UI keeps its full rate.
+    //
+    budget_sim_cfg_t cfg = {TEST_RATE, TEST_BLOCK, 2, 200, 600, 100, 1,
+                            1000, 0, 10, 1};
+    budget_sim_t result;
+
+    budget_sim(&cfg, &result);
+
+    TEST_ASSERT_EQUAL_UINT32(0, result.stats.late);
+    TEST_ASSERT_EQUAL_UINT32(0, result.stats.deferred);
+    TEST_ASSERT_EQUAL_UINT8(BUDGET_NORMAL, result.stats.level);
+    TEST_ASSERT_TRUE(result.fps > 25.0f);
+}   /* test_sim_idle() */
+
+int
+main (void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_levels);
+    RUN_TEST(test_defer);
+    RUN_TEST(test_sim);
+    RUN_TEST(test_sim_idle);
+
+    return (UNITY_END());
+}   /* main() */
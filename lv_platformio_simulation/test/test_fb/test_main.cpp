@@ -0,0 +1,733 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "fb.h"
+#include "fb_tiles.h"
+#include "perf_bench.h"
+#include "lvgl.h"
+
+#define TEST_WIDTH      (240)   /* STM32F429 discovery, portrait */
+#define TEST_HEIGHT     (320)
+
+// LVGL's own rotation, the one a flush callback calls before copying the
+// turned pixels to the panel.
+//
+#if LV_VERSION_CHECK(9, 1, 0)
+#   define TEST_LV_ROTATE  (1)
+#else
+#   define TEST_LV_ROTATE  (0)
+#endif
+
+static uint16_t g_fb[TEST_WIDTH * TEST_HEIGHT];
+static uint16_t g_src[TEST_WIDTH * TEST_HEIGHT];
+static uint16_t g_screen[TEST_WIDTH * TEST_HEIGHT];
+static uint32_t g_hash[FB_TILES_COUNT(TEST_WIDTH, TEST_HEIGHT)];
+static fb_tiles_t g_tiles;
+static uint16_t g_rot[TEST_WIDTH * TEST_HEIGHT];
+
+void
+setUp (void)
+{
+}   /* setUp() */
+
+void
+tearDown (void)
+{
+}   /* tearDown() */
+
+static void
+check_clip (int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint8_t b_on,
+            int32_t cx1, int32_t cy1, int32_t cx2, int32_t cy2)
+{
+    fb_rect_t area = {x1, y1, x2, y2};
+    fb_rect_t clip = {-1, -1, -1, -1};
+
+    TEST_ASSERT_EQUAL_UINT8(b_on, fb_clip(&area, TEST_WIDTH, TEST_HEIGHT,
+                                          &clip));
+
+    if (b_on)
+    {
+        TEST_ASSERT_EQUAL_INT32(cx1, clip.x1);
+        TEST_ASSERT_EQUAL_INT32(cy1, clip.y1);
+        TEST_ASSERT_EQUAL_INT32(cx2, clip.x2);
+        TEST_ASSERT_EQUAL_INT32(cy2, clip.y2);
+    }
+}   /* check_clip() */
+
+static void
+test_clip (void)
+{
+    check_clip(10, 20, 30, 40, 1, 10, 20, 30, 40);
+    check_clip(0, 0, TEST_WIDTH - 1, TEST_HEIGHT - 1, 1,
+               0, 0, TEST_WIDTH - 1, TEST_HEIGHT - 1);
+    check_clip(-5, -7, 3, 4, 1, 0, 0, 3, 4);
+    check_clip(230, 310, 250, 330, 1, 230, 310, TEST_WIDTH - 1,
+               TEST_HEIGHT - 1);
+    check_clip(-10, 5, TEST_WIDTH + 10, 5, 1, 0, 5, TEST_WIDTH - 1, 5);
+
+    // Wholly off screen, on each side, and empty areas.
+    //
+    check_clip(-10, 0, -1, 10, 0, 0, 0, 0, 0);
+    check_clip(0, -10, 10, -1, 0, 0, 0, 0, 0);
+    check_clip(TEST_WIDTH, 0, TEST_WIDTH + 5, 10, 0, 0, 0, 0, 0);
+    check_clip(0, TEST_HEIGHT, 10, TEST_HEIGHT + 5, 0, 0, 0, 0, 0);
+    check_clip(10, 10, 9, 20, 0, 0, 0, 0, 0);
+}   /* test_clip() */
+
+static void
+check_copy (int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    fb_rect_t area = {x1, y1, x2, y2};
+    fb_rect_t clip;
+    int32_t area_w = x2 - x1 + 1;
+
+    for (uint32_t idx = 0; idx < TEST_WIDTH * TEST_HEIGHT; ++idx)
+    {
+        g_fb[idx] = 0xDEAD;
+        g_src[idx] = (uint16_t) (idx * 2654435761U >> 16);
+    }
+
+    TEST_ASSERT_TRUE(fb_clip(&area, TEST_WIDTH, TEST_HEIGHT, &clip));
+    fb_copy_rows(g_fb, TEST_WIDTH, &area, &clip, g_src);
+
+    // Pixel by pixel against the area's own coordinates.
+    //
+    for (int32_t y = 0; y < TEST_HEIGHT; ++y)
+    {
+        for (int32_t x = 0; x < TEST_WIDTH; ++x)
+        {
+            uint8_t b_in = (x >= x1) && (x <= x2) && (y >= y1) && (y <= y2);
+            uint16_t expect = b_in ? g_src[(y - y1) * area_w + (x - x1)]
+                                   : 0xDEAD;
+
+            TEST_ASSERT_EQUAL_HEX16(expect, g_fb[y * TEST_WIDTH + x]);
+        }
+    }
+}   /* check_copy() */
+
+static void
+test_copy_rows (void)
+{
+    check_copy(0, 0, TEST_WIDTH - 1, 31);
+    check_copy(17, 40, 99, 41);
+    check_copy(5, 5, 5, 5);
+
+    // Clipped on the left and top: rows must still be read at the area's
+    // width, from the first visible pixel.
+    //
+    check_copy(-12, -3, 40, 20);
+    check_copy(200, 300, TEST_WIDTH + 30, TEST_HEIGHT + 30);
+}   /* test_copy_rows() */
+
+// Render `area` of g_screen into a packed buffer, as LVGL would, flush it
+// through the tiles onto g_fb (the panel) and return the rectangles sent.
+//
+static uint32_t
+tiles_flush (const fb_rect_t * p_area, fb_rect_t * p_out)
+{
+    int32_t area_w = p_area->x2 - p_area->x1 + 1;
+    uint32_t num = 0;
+
+    for (int32_t y = p_area->y1; y <= p_area->y2; ++y)
+    {
+        memcpy(&g_src[(y - p_area->y1) * area_w],
+               &g_screen[y * TEST_WIDTH + p_area->x1],
+               area_w * sizeof(uint16_t));
+    }
+
+    num = fb_tiles_diff(&g_tiles, p_area, g_src, p_out, FB_TILES_MAX_RECT);
+
+    for (uint32_t idx = 0; idx < num; ++idx)
+    {
+        fb_copy_rows(g_fb, TEST_WIDTH, p_area, &p_out[idx], g_src);
+    }
+
+    return (num);
+}   /* tiles_flush() */
+
+static void
+check_rect (const fb_rect_t * p_rect, int32_t x1, int32_t y1, int32_t x2,
+            int32_t y2)
+{
+    TEST_ASSERT_EQUAL_INT32(x1, p_rect->x1);
+    TEST_ASSERT_EQUAL_INT32(y1, p_rect->y1);
+    TEST_ASSERT_EQUAL_INT32(x2, p_rect->x2);
+    TEST_ASSERT_EQUAL_INT32(y2, p_rect->y2);
+}   /* check_rect() */
+
+static void
+test_tiles_round (void)
+{
+    fb_rect_t area = {33, 9, 40, 9};
+
+    fb_tiles_init(&g_tiles, TEST_WIDTH, TEST_HEIGHT, g_hash);
+    fb_tiles_round(&g_tiles, &area);
+    check_rect(&area, 32, 8, 63, 15);
+
+    area.x1 = 230;
+    area.y1 = 317;
+    area.x2 = 239;
+    area.y2 = 319;
+    fb_tiles_round(&g_tiles, &area);
+    check_rect(&area, 224, 312, TEST_WIDTH - 1, TEST_HEIGHT - 1);
+}   /* test_tiles_round() */
+
+static void
+test_tiles_diff (void)
+{
+    const fb_rect_t full = {0, 0, TEST_WIDTH - 1, TEST_HEIGHT - 1};
+    const fb_rect_t band = {0, 64, TEST_WIDTH - 1, 103};
+    fb_rect_t out[FB_TILES_MAX_RECT];
+    fb_tiles_stats_t stats;
+
+    fb_tiles_init(&g_tiles, TEST_WIDTH, TEST_HEIGHT, g_hash);
+    memset(g_screen, 0x5A, sizeof(g_screen));
+
+    // Nothing known yet: every tile goes, merged into one rectangle.
+    //
+    TEST_ASSERT_EQUAL_UINT32(1, tiles_flush(&full, out));
+    check_rect(&out[0], 0, 0, TEST_WIDTH - 1, TEST_HEIGHT - 1);
+    fb_tiles_frame_end(&g_tiles);
+
+    // Same pixels again: nothing to send.
+    //
+    TEST_ASSERT_EQUAL_UINT32(0, tiles_flush(&band, out));
+    fb_tiles_frame_end(&g_tiles);
+    fb_tiles_get_stats(&g_tiles, &stats);
+    TEST_ASSERT_EQUAL_UINT32(TEST_WIDTH * 40 * 2, stats.frame_bytes);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.frame_sent);
+
+    // One pixel: its tile only.
+    //
+    g_screen[70 * TEST_WIDTH + 100] ^= 0xFFFF;
+    TEST_ASSERT_EQUAL_UINT32(1, tiles_flush(&band, out));
+    check_rect(&out[0], 96, 64, 127, 71);
+
+    // Neighbours across and below merge; a lone diagonal one does not.
+    //
+    g_screen[80 * TEST_WIDTH + 40] ^= 0xFFFF;
+    g_screen[80 * TEST_WIDTH + 70] ^= 0xFFFF;
+    g_screen[90 * TEST_WIDTH + 40] ^= 0xFFFF;
+    g_screen[90 * TEST_WIDTH + 70] ^= 0xFFFF;
+    g_screen[100 * TEST_WIDTH + 200] ^= 0xFFFF;
+    TEST_ASSERT_EQUAL_UINT32(2, tiles_flush(&band, out));
+    check_rect(&out[0], 32, 80, 95, 95);
+    check_rect(&out[1], 192, 96, 223, 103);
+
+    // Toggled back within the frame: identical to what the panel has.
+    //
+    g_screen[70 * TEST_WIDTH + 100] ^= 0xFFFF;
+    g_screen[70 * TEST_WIDTH + 100] ^= 0xFFFF;
+    TEST_ASSERT_EQUAL_UINT32(0, tiles_flush(&band, out));
+
+    // An area off the tile grid: partly covered tiles are sent as they
+    // are and compared again only once they are flushed whole.
+    //
+    const fb_rect_t odd = {10, 10, 20, 12};
+
+    TEST_ASSERT_EQUAL_UINT32(1, tiles_flush(&odd, out));
+    check_rect(&out[0], 10, 10, 20, 12);
+    TEST_ASSERT_EQUAL_UINT32(1, tiles_flush(&full, out));
+    check_rect(&out[0], 0, 8, 31, 15);
+    TEST_ASSERT_EQUAL_MEMORY(g_screen, g_fb, sizeof(g_screen));
+}   /* test_tiles_diff() */
+
+static void
+test_tiles_random (void)
+{
+    // Random edits and tile-aligned flushes: the panel must always end up
+    // equal to the screen, whatever was skipped.
+    //
+    uint32_t seed = 7;
+    fb_rect_t out[FB_TILES_MAX_RECT];
+
+    fb_tiles_init(&g_tiles, TEST_WIDTH, TEST_HEIGHT, g_hash);
+    memset(g_screen, 0, sizeof(g_screen));
+    memset(g_fb, 0xFF, sizeof(g_fb));
+
+    for (uint32_t round = 0; round < 300; ++round)
+    {
+        fb_rect_t area;
+
+        for (uint32_t edit = 0; edit < 8; ++edit)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            g_screen[(seed >> 8) % (TEST_WIDTH * TEST_HEIGHT)] =
+                                                    (uint16_t) (seed >> 3);
+        }
+
+        seed = seed * 1664525U + 1013904223U;
+        area.x1 = (int32_t) ((seed >> 4) % TEST_WIDTH);
+        area.y1 = (int32_t) ((seed >> 12) % TEST_HEIGHT);
+        area.x2 = area.x1 + (int32_t) ((seed >> 20) % 64);
+        area.y2 = area.y1 + (int32_t) ((seed >> 26) % 64);
+        area.x2 = (area.x2 >= TEST_WIDTH) ? TEST_WIDTH - 1 : area.x2;
+        area.y2 = (area.y2 >= TEST_HEIGHT) ? TEST_HEIGHT - 1 : area.y2;
+        fb_tiles_round(&g_tiles, &area);
+        (void) tiles_flush(&area, out);
+    }
+
+    const fb_rect_t full = {0, 0, TEST_WIDTH - 1, TEST_HEIGHT - 1};
+
+    (void) tiles_flush(&full, out);
+    TEST_ASSERT_EQUAL_MEMORY(g_screen, g_fb, sizeof(g_screen));
+}   /* test_tiles_random() */
+
+static void
+fill_src (uint32_t seed)
+{
+    for (uint32_t idx = 0; idx < TEST_WIDTH * TEST_HEIGHT; ++idx)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        g_src[idx] = (uint16_t) (seed >> 16);
+    }
+}   /* fill_src() */
+
+static void
+test_rotate_rect (void)
+{
+    // The landscape UI on the portrait panel: the whole logical screen
+    // covers the whole panel, and corners go where LVGL sends touches.
+    //
+    const fb_rect_t full = {0, 0, TEST_HEIGHT - 1, TEST_WIDTH - 1};
+    const fb_rect_t corner = {0, 0, 9, 4};
+    fb_rect_t out;
+
+    for (int rot = FB_ROT_90; rot <= FB_ROT_270; rot += 2)
+    {
+        fb_rotate_rect(&full, (fb_rotation_t) rot, TEST_WIDTH, TEST_HEIGHT,
+                       &out);
+        check_rect(&out, 0, 0, TEST_WIDTH - 1, TEST_HEIGHT - 1);
+    }
+
+    fb_rotate_rect(&corner, FB_ROT_90, TEST_WIDTH, TEST_HEIGHT, &out);
+    check_rect(&out, 0, TEST_HEIGHT - 10, 4, TEST_HEIGHT - 1);
+    fb_rotate_rect(&corner, FB_ROT_270, TEST_WIDTH, TEST_HEIGHT, &out);
+    check_rect(&out, TEST_WIDTH - 5, 0, TEST_WIDTH - 1, 9);
+    fb_rotate_rect(&corner, FB_ROT_180, TEST_WIDTH, TEST_HEIGHT, &out);
+    check_rect(&out, TEST_WIDTH - 10, TEST_HEIGHT - 5, TEST_WIDTH - 1,
+               TEST_HEIGHT - 1);
+    fb_rotate_rect(&corner, FB_ROT_0, TEST_WIDTH, TEST_HEIGHT, &out);
+    check_rect(&out, 0, 0, 9, 4);
+}   /* test_rotate_rect() */
+
+// Flush `clip` of an LVGL `area` (packed in g_src) to the panel g_fb with
+// the kernel, and check every pixel against the per-pixel mapping.
+//
+static void
+check_rotate (fb_rotation_t rotation, const fb_rect_t * p_area,
+              const fb_rect_t * p_clip)
+{
+    int32_t area_w = p_area->x2 - p_area->x1 + 1;
+    int32_t clip_w = p_clip->x2 - p_clip->x1 + 1;
+    int32_t clip_h = p_clip->y2 - p_clip->y1 + 1;
+    fb_rect_t panel;
+
+    memset(g_fb, 0, sizeof(g_fb));
+    fb_rotate_rect(p_clip, rotation, TEST_WIDTH, TEST_HEIGHT, &panel);
+    TEST_ASSERT_EQUAL_INT32(((rotation & 1) ? clip_h : clip_w) - 1,
+                            panel.x2 - panel.x1);
+    fb_rotate_copy(&g_fb[fb_dst_offset(&panel, TEST_WIDTH, panel.y1)],
+                   TEST_WIDTH,
+                   &g_src[fb_src_offset(p_area, p_clip, p_clip->y1)], area_w,
+                   clip_w, clip_h, rotation);
+
+    for (int32_t y = p_clip->y1; y <= p_clip->y2; ++y)
+    {
+        for (int32_t x = p_clip->x1; x <= p_clip->x2; ++x)
+        {
+            fb_rect_t px = {x, y, x, y};
+            fb_rect_t out;
+
+            fb_rotate_rect(&px, rotation, TEST_WIDTH, TEST_HEIGHT, &out);
+            TEST_ASSERT_EQUAL_UINT16(
+                g_src[(y - p_area->y1) * area_w + x - p_area->x1],
+                g_fb[out.y1 * TEST_WIDTH + out.x1]);
+        }
+    }
+}   /* check_rotate() */
+
+static void
+test_rotate_copy (void)
+{
+    // Whole screen, a band, odd sizes across the 16-pixel blocks, and a
+    // rectangle inside a wider area, as sent by the tiles.
+    //
+    const fb_rect_t full = {0, 0, TEST_HEIGHT - 1, TEST_WIDTH - 1};
+    const fb_rect_t band = {0, 30, TEST_HEIGHT - 1, 59};
+    const fb_rect_t odd = {7, 3, 7 + 36, 3 + 18};
+    const fb_rect_t wide = {0, 100, TEST_HEIGHT - 1, 139};
+    const fb_rect_t tile = {64, 108, 127, 123};
+
+    fill_src(41);
+
+    for (int rot = FB_ROT_90; rot <= FB_ROT_270; rot += 2)
+    {
+        check_rotate((fb_rotation_t) rot, &full, &full);
+        check_rotate((fb_rotation_t) rot, &band, &band);
+        check_rotate((fb_rotation_t) rot, &odd, &odd);
+        check_rotate((fb_rotation_t) rot, &wide, &tile);
+    }
+
+    // 180 and 0 keep the panel's shape.
+    //
+    {
+        const fb_rect_t portrait = {3, 5, 3 + 40, 5 + 33};
+
+        check_rotate(FB_ROT_180, &portrait, &portrait);
+        check_rotate(FB_ROT_0, &portrait, &portrait);
+    }
+}   /* test_rotate_copy() */
+
+#if TEST_LV_ROTATE
+static void
+test_rotate_lvgl (void)
+{
+    // Same pixels as LVGL's rotation, so touch and picture agree.
+    //
+    const int32_t w = TEST_HEIGHT;
+    const int32_t h = TEST_WIDTH / 8;
+    static const lv_display_rotation_t lv_rot[] =
+    {
+        LV_DISPLAY_ROTATION_0, LV_DISPLAY_ROTATION_90,
+        LV_DISPLAY_ROTATION_180, LV_DISPLAY_ROTATION_270
+    };
+
+    fill_src(43);
+
+    for (int rot = FB_ROT_90; rot <= FB_ROT_270; ++rot)
+    {
+        int32_t out_w = (rot & 1) ? h : w;
+        int32_t out_h = (rot & 1) ? w : h;
+
+        lv_draw_sw_rotate(g_src, g_rot, w, h, w * 2, out_w * 2, lv_rot[rot],
+                          LV_COLOR_FORMAT_RGB565);
+        fb_rotate_copy(g_fb, out_w, g_src, w, w, h, (fb_rotation_t) rot);
+        TEST_ASSERT_EQUAL_MEMORY(g_rot, g_fb, out_w * out_h * 2);
+    }
+}   /* test_rotate_lvgl() */
+#endif
+
+static void
+test_l8_lut (void)
+{
+    // Every palette color comes back exact from its level and its snap
+    // neighbours; levels away from all of them are grey.
+    //
+    static const uint32_t palette[] = FB_L8_PALETTE;
+    const uint32_t count = sizeof(palette) / sizeof(palette[0]);
+    uint16_t lut[256];
+
+    TEST_ASSERT_EQUAL_UINT32(0, fb_l8_lut(lut, palette, count, 0));
+
+    for (uint32_t idx = 0; idx < count; ++idx)
+    {
+        uint32_t rgb = palette[idx];
+        uint16_t px = (uint16_t) (((rgb >> 8) & 0xF800U)
+                                  | ((rgb >> 5) & 0x07E0U)
+                                  | ((rgb >> 3) & 0x001FU));
+        int32_t level = fb_l8_level(rgb);
+
+        TEST_ASSERT_EQUAL_HEX16(px, lut[level]);
+
+        if ((level >= FB_L8_SNAP) && (level + FB_L8_SNAP <= 255))
+        {
+            TEST_ASSERT_EQUAL_HEX16(px, lut[level - FB_L8_SNAP]);
+            TEST_ASSERT_EQUAL_HEX16(px, lut[level + FB_L8_SNAP]);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(255, fb_l8_level(0xFFFFFFU));
+    TEST_ASSERT_EQUAL_UINT8(0, fb_l8_level(0x000000U));
+    TEST_ASSERT_EQUAL_HEX16(0x4208, lut[64]);   /* 0x404040 */
+
+    // Byte swapped for the bus, and two colors on one level.
+    //
+    {
+        static const uint32_t same[] = {0xF44336U, 0xF44336U, 0x2196F3U};
+        uint16_t swapped[256];
+
+        TEST_ASSERT_EQUAL_UINT32(0, fb_l8_lut(swapped, palette, count, 1));
+        TEST_ASSERT_EQUAL_HEX16((uint16_t) ((lut[164] << 8) | (lut[164] >> 8)),
+                                swapped[164]);
+        TEST_ASSERT_EQUAL_UINT32(1, fb_l8_lut(swapped, same, 3, 0));
+    }
+}   /* test_l8_lut() */
+
+static void
+test_l8_expand (void)
+{
+    // A clipped rectangle inside a wider L8 area, odd width for the tail.
+    //
+    static uint8_t l8[TEST_WIDTH * 16];
+    const fb_rect_t area = {0, 0, TEST_WIDTH - 1, 15};
+    const fb_rect_t clip = {13, 2, 13 + 38, 12};
+    uint16_t lut[256];
+
+    for (uint32_t level = 0; level < 256; ++level)
+    {
+        lut[level] = (uint16_t) (level * 257U);
+    }
+
+    for (uint32_t idx = 0; idx < sizeof(l8); ++idx)
+    {
+        l8[idx] = (uint8_t) (idx * 7U);
+    }
+
+    memset(g_fb, 0, sizeof(g_fb));
+    fb_l8_expand(&g_fb[fb_dst_offset(&clip, TEST_WIDTH, clip.y1)], TEST_WIDTH,
+                 &l8[fb_src_offset(&area, &clip, clip.y1)], TEST_WIDTH,
+                 clip.x2 - clip.x1 + 1, clip.y2 - clip.y1 + 1, lut);
+
+    for (int32_t y = 0; y < 16; ++y)
+    {
+        for (int32_t x = 0; x < TEST_WIDTH; ++x)
+        {
+            uint8_t b_in = (x >= clip.x1) && (x <= clip.x2)
+                           && (y >= clip.y1) && (y <= clip.y2);
+            uint16_t px = b_in ? lut[l8[y * TEST_WIDTH + x]] : 0;
+
+            TEST_ASSERT_EQUAL_HEX16(px, g_fb[y * TEST_WIDTH + x]);
+        }
+    }
+}   /* test_l8_expand() */
+
+static void
+test_tiles_l8 (void)
+{
+    // L8 sources hash as pixel pairs: same answers as for RGB565.
+    //
+    static uint8_t l8[TEST_WIDTH * 16];
+    const fb_rect_t area = {0, 16, TEST_WIDTH - 1, 31};
+    fb_rect_t out[FB_TILES_MAX_RECT];
+
+    memset(l8, 0x55, sizeof(l8));
+    fb_tiles_init(&g_tiles, TEST_WIDTH, TEST_HEIGHT, g_hash);
+    g_tiles.px_bytes = 1;
+
+    TEST_ASSERT_EQUAL_UINT32(1, fb_tiles_diff(&g_tiles, &area, l8, out,
+                                              FB_TILES_MAX_RECT));
+    check_rect(&out[0], 0, 16, TEST_WIDTH - 1, 31);
+    TEST_ASSERT_EQUAL_UINT32(0, fb_tiles_diff(&g_tiles, &area, l8, out,
+                                              FB_TILES_MAX_RECT));
+
+    l8[9 * TEST_WIDTH + 100] = 0x56;
+    TEST_ASSERT_EQUAL_UINT32(1, fb_tiles_diff(&g_tiles, &area, l8, out,
+                                              FB_TILES_MAX_RECT));
+    check_rect(&out[0], 96, 24, 127, 31);
+
+    // An odd area width cannot be hashed in pairs: always sent.
+    //
+    {
+        const fb_rect_t odd = {0, 32, 32, 39};
+
+        TEST_ASSERT_EQUAL_UINT32(1, fb_tiles_diff(&g_tiles, &odd, l8, out,
+                                                  FB_TILES_MAX_RECT));
+        TEST_ASSERT_EQUAL_UINT32(1, fb_tiles_diff(&g_tiles, &odd, l8, out,
+                                                  FB_TILES_MAX_RECT));
+        check_rect(&out[0], 0, 32, 32, 39);
+    }
+}   /* test_tiles_l8() */
+
+static void
+bench_clip (void * p_ctx, uint32_t iters)
+{
+    volatile int32_t sink = 0;
+    fb_rect_t clip;
+
+    (void) p_ctx;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        fb_rect_t area = {(int32_t) (idx & 63U) - 32, 10,
+                          (int32_t) (idx & 255U) + 100, 40};
+
+        sink = sink + fb_clip(&area, TEST_WIDTH, TEST_HEIGHT, &clip);
+    }
+}   /* bench_clip() */
+
+static void
+bench_copy_band (void * p_ctx, uint32_t iters)
+{
+    // One LVGL partial buffer: full width, 1/8 of the screen.
+    //
+    fb_rect_t area = {0, 0, TEST_WIDTH - 1, TEST_HEIGHT / 8 - 1};
+
+    (void) p_ctx;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        area.y1 = (int32_t) (idx % 8U) * (TEST_HEIGHT / 8);
+        area.y2 = area.y1 + TEST_HEIGHT / 8 - 1;
+        fb_copy_rows(g_fb, TEST_WIDTH, &area, &area, g_src);
+    }
+}   /* bench_copy_band() */
+
+static void
+bench_tile_hash (void * p_ctx, uint32_t iters)
+{
+    volatile uint32_t sink = 0;
+
+    (void) p_ctx;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        sink = sink + fb_tiles_hash(&g_src[(idx & 15U) * FB_TILE_W],
+                                    TEST_WIDTH, FB_TILE_W, FB_TILE_H);
+    }
+}   /* bench_tile_hash() */
+
+static void
+bench_tiles_diff (void * p_ctx, uint32_t iters)
+{
+    // A whole unchanged band: the cost of finding there is nothing to do.
+    //
+    const fb_rect_t area = {0, 0, TEST_WIDTH - 1, TEST_HEIGHT / 8 - 1};
+    fb_rect_t out[FB_TILES_MAX_RECT];
+
+    (void) p_ctx;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        (void) fb_tiles_diff(&g_tiles, &area, g_src, out, FB_TILES_MAX_RECT);
+    }
+}   /* bench_tiles_diff() */
+
+// One LVGL partial buffer of the landscape UI, 1/8 of the screen, onto
+// the portrait panel.
+//
+static void
+bench_rotate_band (void * p_ctx, uint32_t iters)
+{
+    const int32_t w = TEST_HEIGHT;
+    const int32_t h = TEST_WIDTH / 8;
+
+    (void) p_ctx;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        fb_rect_t area = {0, (int32_t) (idx % 8U) * h, w - 1, 0};
+        fb_rect_t panel;
+
+        area.y2 = area.y1 + h - 1;
+        fb_rotate_rect(&area, FB_ROT_90, TEST_WIDTH, TEST_HEIGHT, &panel);
+        fb_rotate_copy(&g_fb[fb_dst_offset(&panel, TEST_WIDTH, panel.y1)],
+                       TEST_WIDTH, g_src, w, w, h, FB_ROT_90);
+    }
+}   /* bench_rotate_band() */
+
+#if TEST_LV_ROTATE
+// LVGL's way: rotate into a second buffer, then copy the rows.
+//
+static void
+bench_rotate_band_lvgl (void * p_ctx, uint32_t iters)
+{
+    const int32_t w = TEST_HEIGHT;
+    const int32_t h = TEST_WIDTH / 8;
+
+    (void) p_ctx;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        fb_rect_t area = {0, (int32_t) (idx % 8U) * h, w - 1, 0};
+        fb_rect_t panel;
+
+        area.y2 = area.y1 + h - 1;
+        fb_rotate_rect(&area, FB_ROT_90, TEST_WIDTH, TEST_HEIGHT, &panel);
+        lv_draw_sw_rotate(g_src, g_rot, w, h, w * 2, h * 2,
+                          LV_DISPLAY_ROTATION_90, LV_COLOR_FORMAT_RGB565);
+        fb_copy_rows(g_fb, TEST_WIDTH, &panel, &panel, g_rot);
+    }
+}   /* bench_rotate_band_lvgl() */
+#endif
+
+static void
+bench_l8_band (void * p_ctx, uint32_t iters)
+{
+    // The same band as bench_copy_band(), drawn in L8 and expanded.
+    //
+    const uint16_t * p_lut = (const uint16_t *) p_ctx;
+    const uint8_t * p_l8 = (const uint8_t *) g_rot;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        int32_t y1 = (int32_t) (idx % 8U) * (TEST_HEIGHT / 8);
+
+        fb_l8_expand(&g_fb[y1 * TEST_WIDTH], TEST_WIDTH, p_l8, TEST_WIDTH,
+                     TEST_WIDTH, TEST_HEIGHT / 8, p_lut);
+    }
+}   /* bench_l8_band() */
+
+static void
+test_bench (void)
+{
+    perf_bench_t clip;
+    perf_bench_t band;
+    perf_bench_t hash;
+    perf_bench_t diff;
+    perf_bench_t rot;
+    perf_bench_t l8;
+    uint16_t lut[256];
+    static const uint32_t palette[] = FB_L8_PALETTE;
+
+    fb_tiles_init(&g_tiles, TEST_WIDTH, TEST_HEIGHT, g_hash);
+    perf_bench_run("fb_clip", bench_clip, NULL, 21, &clip);
+    perf_bench_run("fb_copy_rows 240x40", bench_copy_band, NULL, 21, &band);
+    perf_bench_run("fb_tiles_hash 32x8", bench_tile_hash, NULL, 21, &hash);
+    perf_bench_run("fb_tiles_diff 240x40 same", bench_tiles_diff, NULL, 21,
+                   &diff);
+    printf("bench fb_tiles_hash %.0f MB/s\n",
+           FB_TILE_W * FB_TILE_H * 2 * 1000.0 / hash.median_ns);
+    perf_bench_run("fb_rotate_copy 320x30", bench_rotate_band, NULL, 21,
+                   &rot);
+    printf("bench rotated / native band %.2f\n",
+           rot.median_ns / band.median_ns);
+    (void) fb_l8_lut(lut, palette, sizeof(palette) / sizeof(palette[0]), 0);
+    perf_bench_run("fb_l8_expand 240x40", bench_l8_band, lut, 21, &l8);
+    printf("bench L8 / RGB565 band %.2f, buffer %u / %u bytes\n",
+           l8.median_ns / band.median_ns, TEST_WIDTH * TEST_HEIGHT / 8,
+           TEST_WIDTH * TEST_HEIGHT / 8 * 2);
+#if TEST_LV_ROTATE
+    {
+        perf_bench_t lv_rot;
+
+        perf_bench_run("lv_draw_sw_rotate 320x30", bench_rotate_band_lvgl,
+                       NULL, 21, &lv_rot);
+        printf("bench rotated / LVGL rotated band %.2f\n",
+               rot.median_ns / lv_rot.median_ns);
+
+        // One blocked pass must beat LVGL's rotate-then-copy.
+        //
+        TEST_ASSERT_TRUE(rot.median_ns < lv_rot.median_ns);
+    }
+#endif
+
+    TEST_ASSERT_TRUE(clip.median_ns > 0.0f);
+    TEST_ASSERT_TRUE(band.median_ns > clip.median_ns);
+    TEST_ASSERT_TRUE(hash.median_ns > 0.0f);
+    TEST_ASSERT_TRUE(diff.median_ns > hash.median_ns);
+    TEST_ASSERT_TRUE(rot.median_ns > 0.0f);
+    TEST_ASSERT_TRUE(l8.median_ns > 0.0f);
+}   /* test_bench() */
+
+int
+main (void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_clip);
+    RUN_TEST(test_copy_rows);
+    RUN_TEST(test_tiles_round);
+    RUN_TEST(test_tiles_diff);
+    RUN_TEST(test_tiles_random);
+    RUN_TEST(test_rotate_rect);
+    RUN_TEST(test_rotate_copy);
+    RUN_TEST(test_l8_lut);
+    RUN_TEST(test_l8_expand);
+    RUN_TEST(test_tiles_l8);
+#if TEST_LV_ROTATE
+    RUN_TEST(test_rotate_lvgl);
+#endif
+    RUN_TEST(test_bench);
+
+    return (UNITY_END());
+}   /* main() */
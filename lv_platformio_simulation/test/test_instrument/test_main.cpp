@@ -0,0 +1,1292 @@
+#include <unity.h>
+#include <math.h>
+#include "instrument.h"
+#include "synth_tables.h"
+#include "perf_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+static synth_t * gp_engine = NULL;
+static instrument_t g_piano;
+static instrument_t g_pad;
+static int16_t g_out[2 * SYNTH_BLOCK_SIZE];
+
+#define TEST_BANK_PRESETS   (512U)
+#define TEST_BANK_PATH      "test_presets.bin"
+#define TEST_SET_FRAMES     (SAMPLER_ATTACK_FRAMES + 3U * SAMPLER_RING_FRAMES)
+#define TEST_SET_ROOT       (60)
+
+void
+setUp (void)
+{
+    // The audio arena only grows: one engine serves every test.
+    //
+    if (NULL == gp_engine)
+    {
+        gp_engine = instrument_engine_create();
+        TEST_ASSERT_NOT_NULL(gp_engine);
+        TEST_ASSERT_EQUAL_UINT8(1, init_instrument(&g_piano, gp_engine));
+        TEST_ASSERT_EQUAL_UINT8(1, init_instrument(&g_pad, gp_engine));
+        instrument_layer(&g_piano, &g_pad);
+    }
+}   /* setUp() */
+
+void
+tearDown (void)
+{
+}   /* tearDown() */
+
+static const synth_voice_t *
+find_voice (uint8_t part, uint8_t note)
+{
+    for (uint32_t idx = 0; idx < SYNTH_NUM_VOICE; ++idx)
+    {
+        const synth_voice_t * p_voice = &gp_engine->voice[idx];
+
+        if (p_voice->active && (p_voice->part == part)
+            && (p_voice->note == note))
+        {
+            return (p_voice);
+        }
+    }
+
+    return (NULL);
+}   /* find_voice() */
+
+static void
+test_note_frequency (void)
+{
+    const synth_tables_t * p_tables = synth_tables_acquire(48000);
+
+    TEST_ASSERT_NOT_NULL(p_tables);
+
+    // Phase steps are 32-bit fractions of the sample rate.
+    //
+    double a4 = p_tables->note_inc[69] / 4294967296.0 * 48000.0;
+    double c4 = p_tables->note_inc[INSTR_BASE_NOTE] / 4294967296.0 * 48000.0;
+
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 440.0f, (float) a4);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 261.626f, (float) c4);
+
+    for (uint32_t note = 12; note < SYNTH_NUM_NOTE; ++note)
+    {
+        double ratio = (double) p_tables->note_inc[note]
+                       / p_tables->note_inc[note - 12];
+
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f, (float) ratio);
+    }
+
+    synth_tables_release(p_tables);
+}   /* test_note_frequency() */
+
+static void
+test_part_note (void)
+{
+    instrument_set_zone(&g_pad, 62, 70, -12);
+
+    TEST_ASSERT_EQUAL_INT32(61, instrument_part_note(&g_piano, 61));
+    TEST_ASSERT_EQUAL_INT32(-1, instrument_part_note(&g_pad, 61));
+    TEST_ASSERT_EQUAL_INT32(50, instrument_part_note(&g_pad, 62));
+    TEST_ASSERT_EQUAL_INT32(58, instrument_part_note(&g_pad, 70));
+    TEST_ASSERT_EQUAL_INT32(-1, instrument_part_note(&g_pad, 71));
+
+    // Transposed past either end of the MIDI range: silent, not wrapped.
+    //
+    instrument_set_zone(&g_pad, 0, 127, -12);
+    TEST_ASSERT_EQUAL_INT32(-1, instrument_part_note(&g_pad, 5));
+    instrument_set_zone(&g_pad, 0, 127, 12);
+    TEST_ASSERT_EQUAL_INT32(-1, instrument_part_note(&g_pad, 120));
+    TEST_ASSERT_EQUAL_INT32(127, instrument_part_note(&g_pad, 115));
+}   /* test_part_note() */
+
+static void
+test_key_to_voice (void)
+{
+    // Pad an octave down, on the lower half of the keyboard only.
+    //
+    instrument_set_zone(&g_pad, INSTR_BASE_NOTE, INSTR_BASE_NOTE + 5, -12);
+
+    instrument_key(&g_piano, 0, 1);
+    instrument_key(&g_piano, 7, 1);
+    TEST_ASSERT_EQUAL_UINT8(2, g_piano.q_key_press);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+
+    const synth_voice_t * p_low = find_voice(g_piano.part, INSTR_BASE_NOTE);
+    const synth_voice_t * p_layer = find_voice(g_pad.part,
+                                               INSTR_BASE_NOTE - 12);
+    const synth_voice_t * p_high = find_voice(g_piano.part,
+                                              INSTR_BASE_NOTE + 7);
+
+    TEST_ASSERT_NOT_NULL(p_low);
+    TEST_ASSERT_NOT_NULL(p_layer);
+    TEST_ASSERT_NOT_NULL(p_high);
+    TEST_ASSERT_TRUE(p_low->gate && p_layer->gate && p_high->gate);
+    TEST_ASSERT_NULL(find_voice(g_pad.part, INSTR_BASE_NOTE + 7 - 12));
+
+    // Releasing a key closes its voices on every part, and only those.
+    //
+    instrument_key(&g_piano, 0, 0);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_FALSE(p_low->gate);
+    TEST_ASSERT_FALSE(p_layer->gate);
+    TEST_ASSERT_TRUE(p_high->gate);
+
+    instrument_key(&g_piano, 7, 0);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_FALSE(p_high->gate);
+    TEST_ASSERT_EQUAL_UINT8(0, g_piano.q_key_press);
+
+    // The oscillator mode is per instrument and survives a new waveform.
+    //
+    instrument_set_osc_mode(&g_pad, OSC_MODE_BLEP);
+    instrument_set_waveform(&g_pad, OSC_SAW);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_UINT8(OSC_MODE_BLEP, gp_engine->part[g_pad.part].mode);
+    TEST_ASSERT_EQUAL_UINT8(OSC_DEFAULT_MODE,
+                            gp_engine->part[g_piano.part].mode);
+
+    // Past the last SYNTH_WAVE_* nothing is sent or recorded.
+    //
+    TEST_ASSERT_EQUAL_UINT8(0, synth_set_waveform(gp_engine, g_pad.part,
+                                                  SYNTH_NUM_WAVE,
+                                                  OSC_DEFAULT_MODE));
+    instrument_set_waveform(&g_pad, SYNTH_NUM_WAVE);
+    TEST_ASSERT_EQUAL_UINT8(OSC_SAW, g_pad.prop.waveform);
+
+    instrument_set_osc_mode(&g_pad, OSC_DEFAULT_MODE);
+    instrument_set_waveform(&g_pad, OSC_SINE);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+}   /* test_key_to_voice() */
+
+static void
+test_seq_layers (void)
+{
+    static seq_t seq;
+    seq_pattern_t * p_pat = NULL;
+
+    // The arpeggiator's notes reach the pad through its zone and
+    // transpose, as the keys do: key 0 is in the pad's zone, key 7 is not.
+    //
+    seq_init(&seq, SYNTH_SAMPLE_RATE, g_piano.part);
+    g_piano.p_seq = &seq;
+    synth_set_seq(gp_engine, &seq);
+    p_pat = seq_edit(&seq);
+    p_pat->mode = SEQ_MODE_ARP;
+    p_pat->gate_pct = 100;
+    seq_commit(&seq);
+
+    instrument_key(&g_piano, 0, 1);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_NOT_NULL(find_voice(g_piano.part, INSTR_BASE_NOTE));
+    TEST_ASSERT_NOT_NULL(find_voice(g_pad.part, INSTR_BASE_NOTE - 12));
+    instrument_key(&g_piano, 0, 0);
+
+    // Next step, a sixteenth at 120 bpm later.
+    //
+    instrument_key(&g_piano, 7, 1);
+
+    for (uint32_t idx = 0; idx < SYNTH_SAMPLE_RATE / 8 / SYNTH_BLOCK_SIZE + 1;
+         ++idx)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    }
+
+    TEST_ASSERT_NOT_NULL(find_voice(g_piano.part, INSTR_BASE_NOTE + 7));
+    TEST_ASSERT_NULL(find_voice(g_pad.part, INSTR_BASE_NOTE + 7 - 12));
+    instrument_key(&g_piano, 7, 0);
+
+    synth_set_seq(gp_engine, NULL);
+    g_piano.p_seq = NULL;
+
+    for (uint32_t idx = 0; idx < SYNTH_SAMPLE_RATE / SYNTH_BLOCK_SIZE; ++idx)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    }
+}   /* test_seq_layers() */
+
+// A bank image of `count` presets: header, then the records.
+//
+static preset_bank_header_t *
+make_bank (uint32_t count)
+{
+    size_t size = sizeof(preset_bank_header_t) + count * sizeof(preset_t);
+    preset_bank_header_t * p_hdr = (preset_bank_header_t *) malloc(size);
+    preset_t * p_preset = (preset_t *) (p_hdr + 1);
+
+    for (uint32_t idx = 0; idx < count; ++idx)
+    {
+        char name[PRESET_NAME_LEN];
+
+        snprintf(name, sizeof(name), "P%u", (unsigned) idx);
+        preset_init(&p_preset[idx], name);
+        p_preset[idx].part[0].volume = (uint8_t) (idx % 101U);
+    }
+
+    p_hdr->magic = PRESET_MAGIC;
+    p_hdr->version = PRESET_VERSION;
+    p_hdr->record_size = sizeof(preset_t);
+    p_hdr->count = count;
+    p_hdr->checksum = preset_checksum(p_preset, count);
+
+    return (p_hdr);
+}   /* make_bank() */
+
+static void
+test_preset_bank (void)
+{
+    size_t size = sizeof(preset_bank_header_t) + 8U * sizeof(preset_t);
+    preset_bank_header_t * p_hdr = make_bank(8);
+    preset_t * p_preset = (preset_t *) (p_hdr + 1);
+    preset_bank_t bank;
+    preset_t preset;
+
+    // Used in place, refused on any header, size or content mismatch.
+    //
+    TEST_ASSERT_EQUAL_UINT8(1, preset_bank_open(&bank, p_hdr, size));
+    TEST_ASSERT_EQUAL_PTR(p_preset, bank.p_preset);
+    TEST_ASSERT_EQUAL_UINT32(8, bank.count);
+    TEST_ASSERT_EQUAL_UINT8(0, preset_bank_open(&bank, p_hdr, size - 1));
+    p_hdr->count = 0xFFFFFFFFU / sizeof(preset_t) + 9U;
+    TEST_ASSERT_EQUAL_UINT8(0, preset_bank_open(&bank, p_hdr, size));
+    p_hdr->count = 8;
+    p_preset[3].fx[0] += 1.0f;
+    TEST_ASSERT_EQUAL_UINT8(0, preset_bank_open(&bank, p_hdr, size));
+    p_preset[3].fx[0] -= 1.0f;
+    ++p_hdr->version;
+    TEST_ASSERT_EQUAL_UINT8(0, preset_bank_open(&bank, p_hdr, size));
+    free(p_hdr);
+
+    // Every fx parameter maps to one slot and back.
+    //
+    for (uint32_t idx = 0; idx < PRESET_NUM_FX_PARAM; ++idx)
+    {
+        fx_id_t id;
+        fx_param_t param;
+
+        preset_fx_param(idx, &id, &param);
+        TEST_ASSERT_EQUAL_INT32((int32_t) idx, preset_fx_index(id, param));
+    }
+
+    TEST_ASSERT_EQUAL_INT32(-1, preset_fx_index(FX_FILTER, FX_PARAM_MIX));
+
+    // A missing file is made from the factory bank; a stored preset is
+    // there after mapping it again.
+    //
+    remove(TEST_BANK_PATH);
+    TEST_ASSERT_EQUAL_UINT8(1, preset_bank_map(&bank, TEST_BANK_PATH));
+    TEST_ASSERT_EQUAL_UINT32(PRESET_BANK_SLOTS, bank.count);
+    TEST_ASSERT_EQUAL_STRING("Piano+Pad", bank.p_preset[0].name);
+    TEST_ASSERT_EQUAL_UINT32(1, preset_bank_next(&bank, 0));
+
+    preset_init(&preset, "Stored");
+    preset.part[1].wave = OSC_SQUARE;
+    TEST_ASSERT_EQUAL_UINT8(1, preset_bank_store(&bank, 100, &preset));
+    preset_bank_unmap(&bank);
+
+    TEST_ASSERT_EQUAL_UINT8(1, preset_bank_map(&bank, TEST_BANK_PATH));
+    TEST_ASSERT_EQUAL_STRING("Stored", bank.p_preset[100].name);
+    TEST_ASSERT_EQUAL_UINT8(OSC_SQUARE, bank.p_preset[100].part[1].wave);
+    TEST_ASSERT_EQUAL_UINT32(0, preset_bank_next(&bank, 100));
+    preset_bank_unmap(&bank);
+    remove(TEST_BANK_PATH);
+}   /* test_preset_bank() */
+
+static void
+test_preset_switch (void)
+{
+    preset_bank_t bank;
+    preset_t preset;
+
+    preset_bank_factory(&bank);
+    instrument_key(&g_piano, 0, 1);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+
+    const synth_voice_t * p_voice = find_voice(g_piano.part, INSTR_BASE_NOTE);
+
+    TEST_ASSERT_NOT_NULL(p_voice);
+
+    // Nothing changes before the block boundary; then the whole sound,
+    // while the held note keeps playing.
+    //
+    instrument_set_preset(&g_piano, &bank.p_preset[1]);
+    TEST_ASSERT_EQUAL_UINT8(bank.p_preset[1].part[g_pad.part].volume,
+                            g_pad.prop.volume);
+    TEST_ASSERT_EQUAL_UINT8(0, gp_engine->fx.stage[FX_CHORUS].enabled);
+
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_UINT8(1, gp_engine->fx.stage[FX_CHORUS].enabled);
+    TEST_ASSERT_EQUAL_UINT8(bank.p_preset[1].part[0].wave,
+                            gp_engine->part[0].wave);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, bank.p_preset[1].part[1].volume / 100.0f,
+                             gp_engine->part[1].volume);
+    TEST_ASSERT_TRUE(p_voice->active && p_voice->gate);
+
+    // A change after the switch wins, and is what gets stored.
+    //
+    instrument_set_preset(&g_piano, &bank.p_preset[0]);
+    instrument_set_volume(&g_pad, 77);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.77f, gp_engine->part[g_pad.part].volume);
+    TEST_ASSERT_EQUAL_UINT8(0, gp_engine->fx.stage[FX_CHORUS].enabled);
+
+    synth_get_preset(gp_engine, &preset);
+    TEST_ASSERT_EQUAL_UINT8(77, preset.part[g_pad.part].volume);
+    TEST_ASSERT_EQUAL_STRING("Piano+Pad", preset.name);
+
+    // The whole unison stack is stored, and comes back with the preset.
+    //
+    instrument_set_unison(&g_pad, 4, 33.0f, 0.25f);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    synth_get_preset(gp_engine, &preset);
+    TEST_ASSERT_EQUAL_UINT8(4, preset.part[g_pad.part].unison);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 33.0f, preset.detune[g_pad.part]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.25f, preset.spread[g_pad.part]);
+
+    instrument_set_preset(&g_piano, &bank.p_preset[0]);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, UNISON_DETUNE,
+                             gp_engine->part[g_pad.part].detune);
+
+    instrument_set_preset(&g_piano, &preset);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_UINT8(4, gp_engine->part[g_pad.part].unison);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 33.0f, gp_engine->part[g_pad.part].detune);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.25f, gp_engine->part[g_pad.part].spread);
+
+    // Attaching a bank plays its first preset, skipping empty slots.
+    //
+    preset_bank_header_t * p_hdr = make_bank(4);
+    preset_t * p_slot = (preset_t *) (p_hdr + 1);
+    preset_bank_t user_bank;
+
+    p_slot[0].name[0] = '\0';
+    p_hdr->checksum = preset_checksum(p_slot, 4);
+    TEST_ASSERT_EQUAL_UINT8(1, preset_bank_open(&user_bank, p_hdr,
+                                                sizeof(*p_hdr)
+                                                + 4U * sizeof(preset_t)));
+    instrument_set_bank(&g_piano, &user_bank);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(1, g_piano.preset);
+    TEST_ASSERT_EQUAL_UINT8(1, g_piano.prop.volume);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.01f, gp_engine->part[0].volume);
+
+    instrument_set_bank(&g_piano, NULL);
+    free(p_hdr);
+
+    instrument_set_preset(&g_piano, &bank.p_preset[0]);
+    instrument_set_volume(&g_pad, 100);
+
+    instrument_key(&g_piano, 0, 0);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+}   /* test_preset_switch() */
+
+static void
+test_preset_mod (void)
+{
+    const uint32_t base = gp_engine->p_tables->note_inc[INSTR_BASE_NOTE];
+    mod_patch_t * p_patch = synth_mod_edit(gp_engine);
+    const synth_voice_t * p_voice = NULL;
+    preset_bank_t bank;
+    preset_t preset;
+    uint32_t hi = 0;
+
+    // A committed matrix is stored with the rest of the sound.
+    //
+    preset_bank_factory(&bank);
+    instrument_set_preset(&g_piano, &bank.p_preset[0]);
+    p_patch->route[0] = (mod_route_t) {MOD_SRC_LFO1, MOD_DST_PITCH,
+                                       g_piano.part, 0, 1.0f};
+    p_patch->env.attack_ms = 20.0f;
+    TEST_ASSERT_EQUAL_UINT8(1, synth_mod_commit(gp_engine));
+    synth_get_preset(gp_engine, &preset);
+    TEST_ASSERT_EQUAL_UINT8(MOD_SRC_LFO1, preset.mod.route[0].src);
+    TEST_ASSERT_EQUAL_UINT8(g_piano.part, preset.mod.route[0].part);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, preset.mod.route[0].depth);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 20.0f, preset.mod.env.attack_ms);
+
+    // Another preset takes it out, from the edit copy to the voices.
+    //
+    instrument_set_preset(&g_piano, &bank.p_preset[1]);
+    TEST_ASSERT_EQUAL_UINT8(MOD_SRC_OFF, p_patch->route[0].src);
+    instrument_key(&g_piano, 0, 1);
+
+    for (uint32_t block = 0; block < 50; ++block)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+        p_voice = find_voice(g_piano.part, INSTR_BASE_NOTE);
+        TEST_ASSERT_NOT_NULL(p_voice);
+        TEST_ASSERT_EQUAL_UINT32(base, p_voice->osc.phase_inc);
+    }
+
+    // Recalling the stored preset brings the vibrato back.
+    //
+    instrument_set_preset(&g_piano, &preset);
+    TEST_ASSERT_EQUAL_UINT8(MOD_SRC_LFO1, p_patch->route[0].src);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 20.0f, p_patch->env.attack_ms);
+
+    for (uint32_t block = 0; block < 200; ++block)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+        hi = (p_voice->osc.phase_inc > hi) ? p_voice->osc.phase_inc : hi;
+    }
+
+    TEST_ASSERT_UINT32_WITHIN(base / 1000U, (uint32_t) (base * 1.05946f),
+                              hi);
+
+    // A matrix the engine cannot run comes back with every slot off.
+    //
+    preset.mod.route[0].part = MOD_NUM_PART;
+    instrument_set_preset(&g_piano, &preset);
+    TEST_ASSERT_EQUAL_UINT8(MOD_SRC_OFF, p_patch->route[0].src);
+    synth_get_preset(gp_engine, &preset);
+    TEST_ASSERT_EQUAL_UINT8(MOD_SRC_OFF, preset.mod.route[0].src);
+
+    instrument_set_preset(&g_piano, &bank.p_preset[0]);
+    instrument_key(&g_piano, 0, 0);
+
+    for (uint32_t block = 0; p_voice->active && (block < 100); ++block)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    }
+
+    TEST_ASSERT_FALSE(p_voice->active);
+}   /* test_preset_mod() */
+
+static void
+bench_bank_open (void * p_ctx, uint32_t iters)
+{
+    const preset_bank_header_t * p_hdr = (const preset_bank_header_t *) p_ctx;
+    size_t size = sizeof(*p_hdr) + p_hdr->count * sizeof(preset_t);
+    preset_bank_t bank;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        TEST_ASSERT_EQUAL_UINT8(1, preset_bank_open(&bank, p_hdr, size));
+    }
+}   /* bench_bank_open() */
+
+// A one-zone set of `frames` frames whose sample `n` is n % 32749, so
+// any frame played can be checked against where it came from.
+//
+static uint8_t *
+make_set (uint32_t frames, uint32_t sample_rate, size_t * p_size)
+{
+    size_t offset = sizeof(sampler_set_header_t) + sizeof(sampler_zone_t);
+    uint8_t * p_image = (uint8_t *) malloc(offset + frames * sizeof(int16_t));
+    sampler_set_header_t hdr = {SAMPLER_MAGIC, SAMPLER_VERSION, 1,
+                                sample_rate, (uint32_t) offset};
+    sampler_zone_t zone = {0, 127, TEST_SET_ROOT, 0, 0, frames};
+    int16_t * p_pcm = (int16_t *) (p_image + offset);
+
+    memcpy(p_image, &hdr, sizeof(hdr));
+    memcpy(p_image + sizeof(hdr), &zone, sizeof(zone));
+
+    for (uint32_t idx = 0; idx < frames; ++idx)
+    {
+        p_pcm[idx] = (int16_t) (idx % 32749U);
+    }
+
+    *p_size = offset + frames * sizeof(int16_t);
+
+    return (p_image);
+}   /* make_set() */
+
+static void
+test_sampler_stream (void)
+{
+    size_t size = 0;
+    uint8_t * p_image = make_set(TEST_SET_FRAMES, 48000, &size);
+    size_t arena_size = (SAMPLER_ATTACK_FRAMES
+                         + SAMPLER_NUM_STREAM * SAMPLER_RING_FRAMES)
+                        * sizeof(int16_t) + 256U;
+    void * p_mem = malloc(arena_size);
+    void * p_obj = malloc(sizeof(sampler_t));
+    sampler_voice_t voice = {};
+    sampler_set_t set;
+    sampler_stats_t stats;
+    mem_arena_t arena;
+    float out[SYNTH_BLOCK_SIZE];
+    uint32_t frame = 0;
+
+    TEST_ASSERT_EQUAL_UINT8(0, sampler_set_open(&set, p_image, size - 2));
+    TEST_ASSERT_EQUAL_UINT8(1, sampler_set_open(&set, p_image, size));
+
+    mem_arena_init(&arena, p_mem, (uint32_t) arena_size);
+    sampler_t * p_sampler = sampler_create(p_obj, &arena, &set, 48000);
+
+    TEST_ASSERT_NOT_NULL(p_sampler);
+
+    // At the root and the same rate every frame is played as stored:
+    // first from the preloaded attack, then from the ring.
+    //
+    TEST_ASSERT_EQUAL_UINT8(1, sampler_voice_start(p_sampler, &voice,
+                                                   TEST_SET_ROOT));
+
+    while (frame < SAMPLER_ATTACK_FRAMES + SAMPLER_RING_FRAMES)
+    {
+        sampler_prefetch(p_sampler);
+        TEST_ASSERT_EQUAL_UINT8(1, sampler_voice_render(p_sampler, &voice,
+                                                        out, SYNTH_BLOCK_SIZE));
+
+        for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx, ++frame)
+        {
+            TEST_ASSERT_EQUAL_FLOAT((float) (frame % 32749U) / 32768.0f,
+                                    out[idx]);
+        }
+    }
+
+    // Fed synchronously before every block, so no underrun is possible.
+    //
+    sampler_get_stats(p_sampler, &stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.underruns);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.active);
+
+    // A starved stream plays silence, counts it, and resumes where it
+    // stopped once fed.
+    //
+    for (uint32_t block = 0; block <= SAMPLER_RING_FRAMES / SYNTH_BLOCK_SIZE;
+         ++block)
+    {
+        sampler_voice_render(p_sampler, &voice, out, SYNTH_BLOCK_SIZE);
+    }
+
+    sampler_get_stats(p_sampler, &stats);
+    TEST_ASSERT_TRUE(stats.underruns > 0);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, out[SYNTH_BLOCK_SIZE - 1]);
+
+    frame = (uint32_t) (voice.pos >> 32);
+    sampler_prefetch(p_sampler);
+    sampler_voice_render(p_sampler, &voice, out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_FLOAT((float) (frame % 32749U) / 32768.0f, out[0]);
+
+    // An octave up reads two frames per output frame.
+    //
+    TEST_ASSERT_EQUAL_UINT8(1, sampler_voice_start(p_sampler, &voice,
+                                                   TEST_SET_ROOT + 12));
+    sampler_prefetch(p_sampler);
+    sampler_voice_render(p_sampler, &voice, out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f / 32768.0f, out[1]);
+
+    sampler_voice_stop(p_sampler, &voice);
+    sampler_get_stats(p_sampler, &stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.active);
+
+    free(p_obj);
+    free(p_mem);
+    free(p_image);
+
+    // On the engine, a part set to the sample set streams its notes.
+    //
+    TEST_ASSERT_NOT_NULL(gp_engine->p_sampler);
+    instrument_set_waveform(&g_piano, SYNTH_WAVE_SAMPLE);
+    instrument_key(&g_piano, 4, 1);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+
+    const synth_voice_t * p_voice = find_voice(g_piano.part,
+                                               INSTR_BASE_NOTE + 4);
+
+    TEST_ASSERT_NOT_NULL(p_voice);
+    TEST_ASSERT_TRUE(0 != p_voice->sample.stream);
+
+    instrument_key(&g_piano, 4, 0);
+    instrument_set_waveform(&g_piano, OSC_SINE);
+
+    for (uint32_t block = 0; p_voice->active && (block < 100); ++block)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    }
+
+    sampler_get_stats(gp_engine->p_sampler, &stats);
+    TEST_ASSERT_FALSE(p_voice->active);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.active);
+}   /* test_sampler_stream() */
+
+static void
+test_fm_voice (void)
+{
+    static float lanes[FM_LANES][SYNTH_BLOCK_SIZE];
+    static float single[SYNTH_BLOCK_SIZE];
+    fm_voice_t voice[FM_LANES];
+    fm_voice_t alone[FM_LANES];
+    fm_voice_t * pp_voice[FM_LANES];
+    float * pp_out[FM_LANES];
+    uint32_t inc = gp_engine->p_tables->note_inc[INSTR_BASE_NOTE];
+    uint32_t alive = 0;
+    uint32_t block = 0;
+    float peak = 0.0f;
+
+    for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+    {
+        fm_voice_start(&voice[lane], (fm_patch_id_t) (lane % FM_NUM_PATCH),
+                       inc + lane * 1000U, SYNTH_SAMPLE_RATE);
+        alone[lane] = voice[lane];
+        pp_voice[lane] = &voice[lane];
+        pp_out[lane] = lanes[lane];
+    }
+
+    // A voice renders the same whichever lane it runs in and whoever it
+    // shares the call with.
+    //
+    for (block = 0; block < 8; ++block)
+    {
+        TEST_ASSERT_EQUAL_UINT32((1U << FM_LANES) - 1U,
+                                 fm_render(pp_voice, FM_LANES, pp_out,
+                                           SYNTH_BLOCK_SIZE));
+
+        for (uint32_t lane = 0; lane < FM_LANES; ++lane)
+        {
+            fm_voice_t * p_alone = &alone[lane];
+            float * p_single = single;
+
+            TEST_ASSERT_EQUAL_UINT32(1, fm_render(&p_alone, 1, &p_single,
+                                                  SYNTH_BLOCK_SIZE));
+
+            for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx)
+            {
+                TEST_ASSERT_FLOAT_WITHIN(1e-6f, single[idx], lanes[lane][idx]);
+                peak = (fabsf(single[idx]) > peak) ? fabsf(single[idx]) : peak;
+            }
+        }
+    }
+
+    TEST_ASSERT_TRUE(peak > 0.1f);
+    TEST_ASSERT_TRUE(peak <= 1.0f);
+
+    // Released, the bass dies away on its operator envelopes.
+    //
+    fm_voice_release(&voice[FM_BASS]);
+    alive = 1;
+
+    for (block = 0; (0 != alive) && (block < 1000); ++block)
+    {
+        alive = fm_render(&pp_voice[FM_BASS], 1, &pp_out[0],
+                          SYNTH_BLOCK_SIZE);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, alive);
+    TEST_ASSERT_TRUE(block > 10);
+
+    // On the engine, an FM part holds its voice until the patch is done.
+    //
+    instrument_set_waveform(&g_piano, SYNTH_WAVE_FM + FM_BASS);
+    instrument_key(&g_piano, 2, 1);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+
+    const synth_voice_t * p_voice = find_voice(g_piano.part,
+                                               INSTR_BASE_NOTE + 2);
+
+    TEST_ASSERT_NOT_NULL(p_voice);
+    TEST_ASSERT_EQUAL_UINT8(1 + FM_BASS, p_voice->fm.patch);
+
+    instrument_key(&g_piano, 2, 0);
+
+    for (block = 0; p_voice->active && (block < 1000); ++block)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    }
+
+    TEST_ASSERT_FALSE(p_voice->active);
+    TEST_ASSERT_TRUE(block > 10);
+    instrument_set_waveform(&g_piano, OSC_SINE);
+}   /* test_fm_voice() */
+
+static void
+test_unison (void)
+{
+    static float mid[SYNTH_BLOCK_SIZE];
+    static float side[SYNTH_BLOCK_SIZE];
+    static float ref[SYNTH_BLOCK_SIZE];
+    uint32_t inc = gp_engine->p_tables->note_inc[INSTR_BASE_NOTE];
+    osc_t osc = {0, inc, (uint8_t) OSC_SAW, (uint8_t) OSC_MODE_BLEP};
+    unison_t unison;
+    float energy = 0.0f;
+    uint8_t b_stereo = 0;
+
+    // A stack of one is the plain oscillator, also across blocks that are
+    // not a whole number of vectors.
+    //
+    unison_start(&unison, inc, 1, UNISON_DETUNE, 1);
+
+    for (uint32_t frames = SYNTH_BLOCK_SIZE - 3; frames <= SYNTH_BLOCK_SIZE;
+         frames += 3)
+    {
+        memset(mid, 0, sizeof(mid));
+        memset(side, 0, sizeof(side));
+        unison_render(&unison, OSC_SAW, 1.0f, mid, side, frames);
+        osc_render(&osc, ref, frames);
+
+        for (uint32_t idx = 0; idx < frames; ++idx)
+        {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, ref[idx], mid[idx]);
+            TEST_ASSERT_EQUAL_FLOAT(0.0f, side[idx]);
+        }
+    }
+
+    // Eight copies: detuned either side of the note, stereo only when
+    // spread, about as loud as one.
+    //
+    unison_start(&unison, inc, 8, UNISON_DETUNE, 1);
+    TEST_ASSERT_TRUE(unison.inc[0] < inc);
+    TEST_ASSERT_TRUE(unison.inc[7] > inc);
+    memset(mid, 0, sizeof(mid));
+    memset(side, 0, sizeof(side));
+    unison_render(&unison, OSC_SAW, 0.0f, mid, side, SYNTH_BLOCK_SIZE);
+
+    for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx)
+    {
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, side[idx]);
+        TEST_ASSERT_TRUE(fabsf(mid[idx]) < 3.0f);
+        energy += mid[idx] * mid[idx];
+    }
+
+    TEST_ASSERT_TRUE(energy > 0.05f * SYNTH_BLOCK_SIZE);
+
+    memset(side, 0, sizeof(side));
+    unison_render(&unison, OSC_SAW, 1.0f, mid, side, SYNTH_BLOCK_SIZE);
+    energy = 0.0f;
+
+    for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx)
+    {
+        energy += side[idx] * side[idx];
+    }
+
+    TEST_ASSERT_TRUE(energy > 0.01f * SYNTH_BLOCK_SIZE);
+
+    // On the engine the stack is one voice, and left and right differ.
+    //
+    instrument_set_waveform(&g_piano, OSC_SAW);
+    instrument_set_unison(&g_piano, 8, UNISON_DETUNE, 1.0f);
+    instrument_key(&g_piano, 1, 1);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+
+    const synth_voice_t * p_voice = find_voice(g_piano.part,
+                                               INSTR_BASE_NOTE + 1);
+
+    TEST_ASSERT_NOT_NULL(p_voice);
+    TEST_ASSERT_EQUAL_UINT8(8, p_voice->unison.count);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+
+    for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx)
+    {
+        b_stereo |= (g_out[2 * idx] != g_out[2 * idx + 1]);
+    }
+
+    TEST_ASSERT_TRUE(b_stereo);
+
+    instrument_key(&g_piano, 1, 0);
+    instrument_set_unison(&g_piano, 1, UNISON_DETUNE, UNISON_SPREAD);
+    instrument_set_waveform(&g_piano, OSC_SINE);
+
+    for (uint32_t block = 0; p_voice->active && (block < 100); ++block)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    }
+
+    TEST_ASSERT_FALSE(p_voice->active);
+}   /* test_unison() */
+
+static void
+test_mod_matrix (void)
+{
+    mod_patch_t * p_patch = synth_mod_edit(gp_engine);
+    mod_route_t * p_route = p_patch->route;
+    const uint32_t base = gp_engine->p_tables->note_inc[INSTR_BASE_NOTE + 3];
+    const int32_t pad_note = instrument_part_note(&g_pad, INSTR_BASE_NOTE + 3);
+    uint32_t lo = base;
+    uint32_t hi = base;
+    float left = 0.0f;
+    float right = 0.0f;
+
+    // Refused: a per-voice source on the engine filter, a part the
+    // engine does not have. Nothing is published.
+    //
+    p_route[0] = (mod_route_t) {MOD_SRC_ENV, MOD_DST_CUTOFF, MOD_ALL_PARTS,
+                                0, 1.0f};
+    TEST_ASSERT_EQUAL_UINT8(0, synth_mod_commit(gp_engine));
+    p_route[0] = (mod_route_t) {MOD_SRC_LFO1, MOD_DST_PITCH, MOD_NUM_PART,
+                                0, 1.0f};
+    TEST_ASSERT_EQUAL_UINT8(0, synth_mod_commit(gp_engine));
+
+    // Vibrato on the piano only: a semitone either way at 5 Hz, sampled
+    // once a block. The pad's voice on the same key stays on the note.
+    //
+    p_route[0].part = g_piano.part;
+    p_patch->lfo[0].hz = 5.0f;
+    TEST_ASSERT_EQUAL_UINT8(1, synth_mod_commit(gp_engine));
+    instrument_key(&g_piano, 3, 1);
+
+    for (uint32_t block = 0; block < 200; ++block)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+
+        const synth_voice_t * p_voice = find_voice(g_piano.part,
+                                                   INSTR_BASE_NOTE + 3);
+
+        TEST_ASSERT_NOT_NULL(p_voice);
+        lo = (p_voice->osc.phase_inc < lo) ? p_voice->osc.phase_inc : lo;
+        hi = (p_voice->osc.phase_inc > hi) ? p_voice->osc.phase_inc : hi;
+        p_voice = find_voice(g_pad.part, (uint8_t) pad_note);
+        TEST_ASSERT_NOT_NULL(p_voice);
+        TEST_ASSERT_EQUAL_UINT32(gp_engine->p_tables->note_inc[pad_note],
+                                 p_voice->osc.phase_inc);
+    }
+
+    TEST_ASSERT_UINT32_WITHIN(base / 1000U, (uint32_t) (base * 1.05946f),
+                              hi);
+    TEST_ASSERT_UINT32_WITHIN(base / 1000U, (uint32_t) (base / 1.05946f),
+                              lo);
+    TEST_ASSERT_EQUAL_UINT32(SYNTH_BLOCK_SIZE,
+                             mod_begin(&gp_engine->mod, SYNTH_BLOCK_SIZE));
+
+    // An audio-rate LFO cuts the blocks: 16 updates per cycle.
+    //
+    p_patch->lfo[0].hz = 500.0f;
+    TEST_ASSERT_EQUAL_UINT8(1, synth_mod_commit(gp_engine));
+    TEST_ASSERT_EQUAL_UINT32(4, mod_begin(&gp_engine->mod, SYNTH_BLOCK_SIZE));
+
+    // A controller pans everything hard right, and velocity takes the
+    // piano down: both slide there within a block.
+    //
+    p_route[0] = (mod_route_t) {MOD_SRC_CC, MOD_DST_PAN, MOD_ALL_PARTS, 10,
+                                1.0f};
+    p_route[1] = (mod_route_t) {MOD_SRC_VELOCITY, MOD_DST_VOLUME,
+                                g_piano.part, 0, -0.5f};
+    TEST_ASSERT_EQUAL_UINT8(1, synth_mod_commit(gp_engine));
+    TEST_ASSERT_EQUAL_UINT8(1, synth_set_cc(gp_engine, 10, 127));
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+
+    const synth_voice_t * p_piano = find_voice(g_piano.part,
+                                               INSTR_BASE_NOTE + 3);
+
+    TEST_ASSERT_EQUAL_UINT32(base, p_piano->osc.phase_inc);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, p_piano->mod.pan);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f - 0.5f * p_piano->velocity,
+                             p_piano->mod.gain);
+
+    for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx)
+    {
+        left += fabsf((float) g_out[2 * idx]);
+        right += fabsf((float) g_out[2 * idx + 1]);
+    }
+
+    TEST_ASSERT_TRUE(right > 4.0f * left);
+
+    // An empty matrix puts every voice back and costs nothing after.
+    //
+    for (uint32_t idx = 0; idx < MOD_NUM_ROUTE; ++idx)
+    {
+        p_route[idx].src = MOD_SRC_OFF;
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(1, synth_mod_commit(gp_engine));
+    synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, p_piano->mod.pan);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, p_piano->mod.gain);
+
+    float cutoff = 1.0f;
+
+    TEST_ASSERT_EQUAL_UINT32(0, mod_run(&gp_engine->mod, SYNTH_BLOCK_SIZE,
+                                        &cutoff));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, cutoff);
+
+    instrument_key(&g_piano, 3, 0);
+
+    for (uint32_t block = 0; p_piano->active && (block < 100); ++block)
+    {
+        synth_render(gp_engine, g_out, SYNTH_BLOCK_SIZE);
+    }
+
+    TEST_ASSERT_FALSE(p_piano->active);
+}   /* test_mod_matrix() */
+
+// Runs `blocks` blocks through the rack, an impulse at frame 0, and
+// returns the left output at frame `frame`.
+//
+static float
+fx_impulse (fx_rack_t * p_rack, uint32_t blocks, uint32_t frame)
+{
+    static float left[SYNTH_BLOCK_SIZE];
+    static float right[SYNTH_BLOCK_SIZE];
+    float value = 0.0f;
+
+    for (uint32_t block = 0; block < blocks; ++block)
+    {
+        memset(left, 0, sizeof(left));
+        memset(right, 0, sizeof(right));
+        left[0] = (0 == block) ? 1.0f : 0.0f;
+        right[0] = left[0];
+        fx_process(p_rack, left, right, SYNTH_BLOCK_SIZE);
+
+        if (frame / SYNTH_BLOCK_SIZE == block)
+        {
+            value = left[frame % SYNTH_BLOCK_SIZE];
+        }
+    }
+
+    return (value);
+}   /* fx_impulse() */
+
+static void
+test_fx (void)
+{
+    static fx_rack_t rack;
+    static float left[SYNTH_BLOCK_SIZE];
+    static float right[SYNTH_BLOCK_SIZE];
+    const uint32_t arena_size = FX_ARENA_SIZE(SYNTH_SAMPLE_RATE);
+    const uint32_t echo = 10 * SYNTH_SAMPLE_RATE / 1000;
+    const uint32_t blocks = echo / SYNTH_BLOCK_SIZE + 2;
+    void * p_mem = malloc(arena_size);
+    mem_arena_t arena;
+    float in = 0.0f;
+    float out = 0.0f;
+
+    TEST_ASSERT_NOT_NULL(p_mem);
+    mem_arena_init(&arena, p_mem, arena_size);
+    TEST_ASSERT_EQUAL_UINT8(1, fx_init(&rack, &arena, SYNTH_SAMPLE_RATE));
+    TEST_ASSERT_EQUAL_UINT8(0, rack.num_active);
+
+    // Only enabled stages are listed, in rack order, and only they run.
+    //
+    fx_enable(&rack, FX_DELAY, 1);
+    fx_enable(&rack, FX_FILTER, 1);
+    TEST_ASSERT_EQUAL_UINT8(2, rack.num_active);
+    TEST_ASSERT_EQUAL_UINT8(FX_FILTER, rack.active[0]);
+    TEST_ASSERT_EQUAL_UINT8(FX_DELAY, rack.active[1]);
+
+    fx_enable(&rack, FX_FILTER, 0);
+    TEST_ASSERT_EQUAL_UINT8(1, rack.num_active);
+    TEST_ASSERT_EQUAL_UINT8(FX_DELAY, rack.active[0]);
+    fx_process(&rack, left, right, SYNTH_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(0, fx_get_cost(&rack, FX_FILTER)->count);
+    TEST_ASSERT_EQUAL_UINT32(1, fx_get_cost(&rack, FX_DELAY)->count);
+
+    // A delay line repeats an impulse after its time, at its mix; bypassed
+    // it passes the impulse alone.
+    //
+    fx_set_param(&rack, FX_DELAY, FX_PARAM_TIME, 10.0f);
+    fx_set_param(&rack, FX_DELAY, FX_PARAM_FEEDBACK, 0.0f);
+    fx_set_param(&rack, FX_DELAY, FX_PARAM_MIX, 0.5f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, fx_impulse(&rack, blocks, echo));
+
+    fx_enable(&rack, FX_DELAY, 0);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, fx_impulse(&rack, blocks, echo));
+
+    // A low cutoff takes a tone at Nyquist out.
+    //
+    fx_enable(&rack, FX_FILTER, 1);
+    fx_set_param(&rack, FX_FILTER, FX_PARAM_CUTOFF, 200.0f);
+    fx_set_param(&rack, FX_FILTER, FX_PARAM_RESONANCE, 0.0f);
+
+    for (uint32_t block = 0; block < 4; ++block)
+    {
+        in = 0.0f;
+        out = 0.0f;
+
+        for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx)
+        {
+            left[idx] = (idx & 1U) ? -0.5f : 0.5f;
+            right[idx] = left[idx];
+            in += fabsf(left[idx]);
+        }
+
+        fx_process(&rack, left, right, SYNTH_BLOCK_SIZE);
+
+        for (uint32_t idx = 0; idx < SYNTH_BLOCK_SIZE; ++idx)
+        {
+            out += fabsf(left[idx]);
+        }
+    }
+
+    TEST_ASSERT_TRUE(out < 0.05f * in);
+
+    free(p_mem);
+}   /* test_fx() */
+
+static void
+bench_part_note (void * p_ctx, uint32_t iters)
+{
+    const instrument_t * p_part = (const instrument_t *) p_ctx;
+    volatile int32_t sink = 0;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        sink = sink + instrument_part_note(p_part, (uint8_t) (idx & 127U));
+    }
+}   /* bench_part_note() */
+
+static void
+bench_key (void * p_ctx, uint32_t iters)
+{
+    // Press and release, then one frame so the engine drains its queue
+    // and starts / releases the voices.
+    //
+    int16_t frame[2];
+
+    (void) p_ctx;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        uint8_t key = (uint8_t) (idx % INSTR_NUM_KEY);
+
+        instrument_key(&g_piano, key, 1);
+        instrument_key(&g_piano, key, 0);
+        synth_render(gp_engine, frame, 1);
+    }
+}   /* bench_key() */
+
+static void
+test_bench (void)
+{
+    perf_bench_t part;
+    perf_bench_t key;
+
+    instrument_set_zone(&g_pad, 0, 127, -12);
+    perf_bench_run("instrument_part_note", bench_part_note, &g_pad, 21,
+                   &part);
+    perf_bench_run("instrument_key + 1 frame", bench_key, NULL, 21, &key);
+
+    TEST_ASSERT_TRUE(part.median_ns > 0.0f);
+    TEST_ASSERT_TRUE(key.median_ns > part.median_ns);
+}   /* test_bench() */
+
+static void
+test_bench_bank (void)
+{
+    preset_bank_header_t * p_hdr = make_bank(TEST_BANK_PRESETS);
+    perf_bench_t open;
+
+    // Loading is the header check and one pass of the checksum: a bank of
+    // hundreds of presets should stay well inside a millisecond. Reported,
+    // not gated: every open in the run has to succeed.
+    //
+    perf_bench_run("preset_bank_open 512", bench_bank_open, p_hdr, 21,
+                   &open);
+    free(p_hdr);
+}   /* test_bench_bank() */
+
+static void
+test_bench_sampler (void)
+{
+    size_t size = 0;
+    uint8_t * p_image = make_set(SYNTH_SAMPLE_RATE * 4U, SYNTH_SAMPLE_RATE,
+                                 &size);
+    sampler_set_t set;
+    sampler_bench_t result;
+
+    TEST_ASSERT_EQUAL_UINT8(1, sampler_set_open(&set, p_image, size));
+    TEST_ASSERT_EQUAL_UINT8(1, sampler_bench(&set, 200, &result));
+    printf("bench sampler: %.0f ns/voice/block, %.0f MB/s streamed, "
+           "max %u voices, %u underruns with %u streams\n",
+           result.render_ns, result.stream_mb_s, (unsigned) result.max_voice,
+           (unsigned) result.underruns, (unsigned) SAMPLER_NUM_STREAM);
+    free(p_image);
+
+    // The voice count and the underruns of the real-time run depend on the
+    // host and its scheduler: reported above, not gated on. Streaming
+    // itself is checked frame by frame in test_sampler_stream().
+    //
+    TEST_ASSERT_TRUE(result.stream_mb_s > 0.0f);
+}   /* test_bench_sampler() */
+
+static void
+test_bench_fm (void)
+{
+    fm_bench_t result;
+    fm_bench_t again;
+
+    fm_bench(INSTR_BASE_NOTE, SYNTH_SAMPLE_RATE, &result);
+    printf("bench fm: %u ns/voice/block (%.0f voices/core), oscillator "
+           "%u ns (%.0f voices/core), checksum %08x\n",
+           (unsigned) result.fm_ns, result.fm_voices,
+           (unsigned) result.osc_ns, result.osc_voices,
+           (unsigned) result.checksum);
+
+    // How many voices fit is the host's to report; the patches have to
+    // sound, and the same on every run.
+    //
+    fm_bench(INSTR_BASE_NOTE, SYNTH_SAMPLE_RATE, &again);
+    TEST_ASSERT_EQUAL_UINT32(result.checksum, again.checksum);
+    TEST_ASSERT_TRUE(result.peak > 0.1f);
+}   /* test_bench_fm() */
+
+static void
+test_bench_unison (void)
+{
+    unison_bench_t result;
+    unison_bench_t again;
+
+    unison_bench(8, INSTR_BASE_NOTE, SYNTH_SAMPLE_RATE, &result);
+    printf("bench unison x8: %u ns/block, as 8 voices %u ns (%.1fx), "
+           "checksum %08x\n", (unsigned) result.unison_ns,
+           (unsigned) result.voices_ns, result.speedup,
+           (unsigned) result.checksum);
+
+    // The speedup is the host's to report; the stack itself has to sound,
+    // and the same on every run.
+    //
+    unison_bench(8, INSTR_BASE_NOTE, SYNTH_SAMPLE_RATE, &again);
+    TEST_ASSERT_EQUAL_UINT32(result.checksum, again.checksum);
+    TEST_ASSERT_TRUE(result.peak > 0.1f);
+}   /* test_bench_unison() */
+
+static void
+test_bench_mod (void)
+{
+    mod_bench_t result;
+
+    // Every slot routed over a full voice pool: the same work every
+    // block, the fastest routing deciding how often it runs.
+    //
+    mod_bench(SYNTH_NUM_VOICE, SYNTH_SAMPLE_RATE, SYNTH_BLOCK_SIZE, &result);
+    printf("bench mod matrix, %u voices: empty %.0f ns/block, full %.0f "
+           "ns/block (sd %.1f %%), updated every %u frames\n",
+           (unsigned) SYNTH_NUM_VOICE, result.idle_ns, result.full_ns,
+           result.spread_pct, (unsigned) result.step);
+
+    TEST_ASSERT_TRUE(result.idle_ns < result.full_ns);
+    TEST_ASSERT_TRUE(result.step >= 1);
+}   /* test_bench_mod() */
+
+static void
+test_bench_seq (void)
+{
+    static const uint16_t bpm[] = {60, 97, 128, 174};
+    static const uint8_t swing[] = {50, 58, 66, 75};
+
+    // Every bpm and swing in random callback sizes while another thread
+    // keeps committing edits: onsets land on the ideal grid, to the sample.
+    //
+    for (uint32_t idx = 0; idx < sizeof(bpm) / sizeof(bpm[0]); ++idx)
+    {
+        seq_bench_t result;
+
+        TEST_ASSERT_EQUAL_UINT8(1, seq_bench(bpm[idx], swing[idx], 20,
+                                             &result));
+        printf("bench seq %u bpm, swing %u %%: %u notes, max error %u "
+               "samples (%u by callback), %u commits\n",
+               (unsigned) bpm[idx], (unsigned) swing[idx],
+               (unsigned) result.num_note, (unsigned) result.max_err,
+               (unsigned) result.max_block_err, (unsigned) result.num_commit);
+
+        TEST_ASSERT_TRUE(result.num_note > 0);
+        TEST_ASSERT_EQUAL_UINT32(0, result.max_err);
+    }
+}   /* test_bench_seq() */
+
+static void
+test_bench_synth (void)
+{
+    uint32_t num_core = std::thread::hardware_concurrency();
+    uint32_t checksum = 0;
+
+    num_core = (num_core < 1) ? 1
+             : ((num_core > WSCHED_MAX_WORKER) ? WSCHED_MAX_WORKER : num_core);
+
+    // The timings are the host's to report; the mix has to come out the
+    // same whichever threads rendered it.
+    //
+    for (uint32_t num_thread = 1; num_thread <= num_core; ++num_thread)
+    {
+        synth_bench_t result;
+
+        TEST_ASSERT_EQUAL_UINT8(1, synth_bench(SYNTH_NUM_VOICE, num_thread,
+                                               1000, &result));
+        printf("bench synth %u voices, %u threads: mean %.1f us, worst "
+               "%.1f us, %.1f %% over the deadline, checksum %08x\n",
+               (unsigned) SYNTH_NUM_VOICE, (unsigned) num_thread,
+               result.mean_us, result.worst_us, result.miss_pct,
+               (unsigned) result.checksum);
+
+        if (1 == num_thread)
+        {
+            printf("bench synth fx per block: filter %.1f us, chorus %.1f "
+                   "us, delay %.1f us, reverb %.1f us\n",
+                   result.fx_us[FX_FILTER], result.fx_us[FX_CHORUS],
+                   result.fx_us[FX_DELAY], result.fx_us[FX_REVERB]);
+        }
+
+        checksum = (1 == num_thread) ? result.checksum : checksum;
+        TEST_ASSERT_EQUAL_UINT32(checksum, result.checksum);
+    }
+}   /* test_bench_synth() */
+
+static void
+test_bench_osc (void)
+{
+    static const osc_wave_t wave[] = {OSC_SAW, OSC_SQUARE};
+    static const osc_mode_t mode[] = {OSC_MODE_TABLE, OSC_MODE_BLEP};
+    static const char * const p_mode_name[] = {"table", "BLEP"};
+
+    // Both band-limiting schemes at 880 Hz, where a plain saw would fold
+    // back most of its harmonics. PolyBLEP leaves the most aliasing, so
+    // it sets the bound.
+    //
+    for (uint32_t w = 0; w < sizeof(wave) / sizeof(wave[0]); ++w)
+    {
+        for (uint32_t m = 0; m < sizeof(mode) / sizeof(mode[0]); ++m)
+        {
+            osc_bench_t result;
+
+            osc_bench(wave[w], mode[m], 81, SYNTH_SAMPLE_RATE, &result);
+            printf("bench osc %s %s, note 81: %u ns/block, alias %.1f dB\n",
+                   (OSC_SAW == wave[w]) ? "saw" : "square", p_mode_name[m],
+                   (unsigned) result.ns_per_block, result.alias_db);
+
+            TEST_ASSERT_TRUE(result.alias_db < -30.0f);
+        }
+    }
+}   /* test_bench_osc() */
+
+int
+main (void)
+{
+    // The engine maps (and first writes) samples.bin and the bank test its
+    // own file in the working directory: run in a scratch directory that
+    // goes away afterwards.
+    //
+    std::error_code err;
+    std::filesystem::path home = std::filesystem::current_path();
+    std::filesystem::path scratch = std::filesystem::temp_directory_path(err)
+                                    / ("test_instrument."
+                                       + std::to_string((unsigned long)
+                                                        time(NULL)));
+    int result = 0;
+
+    std::filesystem::create_directories(scratch, err);
+    std::filesystem::current_path(scratch, err);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_note_frequency);
+    RUN_TEST(test_part_note);
+    RUN_TEST(test_key_to_voice);
+    RUN_TEST(test_seq_layers);
+    RUN_TEST(test_preset_bank);
+    RUN_TEST(test_preset_switch);
+    RUN_TEST(test_preset_mod);
+    RUN_TEST(test_sampler_stream);
+    RUN_TEST(test_fm_voice);
+    RUN_TEST(test_unison);
+    RUN_TEST(test_mod_matrix);
+    RUN_TEST(test_fx);
+    RUN_TEST(test_bench);
+    RUN_TEST(test_bench_bank);
+    RUN_TEST(test_bench_sampler);
+    RUN_TEST(test_bench_fm);
+    RUN_TEST(test_bench_unison);
+    RUN_TEST(test_bench_mod);
+    RUN_TEST(test_bench_seq);
+    RUN_TEST(test_bench_synth);
+    RUN_TEST(test_bench_osc);
+    result = UNITY_END();
+
+    std::filesystem::current_path(home, err);
+    std::filesystem::remove_all(scratch, err);
+
+    return (result);
+}   /* main() */
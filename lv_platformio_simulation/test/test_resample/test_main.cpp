@@ -0,0 +1,193 @@
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include "resample.h"
+
+#define TEST_PI         (3.14159265358979)
+
+static resample_t g_rs;
+
+void
+setUp (void)
+{
+}   /* setUp() */
+
+void
+tearDown (void)
+{
+}   /* tearDown() */
+
+static void
+test_rate (void)
+{
+    // 48000 to 44100: 441 out for every 480 in, whatever the chunking.
+    //
+    static float in[2 * 100];
+    static float out[2 * 200];
+    uint32_t made = 0;
+
+    TEST_ASSERT_EQUAL_UINT8(1, resample_init(&g_rs, 48000, 44100,
+                                             RESAMPLE_GOOD));
+
+    for (uint32_t idx = 0; idx < 480; ++idx)
+    {
+        TEST_ASSERT_EQUAL_UINT32(100, resample_write(&g_rs, in, 100));
+
+        for (uint32_t got = 1; got > 0; made += got)
+        {
+            got = resample_read(&g_rs, out, 1 + (idx % 200));
+        }
+    }
+
+    TEST_ASSERT_UINT32_WITHIN(1, 44100, made);
+
+    // Out of range or of tiers.
+    //
+    TEST_ASSERT_EQUAL_UINT8(0, resample_init(&g_rs, 0, 44100, RESAMPLE_FAST));
+    TEST_ASSERT_EQUAL_UINT8(0, resample_init(&g_rs, 96000, 8000,
+                                             RESAMPLE_FAST));
+    TEST_ASSERT_EQUAL_UINT8(0, resample_init(&g_rs, 48000, 44100,
+                                             RESAMPLE_NUM_QUALITY));
+}   /* test_rate() */
+
+static void
+test_dc_and_delay (void)
+{
+    // Unity gain at DC, and a step shows up taps / 2 input frames late:
+    // the output crosses half of it there.
+    //
+    static float in[2 * RESAMPLE_CHUNK];
+    static float out[2 * 4096];
+    uint32_t made = 0;
+
+    for (uint32_t idx = 0; idx < 2 * RESAMPLE_CHUNK; ++idx)
+    {
+        in[idx] = 0.5f;
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(1, resample_init(&g_rs, 48000, 48000,
+                                             RESAMPLE_BEST));
+
+    for (uint32_t chunk = 0; chunk < 32; ++chunk)
+    {
+        resample_write(&g_rs, in, RESAMPLE_CHUNK);
+        made += resample_read(&g_rs, &out[2 * made], 4096 - made);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(32 * RESAMPLE_CHUNK, made);
+    TEST_ASSERT_TRUE(out[2 * (g_rs.taps / 2 - 1)] < 0.25f);
+    TEST_ASSERT_TRUE(out[2 * (g_rs.taps / 2)] > 0.25f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, out[2 * 1000]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, out[2 * 1000 + 1]);
+}   /* test_dc_and_delay() */
+
+static uint32_t g_src_frames;
+
+static void
+sine_src (void * p_user, int16_t * p_out, uint32_t frames)
+{
+    const double freq = *(const double *) p_user;
+
+    for (uint32_t idx = 0; idx < frames; ++idx, ++g_src_frames)
+    {
+        double s = 0.5 * sin(2.0 * TEST_PI * freq * g_src_frames / 48000.0);
+
+        p_out[2 * idx] = (int16_t) lrint(s * 32767.0);
+        p_out[2 * idx + 1] = (int16_t) -lrint(s * 32767.0);
+    }
+}   /* sine_src() */
+
+static void
+test_pull (void)
+{
+    // The device side: 1 kHz from a 48 kHz source comes out of a 44.1 kHz
+    // device as 1 kHz, the channels kept apart.
+    //
+    static int16_t out[2 * 8192];
+    double freq = 1000.0;
+    double corr = 0.0;
+    double power = 0.0;
+    const uint32_t skip = 256;
+
+    g_src_frames = 0;
+    TEST_ASSERT_EQUAL_UINT8(1, resample_init(&g_rs, 48000, 44100,
+                                             RESAMPLE_GOOD));
+
+    for (uint32_t done = 0; done < 8192; done += 441)
+    {
+        uint32_t frames = (8192 - done > 441) ? 441 : 8192 - done;
+
+        resample_pull(&g_rs, sine_src, &freq, &out[2 * done], frames);
+    }
+
+    TEST_ASSERT_UINT32_WITHIN(RESAMPLE_CHUNK + g_rs.taps,
+                              8192 * 48000 / 44100, g_src_frames);
+
+    for (uint32_t idx = skip; idx < 8192; ++idx)
+    {
+        double t = (idx - (g_rs.taps / 2) * 44100.0 / 48000.0) / 44100.0;
+        double ref = 0.5 * sin(2.0 * TEST_PI * freq * t) * 32767.0;
+
+        TEST_ASSERT_EQUAL_INT(-out[2 * idx], out[2 * idx + 1]);
+        corr += out[2 * idx] * ref;
+        power += ref * ref;
+    }
+
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1.0, corr / power);
+}   /* test_pull() */
+
+static void
+test_bench (void)
+{
+    static const char * const name[RESAMPLE_NUM_QUALITY] = {"fast", "good",
+                                                             "best"};
+    static const uint32_t rate[][2] = {{48000, 44100}, {48000, 96000},
+                                       {32000, 44100}};
+    // Worst aliasing allowed per tier, dB under the tone.
+    //
+    static const float alias_max[RESAMPLE_NUM_QUALITY] = {-50.0f, -75.0f,
+                                                          -90.0f};
+    resample_bench_t result[RESAMPLE_NUM_QUALITY];
+
+    for (uint32_t pair = 0; pair < sizeof(rate) / sizeof(rate[0]); ++pair)
+    {
+        for (uint32_t tier = 0; tier < RESAMPLE_NUM_QUALITY; ++tier)
+        {
+            resample_bench_t * p_result = &result[tier];
+
+            resample_bench(rate[pair][0], rate[pair][1],
+                           (resample_quality_t) tier, p_result);
+            printf("bench resample %u -> %u %s (%u taps, %u phases): "
+                   "pass %.0f Hz, ripple %.4f dB, alias %.1f dB, "
+                   "%.1f ns/frame, x%.0f real time\n",
+                   (unsigned) rate[pair][0], (unsigned) rate[pair][1],
+                   name[tier], (unsigned) p_result->taps,
+                   (unsigned) p_result->phases, p_result->pass_hz,
+                   p_result->ripple_db, p_result->alias_db,
+                   p_result->ns_per_frame, p_result->realtime);
+
+            TEST_ASSERT_TRUE(p_result->ripple_db < 0.1f);
+            TEST_ASSERT_TRUE(p_result->alias_db < alias_max[tier]);
+            TEST_ASSERT_TRUE(p_result->realtime > 1.0f);
+        }
+
+        // Better tiers: a wider passband, for more CPU.
+        //
+        TEST_ASSERT_TRUE(result[RESAMPLE_BEST].pass_hz
+                         > result[RESAMPLE_FAST].pass_hz);
+        TEST_ASSERT_TRUE(result[RESAMPLE_BEST].alias_db
+                         < result[RESAMPLE_FAST].alias_db);
+    }
+}   /* test_bench() */
+
+int
+main (void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rate);
+    RUN_TEST(test_dc_and_delay);
+    RUN_TEST(test_pull);
+    RUN_TEST(test_bench);
+
+    return (UNITY_END());
+}   /* main() */
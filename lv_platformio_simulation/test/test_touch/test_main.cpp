@@ -0,0 +1,188 @@
+#include <unity.h>
+#include <stdio.h>
+#include "touch_filter.h"
+#include "perf_bench.h"
+
+#define TEST_WIDTH      (240)
+#define TEST_HEIGHT     (320)
+#define TEST_DT         (0.002f)    /* 500 Hz controller FIFO */
+
+void
+setUp (void)
+{
+}   /* setUp() */
+
+void
+tearDown (void)
+{
+}   /* tearDown() */
+
+static void
+test_default_calib (void)
+{
+    // The default must keep the mapping the discovery board shipped with:
+    // x = (3870 - raw_x) / 15, y = (raw_y - 360) / 11.
+    //
+    touch_cfg_t cfg;
+    static const uint16_t raw[][2] = {{3870, 360}, {270, 3880}, {2000, 2000},
+                                      {100, 4000}};
+
+    touch_cfg_default(&cfg, TEST_WIDTH, TEST_HEIGHT);
+
+    for (uint32_t idx = 0; idx < sizeof(raw) / sizeof(raw[0]); ++idx)
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+
+        touch_calib_apply(&cfg.calib, raw[idx][0], raw[idx][1], &x, &y);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, (3870.0f - raw[idx][0]) / 15.0f, x);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, (raw[idx][1] - 360.0f) / 11.0f, y);
+    }
+}   /* test_default_calib() */
+
+static void
+test_calib_solve (void)
+{
+    // A rotated, skewed panel: three targets must recover the matrix.
+    //
+    const touch_calib_t truth = {0.05f, -0.012f, 12.0f, 0.008f, 0.07f, -30.0f};
+    const float raw[3][2] = {{400.0f, 500.0f}, {3600.0f, 700.0f},
+                             {1800.0f, 3500.0f}};
+    float screen[3][2];
+    touch_calib_t calib;
+
+    for (uint32_t idx = 0; idx < 3; ++idx)
+    {
+        touch_calib_apply(&truth, raw[idx][0], raw[idx][1], &screen[idx][0],
+                          &screen[idx][1]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(1, touch_calib_solve(&calib, raw, screen));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, truth.a, calib.a);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, truth.b, calib.b);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, truth.c, calib.c);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, truth.d, calib.d);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, truth.e, calib.e);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, truth.f, calib.f);
+
+    // Three targets on a line give no solution.
+    //
+    const float line[3][2] = {{100.0f, 100.0f}, {200.0f, 200.0f},
+                              {300.0f, 300.0f}};
+
+    TEST_ASSERT_EQUAL_UINT8(0, touch_calib_solve(&calib, line, screen));
+}   /* test_calib_solve() */
+
+static void
+test_filter (void)
+{
+    touch_cfg_t cfg;
+    touch_filter_t filter;
+    int16_t x = 0;
+    int16_t y = 0;
+
+    touch_cfg_default(&cfg, TEST_WIDTH, TEST_HEIGHT);
+    touch_filter_init(&filter, &cfg);
+
+    // A still finger settles on its calibrated point...
+    //
+    for (uint32_t idx = 0; idx < 200; ++idx)
+    {
+        touch_filter_push(&filter, 2370, 1460, TEST_DT);
+    }
+
+    TEST_ASSERT_TRUE(filter.b_started);
+    TEST_ASSERT_INT16_WITHIN(1, 100, filter.x);
+    TEST_ASSERT_INT16_WITHIN(1, 100, filter.y);
+
+    // ...and a single-sample spike does not move it.
+    //
+    x = filter.x;
+    y = filter.y;
+    touch_filter_push(&filter, 100, 4000, TEST_DT);
+    touch_filter_push(&filter, 2370, 1460, TEST_DT);
+    TEST_ASSERT_INT16_WITHIN(1, x, filter.x);
+    TEST_ASSERT_INT16_WITHIN(1, y, filter.y);
+
+    touch_filter_reset(&filter);
+    TEST_ASSERT_FALSE(filter.b_started);
+}   /* test_filter() */
+
+static void
+test_trace_quality (void)
+{
+    static touch_sample_t trace[1500];
+    touch_cfg_t cfg;
+    touch_bench_t result;
+
+    touch_cfg_default(&cfg, TEST_WIDTH, TEST_HEIGHT);
+    touch_trace_synth(trace, 1500, &cfg.calib, TEST_DT, 1.5f);
+    touch_bench(trace, 1500, &cfg, TEST_DT, &result);
+
+    printf("touch: latency %.1f ms, jitter %.2f px\n",
+           (double) result.latency_ms, (double) result.jitter_px);
+    TEST_ASSERT_TRUE(result.jitter_px < 1.5f);
+    TEST_ASSERT_TRUE(result.latency_ms < 40.0f);
+}   /* test_trace_quality() */
+
+static void
+bench_calib_apply (void * p_ctx, uint32_t iters)
+{
+    const touch_calib_t * p_calib = (const touch_calib_t *) p_ctx;
+    volatile float sink = 0.0f;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+
+        touch_calib_apply(p_calib, (float) (idx & 4095U),
+                          (float) ((idx >> 3) & 4095U), &x, &y);
+        sink = sink + x + y;
+    }
+}   /* bench_calib_apply() */
+
+static void
+bench_filter_push (void * p_ctx, uint32_t iters)
+{
+    touch_filter_t * p_filter = (touch_filter_t *) p_ctx;
+
+    for (uint32_t idx = 0; idx < iters; ++idx)
+    {
+        touch_filter_push(p_filter, (uint16_t) (2000 + (idx & 63U)),
+                          (uint16_t) (1500 + ((idx >> 2) & 63U)), TEST_DT);
+    }
+}   /* bench_filter_push() */
+
+static void
+test_bench (void)
+{
+    touch_cfg_t cfg;
+    touch_filter_t filter;
+    perf_bench_t apply;
+    perf_bench_t push;
+
+    touch_cfg_default(&cfg, TEST_WIDTH, TEST_HEIGHT);
+    touch_filter_init(&filter, &cfg);
+
+    perf_bench_run("touch_calib_apply", bench_calib_apply, &cfg.calib, 21,
+                   &apply);
+    perf_bench_run("touch_filter_push", bench_filter_push, &filter, 21,
+                   &push);
+
+    TEST_ASSERT_TRUE(apply.median_ns > 0.0f);
+    TEST_ASSERT_TRUE(push.median_ns > 0.0f);
+}   /* test_bench() */
+
+int
+main (void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_default_calib);
+    RUN_TEST(test_calib_solve);
+    RUN_TEST(test_filter);
+    RUN_TEST(test_trace_quality);
+    RUN_TEST(test_bench);
+
+    return (UNITY_END());
+}   /* main() */